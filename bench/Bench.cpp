@@ -0,0 +1,158 @@
+/*
+	Copyright 2010 Warzone 2100 Project
+
+	This file is part of WMIT.
+
+	WMIT is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	WMIT is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with WMIT.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "Bench.hpp"
+
+#include <cstdio>
+#include <cstring>
+#include <algorithm>
+#include <vector>
+#include <iostream>
+
+#include <fstream>
+#include <string>
+
+#ifdef _WIN32
+#  include <windows.h>
+#  include <psapi.h>
+#else
+#  include <sys/time.h>
+#  include <sys/resource.h>
+#endif
+
+static double nowMs()
+{
+#ifdef _WIN32
+	LARGE_INTEGER freq, count;
+	QueryPerformanceFrequency(&freq);
+	QueryPerformanceCounter(&count);
+	return count.QuadPart * 1000. / freq.QuadPart;
+#else
+	timeval tv;
+	gettimeofday(&tv, NULL);
+	return tv.tv_sec * 1000. + tv.tv_usec / 1000.;
+#endif
+}
+
+BenchTimer::BenchTimer()
+{
+	restart();
+}
+
+void BenchTimer::restart()
+{
+	benchResetPeakMemory();
+	m_start = nowMs();
+}
+
+double BenchTimer::elapsedMs() const
+{
+	return nowMs() - m_start;
+}
+
+void benchResetPeakMemory()
+{
+#ifdef __linux__
+	// "5" resets the VmHWM peak to the current RSS (Linux 4.0+)
+	std::ofstream clearRefs("/proc/self/clear_refs");
+	clearRefs << "5";
+#endif
+}
+
+double benchPeakMemoryMB()
+{
+#if defined(_WIN32)
+	PROCESS_MEMORY_COUNTERS counters;
+	if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+	{
+		return counters.PeakWorkingSetSize / (1024. * 1024.);
+	}
+	return 0;
+#else
+#  ifdef __linux__
+	std::ifstream status("/proc/self/status");
+	std::string key;
+	double kb;
+
+	while (status >> key)
+	{
+		if (key == "VmHWM:" && status >> kb)
+		{
+			return kb / 1024.;
+		}
+	}
+#  endif
+	rusage usage;
+	getrusage(RUSAGE_SELF, &usage);
+#  ifdef __APPLE__
+	return usage.ru_maxrss / (1024. * 1024.);
+#  else
+	return usage.ru_maxrss / 1024.;
+#  endif
+#endif
+}
+
+void benchHeader(const std::string& suite)
+{
+	std::cout << "\n== " << suite << " ==\n";
+	std::printf("%-40s %10s %12s %10s  %s\n", "case", "size", "time (ms)", "peak (MB)", "notes");
+}
+
+void benchReport(const std::string& name, unsigned size, double ms, const std::string& note)
+{
+	std::printf("%-40s %10u %12.3f %10.1f  %s\n", name.c_str(), size, ms, benchPeakMemoryMB(), note.c_str());
+	std::fflush(stdout);
+}
+
+int main(int argc, char *argv[])
+{
+	// optional suite filter: wmit-bench [weld|pie|wzmb|parse|kernels|scene|formats [fixture files...]]
+	const char* only = argc > 1 ? argv[1] : NULL;
+
+	if (!only || !std::strcmp(only, "weld"))
+	{
+		runWeldBenchmarks();
+	}
+	if (!only || !std::strcmp(only, "pie"))
+	{
+		runPieExportBenchmarks();
+	}
+	if (!only || !std::strcmp(only, "wzmb"))
+	{
+		runWZMLoadBenchmarks();
+	}
+	if (!only || !std::strcmp(only, "parse"))
+	{
+		runParseBenchmarks();
+	}
+	if (!only || !std::strcmp(only, "kernels"))
+	{
+		runKernelBenchmarks();
+	}
+	if (!only || !std::strcmp(only, "scene"))
+	{
+		runSceneBenchmarks();
+	}
+	if (!only || !std::strcmp(only, "formats"))
+	{
+		runFormatBenchmarks(std::vector<std::string>(argv + std::min(argc, 2), argv + argc));
+	}
+
+	return 0;
+}
@@ -0,0 +1,56 @@
+/*
+	Copyright 2010 Warzone 2100 Project
+
+	This file is part of WMIT.
+
+	WMIT is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	WMIT is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with WMIT.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef BENCH_HPP
+#define BENCH_HPP
+
+#include <string>
+#include <vector>
+
+/// Wall clock timer, (re)starting it also restarts peak memory tracking
+class BenchTimer
+{
+public:
+	BenchTimer();
+
+	void restart();
+	double elapsedMs() const;
+private:
+	double m_start;
+};
+
+/**
+  * Peak resident memory of the process. Only Linux can reset the peak, so
+  * elsewhere this is the peak of the whole run so far.
+  */
+void benchResetPeakMemory();
+double benchPeakMemoryMB();
+
+void benchHeader(const std::string& suite);
+void benchReport(const std::string& name, unsigned size, double ms, const std::string& note = std::string());
+
+// Suites
+void runWeldBenchmarks();
+void runPieExportBenchmarks();
+void runWZMLoadBenchmarks();
+void runParseBenchmarks();
+void runFormatBenchmarks(const std::vector<std::string>& fixtures);
+void runKernelBenchmarks();
+void runSceneBenchmarks();
+
+#endif // BENCH_HPP
@@ -0,0 +1,68 @@
+/*
+	Copyright 2010 Warzone 2100 Project
+
+	This file is part of WMIT.
+
+	WMIT is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	WMIT is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with WMIT.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include "BenchData.hpp"
+
+#include <cmath>
+
+/*
+ * Wavy n*n grid, 2 triangles per quad, in OBJ form (1 based, shared v/vt/vn
+ * entries), interior vertices are referenced by 6 triangle corners.
+ */
+void makeGrid(unsigned n, std::vector<OBJTri>& faces, std::vector<OBJVertex>& verts,
+	      std::vector<OBJUV>& uvs, std::vector<OBJVertex>& normals)
+{
+	faces.clear(), verts.clear(), uvs.clear(), normals.clear();
+
+	for (unsigned j = 0; j < n; ++j)
+	{
+		for (unsigned i = 0; i < n; ++i)
+		{
+			const float x = i * 2.f, z = j * 2.f;
+			const float y = 8.f * std::sin(x * 0.05f) * std::cos(z * 0.07f);
+			OBJUV uv;
+			uv.u() = i / float(n - 1);
+			uv.v() = j / float(n - 1);
+
+			verts.push_back(OBJVertex(x, y, z));
+			uvs.push_back(uv);
+			normals.push_back(OBJVertex(0.f, 1.f, 0.f));
+		}
+	}
+
+	for (unsigned j = 0; j + 1 < n; ++j)
+	{
+		for (unsigned i = 0; i + 1 < n; ++i)
+		{
+			const unsigned quad[4] = {j * n + i + 1, j * n + i + 2, (j + 1) * n + i + 2, (j + 1) * n + i + 1};
+			const unsigned tris[2][3] = {{0, 1, 2}, {0, 2, 3}};
+
+			for (unsigned t = 0; t < 2; ++t)
+			{
+				OBJTri tri;
+				for (unsigned k = 0; k < 3; ++k)
+				{
+					tri.tri[k] = quad[tris[t][k]];
+					tri.uvs[k] = quad[tris[t][k]];
+					tri.nrm[k] = quad[tris[t][k]];
+				}
+				faces.push_back(tri);
+			}
+		}
+	}
+}
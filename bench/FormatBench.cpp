@@ -0,0 +1,372 @@
+/*
+	Copyright 2010 Warzone 2100 Project
+
+	This file is part of WMIT.
+
+	WMIT is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	WMIT is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with WMIT.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include "Bench.hpp"
+#include "BenchData.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <sstream>
+#include <vector>
+
+#include "Mesh.hpp"
+#include "WZM.hpp"
+#include "Pie.hpp"
+#include "ModelIO.hpp"
+#include "VertexCache.hpp"
+#include "Overdraw.hpp"
+#include "Meshlet.hpp"
+
+// PIE indices are 16 bit signed, so synthetic models are tiled into meshes of this size
+static const unsigned maxTileTriangles = 20000;
+
+// Exposes the protected import steps
+class BenchMesh : public Mesh
+{
+public:
+	BenchMesh(const Mesh& mesh): Mesh(mesh) {}
+
+	using Mesh::recalculateBoundData;
+
+	/// True if the meshlets hold every triangle in index order, as the viewer's IBO needs
+	bool keepsIndexOrder(const MeshletSet& set) const
+	{
+		const std::vector<IndexedTri>& tris = m_indexArray.get();
+		std::vector<Meshlet>::const_iterator it;
+		GLuint i;
+
+		for (it = set.meshlets.begin(); it != set.meshlets.end(); ++it)
+		{
+			for (i = 0; i < it->triangleCount; ++i)
+			{
+				const IndexedTri tri = set.triangle(*it, i);
+				const IndexedTri& want = tris[it->triangleOffset + i];
+
+				if (tri.a() != want.a() || tri.b() != want.b() || tri.c() != want.c())
+				{
+					return false;
+				}
+			}
+		}
+		return set.triangles.size() == tris.size() * 3;
+	}
+};
+
+static unsigned triangleCount(WZM& model)
+{
+	unsigned count = 0;
+
+	for (int i = 0; i < model.meshes(); ++i)
+	{
+		count += model.getMesh(i).indices();
+	}
+	return count;
+}
+
+/// Model of roughly the given triangle count, made of grid tiles
+static void makeModel(unsigned triangles, WZM& model)
+{
+	std::vector<OBJTri> faces;
+	std::vector<OBJVertex> verts, normals;
+	std::vector<OBJUV> uvs;
+
+	const unsigned tiles = std::max(1u, triangles / maxTileTriangles);
+	const unsigned n = static_cast<unsigned>(std::sqrt(triangles / tiles / 2.)) + 1;
+
+	makeGrid(n, faces, verts, uvs, normals);
+	for (unsigned i = 0; i < tiles; ++i)
+	{
+		Mesh mesh;
+		std::ostringstream name;
+
+		mesh.importFromOBJ(faces, verts, uvs, normals);
+		name << "tile" << i;
+		mesh.setName(name.str());
+		mesh.addConnector(WZMConnector(1.f, 2.f, 3.f));
+		model.addMesh(mesh);
+	}
+	model.setTextureName(WZM_TEX_DIFFUSE, "page-1.png");
+}
+
+static void runModelCases(WZM& source)
+{
+	const unsigned size = triangleCount(source);
+	BenchTimer timer;
+	double ms;
+	int i;
+
+	// WZM text
+	std::ostringstream wzmOut;
+	timer.restart();
+	source.write(wzmOut);
+	benchReport("WZM::write", size, timer.elapsedMs());
+
+	{
+		std::istringstream wzmIn(wzmOut.str());
+		WZM wzm;
+		timer.restart();
+		wzm.read(wzmIn);
+		benchReport("WZM::read", size, timer.elapsedMs());
+	}
+
+	// OBJ
+	std::ostringstream objOut;
+	timer.restart();
+	source.exportToOBJ(objOut);
+	benchReport("WZM::exportToOBJ", size, timer.elapsedMs());
+
+	{
+		std::istringstream objIn(objOut.str());
+		WZM obj;
+		timer.restart();
+		obj.importFromOBJ(objIn);
+		benchReport("WZM::importFromOBJ", size, timer.elapsedMs());
+	}
+
+	// PIE
+	timer.restart();
+	Pie3Model p3 = source;
+	benchReport("WZM -> Pie3Model", size, timer.elapsedMs());
+
+	std::ostringstream pieOut;
+	timer.restart();
+	p3.write(pieOut);
+	benchReport("Pie3Model::write", size, timer.elapsedMs());
+
+	{
+		std::istringstream pieIn(pieOut.str());
+		Pie3Model pie;
+		timer.restart();
+		pie.read(pieIn);
+		benchReport("Pie3Model::read", size, timer.elapsedMs());
+	}
+
+	{
+		timer.restart();
+		WZM fromPie(p3);
+		benchReport("WZM(const Pie3Model&)", size, timer.elapsedMs());
+	}
+
+	{
+		Pie2Model p2 = p3;
+		timer.restart();
+		Pie3Model upConverted(p2);
+		benchReport("Pie2 -> Pie3 upconversion", size, timer.elapsedMs());
+	}
+
+	// export snapshot: geometry is shared, only what the transform touches gets copied
+	{
+		timer.restart();
+		WZM snapshot = source;
+		benchReport("WZM copy (shared)", size, timer.elapsedMs());
+
+		timer.restart();
+		snapshot.scale(2.f, 2.f, 2.f);
+		benchReport("WZM::scale (detach)", size, timer.elapsedMs());
+	}
+
+	// Mesh processing, copies are made outside the timed part (but
+	// share geometry with source, so the first write also detaches)
+	std::vector<BenchMesh> copies;
+	for (i = 0; i < source.meshes(); ++i)
+	{
+		copies.push_back(BenchMesh(source.getMesh(i)));
+	}
+
+	timer.restart();
+	for (i = 0; i < source.meshes(); ++i)
+	{
+		copies[i].recalculateBoundData();
+	}
+	ms = timer.elapsedMs();
+	benchReport("Mesh::recalculateBoundData", size, ms);
+
+	timer.restart();
+	for (i = 0; i < source.meshes(); ++i)
+	{
+		copies[i].recalculateTangents();
+	}
+	ms = timer.elapsedMs();
+	benchReport("Mesh::recalculateTangents", size, ms);
+
+	{
+		VertexCacheStats before, after;
+		std::ostringstream note;
+
+		for (i = 0; i < source.meshes(); ++i)
+		{
+			before += copies[i].vertexCacheStats();
+		}
+		timer.restart();
+		for (i = 0; i < source.meshes(); ++i)
+		{
+			copies[i].optimizeForsyth();
+		}
+		ms = timer.elapsedMs();
+		for (i = 0; i < source.meshes(); ++i)
+		{
+			after += copies[i].vertexCacheStats();
+		}
+
+		note.precision(3);
+		note << std::fixed << "ACMR " << before.acmr() << " -> " << after.acmr();
+		benchReport("Mesh::optimizeForsyth", size, ms, note.str());
+	}
+
+	{
+		OverdrawStats before, after;
+		VertexCacheStats cache;
+		std::ostringstream note;
+
+		for (i = 0; i < source.meshes(); ++i)
+		{
+			before += copies[i].overdrawStats();
+		}
+		timer.restart();
+		for (i = 0; i < source.meshes(); ++i)
+		{
+			copies[i].optimizeOverdraw();
+		}
+		ms = timer.elapsedMs();
+		for (i = 0; i < source.meshes(); ++i)
+		{
+			after += copies[i].overdrawStats();
+			cache += copies[i].vertexCacheStats();
+		}
+
+		note.precision(3);
+		note << std::fixed << "overdraw " << before.overdraw() << " -> " << after.overdraw()
+		     << ", ACMR " << cache.acmr();
+		benchReport("Mesh::optimizeOverdraw", size, ms, note.str());
+	}
+
+	// grown clusters for export stats, index order runs for the viewer's IBO
+	for (int keepOrder = 0; keepOrder < 2; ++keepOrder)
+	{
+		MeshletStats stats;
+		MeshletSet set;
+		std::ostringstream note;
+		bool ordered = true;
+
+		timer.restart();
+		for (i = 0; i < source.meshes(); ++i)
+		{
+			copies[i].buildMeshlets(set, keepOrder != 0);
+			stats += meshletStats(set);
+			ordered = ordered && copies[i].keepsIndexOrder(set);
+		}
+		ms = timer.elapsedMs();
+
+		note.precision(1);
+		note << std::fixed << stats.meshlets << " clusters, " << stats.verticesPerMeshlet() << "/"
+		     << stats.trianglesPerMeshlet() << " vertices/triangles avg";
+		if (keepOrder)
+		{
+			note << (ordered ? ", index order kept" : ", INDEX ORDER CHANGED");
+		}
+		benchReport(keepOrder ? "Mesh::buildMeshlets (runs)" : "Mesh::buildMeshlets", size, ms, note.str());
+	}
+
+	// the same transform pass over both vertex layouts
+	timer.restart();
+	for (i = 0; i < source.meshes(); ++i)
+	{
+		copies[i].mirrorUsingLocalCenter(0);
+	}
+	ms = timer.elapsedMs();
+	benchReport("Mesh::mirror (separate)", size, ms);
+
+	timer.restart();
+	for (i = 0; i < source.meshes(); ++i)
+	{
+		copies[i].setLayout(WZM_MESH_LAYOUT_INTERLEAVED);
+	}
+	ms = timer.elapsedMs();
+	benchReport("Mesh::setLayout(interleaved)", size, ms);
+
+	timer.restart();
+	for (i = 0; i < source.meshes(); ++i)
+	{
+		copies[i].mirrorUsingLocalCenter(0);
+	}
+	ms = timer.elapsedMs();
+	benchReport("Mesh::mirror (interleaved)", size, ms);
+
+	{
+		size_t before = 0, after = 0;
+		std::ostringstream note;
+
+		for (i = 0; i < source.meshes(); ++i)
+		{
+			before += copies[i].indices();
+		}
+		timer.restart();
+		for (i = 0; i < source.meshes(); ++i)
+		{
+			copies[i].simplify(copies[i].indices() / 4);
+		}
+		ms = timer.elapsedMs();
+		for (i = 0; i < source.meshes(); ++i)
+		{
+			after += copies[i].indices();
+		}
+
+		note << before << " -> " << after << " triangles";
+		benchReport("Mesh::simplify (25%)", size, ms, note.str());
+	}
+}
+
+void runFormatBenchmarks(const std::vector<std::string>& fixtures)
+{
+	static const unsigned sizes[] = {1000, 10000, 100000, 1000000};
+	std::vector<std::string>::const_iterator it;
+
+	// fixture files replace the synthetic models
+	if (!fixtures.empty())
+	{
+		for (it = fixtures.begin(); it != fixtures.end(); ++it)
+		{
+			WZM model;
+
+			benchHeader("Formats: " + *it + " (size = triangles)");
+
+			BenchTimer timer;
+			if (!loadModel(*it, model))
+			{
+				std::cerr << "runFormatBenchmarks - Can't load fixture " << *it << std::endl;
+				continue;
+			}
+			benchReport("loadModel", triangleCount(model), timer.elapsedMs());
+			runModelCases(model);
+		}
+		return;
+	}
+
+	for (unsigned s = 0; s < sizeof(sizes) / sizeof(sizes[0]); ++s)
+	{
+		WZM model;
+
+		makeModel(sizes[s], model);
+
+		std::ostringstream title;
+		title << "Formats: synthetic " << model.meshes() << " mesh model (size = triangles)";
+		benchHeader(title.str());
+		runModelCases(model);
+	}
+}
@@ -0,0 +1,190 @@
+/*
+	Copyright 2010 Warzone 2100 Project
+
+	This file is part of WMIT.
+
+	WMIT is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	WMIT is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with WMIT.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include "Bench.hpp"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#include "VertexKernels.hpp"
+
+// passes per timed case, so the small sizes still measure something
+static const unsigned passes = 20;
+
+static void fillFloats(std::vector<GLfloat>& data)
+{
+	std::srand(42);
+	for (size_t i = 0; i < data.size(); ++i)
+	{
+		data[i] = (std::rand() / (GLfloat)RAND_MAX - 0.5f) * 100.f;
+	}
+}
+
+static std::string speedupNote(double ms, double scalarMs)
+{
+	char note[32];
+
+	if (ms <= 0.)
+	{
+		return std::string();
+	}
+	std::sprintf(note, "%.2fx scalar", scalarMs / ms);
+	return note;
+}
+
+// stride is in floats, 3 for the separate position array, 12 for interleaved records
+static void runLayoutCases(unsigned vertices, unsigned stride, const char* layout)
+{
+	const std::vector<const VertexKernels*> kernels = availableVertexKernels();
+	const GLfloat mul[4] = {1.001f, 0.999f, -1.f, 1.f};
+	const GLfloat add[4] = {0.5f, -0.5f, 2.f, 0.f};
+	GLfloat matrix[16] = {0.f};
+	std::vector<GLfloat> data(vertices * stride);
+	double scalarMs[4] = {0., 0., 0., 0.};
+	char name[64];
+	VertexBounds bounds;
+	BenchTimer timer;
+	double ms;
+
+	// small rotation around z plus a translation
+	matrix[0] = 0.999f; matrix[1] = 0.01f;
+	matrix[4] = -0.01f; matrix[5] = 0.999f;
+	matrix[10] = 1.f;
+	matrix[12] = 0.1f; matrix[13] = -0.1f; matrix[15] = 1.f;
+
+	for (size_t k = 0; k < kernels.size(); ++k)
+	{
+		const VertexKernels& kern = *kernels[k];
+		const size_t bytes = stride * sizeof(GLfloat);
+
+		fillFloats(data);
+
+		timer.restart();
+		for (unsigned p = 0; p < passes; ++p)
+		{
+			kern.scale(&data[0], vertices, bytes, 0x7, mul);
+		}
+		ms = timer.elapsedMs();
+		std::sprintf(name, "scale (%s, %s)", layout, kern.name);
+		benchReport(name, vertices, ms, speedupNote(ms, k ? scalarMs[0] : ms));
+		if (!k) scalarMs[0] = ms;
+
+		timer.restart();
+		for (unsigned p = 0; p < passes; ++p)
+		{
+			kern.scaleAdd(&data[0], vertices, bytes, 0x4, mul, add);
+		}
+		ms = timer.elapsedMs();
+		std::sprintf(name, "mirror (%s, %s)", layout, kern.name);
+		benchReport(name, vertices, ms, speedupNote(ms, k ? scalarMs[1] : ms));
+		if (!k) scalarMs[1] = ms;
+
+		timer.restart();
+		for (unsigned p = 0; p < passes; ++p)
+		{
+			kern.transform(&data[0], vertices, bytes, 0x7, matrix, 1.f);
+		}
+		ms = timer.elapsedMs();
+		std::sprintf(name, "transform (%s, %s)", layout, kern.name);
+		benchReport(name, vertices, ms, speedupNote(ms, k ? scalarMs[2] : ms));
+		if (!k) scalarMs[2] = ms;
+
+		timer.restart();
+		for (unsigned p = 0; p < passes; ++p)
+		{
+			kern.bounds(&data[0], vertices, bytes, bounds);
+		}
+		ms = timer.elapsedMs();
+		std::sprintf(name, "bounds (%s, %s)", layout, kern.name);
+		benchReport(name, vertices, ms, speedupNote(ms, k ? scalarMs[3] : ms));
+		if (!k) scalarMs[3] = ms;
+	}
+}
+
+static bool sameBounds(const VertexBounds& lhs, const VertexBounds& rhs)
+{
+	return !std::memcmp(lhs.min, rhs.min, sizeof(lhs.min)) && !std::memcmp(lhs.max, rhs.max, sizeof(lhs.max)) &&
+		!std::memcmp(lhs.sum, rhs.sum, sizeof(lhs.sum)) &&
+		!std::memcmp(lhs.minIndex, rhs.minIndex, sizeof(lhs.minIndex)) &&
+		!std::memcmp(lhs.maxIndex, rhs.maxIndex, sizeof(lhs.maxIndex));
+}
+
+/// Every implementation has to give the scalar results bit for bit, tails and odd strides included
+static void checkKernels()
+{
+	static const unsigned counts[] = {1, 2, 3, 4, 7, 8, 9, 15, 16, 17, 23, 24, 25, 33, 1001};
+	static const unsigned strides[] = {3, 4, 5, 12};
+	const std::vector<const VertexKernels*> kernels = availableVertexKernels();
+	const GLfloat mul[4] = {1.001f, 0.999f, -1.f, 1.f};
+	const GLfloat add[4] = {0.5f, -0.5f, 2.f, 0.f};
+	const GLfloat matrix[16] = {0.999f, 0.01f, 0.f, 0.f, -0.01f, 0.999f, 0.f, 0.f,
+				    0.f, 0.f, 1.f, 0.f, 0.1f, -0.1f, 0.f, 1.f};
+	unsigned mismatches = 0;
+
+	for (size_t k = 1; k < kernels.size(); ++k)
+	{
+		for (unsigned c = 0; c < sizeof(counts) / sizeof(counts[0]); ++c)
+		{
+			for (unsigned s = 0; s < sizeof(strides) / sizeof(strides[0]); ++s)
+			{
+				const size_t bytes = strides[s] * sizeof(GLfloat);
+				std::vector<GLfloat> data(counts[c] * strides[s]), expected, result;
+				VertexBounds expectedBounds, bounds;
+
+				fillFloats(data);
+				// ties, the first extreme has to win everywhere
+				data[data.size() / 2] = data[0];
+
+				kernels[0]->bounds(&data[0], counts[c], bytes, expectedBounds);
+				kernels[k]->bounds(&data[0], counts[c], bytes, bounds);
+				mismatches += !sameBounds(expectedBounds, bounds);
+
+				expected = result = data;
+				kernels[0]->scaleAdd(&expected[0], counts[c], bytes, 0x5, mul, add);
+				kernels[k]->scaleAdd(&result[0], counts[c], bytes, 0x5, mul, add);
+				kernels[0]->scale(&expected[0], counts[c], bytes, 0x7, mul);
+				kernels[k]->scale(&result[0], counts[c], bytes, 0x7, mul);
+				kernels[0]->transform(&expected[0], counts[c], bytes, 0x7, matrix, 1.f);
+				kernels[k]->transform(&result[0], counts[c], bytes, 0x7, matrix, 1.f);
+				mismatches += std::memcmp(&expected[0], &result[0], data.size() * sizeof(GLfloat)) != 0;
+			}
+		}
+	}
+
+	std::printf("vertex kernel results: %s\n", mismatches ? "MISMATCH against scalar" : "all match scalar");
+}
+
+void runKernelBenchmarks()
+{
+	static const unsigned sizes[] = {10000, 100000, 1000000};
+
+	std::printf("\nvertex kernels picked for this CPU: %s\n", vertexKernels().name);
+	checkKernels();
+
+	for (unsigned s = 0; s < sizeof(sizes) / sizeof(sizes[0]); ++s)
+	{
+		char title[96];
+		std::sprintf(title, "Vertex kernels, %u passes (size = vertices)", passes);
+		benchHeader(title);
+
+		runLayoutCases(sizes[s], 3, "separate");
+		runLayoutCases(sizes[s], 12, "interleaved");
+	}
+}
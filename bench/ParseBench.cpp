@@ -0,0 +1,133 @@
+/*
+	Copyright 2010 Warzone 2100 Project
+
+	This file is part of WMIT.
+
+	WMIT is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	WMIT is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with WMIT.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "Bench.hpp"
+#include "BenchData.hpp"
+
+#include <cstdio>
+#include <sstream>
+#include <vector>
+
+#include "Mesh.hpp"
+#include "WZM.hpp"
+#include "Pie.hpp"
+#include "TextLexer.hpp"
+
+static std::string throughput(size_t bytes, double ms)
+{
+	char buf[64];
+	std::snprintf(buf, sizeof(buf), "%.1f MB/s", ms > 0 ? bytes / (ms * 1000.) : 0.);
+	return buf;
+}
+
+void runParseBenchmarks()
+{
+	static const unsigned sizes[] = {64, 128, 230};
+
+	std::vector<OBJTri> faces;
+	std::vector<OBJVertex> verts, normals;
+	std::vector<OBJUV> uvs;
+
+	benchHeader("Text parsing throughput (size = triangles)");
+
+	for (unsigned s = 0; s < sizeof(sizes) / sizeof(sizes[0]); ++s)
+	{
+		WZM source;
+		Mesh mesh;
+
+		makeGrid(sizes[s], faces, verts, uvs, normals);
+		mesh.importFromOBJ(faces, verts, uvs, normals);
+		mesh.setName("grid");
+		source.addMesh(mesh);
+		source.setTextureName(WZM_TEX_DIFFUSE, "page-1.png");
+
+		std::ostringstream wzmOut, pieOut, objOut;
+		source.write(wzmOut);
+		Pie3Model(source).write(pieOut);
+		source.exportToOBJ(objOut);
+
+		const std::string wzmText = wzmOut.str();
+		const std::string pieText = pieOut.str();
+		const std::string objText = objOut.str();
+
+		// raw number lexing, istream vs TextLexer, over the same text
+		{
+			std::istringstream in(wzmText);
+			std::string skip;
+			unsigned count = 0;
+			float f;
+
+			BenchTimer timer;
+			while (in >> skip)
+			{
+				std::istringstream num(skip);
+				if (num >> f)
+					++count;
+			}
+			benchReport("istream tokens (baseline)", faces.size(), timer.elapsedMs(),
+				    throughput(wzmText.size(), timer.elapsedMs()));
+
+			TextLexer lex(wzmText.data(), wzmText.data() + wzmText.size());
+			TextToken tok;
+			unsigned lexCount = 0;
+
+			timer.restart();
+			while (!lex.atEnd())
+			{
+				lex >> tok;
+				TextLexer num(tok.ptr, tok.ptr + tok.len);
+				if (!(num >> f).fail() && num.atEnd())
+					++lexCount;
+			}
+			std::string note = throughput(wzmText.size(), timer.elapsedMs());
+			benchReport("TextLexer tokens", faces.size(), timer.elapsedMs(),
+				    lexCount == count ? note : note + ", NUMBER COUNT MISMATCH");
+		}
+
+		{
+			std::istringstream in(wzmText);
+			WZM model;
+
+			BenchTimer timer;
+			const bool ok = model.read(in);
+			benchReport("WZM::read", faces.size(), timer.elapsedMs(),
+				    ok ? throughput(wzmText.size(), timer.elapsedMs()) : "READ FAILED");
+		}
+
+		{
+			std::istringstream in(pieText);
+			Pie3Model model;
+
+			BenchTimer timer;
+			const bool ok = model.read(in);
+			benchReport("Pie3Model::read", faces.size(), timer.elapsedMs(),
+				    ok ? throughput(pieText.size(), timer.elapsedMs()) : "READ FAILED");
+		}
+
+		{
+			std::istringstream in(objText);
+			WZM model;
+
+			BenchTimer timer;
+			const bool ok = model.importFromOBJ(in);
+			benchReport("WZM::importFromOBJ", faces.size(), timer.elapsedMs(),
+				    ok ? throughput(objText.size(), timer.elapsedMs()) : "IMPORT FAILED");
+		}
+	}
+}
@@ -0,0 +1,131 @@
+/*
+	Copyright 2010 Warzone 2100 Project
+
+	This file is part of WMIT.
+
+	WMIT is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	WMIT is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with WMIT.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "Bench.hpp"
+#include "BenchData.hpp"
+
+#include <algorithm>
+#include <sstream>
+#include <vector>
+
+#include "Generic.hpp"
+#include "Mesh.hpp"
+#include "Pie.hpp"
+
+// The find_if Mesh::operator Pie3Level() used before SpatialHash, kept for comparison
+static void legacyPoints(const std::vector<Pie3Vertex>& corners, std::vector<Pie3Vertex>& points,
+			 std::vector<unsigned>& indices)
+{
+	typedef Pie3Vertex::equal_wEps equals;
+	std::vector<Pie3Vertex>::iterator itPV;
+
+	points.clear();
+	indices.clear();
+	for (std::vector<Pie3Vertex>::const_iterator it = corners.begin(); it != corners.end(); ++it)
+	{
+		mybinder1st<equals> compare(*it);
+
+		itPV = std::find_if(points.begin(), points.end(), compare);
+		if (itPV == points.end())
+		{
+			indices.push_back(points.size());
+			points.push_back(*it);
+		}
+		else
+		{
+			indices.push_back(std::distance(points.begin(), itPV));
+		}
+	}
+}
+
+static void hashPoints(const std::vector<Pie3Vertex>& corners, std::vector<Pie3Vertex>& points,
+		       std::vector<unsigned>& indices)
+{
+	SpatialHash<Pie3Vertex, Pie3VertexHashTraits> hash;
+
+	indices.clear();
+	for (std::vector<Pie3Vertex>::const_iterator it = corners.begin(); it != corners.end(); ++it)
+	{
+		indices.push_back(hash.insert(*it).first);
+	}
+	points = hash.values();
+}
+
+static bool samePoints(const std::vector<Pie3Vertex>& lhs, const std::vector<Pie3Vertex>& rhs)
+{
+	if (lhs.size() != rhs.size())
+		return false;
+	for (unsigned i = 0; i < lhs.size(); ++i)
+	{
+		if (!(lhs[i] == rhs[i]))
+			return false;
+	}
+	return true;
+}
+
+void runPieExportBenchmarks()
+{
+	static const unsigned sizes[] = {32, 64, 128, 181, 230};
+	static const unsigned legacyMaxSize = 128;
+
+	std::vector<OBJTri> faces;
+	std::vector<OBJVertex> verts, normals;
+	std::vector<OBJUV> uvs;
+	std::vector<Pie3Vertex> corners, legacyPts, hashPts;
+	std::vector<unsigned> legacyIndices, hashIndices;
+
+	benchHeader("PIE point reconstruction (size = triangles)");
+
+	for (unsigned s = 0; s < sizeof(sizes) / sizeof(sizes[0]); ++s)
+	{
+		makeGrid(sizes[s], faces, verts, uvs, normals);
+
+		corners.clear();
+		for (std::vector<OBJTri>::const_iterator it = faces.begin(); it != faces.end(); ++it)
+		{
+			for (unsigned k = 0; k < 3; ++k)
+			{
+				corners.push_back(verts[it->tri[k] - 1]);
+			}
+		}
+
+		BenchTimer timer;
+		hashPoints(corners, hashPts, hashIndices);
+		benchReport("points SpatialHash", faces.size(), timer.elapsedMs());
+
+		if (sizes[s] <= legacyMaxSize)
+		{
+			timer.restart();
+			legacyPoints(corners, legacyPts, legacyIndices);
+			benchReport("points find_if (legacy)", faces.size(), timer.elapsedMs(),
+				    legacyIndices == hashIndices && samePoints(legacyPts, hashPts) ?
+					    "identical points and polygons" : "OUTPUT MISMATCH");
+		}
+
+		Mesh mesh;
+		mesh.importFromOBJ(faces, verts, uvs, normals);
+
+		timer.restart();
+		Pie3Level p3 = mesh;
+
+		std::stringstream note;
+		note << p3.points() << " points, " << p3.polygons() << " polygons";
+		benchReport("Mesh::operator Pie3Level", faces.size(), timer.elapsedMs(), note.str());
+	}
+}
@@ -0,0 +1,120 @@
+/*
+	Copyright 2010 Warzone 2100 Project
+
+	This file is part of WMIT.
+
+	WMIT is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	WMIT is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with WMIT.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include "Bench.hpp"
+
+#include <cstdio>
+#include <vector>
+
+#include "TransformHierarchy.hpp"
+
+// passes per timed case, single updates are too quick to time alone
+static const unsigned passes = 100;
+
+/**
+  * Droid-like assemblies on a grid: a propulsion root, a body on it and
+  * two turrets on the body, each with a muzzle part.
+  */
+static void buildAssemblies(TransformHierarchy& hierarchy, unsigned assemblies)
+{
+	unsigned i;
+	int body, turret;
+
+	hierarchy.clear();
+	for (i = 0; i < assemblies; ++i)
+	{
+		const int root = hierarchy.addNode(-1, Matrix4::translation(i % 100, 0.f, i / 100));
+
+		body = hierarchy.addNode(root, Matrix4::translation(0.f, 0.1f, 0.f));
+		turret = hierarchy.addNode(body, Matrix4::translation(-0.1f, 0.2f, 0.f));
+		hierarchy.addNode(turret, Matrix4::translation(0.f, 0.f, 0.3f));
+		turret = hierarchy.addNode(body, Matrix4::translation(0.1f, 0.2f, 0.f));
+		hierarchy.addNode(turret, Matrix4::translation(0.f, 0.f, 0.3f));
+	}
+}
+
+static std::string updatedNote(size_t updated, double ms, double fullMs)
+{
+	char note[64];
+
+	if (ms <= 0.)
+	{
+		std::sprintf(note, "%u recomputed", (unsigned)updated);
+		return note;
+	}
+	std::sprintf(note, "%u recomputed, %.1fx full", (unsigned)updated, fullMs / ms);
+	return note;
+}
+
+static void runUpdateCases(unsigned assemblies)
+{
+	TransformHierarchy hierarchy;
+	BenchTimer timer;
+	size_t updated = 0;
+	double ms, fullMs;
+	unsigned p;
+
+	timer.restart();
+	buildAssemblies(hierarchy, assemblies);
+	hierarchy.update();
+	benchReport("TransformHierarchy build", hierarchy.size(), timer.elapsedMs());
+
+	timer.restart();
+	for (p = 0; p < passes; ++p)
+	{
+		hierarchy.invalidate();
+		updated = hierarchy.update();
+	}
+	fullMs = timer.elapsedMs() / passes;
+	benchReport("TransformHierarchy update, all", hierarchy.size(), fullMs, updatedNote(updated, fullMs, fullMs));
+
+	// the first assembly is the worst case, the pass runs from there to the end
+	timer.restart();
+	for (p = 0; p < passes; ++p)
+	{
+		hierarchy.setLocal(2, Matrix4::rotation(p, 0.f, 1.f, 0.f));
+		updated = hierarchy.update();
+	}
+	ms = timer.elapsedMs() / passes;
+	benchReport("TransformHierarchy update, 1 turret", hierarchy.size(), ms, updatedNote(updated, ms, fullMs));
+
+	timer.restart();
+	for (p = 0; p < passes; ++p)
+	{
+		hierarchy.setLocal(0, Matrix4::translation(0.f, 0.f, p * 0.01f));
+		updated = hierarchy.update();
+	}
+	ms = timer.elapsedMs() / passes;
+	benchReport("TransformHierarchy update, 1 root", hierarchy.size(), ms, updatedNote(updated, ms, fullMs));
+
+	timer.restart();
+	for (p = 0; p < passes; ++p)
+	{
+		updated = hierarchy.update();
+	}
+	ms = timer.elapsedMs() / passes;
+	benchReport("TransformHierarchy update, clean", hierarchy.size(), ms, updatedNote(updated, ms, fullMs));
+}
+
+void runSceneBenchmarks()
+{
+	benchHeader("Scene hierarchy");
+
+	runUpdateCases(100);
+	runUpdateCases(10000);
+}
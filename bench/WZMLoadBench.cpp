@@ -0,0 +1,144 @@
+/*
+	Copyright 2010 Warzone 2100 Project
+
+	This file is part of WMIT.
+
+	WMIT is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	WMIT is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with WMIT.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "Bench.hpp"
+#include "BenchData.hpp"
+
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <vector>
+
+#include "Mesh.hpp"
+#include "WZM.hpp"
+
+static const char benchFileName[] = "wmit-bench-tmp.wzmb";
+
+static int totalConnectors(WZM& model)
+{
+	int count = 0;
+
+	for (int i = 0; i < model.meshes(); ++i)
+	{
+		count += model.getMesh(i).connectors();
+	}
+	return count;
+}
+
+// Every connector of every mesh has to survive both formats, text reads take another path with 1 mesh
+static void checkConnectors(unsigned meshes)
+{
+	std::vector<OBJTri> faces;
+	std::vector<OBJVertex> verts, normals;
+	std::vector<OBJUV> uvs;
+	WZM source, textModel, binModel;
+	Mesh mesh;
+	char name[64];
+
+	makeGrid(8, faces, verts, uvs, normals);
+	mesh.importFromOBJ(faces, verts, uvs, normals);
+	mesh.addConnector(WZMConnector(1.f, 2.f, 3.f));
+	mesh.addConnector(WZMConnector(-4.f, 5.f, 6.f));
+	mesh.addConnector(WZMConnector(7.f, -8.f, 9.f));
+	for (unsigned i = 0; i < meshes; ++i)
+	{
+		source.addMesh(mesh);
+	}
+
+	std::ostringstream textOut, textAgain;
+	source.write(textOut);
+	std::istringstream textIn(textOut.str());
+	BenchTimer timer;
+	textModel.read(textIn);
+	textModel.write(textAgain);
+
+	std::sprintf(name, "connectors, %u mesh(es) (text)", meshes);
+	benchReport(name, totalConnectors(source), timer.elapsedMs(),
+		    totalConnectors(textModel) == totalConnectors(source) && textAgain.str() == textOut.str()
+		    ? "all kept" : "CONNECTORS LOST");
+
+	{
+		std::ofstream binOut(benchFileName, std::ios::out | std::ios::binary);
+		source.writeBinary(binOut);
+	}
+
+	std::ostringstream binAgain;
+	timer.restart();
+	binModel.readBinary(benchFileName);
+	std::remove(benchFileName);
+	binModel.write(binAgain);
+
+	std::sprintf(name, "connectors, %u mesh(es) (binary)", meshes);
+	benchReport(name, totalConnectors(source), timer.elapsedMs(),
+		    totalConnectors(binModel) == totalConnectors(source) && binAgain.str() == textOut.str()
+		    ? "all kept" : "CONNECTORS LOST");
+}
+
+void runWZMLoadBenchmarks()
+{
+	static const unsigned sizes[] = {64, 128, 181, 230, 400};
+
+	std::vector<OBJTri> faces;
+	std::vector<OBJVertex> verts, normals;
+	std::vector<OBJUV> uvs;
+
+	benchHeader("WZM text vs binary load (size = triangles)");
+
+	checkConnectors(1);
+	checkConnectors(2);
+
+	for (unsigned s = 0; s < sizeof(sizes) / sizeof(sizes[0]); ++s)
+	{
+		WZM source, textModel, binModel;
+		Mesh mesh;
+
+		makeGrid(sizes[s], faces, verts, uvs, normals);
+		mesh.importFromOBJ(faces, verts, uvs, normals);
+		mesh.setName("grid");
+		mesh.addConnector(WZMConnector(1.f, 2.f, 3.f));
+		source.addMesh(mesh);
+		source.setTextureName(WZM_TEX_DIFFUSE, "page-1.png");
+
+		std::ostringstream textOut;
+		source.write(textOut);
+		const std::string text = textOut.str();
+
+		std::istringstream textIn(text);
+		BenchTimer timer;
+		textModel.read(textIn);
+		benchReport("WZM::read (text)", faces.size(), timer.elapsedMs());
+
+		{
+			std::ofstream binOut(benchFileName, std::ios::out | std::ios::binary);
+			textModel.writeBinary(binOut);
+		}
+
+		timer.restart();
+		binModel.readBinary(benchFileName);
+		const double binMs = timer.elapsedMs();
+		std::remove(benchFileName);
+
+		// text -> binary -> text has to give back the same file
+		std::ostringstream textAgain, roundTrip;
+		textModel.write(textAgain);
+		binModel.write(roundTrip);
+		benchReport("WZM::readBinary (mapped)", faces.size(), binMs,
+			    roundTrip.str() == textAgain.str() ? "lossless round-trip" : "ROUND-TRIP MISMATCH");
+	}
+}
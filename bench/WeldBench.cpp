@@ -0,0 +1,344 @@
+/*
+	Copyright 2010 Warzone 2100 Project
+
+	This file is part of WMIT.
+
+	WMIT is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	WMIT is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with WMIT.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "Bench.hpp"
+#include "BenchData.hpp"
+
+#include <iterator>
+#include <limits>
+#include <set>
+#include <sstream>
+#include <vector>
+
+#include "Mesh.hpp"
+#include "OBJ.hpp"
+
+// The std::set based welding Mesh used before SpatialHash, kept for comparison
+struct legacyCompareWZMPoint_less_wEps
+{
+	const WZMVertex::less_wEps vertLess;
+	const WZMUV::less_wEps uvLess;
+	const WZMVertex::equal_wEps vertEq;
+	const WZMUV::equal_wEps uvEq;
+
+	legacyCompareWZMPoint_less_wEps(float vertEps = 0.0001, float uvEps = 0.0001):
+		vertLess(vertEps), uvLess(uvEps), vertEq(vertEps), uvEq(uvEps) {}
+
+	bool operator() (const WZMPoint& lhs, const WZMPoint& rhs) const
+	{
+		if (vertLess(std::tr1::get<0>(lhs), std::tr1::get<0>(rhs)))
+			return true;
+		if (vertEq(std::tr1::get<0>(lhs), std::tr1::get<0>(rhs)))
+		{
+			if (uvLess(std::tr1::get<1>(lhs), std::tr1::get<1>(rhs)))
+				return true;
+			if (uvEq(std::tr1::get<1>(lhs), std::tr1::get<1>(rhs)))
+				return vertLess(std::tr1::get<2>(lhs), std::tr1::get<2>(rhs));
+		}
+		return false;
+	}
+};
+
+static void legacyWeld(const std::vector<WZMPoint>& corners, std::vector<unsigned>& indices)
+{
+	typedef std::set<WZMPoint, legacyCompareWZMPoint_less_wEps> t_tupleSet;
+	t_tupleSet tupleSet;
+	std::pair<t_tupleSet::iterator, bool> inResult;
+	std::vector<unsigned> mapping;
+	std::vector<unsigned>::iterator itMap;
+	unsigned vertices = 0;
+
+	indices.clear();
+	for (std::vector<WZMPoint>::const_iterator it = corners.begin(); it != corners.end(); ++it)
+	{
+		inResult = tupleSet.insert(*it);
+		if (!inResult.second)
+		{
+			indices.push_back(mapping[std::distance(tupleSet.begin(), inResult.first)]);
+		}
+		else
+		{
+			itMap = mapping.begin();
+			std::advance(itMap, std::distance(tupleSet.begin(), inResult.first));
+			mapping.insert(itMap, vertices);
+			indices.push_back(vertices++);
+		}
+	}
+}
+
+static void hashWeld(const std::vector<WZMPoint>& corners, std::vector<unsigned>& indices)
+{
+	WZMPointWelder welder;
+
+	indices.clear();
+	for (std::vector<WZMPoint>::const_iterator it = corners.begin(); it != corners.end(); ++it)
+	{
+		indices.push_back(welder.insert(*it).first);
+	}
+}
+
+// Optionally jitter corner positions, like float noise from an exporter
+static void makeCorners(const std::vector<OBJTri>& faces, const std::vector<OBJVertex>& verts,
+			const std::vector<OBJUV>& uvs, const std::vector<OBJVertex>& normals,
+			std::vector<WZMPoint>& corners, float jitter = 0.f)
+{
+	unsigned seed = 12345;
+
+	corners.clear();
+	for (std::vector<OBJTri>::const_iterator it = faces.begin(); it != faces.end(); ++it)
+	{
+		for (unsigned k = 0; k < 3; ++k)
+		{
+			WZMVertex pos = verts[it->tri[k] - 1];
+			for (unsigned c = 0; c < 3; ++c)
+			{
+				seed = seed * 1103515245 + 12345;
+				pos[c] += ((seed >> 16) % 1000 / 1000.f - 0.5f) * jitter;
+			}
+			corners.push_back(WZMPoint(pos, uvs[(unsigned short)it->uvs[k] - 1],
+						   normals[(unsigned short)it->nrm[k] - 1]));
+		}
+	}
+}
+
+// Flat shaded like a PIE import, one normal per triangle from its corners
+static void makeFlatCorners(const std::vector<OBJTri>& faces, const std::vector<OBJVertex>& verts,
+			    const std::vector<OBJUV>& uvs, const std::vector<OBJVertex>& normals,
+			    std::vector<WZMPoint>& corners, float jitter)
+{
+	makeCorners(faces, verts, uvs, normals, corners, jitter);
+	for (size_t i = 0; i + 2 < corners.size(); i += 3)
+	{
+		const WZMVertex& p0 = std::tr1::get<0>(corners[i]);
+		const WZMVertex nrm = normalizeVector(WZMVertex(std::tr1::get<0>(corners[i + 1]) - p0)
+						      .crossProduct(std::tr1::get<0>(corners[i + 2]) - p0));
+
+		for (unsigned k = 0; k < 3; ++k)
+		{
+			std::tr1::get<2>(corners[i + k]) = nrm;
+		}
+	}
+}
+
+/**
+  * Checks a weld: bad counts corners put on a vertex they aren't within eps
+  * of, kept counts vertices within eps of an earlier vertex (missed welds).
+  */
+static std::string checkWeld(const std::vector<WZMPoint>& corners, const std::vector<unsigned>& indices)
+{
+	const WZMPointWeldTraits traits;
+	std::vector<WZMPoint> vertices;
+	WZMPointWelder welder;
+	unsigned bad = 0, kept = 0;
+
+	for (size_t i = 0; i < corners.size(); ++i)
+	{
+		if (indices[i] == vertices.size())
+		{
+			vertices.push_back(corners[i]);
+			kept += !welder.insert(corners[i]).second;
+		}
+		else if (indices[i] > vertices.size() || !traits.equal(vertices[indices[i]], corners[i]))
+		{
+			++bad;
+		}
+	}
+
+	std::stringstream note;
+	note << vertices.size() << " vertices, " << bad << " bad welds, " << kept << " missed";
+	return note.str();
+}
+
+// The OBJ export numbering before OBJVertexTable, kept for comparison
+template <typename T>
+static unsigned legacyOBJIndex(const T& val, std::vector<T>& table, std::set<T, typename T::less_wEps>& set,
+			       std::vector<unsigned>& mapping)
+{
+	std::pair<typename std::set<T, typename T::less_wEps>::iterator, bool> inResult = set.insert(val);
+	std::vector<unsigned>::iterator itMap = mapping.begin();
+
+	std::advance(itMap, std::distance(set.begin(), inResult.first));
+	if (inResult.second)
+	{
+		mapping.insert(itMap, table.size());
+		table.push_back(val);
+		return table.size();
+	}
+	return *itMap + 1;
+}
+
+/**
+  * Exports values through the legacy and the hash OBJ tables, returns how
+  * many of them end up on a different table entry value (the numbers
+  * themselves shift for everything after the first split).
+  */
+template <typename T, typename Traits>
+static unsigned objTableDiffs(const std::vector<T>& values, size_t& legacySize, size_t& hashSize)
+{
+	std::set<T, typename T::less_wEps> set;
+	std::vector<T> table;
+	std::vector<unsigned> mapping, legacyIndices;
+	SpatialHash<T, Traits> hash;
+	unsigned differ = 0;
+	size_t i;
+
+	for (i = 0; i < values.size(); ++i)
+	{
+		legacyIndices.push_back(legacyOBJIndex(values[i], table, set, mapping) - 1);
+	}
+	for (i = 0; i < values.size(); ++i)
+	{
+		differ += !(table[legacyIndices[i]] == hash.values()[hash.insert(values[i]).first]);
+	}
+	legacySize = table.size();
+	hashSize = hash.size();
+	return differ;
+}
+
+/*
+ * What the OBJ export tables get from flat shaded corners, jittered by
+ * about their float eps. Positions are scaled into the unit cube, equal_wEps
+ * is absolute and only means something for values around 1.
+ */
+static void makeOBJAttributes(const std::vector<WZMPoint>& corners, float scale, std::vector<OBJVertex>& verts,
+			      std::vector<OBJUV>& uvs, std::vector<OBJVertex>& normals)
+{
+	const float jitter = 3.f * std::numeric_limits<float>::epsilon();
+	unsigned seed = 54321, c;
+
+	verts.clear(), uvs.clear(), normals.clear();
+	for (std::vector<WZMPoint>::const_iterator it = corners.begin(); it != corners.end(); ++it)
+	{
+		OBJVertex pos = std::tr1::get<0>(*it) * scale, nrm = std::tr1::get<2>(*it);
+		OBJUV uv = std::tr1::get<1>(*it);
+
+		for (c = 0; c < 3; ++c)
+		{
+			seed = seed * 1103515245 + 12345;
+			pos[c] += ((seed >> 16) % 1000 / 1000.f - 0.5f) * jitter;
+			seed = seed * 1103515245 + 12345;
+			nrm[c] += ((seed >> 16) % 1000 / 1000.f - 0.5f) * jitter;
+			if (c < 2)
+			{
+				seed = seed * 1103515245 + 12345;
+				uv[c] += ((seed >> 16) % 1000 / 1000.f - 0.5f) * jitter;
+			}
+		}
+		verts.push_back(pos);
+		uvs.push_back(uv);
+		normals.push_back(nrm);
+	}
+}
+
+// "v/vt/vn entries legacy a/b/c, hash a/b/c, differ a/b/c of n"
+static std::string checkOBJTables(const std::vector<WZMPoint>& corners, float scale)
+{
+	std::vector<OBJVertex> verts, normals;
+	std::vector<OBJUV> uvs;
+	size_t legacy[3], hash[3];
+	unsigned differ[3];
+
+	makeOBJAttributes(corners, scale, verts, uvs, normals);
+	differ[0] = objTableDiffs<OBJVertex, OBJVertexHashTraits>(verts, legacy[0], hash[0]);
+	differ[1] = objTableDiffs<OBJUV, OBJUVHashTraits>(uvs, legacy[1], hash[1]);
+	differ[2] = objTableDiffs<OBJVertex, OBJVertexHashTraits>(normals, legacy[2], hash[2]);
+
+	std::stringstream note;
+	note << "v/vt/vn entries legacy " << legacy[0] << "/" << legacy[1] << "/" << legacy[2]
+	     << ", hash " << hash[0] << "/" << hash[1] << "/" << hash[2]
+	     << ", differ " << differ[0] << "/" << differ[1] << "/" << differ[2] << " of " << corners.size();
+	return note.str();
+}
+
+void runWeldBenchmarks()
+{
+	// 16 bit indices keep us below 65536 welded vertices, 230^2 gives ~105k triangles
+	static const unsigned sizes[] = {32, 64, 128, 181, 230};
+	static const unsigned legacyMaxSize = 128; // quadratic, gets painful beyond that
+	static const unsigned legacyFlatMaxSize = 64; // flat shading splits every corner, even more vertices
+
+	std::vector<OBJTri> faces;
+	std::vector<OBJVertex> verts, normals;
+	std::vector<OBJUV> uvs;
+	std::vector<WZMPoint> corners;
+	std::vector<unsigned> legacyIndices, hashIndices;
+
+	benchHeader("Vertex welding (size = triangles)");
+
+	for (unsigned s = 0; s < sizeof(sizes) / sizeof(sizes[0]); ++s)
+	{
+		makeGrid(sizes[s], faces, verts, uvs, normals);
+		makeCorners(faces, verts, uvs, normals, corners);
+
+		BenchTimer timer;
+		hashWeld(corners, hashIndices);
+		benchReport("weld SpatialHash", faces.size(), timer.elapsedMs());
+
+		if (sizes[s] <= legacyMaxSize)
+		{
+			timer.restart();
+			legacyWeld(corners, legacyIndices);
+			benchReport("weld std::set (legacy)", faces.size(), timer.elapsedMs(),
+				    legacyIndices == hashIndices ? "identical indices" : "INDEX MISMATCH");
+		}
+
+		// jitter below the weld eps must not split vertices
+		makeCorners(faces, verts, uvs, normals, corners, 0.00004f);
+
+		std::vector<unsigned> jitterIndices;
+		timer.restart();
+		hashWeld(corners, jitterIndices);
+		benchReport("weld SpatialHash (jittered)", faces.size(), timer.elapsedMs(),
+			    jitterIndices == hashIndices ? "same welding as exact input" : "WELDING DIFFERS");
+
+		Mesh mesh;
+		timer.restart();
+		mesh.importFromOBJ(faces, verts, uvs, normals);
+
+		std::stringstream note;
+		note << mesh.vertices() << " welded vertices";
+		benchReport("Mesh::importFromOBJ", faces.size(), timer.elapsedMs(), note.str());
+
+		/*
+		 * Near-equal normals are where the two welds part ways, the legacy
+		 * set keeps some corners within eps of each other apart.
+		 */
+		if (sizes[s] <= legacyFlatMaxSize)
+		{
+			makeFlatCorners(faces, verts, uvs, normals, corners, 0.00004f);
+
+			timer.restart();
+			hashWeld(corners, hashIndices);
+			benchReport("weld SpatialHash (flat, jittered)", faces.size(), timer.elapsedMs(),
+				    checkWeld(corners, hashIndices));
+
+			timer.restart();
+			legacyWeld(corners, legacyIndices);
+			benchReport("weld std::set (flat, jittered)", faces.size(), timer.elapsedMs(),
+				    checkWeld(corners, legacyIndices));
+
+			// the OBJ export tables part ways with the legacy ones the same way
+			makeFlatCorners(faces, verts, uvs, normals, corners, 0.f);
+
+			timer.restart();
+			const std::string tables = checkOBJTables(corners, 0.5f / sizes[s]);
+			benchReport("OBJ tables vs std::set (jittered)", faces.size(), timer.elapsedMs(), tables);
+		}
+	}
+}
@@ -0,0 +1,33 @@
+#version 120
+#pragma debug(on)
+
+varying vec3 normal, lightDir, eyeVec;
+
+uniform sampler2D Texture0; //diffuse
+uniform int textured;
+
+void main(void)
+{
+	vec4 colour = vec4(1.0);
+	vec4 light = (gl_FrontLightModelProduct.sceneColor * gl_FrontMaterial.ambient) + (gl_LightSource[0].ambient * gl_FrontMaterial.ambient);
+	vec3 N = normalize(normal);
+	vec3 L = normalize(lightDir);
+
+	float lambertTerm = dot(N, L);
+	if (lambertTerm > 0.0)
+	{
+		light += gl_LightSource[0].diffuse * gl_FrontMaterial.diffuse * lambertTerm;
+		vec3 E = normalize(eyeVec);
+		vec3 R = reflect(-L, N);
+		float specular = pow(max(dot(R, E), 0.0), gl_FrontMaterial.shininess);
+		light += gl_LightSource[0].specular * gl_FrontMaterial.specular * specular;
+	}
+
+	// Get color from texture unit 0
+	if (textured == 1)
+	{
+		colour = texture2D(Texture0, gl_TexCoord[0].st);
+	}
+
+	gl_FragColor = colour * light * gl_Color;
+}
@@ -0,0 +1,27 @@
+#version 120
+#extension GL_ARB_draw_instanced : require
+#pragma debug(on)
+
+// has to match instancingBatch in QWZM.cpp
+uniform mat4 instances[16];
+
+varying vec3 normal, lightDir, eyeVec;
+
+void main(void)
+{
+	// the instance places the model in the scene, the modelview only holds the camera
+	mat4 instance = instances[gl_InstanceIDARB];
+	vec4 position = instance * gl_Vertex;
+	vec3 vVertex = vec3(gl_ModelViewMatrix * position);
+
+	// Pass texture coordinates to fragment shader
+	gl_TexCoord[0] = gl_TextureMatrix[0] * gl_MultiTexCoord0;
+
+	// Lighting -- we pass these to the fragment shader
+	normal = gl_NormalMatrix * (mat3(instance) * gl_Normal);
+	lightDir = vec3(gl_LightSource[0].position.xyz - vVertex);
+	eyeVec = -vVertex;
+	gl_FrontColor = gl_Color;
+
+	gl_Position = gl_ModelViewProjectionMatrix * position;
+}
@@ -0,0 +1,322 @@
+/*
+	Copyright 2010 Warzone 2100 Project
+
+	This file is part of WMIT.
+
+	WMIT is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	WMIT is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with WMIT.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include "BatchConvert.hpp"
+
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <set>
+#include <sstream>
+
+#ifdef _WIN32
+#  include <windows.h>
+#  include <direct.h>
+#else
+#  include <sys/types.h>
+#  include <sys/stat.h>
+#  include <sys/time.h>
+#  include <dirent.h>
+#endif
+
+#include "WZM.hpp"
+#include "ModelIO.hpp"
+#include "TaskPool.hpp"
+
+struct BatchJob
+{
+	std::string input, output;
+	bool ok;
+	double ms;
+	std::string report; // vertex cache stats, if optimized
+};
+
+static double nowMs()
+{
+#ifdef _WIN32
+	LARGE_INTEGER freq, count;
+	QueryPerformanceFrequency(&freq);
+	QueryPerformanceCounter(&count);
+	return count.QuadPart * 1000. / freq.QuadPart;
+#else
+	timeval tv;
+	gettimeofday(&tv, NULL);
+	return tv.tv_sec * 1000. + tv.tv_usec / 1000.;
+#endif
+}
+
+static bool isDirectory(const std::string& path)
+{
+#ifdef _WIN32
+	const DWORD attr = GetFileAttributesA(path.c_str());
+	return attr != INVALID_FILE_ATTRIBUTES && (attr & FILE_ATTRIBUTE_DIRECTORY);
+#else
+	struct stat st;
+	return stat(path.c_str(), &st) == 0 && S_ISDIR(st.st_mode);
+#endif
+}
+
+static bool makeDirectory(const std::string& path)
+{
+	if (isDirectory(path))
+	{
+		return true;
+	}
+#ifdef _WIN32
+	return _mkdir(path.c_str()) == 0;
+#else
+	return mkdir(path.c_str(), 0755) == 0;
+#endif
+}
+
+/// Sorted names of the regular entries in dir
+static bool listDirectory(const std::string& dir, std::set<std::string>& names)
+{
+#ifdef _WIN32
+	WIN32_FIND_DATAA data;
+	HANDLE find = FindFirstFileA((dir + "\\*").c_str(), &data);
+
+	if (find == INVALID_HANDLE_VALUE)
+	{
+		return false;
+	}
+	do
+	{
+		if (!(data.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY))
+		{
+			names.insert(data.cFileName);
+		}
+	} while (FindNextFileA(find, &data));
+	FindClose(find);
+#else
+	DIR* d = opendir(dir.c_str());
+	dirent* entry;
+
+	if (!d)
+	{
+		return false;
+	}
+	while ((entry = readdir(d)) != NULL)
+	{
+		if (!isDirectory(dir + '/' + entry->d_name))
+		{
+			names.insert(entry->d_name);
+		}
+	}
+	closedir(d);
+#endif
+	return true;
+}
+
+static std::string baseName(const std::string& path)
+{
+	std::string::size_type slash = path.find_last_of("/\\");
+	std::string name = slash == std::string::npos ? path : path.substr(slash + 1);
+	std::string::size_type dot = name.find_last_of('.');
+
+	return dot == std::string::npos ? name : name.substr(0, dot);
+}
+
+static bool collectInputs(const std::string& input, std::vector<std::string>& files)
+{
+	wmit_filetype_t type;
+
+	if (isDirectory(input))
+	{
+		std::set<std::string> names;
+		std::set<std::string>::const_iterator it;
+
+		if (!listDirectory(input, names))
+		{
+			std::cerr << "runBatchConversion - Can't read directory " << input << std::endl;
+			return false;
+		}
+		for (it = names.begin(); it != names.end(); ++it)
+		{
+			if (guessModelType(*it, type))
+			{
+				files.push_back(input + '/' + *it);
+			}
+		}
+		return true;
+	}
+
+	std::ifstream list(input.c_str());
+	std::string line;
+
+	if (!list.is_open())
+	{
+		std::cerr << "runBatchConversion - Can't open file list " << input << std::endl;
+		return false;
+	}
+	while (std::getline(list, line))
+	{
+		// tolerate DOS line endings and blank lines
+		if (!line.empty() && line[line.size() - 1] == '\r')
+		{
+			line.erase(line.size() - 1);
+		}
+		if (line.empty())
+		{
+			continue;
+		}
+		if (!guessModelType(line, type))
+		{
+			std::cerr << "runBatchConversion - Skipping unknown model type " << line << std::endl;
+			continue;
+		}
+		files.push_back(line);
+	}
+	return true;
+}
+
+class ConvertTask : public Task
+{
+public:
+	ConvertTask(BatchJob& job, wmit_filetype_t type, bool optimize, bool overdraw):
+		m_job(job), m_type(type), m_optimize(optimize), m_overdraw(overdraw) {}
+
+	void run()
+	{
+		const double start = nowMs();
+		WZM model;
+
+		m_job.ok = loadModel(m_job.input, model);
+		if (m_job.ok && m_optimize)
+		{
+			std::ostringstream report;
+
+			m_job.ok = optimizeModel(model, m_overdraw, report);
+			m_job.report = report.str();
+		}
+		m_job.ok = m_job.ok && saveModel(m_job.output, model, m_type);
+		m_job.ms = nowMs() - start;
+	}
+
+private:
+	BatchJob& m_job;
+	wmit_filetype_t m_type;
+	bool m_optimize;
+	bool m_overdraw;
+};
+
+static void printUsage()
+{
+	std::cerr << "Usage: wmit[-convert] --batch [-j threads] [--forsyth | --overdraw] <input dir | file list> <output dir> <pie|wzm|wzmb|obj>" << std::endl;
+}
+
+int runBatchConversion(const std::vector<std::string>& args)
+{
+	std::vector<std::string> files;
+	std::vector<BatchJob> jobs;
+	std::vector<ConvertTask*> tasks;
+	std::set<std::string> outputs;
+	wmit_filetype_t outType;
+	unsigned threads = 0, failed = 0;
+	size_t arg = 0, i;
+	bool optimize = false, overdraw = false;
+
+	if (args.size() > 1 && args[0] == "-j")
+	{
+		threads = std::atoi(args[1].c_str());
+		arg = 2;
+	}
+	if (args.size() > arg && (args[arg] == "--forsyth" || args[arg] == "--overdraw"))
+	{
+		optimize = true;
+		overdraw = args[arg] == "--overdraw";
+		++arg;
+	}
+
+	if (args.size() != arg + 3)
+	{
+		printUsage();
+		return 1;
+	}
+
+	const std::string& input = args[arg];
+	const std::string& outDir = args[arg + 1];
+
+	if (!guessModelType("." + args[arg + 2], outType))
+	{
+		std::cerr << "runBatchConversion - Unknown output format " << args[arg + 2] << std::endl;
+		printUsage();
+		return 1;
+	}
+
+	if (!collectInputs(input, files))
+	{
+		return 1;
+	}
+
+	if (!makeDirectory(outDir))
+	{
+		std::cerr << "runBatchConversion - Can't create output directory " << outDir << std::endl;
+		return 1;
+	}
+
+	jobs.resize(files.size());
+	for (i = 0; i < files.size(); ++i)
+	{
+		jobs[i].input = files[i];
+		jobs[i].output = outDir + '/' + baseName(files[i]) + '.' + modelTypeExtension(outType);
+		jobs[i].ok = false;
+		jobs[i].ms = 0;
+
+		// list inputs from different directories can share a base name
+		if (!outputs.insert(jobs[i].output).second)
+		{
+			std::cerr << "runBatchConversion - " << jobs[i].input << " would overwrite "
+				  << jobs[i].output << ", skipping" << std::endl;
+			continue;
+		}
+		tasks.push_back(new ConvertTask(jobs[i], outType, optimize, overdraw));
+	}
+
+	TaskPool pool(threads);
+	const double start = nowMs();
+
+	pool.run(std::vector<Task*>(tasks.begin(), tasks.end()));
+
+	const double wallMs = nowMs() - start;
+	double busyMs = 0;
+
+	for (i = 0; i < tasks.size(); ++i)
+	{
+		delete tasks[i];
+	}
+
+	for (i = 0; i < jobs.size(); ++i)
+	{
+		std::printf("%-6s %10.2f ms  %s -> %s\n", jobs[i].ok ? "ok" : "FAILED",
+			    jobs[i].ms, jobs[i].input.c_str(), jobs[i].output.c_str());
+		if (!jobs[i].report.empty())
+		{
+			std::printf("%-6s %13s  %s\n", "", "", jobs[i].report.c_str());
+		}
+		busyMs += jobs[i].ms;
+		failed += jobs[i].ok ? 0 : 1;
+	}
+
+	std::printf("%u of %u files converted, %u failed, %.1f ms (%.1f ms of work on %u threads)\n",
+		    static_cast<unsigned>(jobs.size()) - failed, static_cast<unsigned>(jobs.size()),
+		    failed, wallMs, busyMs, pool.threads());
+
+	return failed ? 1 : 0;
+}
@@ -0,0 +1,36 @@
+/*
+	Copyright 2010 Warzone 2100 Project
+
+	This file is part of WMIT.
+
+	WMIT is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	WMIT is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with WMIT.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef BATCHCONVERT_HPP
+#define BATCHCONVERT_HPP
+
+#include <string>
+#include <vector>
+
+/*
+ * Command line batch conversion:
+ *	--batch [-j threads] [--forsyth | --overdraw] <input dir | file list> <output dir> <pie|wzm|wzmb|obj>
+ *
+ * A directory input converts every model file directly inside it, any other
+ * input is read as a list of model paths, one per line. --forsyth runs the
+ * vertex cache optimization on every model, --overdraw additionally reorders
+ * the triangles for less overdraw. Returns the process exit code.
+ */
+int runBatchConversion(const std::vector<std::string>& args);
+
+#endif // BATCHCONVERT_HPP
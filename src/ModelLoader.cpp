@@ -0,0 +1,116 @@
+/*
+	Copyright 2010 Warzone 2100 Project
+
+	This file is part of WMIT.
+
+	WMIT is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	WMIT is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with WMIT.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "ModelLoader.hpp"
+
+#include "ModelIO.hpp"
+#include "LoadProgress.hpp"
+
+class ModelLoaderProgress : public LoadProgress
+{
+public:
+	ModelLoaderProgress(ModelLoader& loader): m_loader(loader) {}
+
+protected:
+	bool report(uint64_t bytes, uint64_t total, unsigned meshes)
+	{
+		return m_loader.reportProgress(bytes, total, meshes);
+	}
+
+private:
+	ModelLoader& m_loader;
+};
+
+ModelLoader::ModelLoader(QObject* parent):
+	QThread(parent),
+	m_ok(false),
+	m_cancel(0)
+{
+}
+
+ModelLoader::~ModelLoader()
+{
+	cancel();
+	wait();
+}
+
+void ModelLoader::load(const QString& file)
+{
+	if (isRunning())
+	{
+		cancel();
+		wait();
+	}
+
+	m_file = file;
+	m_model = WZM();
+	m_ok = false;
+	m_cancel = 0;
+	start();
+}
+
+QString ModelLoader::fileName() const
+{
+	return m_file;
+}
+
+bool ModelLoader::cancelled() const
+{
+	return m_cancel != 0;
+}
+
+bool ModelLoader::takeModel(WZM& model)
+{
+	const bool ok = m_ok && isFinished() && m_cancel == 0;
+
+	if (ok)
+	{
+		model = m_model;
+	}
+
+	m_model = WZM();
+	m_file.clear();
+	m_ok = false;
+	return ok;
+}
+
+void ModelLoader::cancel()
+{
+	m_cancel = 1;
+
+	// a result nobody took yet mustn't show up after its finished() arrives
+	if (isFinished())
+	{
+		WZM dropped;
+		takeModel(dropped);
+	}
+}
+
+void ModelLoader::run()
+{
+	ModelLoaderProgress progress(*this);
+
+	m_ok = ::loadModel(m_file.toLocal8Bit().constData(), m_model, &progress);
+}
+
+bool ModelLoader::reportProgress(qlonglong bytes, qlonglong total, int meshes)
+{
+	emit progress(bytes, total, meshes);
+	return m_cancel == 0;
+}
@@ -0,0 +1,73 @@
+/*
+	Copyright 2010 Warzone 2100 Project
+
+	This file is part of WMIT.
+
+	WMIT is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	WMIT is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with WMIT.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef MODELLOADER_HPP
+#define MODELLOADER_HPP
+
+#include <QThread>
+#include <QString>
+#include <QAtomicInt>
+
+#include "WZM.hpp"
+
+/**
+  * Reads a model file on its own thread so the GUI stays responsive,
+  * finished() is emitted once the result can be taken.
+  */
+class ModelLoader : public QThread
+{
+	Q_OBJECT
+	friend class ModelLoaderProgress;
+public:
+	explicit ModelLoader(QObject* parent = 0);
+	~ModelLoader();
+
+	/// Starts reading file, a load still running gets cancelled first
+	void load(const QString& file);
+
+	/// File of the last load, empty once its model got taken
+	QString fileName() const;
+	bool cancelled() const;
+
+	/**
+	  * Hands over the model once the load finished, at most once per load.
+	  * False if it failed, got cancelled or isn't finished.
+	  */
+	bool takeModel(WZM& model);
+
+public slots:
+	/// Stops a running load, or drops the result of a finished one
+	void cancel();
+
+signals:
+	/// From the loading thread, bytes of total read and meshes built so far
+	void progress(qlonglong bytes, qlonglong total, int meshes);
+
+protected:
+	void run();
+
+private:
+	QString m_file;
+	WZM m_model;
+	bool m_ok;
+	QAtomicInt m_cancel;
+
+	bool reportProgress(qlonglong bytes, qlonglong total, int meshes);
+};
+
+#endif // MODELLOADER_HPP
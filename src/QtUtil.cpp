@@ -0,0 +1,127 @@
+/*
+	Copyright 2010 Warzone 2100 Project
+
+	This file is part of WMIT.
+
+	WMIT is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	WMIT is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with WMIT.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include "QtUtil.hpp"
+
+#include <QFileInfo>
+#include <QTextStream>
+
+inline QString getWZMTextureName(const QString& filePath);
+inline QString getPIETextureName(const QString& filePath);
+//inline QString getOBJTextureName(const QString& filePath); // OBJ uses material files which contain the texture info
+QString getTextureName(const QString& filePath)
+{
+	QFileInfo modelFileNfo(filePath);
+	if (!modelFileNfo.exists())
+	{
+		return QString();
+	}
+	else if (modelFileNfo.completeSuffix().compare(QString("wzm"), Qt::CaseInsensitive) == 0)
+	{
+		return getWZMTextureName(modelFileNfo.absoluteFilePath());
+	}
+	else if(modelFileNfo.completeSuffix().compare(QString("pie"), Qt::CaseInsensitive) == 0)
+	{
+		return getPIETextureName(modelFileNfo.absoluteFilePath());
+	}
+	else if(modelFileNfo.completeSuffix().compare(QString("3ds"), Qt::CaseInsensitive) == 0)
+	{
+		return getWZMTextureName(modelFileNfo.absoluteFilePath());
+	}
+#ifdef getOBJTextureName
+	else if(modelFileNfo.completeSuffix().compare(QString("obj"), Qt::CaseInsensitive) == 0)
+	{
+		return getOBJTextureName(modelFileNfo.absoluteFilePath());
+	}
+#endif
+	return QString();
+}
+
+inline QString getWZMTextureName(const QString& filePath)
+{
+	QFile f(filePath);
+	if (!f.open(QFile::ReadOnly))
+	{
+		return QString();
+	}
+	QTextStream in(&f);
+	QString qstr;
+	unsigned uint;
+
+	if (in.status() != QTextStream::Ok || qstr.compare("WZM") != 0)
+	{
+		return  QString();
+	}
+
+	in >> uint;
+	if (in.status() != QTextStream::Ok)
+	{
+		return  QString();
+	}
+
+	in >> qstr;
+	if (qstr.compare("TEXTURE") != 0)
+	{
+		return  QString();
+	}
+	in >> qstr;
+	if (in.status() != QTextStream::Ok)
+	{
+		return  QString();
+	}
+	return qstr;
+}
+
+inline QString getPIETextureName(const QString& filePath)
+{
+	QFile f(filePath);
+	if (!f.open(QFile::ReadOnly))
+	{
+		return QString();
+	}
+	QTextStream in(&f);
+	QString qstr;
+	unsigned uint;
+
+	// PIE %u
+	in >> qstr >> uint;
+	if (in.status() != QTextStream::Ok || qstr.compare("PIE") != 0)
+	{
+		return QString();
+	}
+
+	// TYPE %x
+	in >> qstr >> uint;
+	if (in.status() != QTextStream::Ok || qstr.compare("TYPE") != 0)
+	{
+		return QString();
+	}
+
+	// TEXTURE 0 %s %u %u
+	in >> qstr >> uint;
+	if (in.status() != QTextStream::Ok || qstr.compare("TEXTURE") != 0)
+	{
+		return QString();
+	}
+	in >> qstr;
+	if (in.status() != QTextStream::Ok)
+	{
+		return  QString();
+	}
+	return qstr;
+}
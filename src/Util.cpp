@@ -19,14 +19,9 @@
 
 #include "Util.hpp"
 
-#include <QtDebug>
-
-#include <QFileInfo>
-#include <QTextStream>
-#include <QRegExp>
+#include <cctype>
 
 #include "Pie.hpp"
-#include "wmit.h"
 
 bool isValidWzName(const std::string name)
 {
@@ -56,123 +51,30 @@ std::string makeWzTCMaskName(const std::string& name)
 	return tcmask;
 */
 
-	QString tcmask(QString::fromStdString(name));
-	QRegExp pageNoRegX(WMIT_WZ_TEXPAGE_REMASK);
-
-	if ((pageNoRegX.indexIn(tcmask) != -1) && tcmask.contains("."))
-	{
-		tcmask = pageNoRegX.cap(0).append(PIE_MODEL_TCMASK_SUFFIX) +
-				tcmask.right(tcmask.size() - tcmask.lastIndexOf("."));
-	}
-	else
-	{
-		tcmask.clear();
-	}
-
-	return tcmask.toStdString();
-}
-
-inline QString getWZMTextureName(const QString& filePath);
-inline QString getPIETextureName(const QString& filePath);
-//inline QString getOBJTextureName(const QString& filePath); // OBJ uses material files which contain the texture info
-QString getTextureName(const QString& filePath)
-{
-	QFileInfo modelFileNfo(filePath);
-	if (!modelFileNfo.exists())
-	{
-		return QString();
-	}
-	else if (modelFileNfo.completeSuffix().compare(QString("wzm"), Qt::CaseInsensitive) == 0)
-	{
-		return getWZMTextureName(modelFileNfo.absoluteFilePath());
-	}
-	else if(modelFileNfo.completeSuffix().compare(QString("pie"), Qt::CaseInsensitive) == 0)
-	{
-		return getPIETextureName(modelFileNfo.absoluteFilePath());
-	}
-	else if(modelFileNfo.completeSuffix().compare(QString("3ds"), Qt::CaseInsensitive) == 0)
-	{
-		return getWZMTextureName(modelFileNfo.absoluteFilePath());
-	}
-#ifdef getOBJTextureName
-	else if(modelFileNfo.completeSuffix().compare(QString("obj"), Qt::CaseInsensitive) == 0)
-	{
-		return getOBJTextureName(modelFileNfo.absoluteFilePath());
-	}
-#endif
-	return QString();
-}
-
-inline QString getWZMTextureName(const QString& filePath)
-{
-	QFile f(filePath);
-	if (!f.open(QFile::ReadOnly))
-	{
-		return QString();
-	}
-	QTextStream in(&f);
-	QString qstr;
-	unsigned uint;
-
-	if (in.status() != QTextStream::Ok || qstr.compare("WZM") != 0)
-	{
-		return  QString();
-	}
-
-	in >> uint;
-	if (in.status() != QTextStream::Ok)
-	{
-		return  QString();
-	}
-
-	in >> qstr;
-	if (qstr.compare("TEXTURE") != 0)
-	{
-		return  QString();
-	}
-	in >> qstr;
-	if (in.status() != QTextStream::Ok)
-	{
-		return  QString();
-	}
-	return qstr;
-}
-
-inline QString getPIETextureName(const QString& filePath)
-{
-	QFile f(filePath);
-	if (!f.open(QFile::ReadOnly))
-	{
-		return QString();
-	}
-	QTextStream in(&f);
-	QString qstr;
-	unsigned uint;
+	// first "page-<digits>" match, same as the WMIT_WZ_TEXPAGE_REMASK regexp
+	static const std::string page = "page-";
+	std::string::size_type pos = 0, end = 0;
+	std::string tcmask;
 
-	// PIE %u
-	in >> qstr >> uint;
-	if (in.status() != QTextStream::Ok || qstr.compare("PIE") != 0)
+	while ((pos = name.find(page, pos)) != std::string::npos)
 	{
-		return QString();
+		end = pos + page.size();
+		while (end < name.size() && std::isdigit(static_cast<unsigned char>(name[end])))
+		{
+			++end;
+		}
+		if (end > pos + page.size())
+		{
+			break;
+		}
+		++pos;
 	}
 
-	// TYPE %x
-	in >> qstr >> uint;
-	if (in.status() != QTextStream::Ok || qstr.compare("TYPE") != 0)
+	if (pos != std::string::npos && name.find('.') != std::string::npos)
 	{
-		return QString();
+		tcmask = name.substr(pos, end - pos) + PIE_MODEL_TCMASK_SUFFIX +
+				name.substr(name.find_last_of('.'));
 	}
 
-	// TEXTURE 0 %s %u %u
-	in >> qstr >> uint;
-	if (in.status() != QTextStream::Ok || qstr.compare("TEXTURE") != 0)
-	{
-		return QString();
-	}
-	in >> qstr;
-	if (in.status() != QTextStream::Ok)
-	{
-		return  QString();
-	}
-	return qstr;
+	return tcmask;
 }
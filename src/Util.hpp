@@ -20,12 +20,9 @@
 #ifndef UTIL_HPP
 #define UTIL_HPP
 #include <string>
-#include <QString>
 
 bool isValidWzName(const std::string name);
 std::string makeWzTCMaskName(const std::string& name);
 
-QString getTextureName(const QString& filePath);
-
 
 #endif // UTIL_HPP
@@ -0,0 +1,122 @@
+/*
+	Copyright 2010 Warzone 2100 Project
+
+	This file is part of WMIT.
+
+	WMIT is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	WMIT is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with WMIT.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef ALIGNEDALLOCATOR_HPP
+#define ALIGNEDALLOCATOR_HPP
+
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+
+/**
+  * Standard allocator returning ALIGNMENT aligned blocks,
+  * ALIGNMENT must be a power of two.
+  *
+  * The block start returned by malloc is kept just in front of the
+  * aligned pointer so deallocate can give it back.
+  */
+template <typename T, size_t ALIGNMENT>
+class AlignedAllocator
+{
+public:
+	typedef T value_type;
+	typedef T* pointer;
+	typedef const T* const_pointer;
+	typedef T& reference;
+	typedef const T& const_reference;
+	typedef size_t size_type;
+	typedef ptrdiff_t difference_type;
+
+	template <typename U>
+	struct rebind
+	{
+		typedef AlignedAllocator<U, ALIGNMENT> other;
+	};
+
+	AlignedAllocator() {}
+
+	template <typename U>
+	AlignedAllocator(const AlignedAllocator<U, ALIGNMENT>&) {}
+
+	pointer address(reference r) const
+	{
+		return &r;
+	}
+
+	const_pointer address(const_reference r) const
+	{
+		return &r;
+	}
+
+	pointer allocate(size_type n, const void* = 0)
+	{
+		if (n > max_size())
+		{
+			throw std::bad_alloc();
+		}
+
+		void* raw = std::malloc(n * sizeof(T) + ALIGNMENT + sizeof(void*));
+		if (!raw)
+		{
+			throw std::bad_alloc();
+		}
+
+		size_t aligned = reinterpret_cast<size_t>(raw) + sizeof(void*);
+		aligned = (aligned + ALIGNMENT - 1) & ~(ALIGNMENT - 1);
+
+		reinterpret_cast<void**>(aligned)[-1] = raw;
+		return reinterpret_cast<pointer>(aligned);
+	}
+
+	void deallocate(pointer p, size_type)
+	{
+		if (p)
+		{
+			std::free(reinterpret_cast<void**>(p)[-1]);
+		}
+	}
+
+	size_type max_size() const
+	{
+		return (size_type(-1) - ALIGNMENT - sizeof(void*)) / sizeof(T);
+	}
+
+	void construct(pointer p, const T& val)
+	{
+		new (static_cast<void*>(p)) T(val);
+	}
+
+	void destroy(pointer p)
+	{
+		p->~T();
+	}
+};
+
+template <typename T, typename U, size_t ALIGNMENT>
+inline bool operator ==(const AlignedAllocator<T, ALIGNMENT>&, const AlignedAllocator<U, ALIGNMENT>&)
+{
+	return true;
+}
+
+template <typename T, typename U, size_t ALIGNMENT>
+inline bool operator !=(const AlignedAllocator<T, ALIGNMENT>&, const AlignedAllocator<U, ALIGNMENT>&)
+{
+	return false;
+}
+
+#endif // ALIGNEDALLOCATOR_HPP
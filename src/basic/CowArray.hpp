@@ -0,0 +1,150 @@
+/*
+	Copyright 2010 Warzone 2100 Project
+
+	This file is part of WMIT.
+
+	WMIT is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	WMIT is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with WMIT.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef COWARRAY_HPP
+#define COWARRAY_HPP
+
+#include <memory>
+#include <vector>
+#include <tr1/memory>
+
+/**
+  * std::vector with implicitly shared, copy-on-write storage.
+  *
+  * Copies share one buffer; the first non-const access of a copy that
+  * isn't the only owner duplicates it (same idea as Qt's implicit
+  * sharing). Const accessors never copy, so read-only code should go
+  * through a const reference. clear() and assign() drop a shared buffer
+  * instead of copying it first.
+  *
+  * Sharing is not synchronized beyond the reference count: don't copy
+  * an array on one thread while another one modifies it.
+  */
+template <typename T, typename A = std::allocator<T> >
+class CowArray
+{
+public:
+	typedef std::vector<T, A> vector_type;
+	typedef typename vector_type::value_type value_type;
+	typedef typename vector_type::size_type size_type;
+	typedef typename vector_type::reference reference;
+	typedef typename vector_type::const_reference const_reference;
+	typedef typename vector_type::iterator iterator;
+	typedef typename vector_type::const_iterator const_iterator;
+
+	CowArray() {}
+
+	/// Read access, never copies
+	const vector_type& get() const
+	{
+		return m_data ? *m_data : emptyVector();
+	}
+
+	/// Write access, copies the buffer first if it's shared
+	vector_type& edit()
+	{
+		if (!m_data)
+		{
+			m_data.reset(new vector_type());
+		}
+		else if (!m_data.unique())
+		{
+			m_data.reset(new vector_type(*m_data));
+		}
+		return *m_data;
+	}
+
+	bool isShared() const
+	{
+		return m_data && !m_data.unique();
+	}
+
+	size_type size() const {return get().size();}
+	bool empty() const {return get().empty();}
+
+	const_reference operator [](size_type i) const {return get()[i];}
+	reference operator [](size_type i) {return edit()[i];}
+	const_reference at(size_type i) const {return get().at(i);}
+
+	const_iterator begin() const {return get().begin();}
+	const_iterator end() const {return get().end();}
+	iterator begin() {return edit().begin();}
+	iterator end() {return edit().end();}
+
+	void push_back(const T& val) {edit().push_back(val);}
+	void reserve(size_type n) {edit().reserve(n);}
+	void resize(size_type n, const T& val = T()) {edit().resize(n, val);}
+
+	void clear()
+	{
+		if (isShared())
+		{
+			m_data.reset();
+		}
+		else if (m_data)
+		{
+			m_data->clear();
+		}
+	}
+
+	template <typename It>
+	void assign(It first, It last)
+	{
+		if (isShared())
+		{
+			m_data.reset();
+		}
+		edit().assign(first, last);
+	}
+
+	void assign(size_type n, const T& val)
+	{
+		if (isShared())
+		{
+			m_data.reset();
+		}
+		edit().assign(n, val);
+	}
+
+	/// Takes other's contents, other gets the old ones (or nothing, if they were shared)
+	void swap(vector_type& other)
+	{
+		if (isShared())
+		{
+			m_data.reset();
+		}
+		edit().swap(other);
+	}
+
+	/// Drops this reference to the storage, freeing it if nobody else holds it
+	void release()
+	{
+		m_data.reset();
+	}
+
+private:
+	static const vector_type& emptyVector()
+	{
+		static const vector_type empty;
+		return empty;
+	}
+
+	std::tr1::shared_ptr<vector_type> m_data;
+};
+
+#endif // COWARRAY_HPP
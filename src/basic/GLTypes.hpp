@@ -0,0 +1,34 @@
+/*
+	Copyright 2010 Warzone 2100 Project
+
+	This file is part of WMIT.
+
+	WMIT is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	WMIT is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with WMIT.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef GLTYPES_HPP
+#define GLTYPES_HPP
+
+/*
+ * GL scalar types used by the model formats, so those don't need GL or Qt
+ * headers. They are identical to the gl.h typedefs, and an identical typedef
+ * may be repeated, so mixing this with GLee.h or qgl.h is fine.
+ */
+typedef float GLfloat;
+typedef float GLclampf;
+typedef int GLint;
+typedef unsigned int GLuint;
+typedef unsigned char GLubyte;
+typedef unsigned short GLushort;
+
+#endif // GLTYPES_HPP
@@ -0,0 +1,40 @@
+/*
+	Copyright 2010 Warzone 2100 Project
+
+	This file is part of WMIT.
+
+	WMIT is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	WMIT is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with WMIT.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#pragma once
+
+#include "IGLRenderable.hpp"
+#include "ViewCuller.hpp"
+
+class IGLCullableRenderable : virtual public IGLRenderable
+{
+protected:
+	bool m_culling;
+	CullStats m_cullStats;
+
+public:
+	IGLCullableRenderable(): m_culling(true) {}
+	virtual ~IGLCullableRenderable() {}
+
+	/// Leave out geometry outside the view (and facing away from it) when rendering
+	virtual void setCulling(bool enable) {m_culling = enable;}
+	virtual bool culling() const {return m_culling;}
+
+	/// What the last render() call drew and culled
+	virtual const CullStats& cullStats() const {return m_cullStats;}
+};
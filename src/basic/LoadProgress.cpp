@@ -0,0 +1,48 @@
+/*
+	Copyright 2010 Warzone 2100 Project
+
+	This file is part of WMIT.
+
+	WMIT is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	WMIT is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with WMIT.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "LoadProgress.hpp"
+
+LoadProgress::LoadProgress():
+	m_bytes(0), m_total(0), m_next(0), m_meshes(0), m_cancelled(false)
+{
+}
+
+bool LoadProgress::meshesBuilt(unsigned meshes)
+{
+	m_meshes += meshes;
+	if (!m_cancelled)
+	{
+		m_cancelled = !report(m_bytes, m_total, m_meshes);
+	}
+	return !m_cancelled;
+}
+
+bool LoadProgress::update(uint64_t bytes, uint64_t total)
+{
+	m_bytes = bytes;
+	m_total = total;
+	m_next = bytes + total / 256 + 1;
+
+	if (!m_cancelled)
+	{
+		m_cancelled = !report(m_bytes, m_total, m_meshes);
+	}
+	return !m_cancelled;
+}
@@ -0,0 +1,60 @@
+/*
+	Copyright 2010 Warzone 2100 Project
+
+	This file is part of WMIT.
+
+	WMIT is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	WMIT is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with WMIT.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef LOADPROGRESS_HPP
+#define LOADPROGRESS_HPP
+
+#include <stdint.h>
+
+/**
+  * Progress callback for the model readers. They hand over how far into
+  * the file they got and how many meshes they've built, report() gets the
+  * running totals every 1/256th of the file and after every mesh.
+  *
+  * Returning false from report() cancels the load: the reader gives up at
+  * its next check and fails like on a broken file, without an error message.
+  * Readers only call it from the thread they were started on.
+  */
+class LoadProgress
+{
+public:
+	LoadProgress();
+	virtual ~LoadProgress() {}
+
+	/// Position in a file of total bytes, false once cancelled
+	bool consumed(uint64_t bytes, uint64_t total)
+	{
+		return bytes < m_next && total == m_total ? !m_cancelled : update(bytes, total);
+	}
+	/// Adds to the meshes built, false once cancelled
+	bool meshesBuilt(unsigned meshes);
+
+	bool cancelled() const {return m_cancelled;}
+
+protected:
+	virtual bool report(uint64_t bytes, uint64_t total, unsigned meshes) = 0;
+
+private:
+	bool update(uint64_t bytes, uint64_t total);
+
+	uint64_t m_bytes, m_total, m_next;
+	unsigned m_meshes;
+	bool m_cancelled;
+};
+
+#endif // LOADPROGRESS_HPP
@@ -0,0 +1,217 @@
+/*
+	Copyright 2010 Warzone 2100 Project
+
+	This file is part of WMIT.
+
+	WMIT is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	WMIT is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with WMIT.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "MappedFile.hpp"
+
+#include <fstream>
+
+#ifdef _WIN32
+#  include <windows.h>
+#else
+#  include <sys/types.h>
+#  include <sys/stat.h>
+#  include <sys/mman.h>
+#  include <fcntl.h>
+#  include <unistd.h>
+#endif
+
+MappedFile::MappedFile():
+	m_data(0), m_size(0), m_open(false), m_mapped(false), m_buffer(0)
+#ifdef _WIN32
+	, m_file(INVALID_HANDLE_VALUE), m_mapping(0)
+#endif
+{
+}
+
+MappedFile::~MappedFile()
+{
+	close();
+}
+
+bool MappedFile::open(const std::string& fileName)
+{
+	close();
+
+	if (!map(fileName) && !readAll(fileName))
+	{
+		return false;
+	}
+
+	m_open = true;
+	return true;
+}
+
+void MappedFile::close()
+{
+	if (m_mapped)
+	{
+#ifdef _WIN32
+		UnmapViewOfFile(m_data);
+		CloseHandle(m_mapping);
+		CloseHandle(m_file);
+		m_mapping = 0;
+		m_file = INVALID_HANDLE_VALUE;
+#else
+		munmap(const_cast<char*>(m_data), m_size);
+#endif
+	}
+
+	delete[] m_buffer;
+
+	m_buffer = 0;
+	m_data = 0;
+	m_size = 0;
+	m_open = false;
+	m_mapped = false;
+}
+
+bool MappedFile::isOpen() const
+{
+	return m_open;
+}
+
+bool MappedFile::isMapped() const
+{
+	return m_mapped;
+}
+
+const char* MappedFile::data() const
+{
+	return m_data;
+}
+
+size_t MappedFile::size() const
+{
+	return m_size;
+}
+
+#ifdef _WIN32
+bool MappedFile::map(const std::string& fileName)
+{
+	LARGE_INTEGER fsize;
+	HANDLE file, mapping;
+	const void* view;
+
+	file = CreateFileA(fileName.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL,
+			   OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+	if (file == INVALID_HANDLE_VALUE)
+	{
+		return false;
+	}
+
+	// empty files can't be mapped, let readAll deal with them
+	if (!GetFileSizeEx(file, &fsize) || fsize.QuadPart <= 0 ||
+		static_cast<unsigned long long>(fsize.QuadPart) > static_cast<size_t>(-1))
+	{
+		CloseHandle(file);
+		return false;
+	}
+
+	mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+	if (mapping == NULL)
+	{
+		CloseHandle(file);
+		return false;
+	}
+
+	view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+	if (view == NULL)
+	{
+		CloseHandle(mapping);
+		CloseHandle(file);
+		return false;
+	}
+
+	m_file = file;
+	m_mapping = mapping;
+	m_data = static_cast<const char*>(view);
+	m_size = static_cast<size_t>(fsize.QuadPart);
+	m_mapped = true;
+	return true;
+}
+#else
+bool MappedFile::map(const std::string& fileName)
+{
+	struct stat st;
+	void* view;
+	int fd;
+
+	fd = ::open(fileName.c_str(), O_RDONLY);
+	if (fd < 0)
+	{
+		return false;
+	}
+
+	// empty files can't be mapped, let readAll deal with them
+	if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode) || st.st_size <= 0 ||
+		static_cast<unsigned long long>(st.st_size) > static_cast<size_t>(-1))
+	{
+		::close(fd);
+		return false;
+	}
+
+	view = mmap(0, static_cast<size_t>(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+
+	// the mapping keeps its own reference to the file
+	::close(fd);
+
+	if (view == MAP_FAILED)
+	{
+		return false;
+	}
+
+	m_data = static_cast<const char*>(view);
+	m_size = static_cast<size_t>(st.st_size);
+	m_mapped = true;
+	return true;
+}
+#endif
+
+bool MappedFile::readAll(const std::string& fileName)
+{
+	std::ifstream in(fileName.c_str(), std::ios::in | std::ios::binary);
+	std::streamoff fsize;
+
+	if (!in.is_open())
+	{
+		return false;
+	}
+
+	in.seekg(0, std::ios::end);
+	fsize = in.tellg();
+	in.seekg(0, std::ios::beg);
+	if (fsize < 0)
+	{
+		return false;
+	}
+
+	m_size = static_cast<size_t>(fsize);
+	m_buffer = new char[m_size ? m_size : 1];
+	in.read(m_buffer, m_size);
+	if (static_cast<size_t>(in.gcount()) != m_size)
+	{
+		delete[] m_buffer;
+		m_buffer = 0;
+		m_size = 0;
+		return false;
+	}
+
+	m_data = m_buffer;
+	return true;
+}
@@ -0,0 +1,65 @@
+/*
+	Copyright 2010 Warzone 2100 Project
+
+	This file is part of WMIT.
+
+	WMIT is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	WMIT is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with WMIT.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef MAPPEDFILE_HPP
+#define MAPPEDFILE_HPP
+
+#include <cstddef>
+#include <string>
+
+/**
+  * Read-only view on a whole file.
+  *
+  * The file is memory mapped where the platform allows it, otherwise
+  * (or if mapping fails) it is read into a heap buffer. Either way data()
+  * stays valid until close() or destruction.
+  */
+class MappedFile
+{
+public:
+	MappedFile();
+	~MappedFile();
+
+	bool open(const std::string& fileName);
+	void close();
+
+	bool isOpen() const;
+	bool isMapped() const;
+
+	const char* data() const;
+	size_t size() const;
+
+private:
+	// not copyable
+	MappedFile(const MappedFile&);
+	MappedFile& operator=(const MappedFile&);
+
+	bool map(const std::string& fileName);
+	bool readAll(const std::string& fileName);
+
+	const char* m_data;
+	size_t m_size;
+	bool m_open, m_mapped;
+	char* m_buffer;
+#ifdef _WIN32
+	void* m_file;
+	void* m_mapping;
+#endif
+};
+
+#endif // MAPPEDFILE_HPP
@@ -0,0 +1,188 @@
+/*
+	Copyright 2010 Warzone 2100 Project
+
+	This file is part of WMIT.
+
+	WMIT is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	WMIT is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with WMIT.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "Matrix4.hpp"
+
+#include <cmath>
+
+Matrix4::Matrix4()
+{
+	for (unsigned i = 0; i < 16; ++i)
+	{
+		m_m[i] = i % 5 ? 0.f : 1.f;
+	}
+}
+
+Matrix4::Matrix4(const GLfloat* values)
+{
+	for (unsigned i = 0; i < 16; ++i)
+	{
+		m_m[i] = values[i];
+	}
+}
+
+Matrix4 Matrix4::scale(GLfloat x, GLfloat y, GLfloat z)
+{
+	Matrix4 res;
+
+	res(0, 0) = x;
+	res(1, 1) = y;
+	res(2, 2) = z;
+	return res;
+}
+
+Matrix4 Matrix4::translation(GLfloat x, GLfloat y, GLfloat z)
+{
+	Matrix4 res;
+
+	res(0, 3) = x;
+	res(1, 3) = y;
+	res(2, 3) = z;
+	return res;
+}
+
+Matrix4 Matrix4::rotation(GLfloat angle, GLfloat x, GLfloat y, GLfloat z)
+{
+	Matrix4 res;
+	const double len = std::sqrt((double)x * x + (double)y * y + (double)z * z);
+
+	if (len == 0.)
+	{
+		return res;
+	}
+
+	const double ax = x / len, ay = y / len, az = z / len;
+	const double rad = angle * 3.14159265358979323846 / 180.;
+	const double c = std::cos(rad), s = std::sin(rad), t = 1. - c;
+
+	// same matrix glRotatef builds
+	res(0, 0) = ax * ax * t + c;
+	res(0, 1) = ax * ay * t - az * s;
+	res(0, 2) = ax * az * t + ay * s;
+	res(1, 0) = ay * ax * t + az * s;
+	res(1, 1) = ay * ay * t + c;
+	res(1, 2) = ay * az * t - ax * s;
+	res(2, 0) = az * ax * t - ay * s;
+	res(2, 1) = az * ay * t + ax * s;
+	res(2, 2) = az * az * t + c;
+	return res;
+}
+
+Matrix4 Matrix4::mirror(int axis, const Vertex<GLfloat>& point)
+{
+	Matrix4 res;
+	const unsigned i = axis == 0 || axis == 1 ? axis : 2;
+
+	res(i, i) = -1.f;
+	res(i, 3) = 2 * point[i];
+	return res;
+}
+
+Matrix4 Matrix4::operator *(const Matrix4& rhs) const
+{
+	Matrix4 res;
+
+	for (unsigned col = 0; col < 4; ++col)
+	{
+		for (unsigned row = 0; row < 4; ++row)
+		{
+			double sum = 0.;
+			for (unsigned k = 0; k < 4; ++k)
+			{
+				sum += (double)(*this)(row, k) * rhs(k, col);
+			}
+			res(row, col) = sum;
+		}
+	}
+	return res;
+}
+
+Matrix4& Matrix4::operator *=(const Matrix4& rhs)
+{
+	*this = *this * rhs;
+	return *this;
+}
+
+bool Matrix4::operator ==(const Matrix4& rhs) const
+{
+	for (unsigned i = 0; i < 16; ++i)
+	{
+		if (m_m[i] != rhs.m_m[i])
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+bool Matrix4::isIdentity() const
+{
+	return *this == Matrix4();
+}
+
+GLfloat Matrix4::determinant3() const
+{
+	const Matrix4& m = *this;
+
+	return m(0, 0) * ((double)m(1, 1) * m(2, 2) - (double)m(1, 2) * m(2, 1))
+		- m(0, 1) * ((double)m(1, 0) * m(2, 2) - (double)m(1, 2) * m(2, 0))
+		+ m(0, 2) * ((double)m(1, 0) * m(2, 1) - (double)m(1, 1) * m(2, 0));
+}
+
+bool Matrix4::normalMatrix(Matrix4& out) const
+{
+	const Matrix4& m = *this;
+	const double det = determinant3();
+
+	if (det == 0.)
+	{
+		return false;
+	}
+
+	// the inverse is the transposed cofactor matrix over det, so its transpose is the cofactors over det
+	out = Matrix4();
+	out(0, 0) = (m(1, 1) * (double)m(2, 2) - m(1, 2) * (double)m(2, 1)) / det;
+	out(0, 1) = (m(1, 2) * (double)m(2, 0) - m(1, 0) * (double)m(2, 2)) / det;
+	out(0, 2) = (m(1, 0) * (double)m(2, 1) - m(1, 1) * (double)m(2, 0)) / det;
+	out(1, 0) = (m(0, 2) * (double)m(2, 1) - m(0, 1) * (double)m(2, 2)) / det;
+	out(1, 1) = (m(0, 0) * (double)m(2, 2) - m(0, 2) * (double)m(2, 0)) / det;
+	out(1, 2) = (m(0, 1) * (double)m(2, 0) - m(0, 0) * (double)m(2, 1)) / det;
+	out(2, 0) = (m(0, 1) * (double)m(1, 2) - m(0, 2) * (double)m(1, 1)) / det;
+	out(2, 1) = (m(0, 2) * (double)m(1, 0) - m(0, 0) * (double)m(1, 2)) / det;
+	out(2, 2) = (m(0, 0) * (double)m(1, 1) - m(0, 1) * (double)m(1, 0)) / det;
+	return true;
+}
+
+Vertex<GLfloat> Matrix4::transformPoint(const Vertex<GLfloat>& point) const
+{
+	const Matrix4& m = *this;
+
+	return Vertex<GLfloat>(m(0, 0) * point.x() + m(0, 1) * point.y() + m(0, 2) * point.z() + m(0, 3),
+			       m(1, 0) * point.x() + m(1, 1) * point.y() + m(1, 2) * point.z() + m(1, 3),
+			       m(2, 0) * point.x() + m(2, 1) * point.y() + m(2, 2) * point.z() + m(2, 3));
+}
+
+Vertex<GLfloat> Matrix4::transformDirection(const Vertex<GLfloat>& dir) const
+{
+	const Matrix4& m = *this;
+
+	return Vertex<GLfloat>(m(0, 0) * dir.x() + m(0, 1) * dir.y() + m(0, 2) * dir.z(),
+			       m(1, 0) * dir.x() + m(1, 1) * dir.y() + m(1, 2) * dir.z(),
+			       m(2, 0) * dir.x() + m(2, 1) * dir.y() + m(2, 2) * dir.z());
+}
@@ -0,0 +1,79 @@
+/*
+	Copyright 2010 Warzone 2100 Project
+
+	This file is part of WMIT.
+
+	WMIT is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	WMIT is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with WMIT.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef MATRIX4_HPP
+#define MATRIX4_HPP
+
+#include "GLTypes.hpp"
+#include "VectorTypes.hpp"
+
+/**
+  * Affine 4x4 transform, stored column major like glMultMatrixf and the
+  * vertex kernels want it.
+  *
+  * Products compose right to left: (a * b) applies b first, then a.
+  */
+class Matrix4
+{
+public:
+	/// Identity
+	Matrix4();
+	/// Copies 16 column major values, e.g. from glGetFloatv
+	explicit Matrix4(const GLfloat* values);
+
+	static Matrix4 scale(GLfloat x, GLfloat y, GLfloat z);
+	static Matrix4 translation(GLfloat x, GLfloat y, GLfloat z);
+	/// Rotation by angle degrees around the axis (x, y, z), counter clockwise looking down the axis
+	static Matrix4 rotation(GLfloat angle, GLfloat x, GLfloat y, GLfloat z);
+	/// Reflection across the plane through point that is normal to axis (x == 0, y == 1, z == 2)
+	static Matrix4 mirror(int axis, const Vertex<GLfloat>& point = Vertex<GLfloat>());
+
+	inline GLfloat& operator ()(unsigned row, unsigned col) {
+		return m_m[col * 4 + row];
+	}
+	inline GLfloat operator ()(unsigned row, unsigned col) const {
+		return m_m[col * 4 + row];
+	}
+
+	inline const GLfloat* data() const {
+		return m_m;
+	}
+
+	Matrix4 operator *(const Matrix4& rhs) const;
+	Matrix4& operator *=(const Matrix4& rhs);
+	bool operator ==(const Matrix4& rhs) const;
+
+	bool isIdentity() const;
+	/// Determinant of the linear part, negative if the transform mirrors
+	GLfloat determinant3() const;
+	/**
+	  * Inverse transpose of the linear part (no translation), which is what
+	  * normals get transformed with.
+	  *
+	  * @return	false if the linear part is singular
+	  */
+	bool normalMatrix(Matrix4& out) const;
+
+	Vertex<GLfloat> transformPoint(const Vertex<GLfloat>& point) const;
+	Vertex<GLfloat> transformDirection(const Vertex<GLfloat>& dir) const;
+
+private:
+	GLfloat m_m[16];
+};
+
+#endif // MATRIX4_HPP
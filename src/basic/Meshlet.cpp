@@ -0,0 +1,391 @@
+/*
+	Copyright 2010 Warzone 2100 Project
+
+	This file is part of WMIT.
+
+	WMIT is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	WMIT is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with WMIT.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include "Meshlet.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#include "VectorTypes.hpp"
+
+typedef Vertex<GLfloat> Vec3;
+
+static const GLuint noIndex = ~0u;
+
+static inline Vec3 position(const GLfloat* positions, size_t stride, GLuint index)
+{
+	const GLfloat* p = reinterpret_cast<const GLfloat*>(reinterpret_cast<const char*>(positions) + index * stride);
+	return Vec3(p[0], p[1], p[2]);
+}
+
+static inline GLfloat lengthSq(const Vec3& v)
+{
+	return v.dotProduct(v);
+}
+
+// Ritter's bounding sphere: the most distant pair of axis extremes, grown to fit the rest
+static void boundingSphere(const std::vector<Vec3>& points, Vec3& center, GLfloat& radius)
+{
+	size_t minIndex[3] = {0, 0, 0}, maxIndex[3] = {0, 0, 0}, i;
+	GLfloat span = -1.f;
+	int axis, best = 0;
+
+	for (i = 1; i < points.size(); ++i)
+	{
+		for (axis = 0; axis < 3; ++axis)
+		{
+			if (points[i][axis] < points[minIndex[axis]][axis])
+				minIndex[axis] = i;
+			if (points[i][axis] > points[maxIndex[axis]][axis])
+				maxIndex[axis] = i;
+		}
+	}
+	for (axis = 0; axis < 3; ++axis)
+	{
+		const GLfloat s = lengthSq(Vec3(points[maxIndex[axis]] - points[minIndex[axis]]));
+
+		if (s > span)
+		{
+			span = s;
+			best = axis;
+		}
+	}
+
+	center = Vec3((points[minIndex[best]] + points[maxIndex[best]]) * 0.5f);
+	radius = std::sqrt(span) * 0.5f;
+
+	for (i = 0; i < points.size(); ++i)
+	{
+		const GLfloat distSq = lengthSq(Vec3(points[i] - center));
+
+		if (distSq > radius * radius)
+		{
+			const GLfloat dist = std::sqrt(distSq);
+			const GLfloat grown = (radius + dist) * 0.5f;
+
+			center += Vec3((points[i] - center) * ((grown - radius) / dist));
+			radius = grown;
+		}
+	}
+}
+
+static void computeBounds(Meshlet& m, const MeshletSet& set, const GLfloat* positions, size_t stride)
+{
+	std::vector<Vec3> points(m.vertexCount);
+	Vec3 center, axis;
+	GLfloat minDot = 1.f, maxT = 0.f;
+	GLuint i;
+	int j;
+
+	for (i = 0; i < m.vertexCount; ++i)
+	{
+		points[i] = position(positions, stride, set.vertices[m.vertexOffset + i]);
+		for (j = 0; j < 3; ++j)
+		{
+			m.aabbMin[j] = i ? std::min(m.aabbMin[j], points[i][j]) : points[i][j];
+			m.aabbMax[j] = i ? std::max(m.aabbMax[j], points[i][j]) : points[i][j];
+		}
+	}
+
+	boundingSphere(points, center, m.radius);
+
+	// normal cone, after meshoptimizer's meshopt_computeClusterBounds
+	std::vector<Vec3> normals;
+	std::vector<Vec3> corners;
+
+	for (i = 0; i < m.triangleCount; ++i)
+	{
+		const IndexedTri tri = set.triangle(m, i);
+		const Vec3 p0 = position(positions, stride, tri.a());
+		const Vec3 n = Vec3(p0 - position(positions, stride, tri.b()))
+			.crossProduct(Vec3(p0 - position(positions, stride, tri.c())));
+		const GLfloat len = std::sqrt(lengthSq(n));
+
+		if (len > 0.f)
+		{
+			normals.push_back(Vec3(n * (1.f / len)));
+			corners.push_back(p0);
+			axis += normals.back();
+		}
+	}
+
+	const GLfloat axisLen = std::sqrt(lengthSq(axis));
+
+	axis = axisLen > 0.f ? Vec3(axis * (1.f / axisLen)) : Vec3(0.f, 0.f, 1.f);
+	for (i = 0; i < normals.size(); ++i)
+	{
+		minDot = std::min(minDot, axis.dotProduct(normals[i]));
+	}
+
+	// back facing from anywhere means more than a half space of normals, give up well before that
+	if (normals.empty() || minDot <= 0.1f)
+	{
+		minDot = 0.f;
+	}
+	else
+	{
+		// apex is where every triangle plane is in front of it
+		for (i = 0; i < normals.size(); ++i)
+		{
+			const GLfloat t = Vec3(center - corners[i]).dotProduct(normals[i]) / axis.dotProduct(normals[i]);
+
+			maxT = std::max(maxT, t);
+		}
+	}
+
+	const Vec3 apex = Vec3(center - axis * maxT);
+
+	for (j = 0; j < 3; ++j)
+	{
+		m.center[j] = center[j];
+		m.coneApex[j] = apex[j];
+		m.coneAxis[j] = axis[j];
+	}
+	m.coneCutoff = minDot > 0.f ? std::sqrt(1.f - minDot * minDot) : 1.f;
+}
+
+void buildMeshlets(const std::vector<IndexedTri>& tris, const GLfloat* positions, size_t stride,
+		   unsigned vertices, MeshletSet& out, unsigned maxVertices, unsigned maxTriangles)
+{
+	std::vector<GLuint> offsets(vertices + 1, 0), adjacency(tris.size() * 3), fill;
+	std::vector<GLuint> local(vertices, noIndex), candidates;
+	std::vector<Vec3> centroids(tris.size());
+	std::vector<bool> used(tris.size(), false);
+	size_t seed = 0, i, k;
+	int j;
+
+	maxVertices = std::max(3u, std::min(maxVertices, 256u));
+	maxTriangles = std::max(1u, maxTriangles);
+
+	out.meshlets.clear();
+	out.vertices.clear();
+	out.triangles.clear();
+
+	// triangles around each vertex
+	for (i = 0; i < tris.size(); ++i)
+	{
+		Vec3 sum;
+
+		for (j = 0; j < 3; ++j)
+		{
+			++offsets[tris[i][j] + 1];
+			sum += position(positions, stride, tris[i][j]);
+		}
+		centroids[i] = Vec3(sum * (1.f / 3.f));
+	}
+	for (i = 0; i < vertices; ++i)
+	{
+		offsets[i + 1] += offsets[i];
+	}
+	fill.assign(offsets.begin(), offsets.end() - 1);
+	for (i = 0; i < tris.size(); ++i)
+	{
+		for (j = 0; j < 3; ++j)
+		{
+			adjacency[fill[tris[i][j]]++] = i;
+		}
+	}
+
+	for (;;)
+	{
+		while (seed < tris.size() && used[seed])
+		{
+			++seed;
+		}
+		if (seed == tris.size())
+		{
+			break;
+		}
+
+		Meshlet m;
+		Vec3 sum;
+		GLuint next = seed;
+
+		m.vertexOffset = out.vertices.size();
+		m.vertexCount = 0;
+		m.triangleOffset = out.triangles.size() / 3;
+		m.triangleCount = 0;
+		candidates.clear();
+
+		while (next != noIndex)
+		{
+			used[next] = true;
+			for (j = 0; j < 3; ++j)
+			{
+				const GLuint v = tris[next][j];
+
+				if (local[v] == noIndex)
+				{
+					local[v] = m.vertexCount++;
+					out.vertices.push_back(v);
+					candidates.insert(candidates.end(), adjacency.begin() + offsets[v], adjacency.begin() + offsets[v + 1]);
+				}
+				out.triangles.push_back(static_cast<GLubyte>(local[v]));
+			}
+			sum += centroids[next];
+			if (++m.triangleCount == maxTriangles)
+			{
+				break;
+			}
+
+			// fewest new vertices first, then closest to the centre
+			const Vec3 center = Vec3(sum * (1.f / m.triangleCount));
+			GLfloat bestDist = std::numeric_limits<GLfloat>::max();
+			unsigned bestNew = 4;
+
+			next = noIndex;
+			for (i = 0, k = 0; i < candidates.size(); ++i)
+			{
+				const GLuint t = candidates[i];
+				unsigned fresh = 0;
+
+				if (used[t])
+				{
+					continue;
+				}
+				candidates[k++] = t;
+
+				for (j = 0; j < 3; ++j)
+				{
+					fresh += local[tris[t][j]] == noIndex;
+				}
+				if (m.vertexCount + fresh > maxVertices || fresh > bestNew)
+				{
+					continue;
+				}
+
+				const GLfloat dist = lengthSq(Vec3(centroids[t] - center));
+
+				if (fresh < bestNew || dist < bestDist)
+				{
+					bestNew = fresh;
+					bestDist = dist;
+					next = t;
+				}
+			}
+			candidates.resize(k);
+
+			// nothing connected fits, carry on with the next triangle in order (split meshes, flat shading)
+			if (next == noIndex && m.vertexCount + 3 <= maxVertices)
+			{
+				while (seed < tris.size() && used[seed])
+				{
+					++seed;
+				}
+				if (seed < tris.size())
+				{
+					next = seed;
+				}
+			}
+		}
+
+		for (i = m.vertexOffset; i < out.vertices.size(); ++i)
+		{
+			local[out.vertices[i]] = noIndex;
+		}
+		computeBounds(m, out, positions, stride);
+		out.meshlets.push_back(m);
+	}
+}
+
+void buildMeshletRuns(const std::vector<IndexedTri>& tris, const GLfloat* positions, size_t stride,
+		      unsigned vertices, MeshletSet& out, unsigned maxVertices, unsigned maxTriangles)
+{
+	std::vector<GLuint> local(vertices, noIndex);
+	size_t next = 0, i;
+	int j;
+
+	maxVertices = std::max(3u, std::min(maxVertices, 256u));
+	maxTriangles = std::max(1u, maxTriangles);
+
+	out.meshlets.clear();
+	out.vertices.clear();
+	out.triangles.clear();
+
+	while (next < tris.size())
+	{
+		Meshlet m;
+
+		m.vertexOffset = out.vertices.size();
+		m.vertexCount = 0;
+		m.triangleOffset = next;
+		m.triangleCount = 0;
+
+		for (; next < tris.size() && m.triangleCount < maxTriangles; ++next)
+		{
+			unsigned fresh = 0;
+
+			for (j = 0; j < 3; ++j)
+			{
+				fresh += local[tris[next][j]] == noIndex;
+			}
+			if (m.vertexCount + fresh > maxVertices)
+			{
+				break;
+			}
+
+			for (j = 0; j < 3; ++j)
+			{
+				const GLuint v = tris[next][j];
+
+				if (local[v] == noIndex)
+				{
+					local[v] = m.vertexCount++;
+					out.vertices.push_back(v);
+				}
+				out.triangles.push_back(static_cast<GLubyte>(local[v]));
+			}
+			++m.triangleCount;
+		}
+
+		for (i = m.vertexOffset; i < out.vertices.size(); ++i)
+		{
+			local[out.vertices[i]] = noIndex;
+		}
+		computeBounds(m, out, positions, stride);
+		out.meshlets.push_back(m);
+	}
+}
+
+bool meshletBackFacing(const Meshlet& meshlet, const GLfloat eye[3])
+{
+	const Vec3 dir(meshlet.coneApex[0] - eye[0], meshlet.coneApex[1] - eye[1], meshlet.coneApex[2] - eye[2]);
+	const Vec3 axis(meshlet.coneAxis[0], meshlet.coneAxis[1], meshlet.coneAxis[2]);
+
+	if (meshlet.coneCutoff >= 1.f)
+	{
+		return false;
+	}
+	return dir.dotProduct(axis) >= meshlet.coneCutoff * std::sqrt(lengthSq(dir));
+}
+
+MeshletStats meshletStats(const MeshletSet& set)
+{
+	std::vector<Meshlet>::const_iterator it;
+	MeshletStats stats;
+
+	for (it = set.meshlets.begin(); it != set.meshlets.end(); ++it)
+	{
+		++stats.meshlets;
+		stats.vertices += it->vertexCount;
+		stats.triangles += it->triangleCount;
+		stats.cones += it->coneCutoff < 1.f;
+	}
+	return stats;
+}
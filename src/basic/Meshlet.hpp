@@ -0,0 +1,130 @@
+/*
+	Copyright 2010 Warzone 2100 Project
+
+	This file is part of WMIT.
+
+	WMIT is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	WMIT is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with WMIT.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef MESHLET_HPP
+#define MESHLET_HPP
+
+#include <cstddef>
+#include <vector>
+
+#include "GLTypes.hpp"
+#include "Polygon.hpp"
+
+#define MESHLET_MAX_VERTICES 64
+#define MESHLET_MAX_TRIANGLES 124
+
+/**
+  * A bounded cluster of a mesh's triangles with everything needed to cull
+  * it as a whole: an AABB, a bounding sphere and a normal cone.
+  */
+struct Meshlet
+{
+	GLuint vertexOffset, vertexCount;	// into MeshletSet::vertices
+	GLuint triangleOffset, triangleCount;	// into MeshletSet::triangles, in triangles
+
+	GLfloat aabbMin[3], aabbMax[3];
+	GLfloat center[3], radius;
+
+	/*
+	 * Every triangle faces away from a viewer at eye if
+	 * dot(normalize(coneApex - eye), coneAxis) >= coneCutoff,
+	 * a cutoff of 1 or more means the normals spread too much to tell.
+	 */
+	GLfloat coneApex[3], coneAxis[3], coneCutoff;
+};
+
+struct MeshletSet
+{
+	std::vector<Meshlet> meshlets;
+	std::vector<GLuint> vertices;	// mesh vertex of each meshlet vertex
+	std::vector<GLubyte> triangles;	// 3 meshlet local vertex indices per triangle
+
+	/// Triangle i of meshlet m with the mesh's vertex indices
+	IndexedTri triangle(const Meshlet& m, GLuint i) const
+	{
+		const GLubyte* local = &triangles[(m.triangleOffset + i) * 3];
+		IndexedTri tri;
+
+		tri.a() = vertices[m.vertexOffset + local[0]];
+		tri.b() = vertices[m.vertexOffset + local[1]];
+		tri.c() = vertices[m.vertexOffset + local[2]];
+		return tri;
+	}
+};
+
+/// How well a mesh got clustered, summed over meshlets
+struct MeshletStats
+{
+	MeshletStats(): meshlets(0), vertices(0), triangles(0), cones(0) {}
+
+	double verticesPerMeshlet() const
+	{
+		return meshlets ? static_cast<double>(vertices) / meshlets : 0.;
+	}
+
+	double trianglesPerMeshlet() const
+	{
+		return meshlets ? static_cast<double>(triangles) / meshlets : 0.;
+	}
+
+	MeshletStats& operator += (const MeshletStats& rhs)
+	{
+		meshlets += rhs.meshlets;
+		vertices += rhs.vertices;
+		triangles += rhs.triangles;
+		cones += rhs.cones;
+		return *this;
+	}
+
+	size_t meshlets;
+	size_t vertices;
+	size_t triangles;
+	size_t cones;	// meshlets with a normal cone tight enough for back face culling
+};
+
+/**
+  * Splits a mesh into meshlets of up to maxVertices (at most 256) and
+  * maxTriangles each. Every meshlet starts at the first triangle not
+  * taken yet and grows over the triangles next to it, preferring the ones
+  * that need the fewest new vertices, then the ones closest to its centre,
+  * so a vertex cache optimized mesh gives compact clusters.
+  *
+  * Positions are 3 floats, stride bytes apart, every index has to be below
+  * vertices.
+  */
+void buildMeshlets(const std::vector<IndexedTri>& tris, const GLfloat* positions, size_t stride,
+		   unsigned vertices, MeshletSet& out,
+		   unsigned maxVertices = MESHLET_MAX_VERTICES, unsigned maxTriangles = MESHLET_MAX_TRIANGLES);
+
+/**
+  * Splits a mesh into meshlets of consecutive triangles, a new one starts
+  * whenever the next triangle wouldn't fit anymore. Meshlet triangles keep
+  * their index order, so triangleOffset is into tris as well and a vertex
+  * cache or overdraw optimized order survives. Looser than buildMeshlets()
+  * on meshes whose order jumps around, but a single pass.
+  */
+void buildMeshletRuns(const std::vector<IndexedTri>& tris, const GLfloat* positions, size_t stride,
+		      unsigned vertices, MeshletSet& out,
+		      unsigned maxVertices = MESHLET_MAX_VERTICES, unsigned maxTriangles = MESHLET_MAX_TRIANGLES);
+
+MeshletStats meshletStats(const MeshletSet& set);
+
+/// True if every triangle of the meshlet faces away from eye (in the same space as the positions)
+bool meshletBackFacing(const Meshlet& meshlet, const GLfloat eye[3]);
+
+#endif // MESHLET_HPP
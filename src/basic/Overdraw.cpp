@@ -0,0 +1,313 @@
+/*
+	Copyright 2010 Warzone 2100 Project
+
+	This file is part of WMIT.
+
+	WMIT is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	WMIT is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with WMIT.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include "Overdraw.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#include "VectorTypes.hpp"
+
+typedef Vertex<GLfloat> Vec3;
+
+static inline Vec3 position(const GLfloat* positions, size_t stride, GLuint index)
+{
+	const GLfloat* p = reinterpret_cast<const GLfloat*>(reinterpret_cast<const char*>(positions) + index * stride);
+	return Vec3(p[0], p[1], p[2]);
+}
+
+static inline Vec3 normalized(const Vec3& v)
+{
+	const GLfloat len = std::sqrt(v.dotProduct(v));
+	return len > 0.f ? Vec3(v * (1.f / len)) : v;
+}
+
+/*
+ * Measurement
+ */
+
+// i-th of count directions on a Fibonacci sphere, with u x v == dir
+static void viewBasis(unsigned i, unsigned count, Vec3& dir, Vec3& u, Vec3& v)
+{
+	const double golden = 3.14159265358979 * (3. - std::sqrt(5.));
+	const double z = 1. - (2. * i + 1.) / count;
+	const double r = std::sqrt(1. - z * z);
+
+	dir = Vec3(r * std::cos(golden * i), r * std::sin(golden * i), z);
+
+	const Vec3 helper = std::fabs(dir.x()) < 0.9f ? Vec3(1.f, 0.f, 0.f) : Vec3(0.f, 1.f, 0.f);
+	u = normalized(helper.crossProduct(dir));
+	v = dir.crossProduct(u);
+}
+
+static inline float edge(const Vec3& a, const Vec3& b, float x, float y)
+{
+	return (b.x() - a.x()) * (y - a.y()) - (b.y() - a.y()) * (x - a.x());
+}
+
+static void rasterize(const Vec3& p0, const Vec3& p1, const Vec3& p2, unsigned resolution,
+		      std::vector<float>& depth, OverdrawStats& stats)
+{
+	const float area = edge(p0, p1, p2.x(), p2.y());
+	int x, y;
+
+	// back facing or degenerate
+	if (!(area > 0.f))
+	{
+		return;
+	}
+
+	const float max = static_cast<float>(resolution - 1);
+	const int minX = static_cast<int>(std::max(0.f, std::floor(std::min(p0.x(), std::min(p1.x(), p2.x())))));
+	const int minY = static_cast<int>(std::max(0.f, std::floor(std::min(p0.y(), std::min(p1.y(), p2.y())))));
+	const int maxX = static_cast<int>(std::min(max, std::ceil(std::max(p0.x(), std::max(p1.x(), p2.x())))));
+	const int maxY = static_cast<int>(std::min(max, std::ceil(std::max(p0.y(), std::max(p1.y(), p2.y())))));
+
+	for (y = minY; y <= maxY; ++y)
+	{
+		for (x = minX; x <= maxX; ++x)
+		{
+			// sample at the pixel center
+			const float px = x + 0.5f, py = y + 0.5f;
+			const float w0 = edge(p1, p2, px, py);
+			const float w1 = edge(p2, p0, px, py);
+			const float w2 = edge(p0, p1, px, py);
+
+			if (w0 < 0.f || w1 < 0.f || w2 < 0.f)
+			{
+				continue;
+			}
+
+			const float z = (w0 * p0.z() + w1 * p1.z() + w2 * p2.z()) / area;
+			float& stored = depth[y * resolution + x];
+
+			if (z < stored)
+			{
+				stored = z;
+				++stats.shaded;
+			}
+		}
+	}
+}
+
+OverdrawStats measureOverdraw(const std::vector<IndexedTri>& tris, const GLfloat* positions, size_t stride,
+			      unsigned vertices, unsigned directions, unsigned resolution)
+{
+	const float far = std::numeric_limits<float>::infinity();
+	std::vector<Vec3> projected(vertices);
+	std::vector<float> depth;
+	OverdrawStats stats;
+	Vec3 dir, u, v, p;
+	unsigned d, i;
+	size_t t;
+
+	if (tris.empty() || !resolution)
+	{
+		return stats;
+	}
+
+	for (d = 0; d < directions; ++d)
+	{
+		viewBasis(d, directions, dir, u, v);
+
+		// orthographic, looking down -dir, fitted to the mesh
+		float minX = far, minY = far, maxX = -far, maxY = -far;
+		for (i = 0; i < vertices; ++i)
+		{
+			p = position(positions, stride, i);
+			projected[i] = Vec3(p.dotProduct(u), p.dotProduct(v), -p.dotProduct(dir));
+			minX = std::min(minX, projected[i].x());
+			minY = std::min(minY, projected[i].y());
+			maxX = std::max(maxX, projected[i].x());
+			maxY = std::max(maxY, projected[i].y());
+		}
+
+		const float extent = std::max(maxX - minX, maxY - minY);
+		if (!(extent > 0.f))
+		{
+			continue;
+		}
+
+		const float scale = resolution / extent * 0.999f;
+		for (i = 0; i < vertices; ++i)
+		{
+			projected[i].x() = (projected[i].x() - minX) * scale;
+			projected[i].y() = (projected[i].y() - minY) * scale;
+		}
+
+		depth.assign(resolution * resolution, far);
+		for (t = 0; t < tris.size(); ++t)
+		{
+			rasterize(projected[tris[t].a()], projected[tris[t].b()], projected[tris[t].c()],
+				  resolution, depth, stats);
+		}
+
+		for (i = 0; i < depth.size(); ++i)
+		{
+			stats.covered += depth[i] != far;
+		}
+	}
+
+	return stats;
+}
+
+/*
+ * Optimization
+ */
+
+// same FIFO cache as vertexCacheStats
+static const size_t overdrawCacheSize = 16;
+
+// vertices of tri missing the cache, stamps as in vertexCacheStats
+static inline unsigned cacheMisses(const IndexedTri& tri, std::vector<size_t>& stamps, size_t& transforms)
+{
+	unsigned misses = 0;
+	int j;
+
+	for (j = 0; j < 3; ++j)
+	{
+		size_t& stamp = stamps[tri[j]];
+
+		if (!stamp || transforms - stamp >= overdrawCacheSize)
+		{
+			stamp = ++transforms;
+			++misses;
+		}
+	}
+	return misses;
+}
+
+struct OverdrawCluster
+{
+	size_t first, last;
+	float sortKey;
+
+	// outward facing clusters first, the rest stays in cache order
+	bool operator < (const OverdrawCluster& rhs) const
+	{
+		return sortKey > rhs.sortKey;
+	}
+};
+
+void optimizeOverdraw(std::vector<IndexedTri>& tris, const GLfloat* positions, size_t stride,
+		      unsigned vertices, float threshold)
+{
+	const size_t count = tris.size();
+	std::vector<size_t> stamps(vertices, 0), hard;
+	std::vector<OverdrawCluster> clusters;
+	std::vector<Vec3> centroids, normals;
+	std::vector<IndexedTri> out;
+	size_t transforms = 0, i, c, h;
+
+	if (count < 2)
+	{
+		return;
+	}
+
+	// hard boundaries: the cache optimizer started over, all 3 vertices missed
+	for (i = 0; i < count; ++i)
+	{
+		if (cacheMisses(tris[i], stamps, transforms) == 3 || i == 0)
+		{
+			hard.push_back(i);
+		}
+	}
+	hard.push_back(count);
+
+	// soft boundaries: split as soon as a cold started part is within threshold of its hard cluster's ACMR
+	for (h = 0; h + 1 < hard.size(); ++h)
+	{
+		const size_t start = hard[h], end = hard[h + 1];
+		size_t misses = 0, first = start;
+
+		transforms += overdrawCacheSize;
+		for (i = start; i < end; ++i)
+		{
+			misses += cacheMisses(tris[i], stamps, transforms);
+		}
+		const float limit = threshold * misses / (end - start);
+
+		transforms += overdrawCacheSize;
+		misses = 0;
+		for (i = start; i < end; ++i)
+		{
+			misses += cacheMisses(tris[i], stamps, transforms);
+			if (i + 1 == end || misses <= limit * (i + 1 - first))
+			{
+				OverdrawCluster cluster = {first, i + 1, 0.f};
+				clusters.push_back(cluster);
+
+				first = i + 1;
+				misses = 0;
+				transforms += overdrawCacheSize;
+			}
+		}
+	}
+
+	// area weighted centroid and normal per cluster
+	Vec3 meshCentroid;
+	float meshArea = 0.f;
+
+	centroids.resize(clusters.size());
+	normals.resize(clusters.size());
+	for (c = 0; c < clusters.size(); ++c)
+	{
+		float area = 0.f;
+
+		for (i = clusters[c].first; i < clusters[c].last; ++i)
+		{
+			const Vec3 p0 = position(positions, stride, tris[i].a());
+			const Vec3 p1 = position(positions, stride, tris[i].b());
+			const Vec3 p2 = position(positions, stride, tris[i].c());
+			const Vec3 n = Vec3(p1 - p0).crossProduct(p2 - p0);
+			const float triArea = std::sqrt(n.dotProduct(n));
+			Vec3 corners = p0;
+
+			corners += p1;
+			corners += p2;
+			centroids[c] += corners * (triArea / 3.f);
+			normals[c] += n;
+			area += triArea;
+		}
+
+		meshCentroid += centroids[c];
+		meshArea += area;
+		if (area > 0.f)
+		{
+			centroids[c] = centroids[c] * (1.f / area);
+		}
+	}
+	if (meshArea > 0.f)
+	{
+		meshCentroid = meshCentroid * (1.f / meshArea);
+	}
+
+	for (c = 0; c < clusters.size(); ++c)
+	{
+		clusters[c].sortKey = Vec3(centroids[c] - meshCentroid).dotProduct(normalized(normals[c]));
+	}
+	std::stable_sort(clusters.begin(), clusters.end());
+
+	out.reserve(count);
+	for (c = 0; c < clusters.size(); ++c)
+	{
+		out.insert(out.end(), tris.begin() + clusters[c].first, tris.begin() + clusters[c].last);
+	}
+	tris.swap(out);
+}
@@ -0,0 +1,78 @@
+/*
+	Copyright 2010 Warzone 2100 Project
+
+	This file is part of WMIT.
+
+	WMIT is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	WMIT is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with WMIT.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef OVERDRAW_HPP
+#define OVERDRAW_HPP
+
+#include <cstddef>
+#include <vector>
+
+#include "GLTypes.hpp"
+#include "Polygon.hpp"
+
+/// Fragments a mesh produces vs. pixels it covers, averaged over several views
+struct OverdrawStats
+{
+	OverdrawStats(): covered(0), shaded(0) {}
+
+	/// Shaded fragments per covered pixel, 1 is optimal
+	double overdraw() const
+	{
+		return covered ? static_cast<double>(shaded) / covered : 0.;
+	}
+
+	OverdrawStats& operator += (const OverdrawStats& rhs)
+	{
+		covered += rhs.covered;
+		shaded += rhs.shaded;
+		return *this;
+	}
+
+	size_t covered;	// pixels with at least one fragment
+	size_t shaded;	// fragments that passed the depth test
+};
+
+/*
+ * Positions are 3 floats, stride bytes apart (see VertexStream), every
+ * index has to be below vertices.
+ */
+
+/**
+  * Rasterizes the mesh on the CPU from directions views spread evenly over
+  * the sphere, orthographic, resolution pixels square, with back faces
+  * (clockwise in view) culled and a less-than depth test. Vertex positions
+  * are 3 floats, stride bytes apart.
+  */
+OverdrawStats measureOverdraw(const std::vector<IndexedTri>& tris, const GLfloat* positions, size_t stride,
+			      unsigned vertices, unsigned directions = 16, unsigned resolution = 256);
+
+/**
+  * Reorders vertex cache optimized triangles so that the ones likely to
+  * occlude others are drawn first, after Sander, Nehab and Barczak, "Fast
+  * Triangle Reordering for Vertex Locality and Reduced Overdraw" (2007).
+  *
+  * The triangle order is cut into clusters wherever the cache would start
+  * cold anyway and wherever a cluster's ACMR is still within threshold of
+  * its parent's, then clusters are sorted by how much they face away from
+  * the mesh centroid. Triangles inside clusters keep their order, so the
+  * ACMR grows by threshold at most.
+  */
+void optimizeOverdraw(std::vector<IndexedTri>& tris, const GLfloat* positions, size_t stride,
+		      unsigned vertices, float threshold = 1.05f);
+
+#endif // OVERDRAW_HPP
@@ -21,14 +21,15 @@
 
 #include <iostream>
 
-#include <QtOpenGL/qgl.h>
+#include "GLTypes.hpp"
 
 #include "Vector.hpp"
+#include "TextLexer.hpp"
 
 
-struct IndexedTri : public Vector<GLushort,3>
+struct IndexedTri : public Vector<GLuint,3>
 {
-	typedef GLushort indexType;
+	typedef GLuint indexType;
 	indexType& a() {
 		return component[0];
 	}
@@ -63,7 +64,7 @@ public:
 	PiePolygon();
 	virtual ~PiePolygon(){}
 
-	bool read(std::istream& in);
+	bool read(TextLexer& in);
 	void write(std::ostream& out) const;
 
 	unsigned getFrames() const;
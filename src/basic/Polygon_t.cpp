@@ -41,12 +41,12 @@ PiePolygon<U, S, MAX>::PiePolygon():
 }
 
 template<typename U, typename S, size_t MAX>
-bool PiePolygon<U, S, MAX>::read(std::istream& in)
+bool PiePolygon<U, S, MAX>::read(TextLexer& in)
 {
 	unsigned i;
 	clear();
 
-	in >> std::hex >> m_flags >> std::dec >> m_vertices;
+	in.hex(m_flags) >> m_vertices;
 	if (in.fail() || m_vertices > MAX)
 	{
 		clear();
@@ -71,7 +71,7 @@ bool PiePolygon<U, S, MAX>::read(std::istream& in)
 	{
 		in >> m_texCoords[i].u() >> m_texCoords[i].v();
 	}
-	if (in.fail() && !in.eof())
+	if (in.fail())
 	{
 		clear();
 		return false;
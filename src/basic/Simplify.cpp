@@ -0,0 +1,825 @@
+/*
+	Copyright 2010 Warzone 2100 Project
+
+	This file is part of WMIT.
+
+	WMIT is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	WMIT is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with WMIT.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include "Simplify.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+static const GLuint noIndex = ~0u;
+
+// Open border and seam edges weigh this much more than the faces next to them
+static const double borderWeight = 10.;
+
+enum SimplifyVertexKind {KIND_MANIFOLD = 0, KIND_BORDER, KIND_SEAM, KIND_LOCKED};
+
+struct Point
+{
+	double x, y, z;
+};
+
+static inline Point makePoint(double x, double y, double z)
+{
+	Point p = {x, y, z};
+	return p;
+}
+
+static inline Point sub(const Point& a, const Point& b)
+{
+	return makePoint(a.x - b.x, a.y - b.y, a.z - b.z);
+}
+
+static inline Point cross(const Point& a, const Point& b)
+{
+	return makePoint(a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x);
+}
+
+static inline double dot(const Point& a, const Point& b)
+{
+	return a.x * b.x + a.y * b.y + a.z * b.z;
+}
+
+static inline Point readPoint(const GLfloat* data, size_t stride, GLuint index)
+{
+	const GLfloat* p = reinterpret_cast<const GLfloat*>(reinterpret_cast<const char*>(data) + index * stride);
+	return makePoint(p[0], p[1], p[2]);
+}
+
+/// Symmetric 4x4 error quadric, w is the face area it was built from
+struct Quadric
+{
+	Quadric(): a00(0.), a11(0.), a22(0.), a10(0.), a20(0.), a21(0.),
+		b0(0.), b1(0.), b2(0.), c(0.), w(0.) {}
+
+	/// Squared distance to the plane dot(n, p) + d = 0, n of unit length
+	void addPlane(const Point& n, double d, double weight)
+	{
+		a00 += weight * n.x * n.x;
+		a11 += weight * n.y * n.y;
+		a22 += weight * n.z * n.z;
+		a10 += weight * n.y * n.x;
+		a20 += weight * n.z * n.x;
+		a21 += weight * n.z * n.y;
+		b0 += weight * n.x * d;
+		b1 += weight * n.y * d;
+		b2 += weight * n.z * d;
+		c += weight * d * d;
+	}
+
+	Quadric& operator += (const Quadric& rhs)
+	{
+		a00 += rhs.a00; a11 += rhs.a11; a22 += rhs.a22;
+		a10 += rhs.a10; a20 += rhs.a20; a21 += rhs.a21;
+		b0 += rhs.b0; b1 += rhs.b1; b2 += rhs.b2;
+		c += rhs.c;
+		w += rhs.w;
+		return *this;
+	}
+
+	/// Area weighted mean squared distance of p to the planes
+	double error(const Point& p) const
+	{
+		const double rx = a00 * p.x + a10 * p.y + a20 * p.z;
+		const double ry = a10 * p.x + a11 * p.y + a21 * p.z;
+		const double rz = a20 * p.x + a21 * p.y + a22 * p.z;
+		const double e = p.x * rx + p.y * ry + p.z * rz + 2. * (b0 * p.x + b1 * p.y + b2 * p.z) + c;
+
+		return std::max(e, 0.) / (w > 0. ? w : 1.);
+	}
+
+	double a00, a11, a22, a10, a20, a21;
+	double b0, b1, b2;
+	double c;
+	double w;
+};
+
+// Orders vertex indices by position, ties by index
+struct PositionLess
+{
+	PositionLess(const std::vector<Point>& positions): m_positions(positions) {}
+
+	bool operator()(GLuint lhs, GLuint rhs) const
+	{
+		const Point& a = m_positions[lhs];
+		const Point& b = m_positions[rhs];
+
+		if (a.x != b.x)
+			return a.x < b.x;
+		if (a.y != b.y)
+			return a.y < b.y;
+		if (a.z != b.z)
+			return a.z < b.z;
+		return lhs < rhs;
+	}
+
+private:
+	const std::vector<Point>& m_positions;
+};
+
+// Orders collapse candidates by error, ties by index
+struct CollapseLess
+{
+	CollapseLess(const std::vector<double>& errors): m_errors(errors) {}
+
+	bool operator()(GLuint lhs, GLuint rhs) const
+	{
+		if (m_errors[lhs] != m_errors[rhs])
+			return m_errors[lhs] < m_errors[rhs];
+		return lhs < rhs;
+	}
+
+private:
+	const std::vector<double>& m_errors;
+};
+
+class QuadricSimplifier
+{
+public:
+	QuadricSimplifier(std::vector<IndexedTri>& tris, const GLfloat* positions, const GLfloat* normals,
+			  size_t stride, unsigned vertices, const std::vector<bool>& locked);
+
+	/**
+	  * One round of collapses that don't touch each other's triangles,
+	  * cheapest first. Returns false if there was nothing to collapse.
+	  */
+	bool pass(size_t targetTriangles, double maxError);
+
+	/// Largest squared error so far
+	double error() const
+	{
+		return m_error;
+	}
+
+private:
+	std::vector<IndexedTri>& m_tris;
+	unsigned m_vertices;
+
+	std::vector<Point> m_positions;	// scaled to the unit cube
+	std::vector<Point> m_normals;	// empty without normals
+	std::vector<bool> m_locked;
+	std::vector<GLuint> m_remap;	// first vertex with the same position
+	std::vector<GLuint> m_wedges;	// next vertex with the same position, circular
+	std::vector<Quadric> m_quadrics;	// indexed by m_remap
+	double m_error;
+
+	// rebuilt every pass
+	std::vector<GLuint> m_edgeOffsets, m_edges;	// outgoing half edges of each vertex
+	std::vector<GLuint> m_triOffsets, m_triList;	// triangles around each vertex
+	std::vector<unsigned char> m_kinds;
+
+	void buildAdjacency();
+	void classify();
+	void addQuadrics();
+	void compact(const std::vector<GLuint>& collapses);
+
+	bool hasEdge(GLuint a, GLuint b) const;
+	bool hasPositionEdge(GLuint a, GLuint b) const;
+	bool isUsed(GLuint v) const;
+	GLuint otherWedge(GLuint v) const;
+	GLuint seamTwin(GLuint v, GLuint u) const;
+	bool canCollapse(GLuint v, GLuint u) const;
+	double collapseError(GLuint v, GLuint u) const;
+	bool flipsTriangle(GLuint v, GLuint u) const;
+	bool breaksManifold(GLuint v, GLuint u) const;
+};
+
+QuadricSimplifier::QuadricSimplifier(std::vector<IndexedTri>& tris, const GLfloat* positions, const GLfloat* normals,
+				     size_t stride, unsigned vertices, const std::vector<bool>& locked):
+	m_tris(tris), m_vertices(vertices), m_positions(vertices), m_locked(vertices, false),
+	m_remap(vertices), m_wedges(vertices), m_quadrics(vertices), m_error(0.)
+{
+	std::vector<GLuint> order;
+	Point lo, hi;
+	double extent;
+	GLuint v;
+	size_t i;
+
+	lo = makePoint(std::numeric_limits<double>::max(), std::numeric_limits<double>::max(),
+		       std::numeric_limits<double>::max());
+	hi = makePoint(-lo.x, -lo.y, -lo.z);
+
+	for (v = 0; v < vertices; ++v)
+	{
+		const Point p = readPoint(positions, stride, v);
+
+		m_positions[v] = p;
+		if (v < locked.size() && locked[v])
+		{
+			m_locked[v] = true;
+		}
+
+		// NaNs and infinities would break the ordering below
+		if (!(std::fabs(p.x) <= std::numeric_limits<double>::max()
+		      && std::fabs(p.y) <= std::numeric_limits<double>::max()
+		      && std::fabs(p.z) <= std::numeric_limits<double>::max()))
+		{
+			m_locked[v] = true;
+			m_remap[v] = m_wedges[v] = v;
+			continue;
+		}
+
+		lo = makePoint(std::min(lo.x, p.x), std::min(lo.y, p.y), std::min(lo.z, p.z));
+		hi = makePoint(std::max(hi.x, p.x), std::max(hi.y, p.y), std::max(hi.z, p.z));
+		order.push_back(v);
+	}
+
+	if (normals)
+	{
+		m_normals.resize(vertices);
+		for (v = 0; v < vertices; ++v)
+		{
+			m_normals[v] = readPoint(normals, stride, v);
+		}
+	}
+
+	// wedges: runs of equal positions, linked into circles
+	std::sort(order.begin(), order.end(), PositionLess(m_positions));
+	for (i = 0; i < order.size(); )
+	{
+		const Point& p = m_positions[order[i]];
+		size_t end = i + 1;
+
+		while (end < order.size() && m_positions[order[end]].x == p.x
+		       && m_positions[order[end]].y == p.y && m_positions[order[end]].z == p.z)
+		{
+			++end;
+		}
+		for (size_t j = i; j < end; ++j)
+		{
+			m_remap[order[j]] = order[i];
+			m_wedges[order[j]] = order[j + 1 < end ? j + 1 : i];
+		}
+		i = end;
+	}
+
+	// errors are relative to the largest extent
+	extent = std::max(hi.x - lo.x, std::max(hi.y - lo.y, hi.z - lo.z));
+	if (!(extent > 0.))
+	{
+		extent = 1.;
+	}
+	for (i = 0; i < order.size(); ++i)
+	{
+		Point& p = m_positions[order[i]];
+		p = makePoint((p.x - lo.x) / extent, (p.y - lo.y) / extent, (p.z - lo.z) / extent);
+	}
+
+	// drop triangles that have no area to begin with
+	compact(std::vector<GLuint>());
+
+	buildAdjacency();
+	addQuadrics();
+}
+
+void QuadricSimplifier::buildAdjacency()
+{
+	std::vector<GLuint> fill;
+	size_t i;
+	int j;
+
+	m_edgeOffsets.assign(m_vertices + 1, 0);
+	for (i = 0; i < m_tris.size(); ++i)
+	{
+		for (j = 0; j < 3; ++j)
+		{
+			++m_edgeOffsets[m_tris[i][j] + 1];
+		}
+	}
+	for (i = 0; i < m_vertices; ++i)
+	{
+		m_edgeOffsets[i + 1] += m_edgeOffsets[i];
+	}
+
+	// every corner has one outgoing edge and one triangle, so the offsets are the same
+	m_triOffsets = m_edgeOffsets;
+	m_edges.resize(m_edgeOffsets[m_vertices]);
+	m_triList.resize(m_edgeOffsets[m_vertices]);
+
+	fill.assign(m_edgeOffsets.begin(), m_edgeOffsets.end() - 1);
+	for (i = 0; i < m_tris.size(); ++i)
+	{
+		for (j = 0; j < 3; ++j)
+		{
+			const GLuint v = m_tris[i][j];
+
+			m_edges[fill[v]] = m_tris[i][(j + 1) % 3];
+			m_triList[fill[v]] = i;
+			++fill[v];
+		}
+	}
+}
+
+bool QuadricSimplifier::hasEdge(GLuint a, GLuint b) const
+{
+	GLuint k;
+
+	for (k = m_edgeOffsets[a]; k < m_edgeOffsets[a + 1]; ++k)
+	{
+		if (m_edges[k] == b)
+		{
+			return true;
+		}
+	}
+	return false;
+}
+
+// Edge between the positions of a and b, from any wedge to any wedge
+bool QuadricSimplifier::hasPositionEdge(GLuint a, GLuint b) const
+{
+	const GLuint target = m_remap[b];
+	GLuint w = a, k;
+
+	do
+	{
+		for (k = m_edgeOffsets[w]; k < m_edgeOffsets[w + 1]; ++k)
+		{
+			if (m_remap[m_edges[k]] == target)
+			{
+				return true;
+			}
+		}
+		w = m_wedges[w];
+	} while (w != a);
+
+	return false;
+}
+
+bool QuadricSimplifier::isUsed(GLuint v) const
+{
+	return m_edgeOffsets[v + 1] > m_edgeOffsets[v];
+}
+
+GLuint QuadricSimplifier::otherWedge(GLuint v) const
+{
+	GLuint w;
+
+	for (w = m_wedges[v]; w != v; w = m_wedges[w])
+	{
+		if (isUsed(w))
+		{
+			return w;
+		}
+	}
+	return noIndex;
+}
+
+// Wedge of u's position that's on the same side of the seam as v's other wedge
+GLuint QuadricSimplifier::seamTwin(GLuint v, GLuint u) const
+{
+	const GLuint v2 = otherWedge(v);
+	GLuint w;
+
+	if (v2 == noIndex)
+	{
+		return noIndex;
+	}
+	for (w = m_wedges[u]; w != u; w = m_wedges[w])
+	{
+		if (hasEdge(v2, w) || hasEdge(w, v2))
+		{
+			return w;
+		}
+	}
+	return noIndex;
+}
+
+void QuadricSimplifier::classify()
+{
+	std::vector<unsigned> openOut(m_vertices, 0), openIn(m_vertices, 0);
+	std::vector<unsigned> seamOut(m_vertices, 0), seamIn(m_vertices, 0);
+	size_t i;
+	GLuint v, w;
+	int j;
+
+	for (i = 0; i < m_tris.size(); ++i)
+	{
+		for (j = 0; j < 3; ++j)
+		{
+			const GLuint a = m_tris[i][j], b = m_tris[i][(j + 1) % 3];
+
+			if (!hasPositionEdge(b, a))
+			{
+				++openOut[a];
+				++openIn[b];
+			}
+			else if (!hasEdge(b, a))
+			{
+				++seamOut[a];
+				++seamIn[b];
+			}
+		}
+	}
+
+	m_kinds.assign(m_vertices, KIND_LOCKED);
+	for (v = 0; v < m_vertices; ++v)
+	{
+		unsigned wedges = 0, out = 0, in = 0;
+		bool locked = false, seams = true;
+		unsigned char kind;
+
+		if (m_remap[v] != v)
+		{
+			continue;
+		}
+
+		w = v;
+		do
+		{
+			if (isUsed(w))
+			{
+				++wedges;
+				out += openOut[w];
+				in += openIn[w];
+				locked = locked || m_locked[w];
+				seams = seams && seamOut[w] == 1 && seamIn[w] == 1;
+			}
+			w = m_wedges[w];
+		} while (w != v);
+
+		if (locked)
+			kind = KIND_LOCKED;
+		else if (wedges == 1 && out == 0 && in == 0)
+			kind = KIND_MANIFOLD;
+		else if (wedges == 1 && out == 1 && in == 1)
+			kind = KIND_BORDER;
+		else if (wedges == 2 && out == 0 && in == 0 && seams)
+			kind = KIND_SEAM;
+		else
+			kind = KIND_LOCKED;
+
+		w = v;
+		do
+		{
+			m_kinds[w] = kind;
+			w = m_wedges[w];
+		} while (w != v);
+	}
+}
+
+void QuadricSimplifier::addQuadrics()
+{
+	size_t i;
+	int j;
+
+	for (i = 0; i < m_tris.size(); ++i)
+	{
+		const IndexedTri& tri = m_tris[i];
+		Point n = cross(sub(m_positions[tri[1]], m_positions[tri[0]]),
+				sub(m_positions[tri[2]], m_positions[tri[0]]));
+		const double len = std::sqrt(dot(n, n));
+		Quadric face;
+
+		if (!(len > 0.))
+		{
+			continue;
+		}
+		n = makePoint(n.x / len, n.y / len, n.z / len);
+		face.addPlane(n, -dot(n, m_positions[tri[0]]), len * 0.5);
+		face.w = len * 0.5;
+
+		for (j = 0; j < 3; ++j)
+		{
+			const GLuint a = tri[j], b = tri[(j + 1) % 3];
+
+			m_quadrics[m_remap[a]] += face;
+
+			// keep open borders and seams in place with a plane standing on the edge
+			if (!hasEdge(b, a))
+			{
+				const Point e = sub(m_positions[b], m_positions[a]);
+				Point m = cross(e, n);
+				const double mlen = std::sqrt(dot(m, m));
+				Quadric edge;
+
+				if (mlen > 0.)
+				{
+					m = makePoint(m.x / mlen, m.y / mlen, m.z / mlen);
+					edge.addPlane(m, -dot(m, m_positions[a]), dot(e, e) * borderWeight);
+					m_quadrics[m_remap[a]] += edge;
+					m_quadrics[m_remap[b]] += edge;
+				}
+			}
+		}
+	}
+}
+
+bool QuadricSimplifier::canCollapse(GLuint v, GLuint u) const
+{
+	if (m_remap[v] == m_remap[u])
+	{
+		return false;
+	}
+
+	switch (m_kinds[v])
+	{
+	case KIND_MANIFOLD:
+		return true;
+	case KIND_BORDER:
+		// only along the border
+		return (m_kinds[u] == KIND_BORDER || m_kinds[u] == KIND_LOCKED)
+			&& (!hasPositionEdge(u, v) || !hasPositionEdge(v, u));
+	case KIND_SEAM:
+		// only along the seam, and the other side has to be able to follow
+		return (m_kinds[u] == KIND_SEAM || m_kinds[u] == KIND_LOCKED)
+			&& (!hasEdge(u, v) || !hasEdge(v, u))
+			&& seamTwin(v, u) != noIndex;
+	default:
+		return false;
+	}
+}
+
+double QuadricSimplifier::collapseError(GLuint v, GLuint u) const
+{
+	double error = m_quadrics[m_remap[v]].error(m_positions[u]);
+
+	if (!m_normals.empty())
+	{
+		const Point d = sub(m_positions[u], m_positions[v]);
+
+		error += (1. - dot(m_normals[v], m_normals[u])) * dot(d, d);
+	}
+	return error;
+}
+
+// Would moving every wedge of v onto u turn a remaining triangle over (by more than ~75 degrees)?
+bool QuadricSimplifier::flipsTriangle(GLuint v, GLuint u) const
+{
+	const GLuint gu = m_remap[u];
+	GLuint w = v, k;
+	int j;
+
+	do
+	{
+		for (k = m_triOffsets[w]; k < m_triOffsets[w + 1]; ++k)
+		{
+			const IndexedTri& tri = m_tris[m_triList[k]];
+			Point p[3];
+			bool collapses = false;
+
+			for (j = 0; j < 3; ++j)
+			{
+				p[j] = m_positions[tri[j]];
+				collapses = collapses || m_remap[tri[j]] == gu;
+			}
+			if (collapses)
+			{
+				continue;
+			}
+
+			const Point before = cross(sub(p[1], p[0]), sub(p[2], p[0]));
+
+			for (j = 0; j < 3; ++j)
+			{
+				if (tri[j] == w)
+				{
+					p[j] = m_positions[u];
+				}
+			}
+
+			const Point after = cross(sub(p[1], p[0]), sub(p[2], p[0]));
+
+			if (dot(before, after) <= 0.25 * std::sqrt(dot(before, before) * dot(after, after)))
+			{
+				return true;
+			}
+		}
+		w = m_wedges[w];
+	} while (w != v);
+
+	return false;
+}
+
+/*
+ * Link condition: v and u may only share the neighbours opposite their
+ * common edge, any other shared neighbour would end up with an edge used
+ * by more than two triangles.
+ */
+bool QuadricSimplifier::breaksManifold(GLuint v, GLuint u) const
+{
+	const GLuint gv = m_remap[v], gu = m_remap[u];
+	std::vector<GLuint> neighbours, opposite;
+	GLuint w, k;
+	int j;
+
+	w = v;
+	do
+	{
+		for (k = m_triOffsets[w]; k < m_triOffsets[w + 1]; ++k)
+		{
+			const IndexedTri& tri = m_tris[m_triList[k]];
+			bool shared = false;
+
+			for (j = 0; j < 3; ++j)
+			{
+				shared = shared || m_remap[tri[j]] == gu;
+			}
+			for (j = 0; j < 3; ++j)
+			{
+				const GLuint g = m_remap[tri[j]];
+
+				if (g != gv && g != gu)
+				{
+					(shared ? opposite : neighbours).push_back(g);
+				}
+			}
+		}
+		w = m_wedges[w];
+	} while (w != v);
+
+	w = u;
+	do
+	{
+		for (k = m_triOffsets[w]; k < m_triOffsets[w + 1]; ++k)
+		{
+			const IndexedTri& tri = m_tris[m_triList[k]];
+
+			for (j = 0; j < 3; ++j)
+			{
+				const GLuint g = m_remap[tri[j]];
+
+				if (std::find(neighbours.begin(), neighbours.end(), g) != neighbours.end()
+				    && std::find(opposite.begin(), opposite.end(), g) == opposite.end())
+				{
+					return true;
+				}
+			}
+		}
+		w = m_wedges[w];
+	} while (w != u);
+
+	return false;
+}
+
+bool QuadricSimplifier::pass(size_t targetTriangles, double maxError)
+{
+	std::vector<GLuint> targets(m_vertices, noIndex), order, collapses;
+	std::vector<double> errors(m_vertices, std::numeric_limits<double>::max());
+	std::vector<bool> touched(m_vertices, false);
+	size_t triangles = m_tris.size(), done = 0, i;
+	double limit;
+	GLuint k;
+	int j;
+
+	buildAdjacency();
+	classify();
+
+	// cheapest collapse of every vertex
+	for (i = 0; i < m_tris.size(); ++i)
+	{
+		for (j = 0; j < 6; ++j)
+		{
+			const GLuint v = m_tris[i][j % 3];
+			const GLuint u = m_tris[i][(j % 3 + (j < 3 ? 1 : 2)) % 3];
+
+			if (m_kinds[v] != KIND_LOCKED && canCollapse(v, u))
+			{
+				const double error = collapseError(v, u);
+
+				if (error < errors[v])
+				{
+					errors[v] = error;
+					targets[v] = u;
+				}
+			}
+		}
+	}
+
+	for (k = 0; k < m_vertices; ++k)
+	{
+		if (targets[k] != noIndex && errors[k] <= maxError)
+		{
+			order.push_back(k);
+		}
+	}
+	if (order.empty())
+	{
+		return false;
+	}
+	std::sort(order.begin(), order.end(), CollapseLess(errors));
+
+	// only the cheaper half per pass (unless none of it works out), the rest
+	// gets another look once their neighbourhoods have changed
+	limit = errors[order[(order.size() - 1) / 2]];
+
+	collapses.resize(m_vertices);
+	for (k = 0; k < m_vertices; ++k)
+	{
+		collapses[k] = k;
+	}
+
+	for (i = 0; i < order.size() && triangles > targetTriangles; ++i)
+	{
+		const GLuint v = order[i], u = targets[v];
+		const GLuint gv = m_remap[v], gu = m_remap[u];
+		size_t removed = 0;
+		GLuint w;
+
+		if (errors[v] > limit && done)
+		{
+			break;
+		}
+		if (touched[gv] || touched[gu] || flipsTriangle(v, u) || breaksManifold(v, u))
+		{
+			continue;
+		}
+
+		collapses[v] = u;
+		if (m_kinds[v] == KIND_SEAM)
+		{
+			collapses[otherWedge(v)] = seamTwin(v, u);
+		}
+
+		// lock the neighbourhood for the rest of the pass
+		touched[gv] = touched[gu] = true;
+		w = v;
+		do
+		{
+			for (k = m_triOffsets[w]; k < m_triOffsets[w + 1]; ++k)
+			{
+				const IndexedTri& tri = m_tris[m_triList[k]];
+				bool collapsed = false;
+
+				for (j = 0; j < 3; ++j)
+				{
+					touched[m_remap[tri[j]]] = true;
+					collapsed = collapsed || m_remap[tri[j]] == gu;
+				}
+				removed += collapsed;
+			}
+			w = m_wedges[w];
+		} while (w != v);
+
+		m_quadrics[gu] += m_quadrics[gv];
+		m_error = std::max(m_error, errors[v]);
+		triangles -= std::min(removed, triangles);
+		++done;
+	}
+
+	if (!done)
+	{
+		return false;
+	}
+	compact(collapses);
+	return true;
+}
+
+// Applies the collapses (if any) and drops the triangles left without area
+void QuadricSimplifier::compact(const std::vector<GLuint>& collapses)
+{
+	size_t i, out = 0;
+	int j;
+
+	for (i = 0; i < m_tris.size(); ++i)
+	{
+		IndexedTri tri = m_tris[i];
+
+		if (!collapses.empty())
+		{
+			for (j = 0; j < 3; ++j)
+			{
+				tri[j] = collapses[tri[j]];
+			}
+		}
+		if (m_remap[tri[0]] == m_remap[tri[1]] || m_remap[tri[1]] == m_remap[tri[2]]
+		    || m_remap[tri[0]] == m_remap[tri[2]])
+		{
+			continue;
+		}
+		m_tris[out++] = tri;
+	}
+	m_tris.resize(out);
+}
+
+float simplifyTriangles(std::vector<IndexedTri>& tris, const GLfloat* positions, const GLfloat* normals,
+			size_t stride, unsigned vertices, const std::vector<bool>& locked,
+			size_t targetTriangles, float maxError)
+{
+	if (tris.size() <= targetTriangles || !vertices)
+	{
+		return 0.f;
+	}
+
+	QuadricSimplifier simplifier(tris, positions, normals, stride, vertices, locked);
+	const double maxError2 = static_cast<double>(maxError) * maxError;
+
+	while (tris.size() > targetTriangles && simplifier.pass(targetTriangles, maxError2))
+	{
+	}
+	return static_cast<float>(std::sqrt(simplifier.error()));
+}
@@ -0,0 +1,53 @@
+/*
+	Copyright 2010 Warzone 2100 Project
+
+	This file is part of WMIT.
+
+	WMIT is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	WMIT is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with WMIT.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef SIMPLIFY_HPP
+#define SIMPLIFY_HPP
+
+#include <cstddef>
+#include <vector>
+
+#include "GLTypes.hpp"
+#include "Polygon.hpp"
+
+/**
+  * Quadric error metric decimation after Garland and Heckbert, "Surface
+  * Simplification Using Quadric Error Metrics" (1997). Edges are collapsed
+  * onto one of their vertices, so every vertex that's left keeps its uv,
+  * normal and tangent as they are and no attributes get interpolated.
+  *
+  * Vertices sharing a position are wedges of one corner. A corner split in
+  * two by a uv or normal seam only collapses along that seam, with both
+  * wedges moving together, a corner on an open border only along the
+  * border. Anything more complex, and every vertex flagged in locked (may
+  * be empty), stays where it is. Collapses turning a triangle over are
+  * skipped, collapses between diverging normals cost extra.
+  *
+  * Positions and normals are 3 floats, stride bytes apart. Stops at
+  * targetTriangles, before a collapse would move the surface by more than
+  * maxError (relative to the largest extent of the mesh), or when nothing
+  * can be collapsed anymore. Vertices are never renumbered, the ones left
+  * unused simply aren't referenced anymore.
+  *
+  * @return	error of the most expensive collapse done
+  */
+float simplifyTriangles(std::vector<IndexedTri>& tris, const GLfloat* positions, const GLfloat* normals,
+			size_t stride, unsigned vertices, const std::vector<bool>& locked,
+			size_t targetTriangles, float maxError = 1.f);
+
+#endif // SIMPLIFY_HPP
@@ -0,0 +1,223 @@
+/*
+	Copyright 2010 Warzone 2100 Project
+
+	This file is part of WMIT.
+
+	WMIT is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	WMIT is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with WMIT.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef SPATIALHASH_HPP
+#define SPATIALHASH_HPP
+
+#include <cstddef>
+#include <cmath>
+#include <utility>
+#include <vector>
+
+/**
+  * Epsilon aware hash index used to weld vertex-like values.
+  *
+  * Values are bucketed by a quantized 3 component key (usually the position),
+  * lookups probe every cell within keyEps() of the key and then run the full
+  * epsilon comparison on the candidates. If several stored values match, the
+  * one inserted first wins, which gives the same result as a std::find_if over
+  * the insertion order.
+  *
+  * This isn't what the old std::set<..., less_wEps> dedup did on noisy input:
+  * less_wEps isn't a strict weak ordering, so the set only compared against
+  * the values along its search path and kept some values within eps of each
+  * other apart. Exact duplicates weld the same, near-equal ones (jittered
+  * positions, flat shaded normals) end up on fewer vertices than before.
+  *
+  * Traits must provide:
+  *	float keyEps() const;				// max per-component key difference of equal values
+  *	void key(const T& val, float out[3]) const;	// spatial key of a value
+  *	bool equal(const T& lhs, const T& rhs) const;	// full epsilon comparison
+  */
+template <typename T, typename Traits>
+class SpatialHash
+{
+public:
+	static const unsigned npos = ~0u;
+
+	SpatialHash(const Traits& traits = Traits()): m_traits(traits)
+	{
+		// Probe window is slightly wider than eps to absorb rounding, cells
+		// are twice the window so each axis needs 2 probes at most.
+		m_window = traits.keyEps() * 1.01;
+		m_cellSize = 2 * m_window;
+		rehash(16);
+	}
+
+	void reserve(size_t size)
+	{
+		m_values.reserve(size);
+		m_cellHashes.reserve(size);
+		m_next.reserve(size);
+		if (size > m_buckets.size())
+		{
+			rehash(size);
+		}
+	}
+
+	void clear()
+	{
+		m_values.clear();
+		m_cellHashes.clear();
+		m_next.clear();
+		m_buckets.assign(m_buckets.size(), npos);
+	}
+
+	size_t size() const
+	{
+		return m_values.size();
+	}
+
+	const T& operator [](unsigned index) const
+	{
+		return m_values[index];
+	}
+
+	const std::vector<T>& values() const
+	{
+		return m_values;
+	}
+
+	/// Returns the index of the first stored value equal to val, or npos.
+	unsigned find(const T& val) const
+	{
+		float key[3];
+		long long lo[3], hi[3], cell[3];
+		unsigned found = npos;
+
+		m_traits.key(val, key);
+		for (int i = 0; i < 3; ++i)
+		{
+			lo[i] = quantize(key[i] - m_window);
+			hi[i] = quantize(key[i] + m_window);
+		}
+
+		for (cell[0] = lo[0]; cell[0] <= hi[0]; ++cell[0])
+		{
+			for (cell[1] = lo[1]; cell[1] <= hi[1]; ++cell[1])
+			{
+				for (cell[2] = lo[2]; cell[2] <= hi[2]; ++cell[2])
+				{
+					const unsigned hash = hashCell(cell);
+					unsigned idx = m_buckets[hash & (m_buckets.size() - 1)];
+
+					for (; idx != npos; idx = m_next[idx])
+					{
+						if (idx < found && m_cellHashes[idx] == hash && m_traits.equal(m_values[idx], val))
+						{
+							found = idx;
+						}
+					}
+				}
+			}
+		}
+
+		return found;
+	}
+
+	/**
+	  * Inserts val unless an equal value is already stored.
+	  *
+	  * @return	index of the stored value and whether val was inserted
+	  */
+	std::pair<unsigned, bool> insert(const T& val)
+	{
+		unsigned found = find(val);
+		if (found != npos)
+		{
+			return std::make_pair(found, false);
+		}
+
+		if (m_values.size() >= m_buckets.size())
+		{
+			rehash(m_buckets.size() * 2);
+		}
+
+		float key[3];
+		long long cell[3];
+
+		m_traits.key(val, key);
+		for (int i = 0; i < 3; ++i)
+		{
+			cell[i] = quantize(key[i]);
+		}
+
+		const unsigned idx = m_values.size();
+		const unsigned hash = hashCell(cell);
+		unsigned& bucket = m_buckets[hash & (m_buckets.size() - 1)];
+
+		m_values.push_back(val);
+		m_cellHashes.push_back(hash);
+		m_next.push_back(bucket);
+		bucket = idx;
+
+		return std::make_pair(idx, true);
+	}
+
+private:
+	long long quantize(double k) const
+	{
+		const double q = std::floor(k / m_cellSize);
+
+		// NaN and values we can't represent all end up in the same cell
+		if (!(q > -4.6e18 && q < 4.6e18))
+		{
+			return 0;
+		}
+		return static_cast<long long>(q);
+	}
+
+	static unsigned hashCell(const long long cell[3])
+	{
+		unsigned long long h = cell[0] * 0x9E3779B97F4A7C15ULL;
+		h ^= cell[1] * 0xC2B2AE3D27D4EB4FULL;
+		h ^= cell[2] * 0x165667B19E3779F9ULL;
+		h ^= h >> 29;
+		return static_cast<unsigned>(h ^ (h >> 32));
+	}
+
+	void rehash(size_t minBuckets)
+	{
+		size_t buckets = 16;
+		while (buckets < minBuckets)
+		{
+			buckets *= 2;
+		}
+
+		m_buckets.assign(buckets, npos);
+		for (unsigned idx = 0; idx < m_values.size(); ++idx)
+		{
+			unsigned& bucket = m_buckets[m_cellHashes[idx] & (buckets - 1)];
+			m_next[idx] = bucket;
+			bucket = idx;
+		}
+	}
+
+	Traits m_traits;
+	double m_window, m_cellSize;
+
+	std::vector<T> m_values;
+	std::vector<unsigned> m_cellHashes;
+	std::vector<unsigned> m_next;
+	std::vector<unsigned> m_buckets;
+};
+
+template <typename T, typename Traits>
+const unsigned SpatialHash<T, Traits>::npos;
+
+#endif // SPATIALHASH_HPP
@@ -0,0 +1,163 @@
+/*
+	Copyright 2010 Warzone 2100 Project
+
+	This file is part of WMIT.
+
+	WMIT is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	WMIT is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with WMIT.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include "TaskPool.hpp"
+
+#ifdef CPP0X_AVAILABLE
+#  include <algorithm>
+#  include <atomic>
+#  include <deque>
+#  include <functional>
+#  include <mutex>
+#  include <thread>
+#endif
+
+#ifdef CPP0X_AVAILABLE
+/**
+  * Per worker task queue: the owner takes from the front (so it works
+  * through its share in order), idle workers steal from the back.
+  */
+struct TaskQueue
+{
+	std::mutex mutex;
+	std::deque<Task*> tasks;
+
+	Task* pop(bool steal)
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		Task* task = 0;
+
+		if (!tasks.empty())
+		{
+			if (steal)
+			{
+				task = tasks.back();
+				tasks.pop_back();
+			}
+			else
+			{
+				task = tasks.front();
+				tasks.pop_front();
+			}
+		}
+		return task;
+	}
+};
+
+// threads currently running tasks, over all pools
+static std::atomic<unsigned> activeWorkers(0);
+
+static void runWorker(std::vector<TaskQueue>& queues, size_t self)
+{
+	const size_t count = queues.size();
+	size_t i;
+	Task* task;
+
+	++activeWorkers;
+	for (;;)
+	{
+		task = queues[self].pop(false);
+		for (i = 1; !task && i < count; ++i)
+		{
+			task = queues[(self + i) % count].pop(true);
+		}
+
+		// nothing adds tasks while we run, so empty queues mean we're done
+		if (!task)
+		{
+			break;
+		}
+		task->run();
+	}
+	--activeWorkers;
+}
+#endif
+
+TaskPool::TaskPool(unsigned threads):
+	m_threads(threads ? threads : hardwareThreads())
+{
+}
+
+unsigned TaskPool::threads() const
+{
+	return m_threads;
+}
+
+void TaskPool::run(const std::vector<Task*>& tasks)
+{
+#ifdef CPP0X_AVAILABLE
+	std::vector<std::thread> workers;
+	size_t i, count = std::min<size_t>(m_threads, tasks.size());
+
+	// Nested run (from a task of another pool): the outer pool already
+	// keeps some cores busy, only use what's left so we don't oversubscribe.
+	const unsigned busy = activeWorkers;
+	if (busy)
+	{
+		const unsigned hw = hardwareThreads();
+		count = std::min<size_t>(count, hw > busy ? hw - busy + 1 : 1);
+	}
+
+	if (count <= 1)
+	{
+		for (i = 0; i < tasks.size(); ++i)
+		{
+			tasks[i]->run();
+		}
+		return;
+	}
+
+	// every worker starts with a contiguous share of the tasks
+	std::vector<TaskQueue> queues(count);
+	for (i = 0; i < tasks.size(); ++i)
+	{
+		queues[i * count / tasks.size()].tasks.push_back(tasks[i]);
+	}
+
+	// the calling thread is one of the workers
+	workers.reserve(count - 1);
+	for (i = 1; i < count; ++i)
+	{
+		workers.push_back(std::thread(runWorker, std::ref(queues), i));
+	}
+
+	runWorker(queues, 0);
+
+	for (i = 0; i < workers.size(); ++i)
+	{
+		workers[i].join();
+	}
+#else
+	std::vector<Task*>::const_iterator it;
+
+	for (it = tasks.begin(); it != tasks.end(); ++it)
+	{
+		(*it)->run();
+	}
+#endif
+}
+
+unsigned TaskPool::hardwareThreads()
+{
+#ifdef CPP0X_AVAILABLE
+	const unsigned hw = std::thread::hardware_concurrency();
+	return hw ? hw : 1;
+#else
+	return 1;
+#endif
+}
@@ -0,0 +1,66 @@
+/*
+	Copyright 2010 Warzone 2100 Project
+
+	This file is part of WMIT.
+
+	WMIT is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	WMIT is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with WMIT.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef TASKPOOL_HPP
+#define TASKPOOL_HPP
+
+#include <vector>
+
+/// Unit of work for TaskPool.
+class Task
+{
+public:
+	virtual ~Task() {}
+	virtual void run() = 0;
+};
+
+/**
+  * Runs independent tasks on a set of worker threads.
+  *
+  * Each worker gets a contiguous share of the tasks and steals from the
+  * others once its own share is done, so uneven tasks still balance out.
+  * Pools can be used from inside a task (a batch conversion loading a
+  * multi mesh model, say), the inner run then only uses the cores the
+  * outer one leaves idle.
+  *
+  * Needs a C++0x compiler (CPP0X_AVAILABLE) for threading, otherwise every
+  * task runs in order on the calling thread.
+  */
+class TaskPool
+{
+public:
+	/// threads == 0 uses one worker per hardware thread
+	explicit TaskPool(unsigned threads = 0);
+
+	unsigned threads() const;
+
+	/**
+	  * Runs all tasks and returns once every one of them has finished.
+	  *
+	  * Tasks can run in any order and on any thread (including the calling
+	  * one), so they must not depend on each other and must not throw.
+	  */
+	void run(const std::vector<Task*>& tasks);
+
+	static unsigned hardwareThreads();
+
+private:
+	unsigned m_threads;
+};
+
+#endif // TASKPOOL_HPP
@@ -0,0 +1,475 @@
+/*
+	Copyright 2010 Warzone 2100 Project
+
+	This file is part of WMIT.
+
+	WMIT is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	WMIT is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with WMIT.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "TextLexer.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+static inline bool isSpace(char c)
+{
+	return c == ' ' || c == '\t' || c == '\n' || c == '\r' || c == '\v' || c == '\f';
+}
+
+static inline bool isDigit(char c)
+{
+	return c >= '0' && c <= '9';
+}
+
+static inline int hexValue(char c)
+{
+	if (c >= '0' && c <= '9')
+		return c - '0';
+	if (c >= 'a' && c <= 'f')
+		return c - 'a' + 10;
+	if (c >= 'A' && c <= 'F')
+		return c - 'A' + 10;
+	return -1;
+}
+
+// Powers of ten that are exact in a double
+static const double exactPow10[] = {
+	1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+	1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+bool TextToken::equals(const char* str) const
+{
+	size_t i;
+
+	for (i = 0; i < len; ++i)
+	{
+		if (str[i] == '\0' || ptr[i] != str[i])
+			return false;
+	}
+	return str[i] == '\0';
+}
+
+std::string TextToken::str() const
+{
+	return std::string(ptr, len);
+}
+
+std::ostream& operator<< (std::ostream& out, const TextToken& tok)
+{
+	return out.write(tok.ptr, tok.len);
+}
+
+TextLexer::TextLexer():
+	m_begin(0), m_pos(0), m_end(0), m_fail(false), m_streamStart(-1), m_progress(0)
+{
+}
+
+TextLexer::TextLexer(const char* begin, const char* end):
+	m_begin(begin), m_pos(begin), m_end(end), m_fail(false), m_streamStart(-1), m_progress(0)
+{
+}
+
+void TextLexer::load(std::istream& in)
+{
+	const std::streamoff chunk = 64 * 1024;
+	std::streamoff start, fsize;
+
+	m_buffer.clear();
+	start = in.tellg();
+	if (start >= 0)
+	{
+		in.seekg(0, std::ios::end);
+		fsize = in.tellg();
+		in.seekg(start);
+		if (fsize > start)
+		{
+			m_buffer.reserve(static_cast<size_t>(fsize - start));
+		}
+	}
+
+	while (in.good())
+	{
+		const size_t used = m_buffer.size();
+
+		m_buffer.resize(used + chunk);
+		in.read(&m_buffer[used], chunk);
+		m_buffer.resize(used + static_cast<size_t>(in.gcount()));
+	}
+
+	m_streamStart = start;
+	if (m_buffer.empty())
+	{
+		reset(0, 0);
+	}
+	else
+	{
+		reset(&m_buffer[0], &m_buffer[0] + m_buffer.size());
+	}
+}
+
+void TextLexer::sync(std::istream& in) const
+{
+	if (m_streamStart >= 0)
+	{
+		in.clear();
+		in.seekg(m_streamStart + static_cast<std::streamoff>(tell()));
+	}
+}
+
+void TextLexer::reset(const char* begin, const char* end)
+{
+	m_begin = m_pos = begin;
+	m_end = end;
+	m_fail = false;
+}
+
+void TextLexer::seek(size_t offset)
+{
+	m_pos = m_begin + std::min(offset, static_cast<size_t>(m_end - m_begin));
+}
+
+bool TextLexer::atEnd()
+{
+	skipSpace();
+	return m_pos == m_end;
+}
+
+bool TextLexer::skip(char c)
+{
+	if (m_pos < m_end && *m_pos == c)
+	{
+		++m_pos;
+		return true;
+	}
+	return false;
+}
+
+bool TextLexer::nextLine(TextLexer& line)
+{
+	const char* eol;
+	const char* next;
+
+	if (m_pos == m_end)
+	{
+		return false;
+	}
+
+	eol = static_cast<const char*>(std::memchr(m_pos, '\n', m_end - m_pos));
+	if (eol)
+	{
+		next = eol + 1;
+	}
+	else
+	{
+		eol = next = m_end;
+	}
+
+	// tolerate CRLF
+	if (eol > m_pos && eol[-1] == '\r')
+	{
+		--eol;
+	}
+
+	line.reset(m_pos, eol);
+	m_pos = next;
+	return true;
+}
+
+TextLexer& TextLexer::operator>> (TextToken& tok)
+{
+	if (m_fail)
+	{
+		return *this;
+	}
+
+	skipSpace();
+	tok.ptr = m_pos;
+	while (m_pos < m_end && !isSpace(*m_pos))
+	{
+		++m_pos;
+	}
+	tok.len = m_pos - tok.ptr;
+	m_fail = tok.len == 0;
+	return *this;
+}
+
+TextLexer& TextLexer::operator>> (std::string& str)
+{
+	TextToken tok;
+
+	if (*this >> tok, !m_fail)
+	{
+		str.assign(tok.ptr, tok.len);
+	}
+	return *this;
+}
+
+TextLexer& TextLexer::operator>> (float& val)
+{
+	Decimal dec;
+
+	if (m_fail)
+	{
+		return *this;
+	}
+
+	skipSpace();
+	if (!scanDecimal(dec))
+	{
+		m_fail = true;
+		return *this;
+	}
+
+	// mantissa and power of ten are exact floats, so one correctly rounded op
+	if (!dec.truncated && dec.mantissa < (1ULL << 24) && dec.exponent >= -10 && dec.exponent <= 10)
+	{
+		float f = static_cast<float>(dec.mantissa);
+		if (dec.exponent < 0)
+			f /= static_cast<float>(exactPow10[-dec.exponent]);
+		else
+			f *= static_cast<float>(exactPow10[dec.exponent]);
+		val = dec.negative ? -f : f;
+	}
+	else
+	{
+		val = static_cast<float>(toDouble(dec));
+	}
+	return *this;
+}
+
+TextLexer& TextLexer::operator>> (double& val)
+{
+	Decimal dec;
+
+	if (m_fail)
+	{
+		return *this;
+	}
+
+	skipSpace();
+	if (scanDecimal(dec))
+	{
+		val = toDouble(dec);
+	}
+	else
+	{
+		m_fail = true;
+	}
+	return *this;
+}
+
+TextLexer& TextLexer::operator>> (bool& val)
+{
+	unsigned long long v;
+	bool negative;
+
+	if (m_fail)
+	{
+		return *this;
+	}
+
+	// noboolalpha: only 0 and 1
+	skipSpace();
+	if (scanUnsigned(v, 10, negative) && !negative && v <= 1)
+	{
+		val = v != 0;
+	}
+	else
+	{
+		m_fail = true;
+	}
+	return *this;
+}
+
+double TextLexer::toDouble(const Decimal& dec)
+{
+	double d;
+
+	// same as for floats if both are exact doubles
+	if (!dec.truncated && dec.mantissa < (1ULL << 53) && dec.exponent >= -22 && dec.exponent <= 22)
+	{
+		d = static_cast<double>(dec.mantissa);
+		if (dec.exponent < 0)
+			d /= exactPow10[-dec.exponent];
+		else
+			d *= exactPow10[dec.exponent];
+	}
+	else
+	{
+		// rare: long mantissas or large exponents, good enough for model data
+		d = static_cast<double>(dec.mantissa * std::pow(10.0L, dec.exponent));
+	}
+
+	return dec.negative ? -d : d;
+}
+
+void TextLexer::skipSpace()
+{
+	while (m_pos < m_end && isSpace(*m_pos))
+	{
+		++m_pos;
+	}
+}
+
+bool TextLexer::scanDecimal(Decimal& dec)
+{
+	// keep 18 digits at most, enough for a double
+	const unsigned long long maxMantissa = 100000000000000000ULL;
+	const char* p = m_pos;
+	bool digits = false;
+	int exp = 0;
+
+	dec.mantissa = 0;
+	dec.exponent = 0;
+	dec.negative = false;
+	dec.truncated = false;
+
+	if (p < m_end && (*p == '+' || *p == '-'))
+	{
+		dec.negative = *p++ == '-';
+	}
+
+	for (; p < m_end && isDigit(*p); ++p)
+	{
+		digits = true;
+		if (dec.mantissa < maxMantissa)
+		{
+			dec.mantissa = dec.mantissa * 10 + (*p - '0');
+		}
+		else
+		{
+			++dec.exponent;
+			dec.truncated |= *p != '0';
+		}
+	}
+
+	if (p < m_end && *p == '.')
+	{
+		for (++p; p < m_end && isDigit(*p); ++p)
+		{
+			digits = true;
+			if (dec.mantissa < maxMantissa)
+			{
+				dec.mantissa = dec.mantissa * 10 + (*p - '0');
+				--dec.exponent;
+			}
+			else
+			{
+				dec.truncated |= *p != '0';
+			}
+		}
+	}
+
+	if (!digits)
+	{
+		return false;
+	}
+
+	// exponent only if there are digits after the 'e'
+	if (p < m_end && (*p == 'e' || *p == 'E'))
+	{
+		const char* e = p + 1;
+		bool negExp = false;
+
+		if (e < m_end && (*e == '+' || *e == '-'))
+		{
+			negExp = *e++ == '-';
+		}
+		if (e < m_end && isDigit(*e))
+		{
+			for (; e < m_end && isDigit(*e); ++e)
+			{
+				if (exp < 100000)
+				{
+					exp = exp * 10 + (*e - '0');
+				}
+			}
+			dec.exponent += negExp ? -exp : exp;
+			p = e;
+		}
+	}
+
+	m_pos = p;
+	return true;
+}
+
+bool TextLexer::scanSigned(long long& val)
+{
+	unsigned long long v;
+	bool negative;
+
+	if (!scanUnsigned(v, 10, negative))
+	{
+		return false;
+	}
+
+	if (negative)
+	{
+		if (v > static_cast<unsigned long long>(std::numeric_limits<long long>::max()) + 1)
+			return false;
+		val = static_cast<long long>(0 - v);
+	}
+	else
+	{
+		if (v > static_cast<unsigned long long>(std::numeric_limits<long long>::max()))
+			return false;
+		val = static_cast<long long>(v);
+	}
+	return true;
+}
+
+bool TextLexer::scanUnsigned(unsigned long long& val, int base, bool& negative)
+{
+	const unsigned long long limit = std::numeric_limits<unsigned long long>::max() / base;
+	const char* p = m_pos;
+	const char* first;
+	int digit;
+
+	val = 0;
+	negative = false;
+
+	if (p < m_end && (*p == '+' || *p == '-'))
+	{
+		negative = *p++ == '-';
+	}
+
+	if (base == 16 && m_end - p > 2 && p[0] == '0' && (p[1] == 'x' || p[1] == 'X') && hexValue(p[2]) >= 0)
+	{
+		p += 2;
+	}
+
+	for (first = p; p < m_end; ++p)
+	{
+		digit = base == 16 ? hexValue(*p) : (isDigit(*p) ? *p - '0' : -1);
+		if (digit < 0)
+		{
+			break;
+		}
+		if (val > limit || val * base > std::numeric_limits<unsigned long long>::max() - digit)
+		{
+			return false;
+		}
+		val = val * base + digit;
+	}
+
+	if (p == first)
+	{
+		return false;
+	}
+
+	m_pos = p;
+	return true;
+}
@@ -0,0 +1,232 @@
+/*
+	Copyright 2010 Warzone 2100 Project
+
+	This file is part of WMIT.
+
+	WMIT is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	WMIT is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with WMIT.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef TEXTLEXER_HPP
+#define TEXTLEXER_HPP
+
+#include <cstddef>
+#include <iostream>
+#include <limits>
+#include <string>
+#include <vector>
+
+#include "LoadProgress.hpp"
+
+/**
+  * Whitespace separated token, points into the lexer's buffer.
+  */
+struct TextToken
+{
+	TextToken(): ptr(0), len(0) {}
+
+	bool empty() const
+	{
+		return len == 0;
+	}
+
+	/// Compares with a NUL terminated string
+	bool equals(const char* str) const;
+	std::string str() const;
+
+	const char* ptr;
+	size_t len;
+};
+
+std::ostream& operator<< (std::ostream& out, const TextToken& tok);
+
+/**
+  * Buffer based replacement for reading text models through istream::operator>>.
+  *
+  * Extraction works like on an istream: whitespace is skipped, numbers end at
+  * the first character that can't be part of them and a failed extraction sets
+  * a sticky fail flag that turns all further extractions into no-ops.
+  * Numbers are always parsed in the "C" locale, nothing is allocated per token
+  * (except for std::string extraction).
+  */
+class TextLexer
+{
+public:
+	TextLexer();
+	TextLexer(const char* begin, const char* end);
+
+	/// Reads the rest of in into an internal buffer and lexes that
+	void load(std::istream& in);
+	/// Positions in right after the consumed text, if in can seek
+	void sync(std::istream& in) const;
+
+	/// Lexes [begin, end), which has to outlive the lexer
+	void reset(const char* begin, const char* end);
+
+	bool fail() const
+	{
+		return m_fail;
+	}
+	void clear()
+	{
+		m_fail = false;
+	}
+
+	/// Offset from the start of the text, for seek()
+	size_t tell() const
+	{
+		return m_pos - m_begin;
+	}
+	/// Start of the text, tell() offsets are relative to it
+	const char* begin() const
+	{
+		return m_begin;
+	}
+	void seek(size_t offset);
+
+	/// Skips whitespace, true if nothing is left
+	bool atEnd();
+
+	/// Where checkProgress() reports to, 0 for nowhere
+	void setProgress(LoadProgress* progress)
+	{
+		m_progress = progress;
+	}
+	LoadProgress* progress() const
+	{
+		return m_progress;
+	}
+	/**
+	  * For readers to call between records: reports the position and sets
+	  * the fail flag once the load got cancelled. False if failed.
+	  */
+	bool checkProgress()
+	{
+		if (m_progress && !m_fail && !m_progress->consumed(tell(), m_end - m_begin))
+		{
+			m_fail = true;
+		}
+		return !m_fail;
+	}
+
+	/// Raw character access, no whitespace skipping, -1 at the end
+	int peek() const
+	{
+		return m_pos < m_end ? static_cast<unsigned char>(*m_pos) : -1;
+	}
+	int get()
+	{
+		return m_pos < m_end ? static_cast<unsigned char>(*m_pos++) : -1;
+	}
+	/// Consumes c if it's the next character
+	bool skip(char c);
+
+	/// Hands the next line (w/o line break) to line, false at the end
+	bool nextLine(TextLexer& line);
+
+	TextLexer& operator>> (TextToken& tok);
+	TextLexer& operator>> (std::string& str);
+
+	TextLexer& operator>> (float& val);
+	TextLexer& operator>> (double& val);
+
+	TextLexer& operator>> (bool& val);
+	TextLexer& operator>> (short& val)		{return readSigned(val);}
+	TextLexer& operator>> (int& val)		{return readSigned(val);}
+	TextLexer& operator>> (long& val)		{return readSigned(val);}
+	TextLexer& operator>> (unsigned short& val)	{return readUnsigned(val, 10);}
+	TextLexer& operator>> (unsigned& val)		{return readUnsigned(val, 10);}
+	TextLexer& operator>> (unsigned long& val)	{return readUnsigned(val, 10);}
+
+	/// Hexadecimal integer, like >> std::hex >> val >> std::dec
+	template <typename T>
+	TextLexer& hex(T& val)
+	{
+		return readUnsigned(val, 16);
+	}
+
+private:
+	// not copyable
+	TextLexer(const TextLexer&);
+	TextLexer& operator=(const TextLexer&);
+
+	struct Decimal
+	{
+		unsigned long long mantissa;
+		int exponent;
+		bool negative;
+		bool truncated;
+	};
+
+	static double toDouble(const Decimal& dec);
+
+	void skipSpace();
+	bool scanDecimal(Decimal& dec);
+	bool scanSigned(long long& val);
+	bool scanUnsigned(unsigned long long& val, int base, bool& negative);
+
+	template <typename T>
+	TextLexer& readSigned(T& val)
+	{
+		long long v;
+
+		if (!m_fail)
+		{
+			skipSpace();
+			if (scanSigned(v) && v >= std::numeric_limits<T>::min() && v <= std::numeric_limits<T>::max())
+			{
+				val = static_cast<T>(v);
+			}
+			else
+			{
+				m_fail = true;
+			}
+		}
+		return *this;
+	}
+
+	// accepts a leading '-' and wraps like strtoul, as istream does
+	template <typename T>
+	TextLexer& readUnsigned(T& val, int base)
+	{
+		unsigned long long v;
+		bool negative;
+
+		if (!m_fail)
+		{
+			skipSpace();
+			if (scanUnsigned(v, base, negative) && v <= std::numeric_limits<T>::max())
+			{
+				val = static_cast<T>(v);
+				if (negative)
+				{
+					val = static_cast<T>(-val);
+				}
+			}
+			else
+			{
+				m_fail = true;
+			}
+		}
+		return *this;
+	}
+
+	std::vector<char> m_buffer;
+	const char* m_begin;
+	const char* m_pos;
+	const char* m_end;
+	bool m_fail;
+	std::streamoff m_streamStart;
+	LoadProgress* m_progress;
+};
+
+#endif // TEXTLEXER_HPP
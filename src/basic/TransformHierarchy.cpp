@@ -0,0 +1,175 @@
+/*
+	Copyright 2010 Warzone 2100 Project
+
+	This file is part of WMIT.
+
+	WMIT is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	WMIT is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with WMIT.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "TransformHierarchy.hpp"
+
+#include <algorithm>
+#include <iostream>
+
+TransformHierarchy::TransformHierarchy():
+	m_firstDirty(0)
+{
+}
+
+int TransformHierarchy::addNode(int parent, const Matrix4& local)
+{
+	if (parent < -1 || parent >= (int)m_parents.size())
+	{
+		std::cerr << "TransformHierarchy::addNode - No node " << parent << " to add to\n";
+		return -1;
+	}
+
+	m_parents.push_back(parent);
+	m_dirty.push_back(false);
+	m_local.push_back(local);
+	m_world.push_back(Matrix4());
+	markDirty(m_parents.size() - 1);
+
+	return m_parents.size() - 1;
+}
+
+void TransformHierarchy::removeSubtree(int node, std::vector<int>* remap)
+{
+	std::vector<int> index(m_parents.size());
+	size_t i, kept;
+
+	if (node < 0 || node >= (int)m_parents.size())
+	{
+		return;
+	}
+
+	for (i = 0; i < (size_t)node; ++i)
+	{
+		index[i] = i;
+	}
+
+	// children come after their parents, so one pass finds the whole subtree
+	m_firstDirty = std::min(m_firstDirty, m_parents.size());
+	for (i = node, kept = node; i < m_parents.size(); ++i)
+	{
+		const int parent = m_parents[i];
+
+		if (i == (size_t)node || (parent >= 0 && index[parent] < 0))
+		{
+			index[i] = -1;
+			continue;
+		}
+
+		index[i] = kept;
+		m_parents[kept] = parent < 0 ? -1 : index[parent];
+		m_dirty[kept] = m_dirty[i];
+		m_local[kept] = m_local[i];
+		m_world[kept] = m_world[i];
+		if (m_dirty[kept])
+		{
+			m_firstDirty = std::min(m_firstDirty, kept);
+		}
+		++kept;
+	}
+	m_parents.resize(kept);
+	m_dirty.resize(kept);
+	m_local.resize(kept);
+	m_world.resize(kept);
+	m_firstDirty = std::min(m_firstDirty, kept);
+
+	if (remap)
+	{
+		remap->swap(index);
+	}
+}
+
+void TransformHierarchy::clear()
+{
+	m_parents.clear();
+	m_dirty.clear();
+	m_local.clear();
+	m_world.clear();
+	m_firstDirty = 0;
+}
+
+size_t TransformHierarchy::size() const
+{
+	return m_parents.size();
+}
+
+int TransformHierarchy::parent(int node) const
+{
+	return m_parents[node];
+}
+
+const Matrix4& TransformHierarchy::local(int node) const
+{
+	return m_local[node];
+}
+
+void TransformHierarchy::setLocal(int node, const Matrix4& local)
+{
+	m_local[node] = local;
+	markDirty(node);
+}
+
+void TransformHierarchy::invalidate()
+{
+	m_dirty.assign(m_dirty.size(), true);
+	m_firstDirty = 0;
+}
+
+size_t TransformHierarchy::update()
+{
+	size_t i, updated = 0;
+
+	// dirtiness goes down to the children first, parents are final by the time they're reached
+	for (i = m_firstDirty; i < m_parents.size(); ++i)
+	{
+		const int parent = m_parents[i];
+
+		if (!m_dirty[i] && (parent < 0 || !m_dirty[parent]))
+		{
+			continue;
+		}
+
+		m_dirty[i] = true;
+		m_world[i] = parent < 0 ? m_local[i] : m_world[parent] * m_local[i];
+		++updated;
+	}
+
+	if (m_firstDirty < m_dirty.size())
+	{
+		std::fill(m_dirty.begin() + m_firstDirty, m_dirty.end(), false);
+	}
+	m_firstDirty = m_parents.size();
+
+	return updated;
+}
+
+bool TransformHierarchy::needsUpdate() const
+{
+	return m_firstDirty < m_parents.size();
+}
+
+const Matrix4& TransformHierarchy::world(int node) const
+{
+	return m_world[node];
+}
+
+void TransformHierarchy::markDirty(size_t node)
+{
+	m_dirty[node] = true;
+	m_firstDirty = std::min(m_firstDirty, node);
+}
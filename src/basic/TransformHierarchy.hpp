@@ -0,0 +1,74 @@
+/*
+	Copyright 2010 Warzone 2100 Project
+
+	This file is part of WMIT.
+
+	WMIT is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	WMIT is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with WMIT.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef TRANSFORMHIERARCHY_HPP
+#define TRANSFORMHIERARCHY_HPP
+
+#include <cstddef>
+#include <vector>
+
+#include "Matrix4.hpp"
+
+/**
+  * Tree of transforms with cached world matrices, world = parent's world *
+  * local. Changing a local transform only marks its node dirty, update()
+  * then recomputes the dirty nodes and whatever hangs below them.
+  *
+  * Nodes are kept in creation order, so a parent always comes before its
+  * children and update() is a single pass starting at the first dirty node.
+  */
+class TransformHierarchy
+{
+public:
+	TransformHierarchy();
+
+	/// Adds a node below parent (-1 for a root), returns its index or -1 if parent doesn't exist
+	int addNode(int parent, const Matrix4& local = Matrix4());
+	/**
+	  * Removes node and everything below it, the nodes after it move down.
+	  * If remap is given it gets the new index of every old one, -1 for
+	  * the removed ones.
+	  */
+	void removeSubtree(int node, std::vector<int>* remap = 0);
+	void clear();
+
+	size_t size() const;
+	int parent(int node) const;
+
+	const Matrix4& local(int node) const;
+	void setLocal(int node, const Matrix4& local);
+	/// Marks everything for recomputation
+	void invalidate();
+
+	/// Brings the world transforms up to date, returns how many got recomputed
+	size_t update();
+	bool needsUpdate() const;
+	/// As of the last update()
+	const Matrix4& world(int node) const;
+
+private:
+	void markDirty(size_t node);
+
+	// kept apart so update() only walks the small arrays past clean nodes
+	std::vector<int> m_parents;
+	std::vector<char> m_dirty;
+	std::vector<Matrix4> m_local, m_world;
+	size_t m_firstDirty;	// size() when everything is up to date
+};
+
+#endif // TRANSFORMHIERARCHY_HPP
@@ -131,10 +131,10 @@ struct Vertex4 : public Vector<T, COMPONENTS>
 
 	Vertex4(const T x, const T y, const T z, const T w)
 	{
-		x() = x;
-		y() = y;
-		z() = z;
-		w() = w;
+		this->x() = x;
+		this->y() = y;
+		this->z() = z;
+		this->w() = w;
 	}
 
 	Vertex4(const Vertex4& rhs): Vector<T, COMPONENTS>(rhs) {}
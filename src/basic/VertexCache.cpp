@@ -0,0 +1,296 @@
+/*
+	Copyright 2010 Warzone 2100 Project
+
+	This file is part of WMIT.
+
+	WMIT is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	WMIT is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with WMIT.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include "VertexCache.hpp"
+
+#include <cmath>
+
+static const GLuint noIndex = ~0u;
+
+VertexCacheStats vertexCacheStats(const std::vector<IndexedTri>& tris, unsigned vertices, unsigned cacheSize)
+{
+	VertexCacheStats stats;
+	// transforms count right after each vertex entered the FIFO, 0 if it never did
+	std::vector<size_t> stamps(vertices, 0);
+	size_t i;
+	int j;
+
+	stats.triangles = tris.size();
+	for (i = 0; i < tris.size(); ++i)
+	{
+		for (j = 0; j < 3; ++j)
+		{
+			size_t& stamp = stamps[tris[i][j]];
+
+			if (!stamp)
+			{
+				++stats.vertices;
+			}
+			if (!stamp || stats.transforms - stamp >= cacheSize)
+			{
+				stamp = ++stats.transforms;
+			}
+		}
+	}
+	return stats;
+}
+
+/*
+ * Forsyth's scoring, see http://tomforsyth1000.github.io/papers/fast_vert_cache_opt.html
+ */
+
+static const int forsythCacheSize = 32;
+static const float forsythCacheDecayPower = 1.5f;
+static const float forsythLastTriScore = 0.75f;
+static const float forsythValenceBoostScale = 2.f;
+static const float forsythValenceBoostPower = 0.5f;
+static const unsigned forsythValenceTable = 64;
+
+class ForsythScores
+{
+public:
+	ForsythScores()
+	{
+		int i;
+
+		for (i = 0; i < forsythCacheSize; ++i)
+		{
+			if (i < 3)
+			{
+				// the triangle just drawn, don't favour any of its order
+				m_cache[i] = forsythLastTriScore;
+			}
+			else
+			{
+				const float scaler = 1.f / (forsythCacheSize - 3);
+				m_cache[i] = std::pow(1.f - (i - 3) * scaler, forsythCacheDecayPower);
+			}
+		}
+
+		m_valence[0] = 0.f;
+		for (i = 1; i < static_cast<int>(forsythValenceTable); ++i)
+		{
+			m_valence[i] = valence(i);
+		}
+	}
+
+	/// cachePos < 0 for vertices outside of the cache
+	float score(int cachePos, unsigned remaining) const
+	{
+		float score;
+
+		if (!remaining)
+		{
+			// no triangle needs it anymore
+			return -1.f;
+		}
+
+		score = cachePos < 0 ? 0.f : m_cache[cachePos];
+
+		// boost vertices with few triangles left, so lone ones get finished off
+		score += remaining < forsythValenceTable ? m_valence[remaining] : valence(remaining);
+		return score;
+	}
+
+private:
+	static float valence(unsigned remaining)
+	{
+		return forsythValenceBoostScale * std::pow(static_cast<float>(remaining), -forsythValenceBoostPower);
+	}
+
+	float m_cache[forsythCacheSize];
+	float m_valence[forsythValenceTable];
+};
+
+void optimizeTriangleOrder(std::vector<IndexedTri>& tris, unsigned vertices)
+{
+	static const ForsythScores scores;
+
+	const size_t count = tris.size();
+
+	// per vertex list of triangles still to be drawn, live ones first
+	std::vector<unsigned> offsets(vertices + 1, 0), adjacency(count * 3), remaining(vertices, 0);
+	std::vector<int> cachePos(vertices, -1);
+	std::vector<float> vertexScore(vertices);
+	std::vector<float> triScore(count, 0.f);
+	std::vector<bool> emitted(count, false);
+
+	std::vector<GLuint> cache, newCache;
+	std::vector<IndexedTri> out;
+
+	size_t i, next = 0, best = noIndex;
+	unsigned v, k;
+	int j;
+
+	if (count < 2)
+	{
+		return;
+	}
+
+	for (i = 0; i < count; ++i)
+	{
+		for (j = 0; j < 3; ++j)
+		{
+			++offsets[tris[i][j] + 1];
+		}
+	}
+	for (v = 0; v < vertices; ++v)
+	{
+		offsets[v + 1] += offsets[v];
+	}
+	for (i = 0; i < count; ++i)
+	{
+		for (j = 0; j < 3; ++j)
+		{
+			v = tris[i][j];
+			adjacency[offsets[v] + remaining[v]++] = i;
+		}
+	}
+
+	for (v = 0; v < vertices; ++v)
+	{
+		vertexScore[v] = scores.score(-1, remaining[v]);
+	}
+	for (i = 0; i < count; ++i)
+	{
+		for (j = 0; j < 3; ++j)
+		{
+			triScore[i] += vertexScore[tris[i][j]];
+		}
+		if (best == noIndex || triScore[i] > triScore[best])
+		{
+			best = i;
+		}
+	}
+
+	out.reserve(count);
+	cache.reserve(forsythCacheSize + 3);
+	newCache.reserve(forsythCacheSize + 3);
+
+	while (out.size() < count)
+	{
+		// dead end, nothing in the cache has triangles left: continue in input order
+		if (best == noIndex)
+		{
+			while (emitted[next])
+			{
+				++next;
+			}
+			best = next;
+		}
+
+		const IndexedTri tri = tris[best];
+		out.push_back(tri);
+		emitted[best] = true;
+
+		// drop it from its vertices' live lists
+		for (j = 0; j < 3; ++j)
+		{
+			v = tri[j];
+			for (k = offsets[v]; adjacency[k] != best; ++k);
+			adjacency[k] = adjacency[offsets[v] + --remaining[v]];
+		}
+
+		// LRU update: the triangle's vertices go to the front
+		newCache.clear();
+		for (j = 0; j < 3; ++j)
+		{
+			if (cachePos[tri[j]] != -2)
+			{
+				newCache.push_back(tri[j]);
+				cachePos[tri[j]] = -2;
+			}
+		}
+		for (k = 0; k < cache.size(); ++k)
+		{
+			if (cachePos[cache[k]] != -2)
+			{
+				newCache.push_back(cache[k]);
+			}
+		}
+
+		// rescore everything in the old and new cache, and their live triangles
+		for (k = 0; k < newCache.size(); ++k)
+		{
+			v = newCache[k];
+			cachePos[v] = k < static_cast<unsigned>(forsythCacheSize) ? static_cast<int>(k) : -1;
+
+			const float delta = scores.score(cachePos[v], remaining[v]) - vertexScore[v];
+			vertexScore[v] += delta;
+			for (i = offsets[v]; i < offsets[v] + remaining[v]; ++i)
+			{
+				triScore[adjacency[i]] += delta;
+			}
+		}
+
+		// best live triangle around the cache
+		best = noIndex;
+		for (k = 0; k < newCache.size() && k < static_cast<unsigned>(forsythCacheSize); ++k)
+		{
+			v = newCache[k];
+			for (i = offsets[v]; i < offsets[v] + remaining[v]; ++i)
+			{
+				const unsigned t = adjacency[i];
+				if (best == noIndex || triScore[t] > triScore[best] ||
+				    (triScore[t] == triScore[best] && t < best))
+				{
+					best = t;
+				}
+			}
+		}
+
+		if (newCache.size() > static_cast<unsigned>(forsythCacheSize))
+		{
+			newCache.resize(forsythCacheSize);
+		}
+		cache.swap(newCache);
+	}
+
+	tris.swap(out);
+}
+
+void optimizeVertexOrder(std::vector<IndexedTri>& tris, unsigned vertices, std::vector<GLuint>& remap)
+{
+	GLuint next = 0;
+	size_t i;
+	unsigned v;
+	int j;
+
+	remap.assign(vertices, noIndex);
+	for (i = 0; i < tris.size(); ++i)
+	{
+		for (j = 0; j < 3; ++j)
+		{
+			GLuint& index = tris[i][j];
+
+			if (remap[index] == noIndex)
+			{
+				remap[index] = next++;
+			}
+			index = remap[index];
+		}
+	}
+
+	for (v = 0; v < vertices; ++v)
+	{
+		if (remap[v] == noIndex)
+		{
+			remap[v] = next++;
+		}
+	}
+}
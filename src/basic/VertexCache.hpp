@@ -0,0 +1,81 @@
+/*
+	Copyright 2010 Warzone 2100 Project
+
+	This file is part of WMIT.
+
+	WMIT is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	WMIT is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with WMIT.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef VERTEXCACHE_HPP
+#define VERTEXCACHE_HPP
+
+#include <cstddef>
+#include <vector>
+
+#include "GLTypes.hpp"
+#include "Polygon.hpp"
+
+/**
+  * How well an index buffer uses the post-transform vertex cache,
+  * simulated on a FIFO cache like the ones of older GPUs.
+  */
+struct VertexCacheStats
+{
+	VertexCacheStats(): triangles(0), vertices(0), transforms(0) {}
+
+	/// Average cache miss ratio: transforms per triangle, 0.5 is the best a grid can do, 3 the worst
+	double acmr() const
+	{
+		return triangles ? static_cast<double>(transforms) / triangles : 0.;
+	}
+
+	/// Average transform to vertex ratio: transforms per used vertex, 1 is optimal
+	double atvr() const
+	{
+		return vertices ? static_cast<double>(transforms) / vertices : 0.;
+	}
+
+	VertexCacheStats& operator += (const VertexCacheStats& rhs)
+	{
+		triangles += rhs.triangles;
+		vertices += rhs.vertices;
+		transforms += rhs.transforms;
+		return *this;
+	}
+
+	size_t triangles;
+	size_t vertices;	// vertices used by at least one triangle
+	size_t transforms;	// cache misses
+};
+
+/*
+ * All functions expect every index to be below vertices.
+ */
+
+VertexCacheStats vertexCacheStats(const std::vector<IndexedTri>& tris, unsigned vertices, unsigned cacheSize = 16);
+
+/**
+  * Reorders triangles for the post-transform cache, using Tom Forsyth's
+  * "Linear-Speed Vertex Cache Optimisation" (greedy, scored on a 32 entry
+  * LRU cache). Vertex indices aren't changed.
+  */
+void optimizeTriangleOrder(std::vector<IndexedTri>& tris, unsigned vertices);
+
+/**
+  * Renumbers vertices in the order triangles first use them, so vertex
+  * fetches walk the arrays front to back. remap[old] is the new index,
+  * unused vertices keep their relative order at the end.
+  */
+void optimizeVertexOrder(std::vector<IndexedTri>& tris, unsigned vertices, std::vector<GLuint>& remap);
+
+#endif // VERTEXCACHE_HPP
@@ -0,0 +1,809 @@
+/*
+	Copyright 2010 Warzone 2100 Project
+
+	This file is part of WMIT.
+
+	WMIT is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	WMIT is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with WMIT.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "VertexKernels.hpp"
+
+#include <cstdlib>
+#include <cstring>
+
+#include <stdint.h>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__SSE2__) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#  define WMIT_KERNELS_SSE2
+#  include <emmintrin.h>
+#endif
+
+// AVX2 code is compiled per function, the rest of the build stays baseline
+#if defined(WMIT_KERNELS_SSE2)
+#  if defined(__clang__) || (defined(__GNUC__) && (__GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 9)))
+#    define WMIT_KERNELS_AVX2
+#    define WMIT_TARGET_AVX2 __attribute__((target("avx2")))
+#    include <immintrin.h>
+#  elif defined(_MSC_VER) && _MSC_VER >= 1700
+#    define WMIT_KERNELS_AVX2
+#    define WMIT_TARGET_AVX2
+#    include <immintrin.h>
+#    include <intrin.h>
+#  endif
+#endif
+
+static inline GLfloat* element(GLfloat* first, size_t stride, size_t index)
+{
+	return reinterpret_cast<GLfloat*>(reinterpret_cast<char*>(first) + index * stride);
+}
+
+static inline const GLfloat* element(const GLfloat* first, size_t stride, size_t index)
+{
+	return reinterpret_cast<const GLfloat*>(reinterpret_cast<const char*>(first) + index * stride);
+}
+
+/* Scalar kernels, also used for the elements the vector loops can't
+ * cover, so they define the exact arithmetic of every implementation.
+ */
+
+static void scaleScalar(GLfloat* first, size_t count, size_t stride, unsigned lanes,
+			const GLfloat mul[4])
+{
+	for (size_t i = 0; i < count; ++i)
+	{
+		GLfloat* v = element(first, stride, i);
+		for (unsigned c = 0; c < 4; ++c)
+		{
+			if (lanes & (1u << c))
+			{
+				v[c] = v[c] * mul[c];
+			}
+		}
+	}
+}
+
+static void scaleAddScalar(GLfloat* first, size_t count, size_t stride, unsigned lanes,
+			   const GLfloat mul[4], const GLfloat add[4])
+{
+	for (size_t i = 0; i < count; ++i)
+	{
+		GLfloat* v = element(first, stride, i);
+		for (unsigned c = 0; c < 4; ++c)
+		{
+			if (lanes & (1u << c))
+			{
+				v[c] = v[c] * mul[c] + add[c];
+			}
+		}
+	}
+}
+
+static void transformScalar(GLfloat* first, size_t count, size_t stride, unsigned lanes,
+			    const GLfloat m[16], GLfloat w)
+{
+	GLfloat in[3];
+
+	for (size_t i = 0; i < count; ++i)
+	{
+		GLfloat* v = element(first, stride, i);
+		in[0] = v[0];
+		in[1] = v[1];
+		in[2] = v[2];
+		for (unsigned c = 0; c < 4; ++c)
+		{
+			if (lanes & (1u << c))
+			{
+				v[c] = m[c] * in[0] + m[4 + c] * in[1] + m[8 + c] * in[2] + m[12 + c] * w;
+			}
+		}
+	}
+}
+
+/* Bounds are gathered in 8 lanes per component, element i goes to lane
+ * i % 8, so the vector versions can take 8 elements per step and still
+ * add up the sums in the same order.
+ */
+#define BOUNDS_LANES 8
+
+struct BoundsLanes
+{
+	GLfloat min[3][BOUNDS_LANES], max[3][BOUNDS_LANES], sum[3][BOUNDS_LANES];
+	int32_t minIndex[3][BOUNDS_LANES], maxIndex[3][BOUNDS_LANES];
+};
+
+static void boundsLanesInit(const GLfloat* first, BoundsLanes& lanes)
+{
+	for (unsigned c = 0; c < 3; ++c)
+	{
+		for (unsigned k = 0; k < BOUNDS_LANES; ++k)
+		{
+			lanes.min[c][k] = lanes.max[c][k] = first[c];
+			lanes.sum[c][k] = 0.f;
+			lanes.minIndex[c][k] = lanes.maxIndex[c][k] = 0;
+		}
+	}
+}
+
+static void boundsLanesScalar(const GLfloat* first, size_t begin, size_t count, size_t stride, BoundsLanes& lanes)
+{
+	for (size_t i = begin; i < count; ++i)
+	{
+		const GLfloat* v = element(first, stride, i);
+		const unsigned k = i % BOUNDS_LANES;
+
+		for (unsigned c = 0; c < 3; ++c)
+		{
+			lanes.sum[c][k] += v[c];
+			if (v[c] < lanes.min[c][k])
+			{
+				lanes.min[c][k] = v[c];
+				lanes.minIndex[c][k] = i;
+			}
+			if (v[c] > lanes.max[c][k])
+			{
+				lanes.max[c][k] = v[c];
+				lanes.maxIndex[c][k] = i;
+			}
+		}
+	}
+}
+
+// Sums pairwise in a fixed order, the first index wins between equal extremes
+static void boundsLanesReduce(const BoundsLanes& lanes, VertexBounds& out)
+{
+	for (unsigned c = 0; c < 3; ++c)
+	{
+		const GLfloat* s = lanes.sum[c];
+
+		out.sum[c] = ((s[0] + s[1]) + (s[2] + s[3])) + ((s[4] + s[5]) + (s[6] + s[7]));
+		out.min[c] = lanes.min[c][0];
+		out.max[c] = lanes.max[c][0];
+		out.minIndex[c] = lanes.minIndex[c][0];
+		out.maxIndex[c] = lanes.maxIndex[c][0];
+
+		for (unsigned k = 1; k < BOUNDS_LANES; ++k)
+		{
+			const unsigned minIndex = lanes.minIndex[c][k];
+			const unsigned maxIndex = lanes.maxIndex[c][k];
+
+			if (lanes.min[c][k] < out.min[c] || (lanes.min[c][k] == out.min[c] && minIndex < out.minIndex[c]))
+			{
+				out.min[c] = lanes.min[c][k];
+				out.minIndex[c] = minIndex;
+			}
+			if (lanes.max[c][k] > out.max[c] || (lanes.max[c][k] == out.max[c] && maxIndex < out.maxIndex[c]))
+			{
+				out.max[c] = lanes.max[c][k];
+				out.maxIndex[c] = maxIndex;
+			}
+		}
+	}
+}
+
+static void boundsScalar(const GLfloat* first, size_t count, size_t stride, VertexBounds& out)
+{
+	BoundsLanes lanes;
+
+	boundsLanesInit(first, lanes);
+	boundsLanesScalar(first, 0, count, stride, lanes);
+	boundsLanesReduce(lanes, out);
+}
+
+static const VertexKernels scalarKernels =
+{
+	"scalar", scaleScalar, scaleAddScalar, transformScalar, boundsScalar
+};
+
+/* Per float parameters for packed arrays. With 2, 3 or 4 floats per
+ * element the pattern repeats every 12 floats, so SSE2 steps over 12 and
+ * AVX2 over 24 floats with 3 registers each.
+ */
+static bool flatPattern(size_t stride, unsigned lanes, const GLfloat mul[4], const GLfloat add[4],
+			GLfloat mulPat[24], GLfloat addPat[24], uint32_t maskPat[24])
+{
+	const size_t floats = stride / sizeof(GLfloat);
+
+	if (stride % sizeof(GLfloat) || floats < 2 || floats > 4 || (lanes >> floats))
+	{
+		return false;
+	}
+
+	for (unsigned k = 0; k < 24; ++k)
+	{
+		const unsigned c = k % floats;
+		const bool on = (lanes & (1u << c)) != 0;
+		mulPat[k] = on ? mul[c] : 1.f;
+		addPat[k] = on && add ? add[c] : 0.f;
+		maskPat[k] = on ? 0xffffffffu : 0u;
+	}
+	return true;
+}
+
+#ifdef WMIT_KERNELS_SSE2
+
+static inline __m128 laneMask(unsigned lanes)
+{
+	return _mm_castsi128_ps(_mm_set_epi32(lanes & 8 ? -1 : 0, lanes & 4 ? -1 : 0,
+					      lanes & 2 ? -1 : 0, lanes & 1 ? -1 : 0));
+}
+
+static inline __m128 blendLanes(__m128 mask, __m128 on, __m128 off)
+{
+	return _mm_or_ps(_mm_and_ps(mask, on), _mm_andnot_ps(mask, off));
+}
+
+/* Packed xyz: 4 elements are 3 registers, transposed to x, y and z
+ * registers and back. Shuffles work within 128 bit lanes, so the AVX2
+ * versions below do the same thing on 2 groups of 4 at once.
+ */
+#define SPLIT_XYZ(shuffle, a, b, c, x, y, z) \
+	do { \
+		x = shuffle(a, shuffle(b, c, _MM_SHUFFLE(0, 1, 0, 2)), _MM_SHUFFLE(2, 0, 3, 0)); \
+		y = shuffle(shuffle(a, b, _MM_SHUFFLE(0, 0, 1, 1)), \
+			    shuffle(b, c, _MM_SHUFFLE(2, 2, 3, 3)), _MM_SHUFFLE(2, 0, 2, 0)); \
+		z = shuffle(shuffle(a, b, _MM_SHUFFLE(1, 1, 2, 2)), \
+			    shuffle(c, c, _MM_SHUFFLE(3, 3, 0, 0)), _MM_SHUFFLE(2, 0, 2, 0)); \
+	} while (0)
+
+#define MERGE_XYZ(shuffle, unpacklo, unpackhi, x, y, z, a, b, c) \
+	do { \
+		a = shuffle(unpacklo(x, y), shuffle(z, x, _MM_SHUFFLE(1, 1, 0, 0)), _MM_SHUFFLE(2, 0, 1, 0)); \
+		b = shuffle(unpacklo(y, z), unpackhi(x, y), _MM_SHUFFLE(1, 0, 3, 2)); \
+		c = shuffle(shuffle(z, x, _MM_SHUFFLE(3, 3, 2, 2)), \
+			    shuffle(y, z, _MM_SHUFFLE(3, 3, 3, 3)), _MM_SHUFFLE(2, 0, 2, 0)); \
+	} while (0)
+
+static inline void splitXYZ(const GLfloat* e, __m128& x, __m128& y, __m128& z)
+{
+	const __m128 a = _mm_loadu_ps(e);
+	const __m128 b = _mm_loadu_ps(e + 4);
+	const __m128 c = _mm_loadu_ps(e + 8);
+
+	SPLIT_XYZ(_mm_shuffle_ps, a, b, c, x, y, z);
+}
+
+static inline void mergeXYZ(GLfloat* e, __m128 x, __m128 y, __m128 z)
+{
+	__m128 a, b, c;
+
+	MERGE_XYZ(_mm_shuffle_ps, _mm_unpacklo_ps, _mm_unpackhi_ps, x, y, z, a, b, c);
+	_mm_storeu_ps(e, a);
+	_mm_storeu_ps(e + 4, b);
+	_mm_storeu_ps(e + 8, c);
+}
+
+/// x, y and z of the 4 elements from i on, strided ones need 4 readable floats each
+static inline void loadXYZ(const GLfloat* first, size_t stride, size_t i, __m128& x, __m128& y, __m128& z)
+{
+	if (stride == 3 * sizeof(GLfloat))
+	{
+		splitXYZ(first + 3 * i, x, y, z);
+	}
+	else
+	{
+		__m128 r0 = _mm_loadu_ps(element(first, stride, i));
+		__m128 r1 = _mm_loadu_ps(element(first, stride, i + 1));
+		__m128 r2 = _mm_loadu_ps(element(first, stride, i + 2));
+		__m128 r3 = _mm_loadu_ps(element(first, stride, i + 3));
+
+		_MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+		x = r0;
+		y = r1;
+		z = r2;
+	}
+}
+
+/**
+  * Elements the 8 wide bounds loops may take: all of a packed array, all
+  * but the last one of a strided array (its 4th float may be past the end).
+  * 0 if the stride doesn't suit either.
+  */
+static inline size_t boundsVectorCount(size_t count, size_t stride)
+{
+	if (stride == 3 * sizeof(GLfloat))
+	{
+		return count;
+	}
+	if (stride >= 4 * sizeof(GLfloat) && stride % sizeof(GLfloat) == 0)
+	{
+		return count - 1;
+	}
+	return 0;
+}
+
+/* The strided loops load 4 floats per element, which stays in the
+ * buffer for all but the last element; that one goes through the scalar
+ * kernel (or a copy) instead.
+ */
+
+static void scaleAddSSE2(GLfloat* first, size_t count, size_t stride, unsigned lanes,
+			 const GLfloat mul[4], const GLfloat add[4])
+{
+	GLfloat mulPat[24], addPat[24];
+	uint32_t maskPat[24];
+	size_t i = 0;
+
+	if (!count)
+	{
+		return;
+	}
+
+	if (flatPattern(stride, lanes, mul, add, mulPat, addPat, maskPat))
+	{
+		const size_t total = count * (stride / sizeof(GLfloat));
+		__m128 m[3], a[3], k[3];
+
+		for (unsigned r = 0; r < 3; ++r)
+		{
+			m[r] = _mm_loadu_ps(mulPat + 4 * r);
+			a[r] = _mm_loadu_ps(addPat + 4 * r);
+			k[r] = _mm_loadu_ps(reinterpret_cast<const float*>(maskPat) + 4 * r);
+		}
+
+		for (; i + 12 <= total; i += 12)
+		{
+			for (unsigned r = 0; r < 3; ++r)
+			{
+				const __m128 v = _mm_loadu_ps(first + i + 4 * r);
+				__m128 res = _mm_mul_ps(v, m[r]);
+				if (add)
+				{
+					res = _mm_add_ps(res, a[r]);
+				}
+				_mm_storeu_ps(first + i + 4 * r, blendLanes(k[r], res, v));
+			}
+		}
+		for (; i < total; ++i)
+		{
+			if (maskPat[i % 12])
+			{
+				first[i] = add ? first[i] * mulPat[i % 12] + addPat[i % 12] : first[i] * mulPat[i % 12];
+			}
+		}
+		return;
+	}
+
+	const __m128 m = _mm_loadu_ps(mul);
+	const __m128 a = add ? _mm_loadu_ps(add) : _mm_setzero_ps();
+	const __m128 k = laneMask(lanes);
+
+	if (stride >= 4 * sizeof(GLfloat))
+	{
+		for (; i + 1 < count; ++i)
+		{
+			GLfloat* e = element(first, stride, i);
+			const __m128 v = _mm_loadu_ps(e);
+			__m128 res = _mm_mul_ps(v, m);
+			if (add)
+			{
+				res = _mm_add_ps(res, a);
+			}
+			_mm_storeu_ps(e, blendLanes(k, res, v));
+		}
+	}
+
+	if (add)
+	{
+		scaleAddScalar(element(first, stride, i), count - i, stride, lanes, mul, add);
+	}
+	else
+	{
+		scaleScalar(element(first, stride, i), count - i, stride, lanes, mul);
+	}
+}
+
+static void scaleSSE2(GLfloat* first, size_t count, size_t stride, unsigned lanes,
+		      const GLfloat mul[4])
+{
+	scaleAddSSE2(first, count, stride, lanes, mul, 0);
+}
+
+static void transformSSE2(GLfloat* first, size_t count, size_t stride, unsigned lanes,
+			  const GLfloat m[16], GLfloat w)
+{
+	const __m128 c0 = _mm_loadu_ps(m);
+	const __m128 c1 = _mm_loadu_ps(m + 4);
+	const __m128 c2 = _mm_loadu_ps(m + 8);
+	const __m128 c3w = _mm_mul_ps(_mm_loadu_ps(m + 12), _mm_set1_ps(w));
+	const __m128 k = laneMask(lanes);
+	size_t i = 0;
+
+	if (!count)
+	{
+		return;
+	}
+
+	if (stride == 3 * sizeof(GLfloat) && lanes == 0x7)
+	{
+		// packed xyz: transpose 4 vertices to x, y and z registers and back
+		const __m128 mx[4] = {_mm_set1_ps(m[0]), _mm_set1_ps(m[4]), _mm_set1_ps(m[8]), _mm_set1_ps(m[12] * w)};
+		const __m128 my[4] = {_mm_set1_ps(m[1]), _mm_set1_ps(m[5]), _mm_set1_ps(m[9]), _mm_set1_ps(m[13] * w)};
+		const __m128 mz[4] = {_mm_set1_ps(m[2]), _mm_set1_ps(m[6]), _mm_set1_ps(m[10]), _mm_set1_ps(m[14] * w)};
+
+		for (; i + 4 <= count; i += 4)
+		{
+			GLfloat* e = first + 3 * i;
+			__m128 x, y, z;
+
+			splitXYZ(e, x, y, z);
+
+			__m128 rx = _mm_mul_ps(mx[0], x);
+			__m128 ry = _mm_mul_ps(my[0], x);
+			__m128 rz = _mm_mul_ps(mz[0], x);
+			rx = _mm_add_ps(rx, _mm_mul_ps(mx[1], y));
+			ry = _mm_add_ps(ry, _mm_mul_ps(my[1], y));
+			rz = _mm_add_ps(rz, _mm_mul_ps(mz[1], y));
+			rx = _mm_add_ps(rx, _mm_mul_ps(mx[2], z));
+			ry = _mm_add_ps(ry, _mm_mul_ps(my[2], z));
+			rz = _mm_add_ps(rz, _mm_mul_ps(mz[2], z));
+			rx = _mm_add_ps(rx, mx[3]);
+			ry = _mm_add_ps(ry, my[3]);
+			rz = _mm_add_ps(rz, mz[3]);
+
+			mergeXYZ(e, rx, ry, rz);
+		}
+	}
+
+	for (; i + 1 < count; ++i)
+	{
+		GLfloat* e = element(first, stride, i);
+		const __m128 v = _mm_loadu_ps(e);
+		__m128 res = _mm_mul_ps(c0, _mm_shuffle_ps(v, v, _MM_SHUFFLE(0, 0, 0, 0)));
+		res = _mm_add_ps(res, _mm_mul_ps(c1, _mm_shuffle_ps(v, v, _MM_SHUFFLE(1, 1, 1, 1))));
+		res = _mm_add_ps(res, _mm_mul_ps(c2, _mm_shuffle_ps(v, v, _MM_SHUFFLE(2, 2, 2, 2))));
+		res = _mm_add_ps(res, c3w);
+		if (stride >= 4 * sizeof(GLfloat))
+		{
+			_mm_storeu_ps(e, blendLanes(k, res, v));
+		}
+		else
+		{
+			// a full store would overlap the next element's load and
+			// defeat store forwarding, so write the lanes one by one
+			GLfloat out[4];
+			_mm_storeu_ps(out, res);
+			for (unsigned c = 0; c < 3; ++c)
+			{
+				if (lanes & (1u << c))
+				{
+					e[c] = out[c];
+				}
+			}
+		}
+	}
+
+	transformScalar(element(first, stride, i), count - i, stride, lanes, m, w);
+}
+
+// 8 elements (2 registers per lane set) per step
+static void boundsSSE2(const GLfloat* first, size_t count, size_t stride, VertexBounds& out)
+{
+	const size_t vectorCount = boundsVectorCount(count, stride);
+	const __m128i four = _mm_set1_epi32(4), eight = _mm_set1_epi32(BOUNDS_LANES);
+	__m128 mn[3][2], mx[3][2], sum[3][2];
+	__m128i mnIdx[3][2], mxIdx[3][2];
+	__m128i idx[2] = {_mm_setr_epi32(0, 1, 2, 3), _mm_setr_epi32(4, 5, 6, 7)};
+	BoundsLanes lanes;
+	size_t i = 0;
+
+	boundsLanesInit(first, lanes);
+	for (unsigned c = 0; c < 3; ++c)
+	{
+		for (unsigned h = 0; h < 2; ++h)
+		{
+			mn[c][h] = _mm_loadu_ps(lanes.min[c] + 4 * h);
+			mx[c][h] = _mm_loadu_ps(lanes.max[c] + 4 * h);
+			sum[c][h] = _mm_setzero_ps();
+			mnIdx[c][h] = mxIdx[c][h] = _mm_setzero_si128();
+		}
+	}
+
+	for (; i + BOUNDS_LANES <= vectorCount; i += BOUNDS_LANES)
+	{
+		__m128 v[3][2];
+
+		loadXYZ(first, stride, i, v[0][0], v[1][0], v[2][0]);
+		loadXYZ(first, stride, i + 4, v[0][1], v[1][1], v[2][1]);
+
+		for (unsigned c = 0; c < 3; ++c)
+		{
+			for (unsigned h = 0; h < 2; ++h)
+			{
+				const __m128i lt = _mm_castps_si128(_mm_cmplt_ps(v[c][h], mn[c][h]));
+				const __m128i gt = _mm_castps_si128(_mm_cmpgt_ps(v[c][h], mx[c][h]));
+
+				sum[c][h] = _mm_add_ps(sum[c][h], v[c][h]);
+				mn[c][h] = _mm_min_ps(v[c][h], mn[c][h]);
+				mx[c][h] = _mm_max_ps(v[c][h], mx[c][h]);
+				mnIdx[c][h] = _mm_or_si128(_mm_and_si128(lt, idx[h]), _mm_andnot_si128(lt, mnIdx[c][h]));
+				mxIdx[c][h] = _mm_or_si128(_mm_and_si128(gt, idx[h]), _mm_andnot_si128(gt, mxIdx[c][h]));
+			}
+		}
+		idx[0] = _mm_add_epi32(idx[0], eight);
+		idx[1] = _mm_add_epi32(idx[0], four);
+	}
+
+	for (unsigned c = 0; c < 3; ++c)
+	{
+		for (unsigned h = 0; h < 2; ++h)
+		{
+			_mm_storeu_ps(lanes.min[c] + 4 * h, mn[c][h]);
+			_mm_storeu_ps(lanes.max[c] + 4 * h, mx[c][h]);
+			_mm_storeu_ps(lanes.sum[c] + 4 * h, sum[c][h]);
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(lanes.minIndex[c] + 4 * h), mnIdx[c][h]);
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(lanes.maxIndex[c] + 4 * h), mxIdx[c][h]);
+		}
+	}
+
+	boundsLanesScalar(first, i, count, stride, lanes);
+	boundsLanesReduce(lanes, out);
+}
+
+static const VertexKernels sse2Kernels =
+{
+	"sse2", scaleSSE2, scaleAddSSE2, transformSSE2, boundsSSE2
+};
+
+#endif // WMIT_KERNELS_SSE2
+
+#ifdef WMIT_KERNELS_AVX2
+
+/* 8 lane versions of the packed loops. Strided elements need a load each
+ * anyway, those go through the SSE2 code.
+ */
+
+/// x, y and z of 8 packed xyz elements: 128 bit lanes get elements 0-3 and 4-7
+WMIT_TARGET_AVX2
+static inline void splitXYZ8(const GLfloat* e, __m256& x, __m256& y, __m256& z)
+{
+	const __m256 l0 = _mm256_loadu_ps(e);
+	const __m256 l1 = _mm256_loadu_ps(e + 8);
+	const __m256 l2 = _mm256_loadu_ps(e + 16);
+	const __m256 a = _mm256_permute2f128_ps(l0, l1, 0x30);
+	const __m256 b = _mm256_permute2f128_ps(l0, l2, 0x21);
+	const __m256 c = _mm256_permute2f128_ps(l1, l2, 0x30);
+
+	SPLIT_XYZ(_mm256_shuffle_ps, a, b, c, x, y, z);
+}
+
+WMIT_TARGET_AVX2
+static inline void mergeXYZ8(GLfloat* e, __m256 x, __m256 y, __m256 z)
+{
+	__m256 a, b, c;
+
+	MERGE_XYZ(_mm256_shuffle_ps, _mm256_unpacklo_ps, _mm256_unpackhi_ps, x, y, z, a, b, c);
+	_mm256_storeu_ps(e, _mm256_permute2f128_ps(a, b, 0x20));
+	_mm256_storeu_ps(e + 8, _mm256_permute2f128_ps(c, a, 0x30));
+	_mm256_storeu_ps(e + 16, _mm256_permute2f128_ps(b, c, 0x31));
+}
+
+WMIT_TARGET_AVX2
+static void scaleAddAVX2(GLfloat* first, size_t count, size_t stride, unsigned lanes,
+			 const GLfloat mul[4], const GLfloat add[4])
+{
+	GLfloat mulPat[24], addPat[24];
+	uint32_t maskPat[24];
+	size_t i = 0;
+
+	if (!count || !flatPattern(stride, lanes, mul, add, mulPat, addPat, maskPat))
+	{
+		scaleAddSSE2(first, count, stride, lanes, mul, add);
+		return;
+	}
+
+	const size_t total = count * (stride / sizeof(GLfloat));
+	__m256 m[3], a[3], k[3];
+
+	for (unsigned r = 0; r < 3; ++r)
+	{
+		m[r] = _mm256_loadu_ps(mulPat + 8 * r);
+		a[r] = _mm256_loadu_ps(addPat + 8 * r);
+		k[r] = _mm256_loadu_ps(reinterpret_cast<const float*>(maskPat) + 8 * r);
+	}
+
+	for (; i + 24 <= total; i += 24)
+	{
+		for (unsigned r = 0; r < 3; ++r)
+		{
+			const __m256 v = _mm256_loadu_ps(first + i + 8 * r);
+			__m256 res = _mm256_mul_ps(v, m[r]);
+			if (add)
+			{
+				res = _mm256_add_ps(res, a[r]);
+			}
+			_mm256_storeu_ps(first + i + 8 * r, _mm256_blendv_ps(v, res, k[r]));
+		}
+	}
+
+	// what's left is less than one step, pattern phase is still 0 at i
+	scaleAddSSE2(first + i, (total - i) / (stride / sizeof(GLfloat)), stride, lanes, mul, add);
+}
+
+WMIT_TARGET_AVX2
+static void scaleAVX2(GLfloat* first, size_t count, size_t stride, unsigned lanes,
+		      const GLfloat mul[4])
+{
+	scaleAddAVX2(first, count, stride, lanes, mul, 0);
+}
+
+WMIT_TARGET_AVX2
+static void transformAVX2(GLfloat* first, size_t count, size_t stride, unsigned lanes,
+			  const GLfloat m[16], GLfloat w)
+{
+	size_t i = 0;
+
+	if (stride == 3 * sizeof(GLfloat) && lanes == 0x7)
+	{
+		// same operations in the same order as transformSSE2()
+		const __m256 mx[4] = {_mm256_set1_ps(m[0]), _mm256_set1_ps(m[4]), _mm256_set1_ps(m[8]), _mm256_set1_ps(m[12] * w)};
+		const __m256 my[4] = {_mm256_set1_ps(m[1]), _mm256_set1_ps(m[5]), _mm256_set1_ps(m[9]), _mm256_set1_ps(m[13] * w)};
+		const __m256 mz[4] = {_mm256_set1_ps(m[2]), _mm256_set1_ps(m[6]), _mm256_set1_ps(m[10]), _mm256_set1_ps(m[14] * w)};
+
+		for (; i + 8 <= count; i += 8)
+		{
+			GLfloat* e = first + 3 * i;
+			__m256 x, y, z;
+
+			splitXYZ8(e, x, y, z);
+
+			__m256 rx = _mm256_mul_ps(mx[0], x);
+			__m256 ry = _mm256_mul_ps(my[0], x);
+			__m256 rz = _mm256_mul_ps(mz[0], x);
+			rx = _mm256_add_ps(rx, _mm256_mul_ps(mx[1], y));
+			ry = _mm256_add_ps(ry, _mm256_mul_ps(my[1], y));
+			rz = _mm256_add_ps(rz, _mm256_mul_ps(mz[1], y));
+			rx = _mm256_add_ps(rx, _mm256_mul_ps(mx[2], z));
+			ry = _mm256_add_ps(ry, _mm256_mul_ps(my[2], z));
+			rz = _mm256_add_ps(rz, _mm256_mul_ps(mz[2], z));
+			rx = _mm256_add_ps(rx, mx[3]);
+			ry = _mm256_add_ps(ry, my[3]);
+			rz = _mm256_add_ps(rz, mz[3]);
+
+			mergeXYZ8(e, rx, ry, rz);
+		}
+	}
+
+	transformSSE2(element(first, stride, i), count - i, stride, lanes, m, w);
+}
+
+// Whole lanes in registers, 8 packed elements per step
+WMIT_TARGET_AVX2
+static void boundsAVX2(const GLfloat* first, size_t count, size_t stride, VertexBounds& out)
+{
+	const __m256i laneOffset = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+	__m256 mn[3], mx[3], sum[3], mnIdx[3], mxIdx[3];
+	BoundsLanes lanes;
+	size_t i = 0;
+
+	// gathering strided elements eats up the gain of the wider registers
+	if (stride != 3 * sizeof(GLfloat))
+	{
+		boundsSSE2(first, count, stride, out);
+		return;
+	}
+
+	boundsLanesInit(first, lanes);
+	for (unsigned c = 0; c < 3; ++c)
+	{
+		mn[c] = _mm256_loadu_ps(lanes.min[c]);
+		mx[c] = _mm256_loadu_ps(lanes.max[c]);
+		sum[c] = _mm256_loadu_ps(lanes.sum[c]);
+		mnIdx[c] = mxIdx[c] = _mm256_setzero_ps();
+	}
+
+	for (; i + BOUNDS_LANES <= count; i += BOUNDS_LANES)
+	{
+		const __m256 idx = _mm256_castsi256_ps(_mm256_add_epi32(_mm256_set1_epi32(static_cast<int>(i)), laneOffset));
+		__m256 v[3];
+
+		splitXYZ8(first + 3 * i, v[0], v[1], v[2]);
+
+		for (unsigned c = 0; c < 3; ++c)
+		{
+			const __m256 lt = _mm256_cmp_ps(v[c], mn[c], _CMP_LT_OQ);
+			const __m256 gt = _mm256_cmp_ps(v[c], mx[c], _CMP_GT_OQ);
+
+			sum[c] = _mm256_add_ps(sum[c], v[c]);
+			mn[c] = _mm256_blendv_ps(mn[c], v[c], lt);
+			mx[c] = _mm256_blendv_ps(mx[c], v[c], gt);
+			mnIdx[c] = _mm256_blendv_ps(mnIdx[c], idx, lt);
+			mxIdx[c] = _mm256_blendv_ps(mxIdx[c], idx, gt);
+		}
+	}
+
+	for (unsigned c = 0; c < 3; ++c)
+	{
+		_mm256_storeu_ps(lanes.min[c], mn[c]);
+		_mm256_storeu_ps(lanes.max[c], mx[c]);
+		_mm256_storeu_ps(lanes.sum[c], sum[c]);
+		_mm256_storeu_ps(reinterpret_cast<float*>(lanes.minIndex[c]), mnIdx[c]);
+		_mm256_storeu_ps(reinterpret_cast<float*>(lanes.maxIndex[c]), mxIdx[c]);
+	}
+
+	boundsLanesScalar(first, i, count, stride, lanes);
+	boundsLanesReduce(lanes, out);
+}
+
+static const VertexKernels avx2Kernels =
+{
+	"avx2", scaleAVX2, scaleAddAVX2, transformAVX2, boundsAVX2
+};
+
+static bool cpuHasAVX2()
+{
+#ifdef _MSC_VER
+	int info[4];
+
+	__cpuid(info, 0);
+	if (info[0] < 7)
+	{
+		return false;
+	}
+	// the OS has to save the YMM registers too
+	__cpuid(info, 1);
+	if (!(info[2] & (1 << 27)) || !(info[2] & (1 << 28)) || (_xgetbv(0) & 6) != 6)
+	{
+		return false;
+	}
+	__cpuidex(info, 7, 0);
+	return (info[1] & (1 << 5)) != 0;
+#else
+	__builtin_cpu_init();
+	return __builtin_cpu_supports("avx2") != 0;
+#endif
+}
+
+#endif // WMIT_KERNELS_AVX2
+
+std::vector<const VertexKernels*> availableVertexKernels()
+{
+	std::vector<const VertexKernels*> kernels;
+
+	kernels.push_back(&scalarKernels);
+#ifdef WMIT_KERNELS_SSE2
+	kernels.push_back(&sse2Kernels);
+#endif
+#ifdef WMIT_KERNELS_AVX2
+	if (cpuHasAVX2())
+	{
+		kernels.push_back(&avx2Kernels);
+	}
+#endif
+	return kernels;
+}
+
+static const VertexKernels* selectVertexKernels()
+{
+	const std::vector<const VertexKernels*> kernels = availableVertexKernels();
+	const char* forced = std::getenv("WMIT_VERTEX_KERNELS");
+	std::vector<const VertexKernels*>::const_iterator it;
+
+	if (forced)
+	{
+		for (it = kernels.begin(); it != kernels.end(); ++it)
+		{
+			if (!std::strcmp((*it)->name, forced))
+			{
+				return *it;
+			}
+		}
+	}
+	return kernels.back();
+}
+
+const VertexKernels& vertexKernels()
+{
+	static const VertexKernels* kernels = selectVertexKernels();
+	return *kernels;
+}
@@ -0,0 +1,73 @@
+/*
+	Copyright 2010 Warzone 2100 Project
+
+	This file is part of WMIT.
+
+	WMIT is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	WMIT is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with WMIT.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef VERTEXKERNELS_HPP
+#define VERTEXKERNELS_HPP
+
+#include <cstddef>
+#include <vector>
+
+#include "GLTypes.hpp"
+
+/// Result of VertexKernels::bounds, indices are those of the first extreme
+struct VertexBounds
+{
+	GLfloat min[3], max[3], sum[3];
+	unsigned minIndex[3], maxIndex[3];
+};
+
+/**
+  * Vectorized loops over strided float attributes.
+  *
+  * Each kernel walks count elements starting at first, stride bytes apart,
+  * and only touches the components set in lanes (bit 0 is x, bit 3 is w).
+  * Every implementation does the same float operations in the same order
+  * as the scalar one, so results don't depend on the CPU they ran on.
+  */
+struct VertexKernels
+{
+	const char* name;
+
+	/// v[c] *= mul[c]
+	void (*scale)(GLfloat* first, size_t count, size_t stride, unsigned lanes,
+		      const GLfloat mul[4]);
+	/// v[c] = v[c] * mul[c] + add[c]
+	void (*scaleAdd)(GLfloat* first, size_t count, size_t stride, unsigned lanes,
+			 const GLfloat mul[4], const GLfloat add[4]);
+	/// v[c] = m[c] * x + m[4 + c] * y + m[8 + c] * z + m[12 + c] * w, column major m
+	void (*transform)(GLfloat* first, size_t count, size_t stride, unsigned lanes,
+			  const GLfloat matrix[16], GLfloat w);
+	/**
+	  * AABB and component sums of 3 component elements, count must not be 0.
+	  * Sums are kept per element index % 8 and added up pairwise at the end.
+	  */
+	void (*bounds)(const GLfloat* first, size_t count, size_t stride, VertexBounds& out);
+};
+
+/**
+  * Best kernels for this CPU, picked on first use.
+  *
+  * WMIT_VERTEX_KERNELS=scalar|sse2|avx2 in the environment forces a
+  * (supported) implementation.
+  */
+const VertexKernels& vertexKernels();
+
+/// Every implementation this CPU can run, scalar first
+std::vector<const VertexKernels*> availableVertexKernels();
+
+#endif // VERTEXKERNELS_HPP
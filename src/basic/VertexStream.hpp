@@ -0,0 +1,92 @@
+/*
+	Copyright 2010 Warzone 2100 Project
+
+	This file is part of WMIT.
+
+	WMIT is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	WMIT is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with WMIT.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef VERTEXSTREAM_HPP
+#define VERTEXSTREAM_HPP
+
+#include <cstddef>
+
+/**
+  * Strided view of one vertex attribute.
+  *
+  * Lets code walk an attribute the same way whether it lives in its own
+  * array (stride == sizeof(T)) or inside an interleaved vertex record.
+  * The view doesn't own anything and is invalidated by any resize of the
+  * storage it points into.
+  */
+template <typename T>
+class VertexStream
+{
+public:
+	VertexStream(): m_bytes(0), m_size(0), m_stride(sizeof(T)) {}
+
+	VertexStream(T* first, size_t size, size_t stride = sizeof(T)):
+		m_bytes(const_cast<char*>(reinterpret_cast<const char*>(first))),
+		m_size(size),
+		m_stride(stride)
+	{
+	}
+
+	/// Mutable to const view conversion
+	template <typename U>
+	VertexStream(const VertexStream<U>& rhs):
+		m_bytes(const_cast<char*>(reinterpret_cast<const char*>(rhs.data()))),
+		m_size(rhs.size()),
+		m_stride(rhs.stride())
+	{
+	}
+
+	T& operator [](size_t index) const
+	{
+		return *reinterpret_cast<T*>(m_bytes + index * m_stride);
+	}
+
+	T* data() const
+	{
+		return reinterpret_cast<T*>(m_bytes);
+	}
+
+	size_t size() const
+	{
+		return m_size;
+	}
+
+	bool empty() const
+	{
+		return m_size == 0;
+	}
+
+	/// Distance in bytes between two consecutive elements
+	size_t stride() const
+	{
+		return m_stride;
+	}
+
+	/// True if the elements are tightly packed, ie. data() is a plain array
+	bool contiguous() const
+	{
+		return m_stride == sizeof(T);
+	}
+
+private:
+	char* m_bytes;
+	size_t m_size;
+	size_t m_stride;
+};
+
+#endif // VERTEXSTREAM_HPP
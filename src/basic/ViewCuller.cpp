@@ -0,0 +1,142 @@
+/*
+	Copyright 2010 Warzone 2100 Project
+
+	This file is part of WMIT.
+
+	WMIT is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	WMIT is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with WMIT.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include "ViewCuller.hpp"
+
+#include <cmath>
+
+ViewCuller::ViewCuller():
+	m_cones(false)
+{
+	// 0x + 0y + 0z + 1, every point is inside every plane
+	for (int k = 0; k < 6; ++k)
+	{
+		m_planes[k][0] = m_planes[k][1] = m_planes[k][2] = 0.f;
+		m_planes[k][3] = 1.f;
+	}
+	m_eye[0] = m_eye[1] = m_eye[2] = 0.f;
+}
+
+ViewCuller::ViewCuller(const GLfloat modelView[16], const GLfloat projection[16], bool cullBackFaces)
+{
+	double clip[16], det;
+	int row, col, k;
+
+	for (col = 0; col < 4; ++col)
+	{
+		for (row = 0; row < 4; ++row)
+		{
+			clip[col * 4 + row] = 0.;
+			for (k = 0; k < 4; ++k)
+			{
+				clip[col * 4 + row] += (double)projection[k * 4 + row] * modelView[col * 4 + k];
+			}
+		}
+	}
+
+	// Gribb/Hartmann: w +- x, w +- y, w +- z
+	for (k = 0; k < 6; ++k)
+	{
+		const double sign = (k & 1) ? -1. : 1.;
+		double len = 0.;
+
+		for (col = 0; col < 4; ++col)
+		{
+			m_planes[k][col] = clip[col * 4 + 3] + sign * clip[col * 4 + k / 2];
+		}
+		for (col = 0; col < 3; ++col)
+		{
+			len += (double)m_planes[k][col] * m_planes[k][col];
+		}
+		len = std::sqrt(len);
+		for (col = 0; col < 4 && len > 0.; ++col)
+		{
+			m_planes[k][col] /= len;
+		}
+	}
+
+	// the eye sits at the origin of eye space, so it's -L^-1 * t for the linear part L
+	const GLfloat* m = modelView;
+	det = m[0] * ((double)m[5] * m[10] - (double)m[9] * m[6])
+	    - m[4] * ((double)m[1] * m[10] - (double)m[9] * m[2])
+	    + m[8] * ((double)m[1] * m[6] - (double)m[5] * m[2]);
+
+	m_cones = cullBackFaces && det != 0.
+		&& projection[3] == 0.f && projection[7] == 0.f && projection[11] == -1.f && projection[15] == 0.f;
+
+	if (m_cones)
+	{
+		const double t[3] = {-m[12], -m[13], -m[14]};
+
+		// Cramer's rule, one column of L swapped for t at a time
+		m_eye[0] = (t[0] * ((double)m[5] * m[10] - (double)m[9] * m[6])
+			  - m[4] * (t[1] * m[10] - (double)m[9] * t[2])
+			  + m[8] * (t[1] * m[6] - (double)m[5] * t[2])) / det;
+		m_eye[1] = (m[0] * (t[1] * m[10] - (double)m[9] * t[2])
+			  - t[0] * ((double)m[1] * m[10] - (double)m[9] * m[2])
+			  + m[8] * ((double)m[1] * t[2] - t[1] * m[2])) / det;
+		m_eye[2] = (m[0] * ((double)m[5] * t[2] - t[1] * m[6])
+			  - m[4] * ((double)m[1] * t[2] - t[1] * m[2])
+			  + t[0] * ((double)m[1] * m[6] - (double)m[5] * m[2])) / det;
+	}
+	else
+	{
+		m_eye[0] = m_eye[1] = m_eye[2] = 0.f;
+	}
+}
+
+bool ViewCuller::sphereVisible(const GLfloat center[3], GLfloat radius) const
+{
+	for (int k = 0; k < 6; ++k)
+	{
+		if (planeDistance(k, center) < -radius)
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+bool ViewCuller::boxVisible(const GLfloat min[3], const GLfloat max[3]) const
+{
+	GLfloat corner[3];
+	int k, i;
+
+	// only the corner furthest along the plane normal needs checking
+	for (k = 0; k < 6; ++k)
+	{
+		for (i = 0; i < 3; ++i)
+		{
+			corner[i] = m_planes[k][i] >= 0.f ? max[i] : min[i];
+		}
+		if (planeDistance(k, corner) < 0.f)
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+bool ViewCuller::visible(const Meshlet& meshlet) const
+{
+	if (!sphereVisible(meshlet.center, meshlet.radius))
+	{
+		return false;
+	}
+	return !(m_cones && meshletBackFacing(meshlet, m_eye));
+}
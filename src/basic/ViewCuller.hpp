@@ -0,0 +1,83 @@
+/*
+	Copyright 2010 Warzone 2100 Project
+
+	This file is part of WMIT.
+
+	WMIT is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	WMIT is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with WMIT.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef VIEWCULLER_HPP
+#define VIEWCULLER_HPP
+
+#include <cstddef>
+
+#include "GLTypes.hpp"
+#include "Meshlet.hpp"
+
+/// What a render pass drew and what it left out
+struct CullStats
+{
+	CullStats(): meshesDrawn(0), meshesCulled(0), trianglesDrawn(0), trianglesCulled(0),
+		clustersDrawn(0), clustersCulled(0), transformsUpdated(0) {}
+
+	CullStats& operator += (const CullStats& rhs)
+	{
+		meshesDrawn += rhs.meshesDrawn;
+		meshesCulled += rhs.meshesCulled;
+		trianglesDrawn += rhs.trianglesDrawn;
+		trianglesCulled += rhs.trianglesCulled;
+		clustersDrawn += rhs.clustersDrawn;
+		clustersCulled += rhs.clustersCulled;
+		transformsUpdated += rhs.transformsUpdated;
+		return *this;
+	}
+
+	size_t meshesDrawn, meshesCulled;
+	size_t trianglesDrawn, trianglesCulled;
+	size_t clustersDrawn, clustersCulled;	// meshlets of the meshes that weren't culled whole
+	size_t transformsUpdated;	// cached world transforms an assembly had to recompute first
+};
+
+/**
+  * Frustum and back face tests against one view, done in the model's own
+  * space so bounds don't need transforming.
+  */
+class ViewCuller
+{
+public:
+	/// Sees everything, for passes that don't cull
+	ViewCuller();
+	/**
+	  * Takes column major matrices as GL hands them out. Back faces are
+	  * only culled for perspective projections, where the eye is a point.
+	  */
+	ViewCuller(const GLfloat modelView[16], const GLfloat projection[16], bool cullBackFaces);
+
+	bool sphereVisible(const GLfloat center[3], GLfloat radius) const;
+	bool boxVisible(const GLfloat min[3], const GLfloat max[3]) const;
+	/// Frustum test of the bounding sphere, then the normal cone
+	bool visible(const Meshlet& meshlet) const;
+
+private:
+	GLfloat planeDistance(int plane, const GLfloat point[3]) const
+	{
+		return m_planes[plane][0] * point[0] + m_planes[plane][1] * point[1]
+			+ m_planes[plane][2] * point[2] + m_planes[plane][3];
+	}
+
+	GLfloat m_planes[6][4];	// normalized, pointing inwards
+	GLfloat m_eye[3];
+	bool m_cones;
+};
+
+#endif // VIEWCULLER_HPP
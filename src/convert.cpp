@@ -0,0 +1,165 @@
+/*
+	Copyright 2010 Warzone 2100 Project
+
+	This file is part of WMIT.
+
+	WMIT is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	WMIT is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with WMIT.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "WZM.hpp"
+#include "ModelIO.hpp"
+#include "BatchConvert.hpp"
+#include "VertexCache.hpp"
+#include "Overdraw.hpp"
+#include "Meshlet.hpp"
+
+// "<meshlets> clusters (<vertices>/<triangles> avg, <cones> cullable)"
+static void printMeshletStats(const MeshletStats& stats)
+{
+	std::cout << stats.meshlets << " clusters (" << stats.verticesPerMeshlet() << "/"
+		  << stats.trianglesPerMeshlet() << " vertices/triangles avg, " << stats.cones << " cone cullable)";
+}
+
+// Per mesh and total vertex cache, overdraw and cluster statistics of a model
+static int printStats(const char* inname)
+{
+	WZM model;
+
+	if (!loadModel(inname, model))
+		return 1;
+
+	VertexCacheStats cacheTotal;
+	OverdrawStats overdrawTotal;
+	MeshletStats meshletTotal;
+	int i;
+
+	std::cout << std::fixed << std::setprecision(3);
+	for (i = 0; i < model.meshes(); ++i)
+	{
+		const Mesh& mesh = model.getMesh(i);
+		const VertexCacheStats cache = mesh.vertexCacheStats();
+		const OverdrawStats overdraw = mesh.overdrawStats();
+		const MeshletStats meshlets = mesh.meshletStats();
+
+		std::cout << "mesh " << i << " (" << mesh.getName() << "): "
+			  << cache.triangles << " triangles, ACMR " << cache.acmr()
+			  << ", ATVR " << cache.atvr() << ", overdraw " << overdraw.overdraw() << ", ";
+		printMeshletStats(meshlets);
+		std::cout << '\n';
+		cacheTotal += cache;
+		overdrawTotal += overdraw;
+		meshletTotal += meshlets;
+	}
+	std::cout << "total: " << cacheTotal.triangles << " triangles, ACMR " << cacheTotal.acmr()
+		  << ", ATVR " << cacheTotal.atvr() << ", overdraw " << overdrawTotal.overdraw() << ", ";
+	printMeshletStats(meshletTotal);
+	std::cout << std::endl;
+	return 0;
+}
+
+// Qt free command line converter, takes the same conversion arguments as wmit plus --lod and --stats
+int main(int argc, char *argv[])
+{
+	if (argc > 1 && std::strcmp(argv[1], "--batch") == 0)
+	{
+		return runBatchConversion(std::vector<std::string>(argv + 2, argv + argc));
+	}
+
+	if (argc == 3 && std::strcmp(argv[1], "--stats") == 0)
+	{
+		return printStats(argv[2]);
+	}
+
+	bool optimize = false, overdraw = false;
+	std::vector<float> lodRatios;
+	int arg;
+
+	// conversion options, --overdraw implies --forsyth
+	for (arg = 1; arg + 2 < argc; ++arg)
+	{
+		if (std::strcmp(argv[arg], "--forsyth") == 0)
+			optimize = true;
+		else if (std::strcmp(argv[arg], "--overdraw") == 0)
+			optimize = overdraw = true;
+		else if (std::strcmp(argv[arg], "--lod") == 0 && arg + 3 < argc && parseLODRatios(argv[arg + 1], lodRatios))
+			++arg;
+		else
+			break;
+	}
+
+	if (argc == arg + 2)
+	{
+		const char* inname = argv[arg];
+		const char* outname = argv[arg + 1];
+		wmit_filetype_t outtype;
+		std::vector<WZM> lods;
+		size_t i;
+
+		if (!guessModelType(outname, outtype))
+		{
+			std::cerr << "wmit-convert - Unknown output format " << outname << std::endl;
+			return 1;
+		}
+
+		WZM model;
+
+		if (!loadModel(inname, model))
+			return 1;
+
+		if (!lodRatios.empty())
+		{
+			if (!model.generateLODs(lodRatios, lods))
+				return 1;
+			for (i = 0; i < lods.size(); ++i)
+			{
+				std::cout << "LOD " << i + 1 << ": " << model.triangles() << " -> "
+					  << lods[i].triangles() << " triangles" << std::endl;
+			}
+		}
+
+		if (optimize)
+		{
+			if (!optimizeModel(model, overdraw, std::cout))
+				return 1;
+			std::cout << std::endl;
+
+			for (i = 0; i < lods.size(); ++i)
+			{
+				std::cout << "LOD " << i + 1 << ": ";
+				if (!optimizeModel(lods[i], overdraw, std::cout))
+					return 1;
+				std::cout << std::endl;
+			}
+		}
+
+		if (!saveModel(outname, model, outtype))
+			return 1;
+		for (i = 0; i < lods.size(); ++i)
+		{
+			if (!saveModel(lodFileName(outname, i + 1), lods[i], outtype))
+				return 1;
+		}
+		return 0;
+	}
+
+	std::cerr << "Usage: wmit-convert [--forsyth | --overdraw] [--lod ratio[,ratio...]] <input> <output>\n"
+		  << "       wmit-convert --stats <input>\n"
+		  << "       wmit-convert --batch [-j threads] [--forsyth | --overdraw] <input dir | file list> <output dir> <pie|wzm|wzmb|obj>" << std::endl;
+	return 1;
+}
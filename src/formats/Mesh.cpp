@@ -26,6 +26,7 @@
 #include <set>
 
 #include <cmath>
+#include <limits>
 
 #include <sstream>
 
@@ -33,6 +34,21 @@
 #include "Util.hpp"
 #include "Pie.hpp"
 #include "Vector.hpp"
+#include "TextLexer.hpp"
+#include "WZMBinary.hpp"
+#include "VertexKernels.hpp"
+#include "Matrix4.hpp"
+#include "TaskPool.hpp"
+#include "VertexCache.hpp"
+#include "Overdraw.hpp"
+#include "Simplify.hpp"
+#include "Meshlet.hpp"
+
+#ifdef CPP0X_AVAILABLE
+#  define CPP0X_FEATURED(x) x
+#else
+#  define CPP0X_FEATURED(x) do {} while (0)
+#endif
 
 WZMVertex normalizeVector(const WZMVertex& ver)
 {
@@ -42,44 +58,68 @@ WZMVertex normalizeVector(const WZMVertex& ver)
 	return ver / sqrt(sq);
 }
 
-struct compareWZMPoint_less_wEps: public std::binary_function<WZMPoint&, WZMPoint&, bool>
+/*
+ * The separate layout arrays of a mesh being built, taken with edit() once
+ * up front, CowArray::push_back would check for sharing on every element.
+ * Only valid until something else touches the mesh arrays.
+ */
+struct MeshBuildArrays
 {
-	const WZMVertex::less_wEps vertLess;
-	const WZMUV::less_wEps uvLess;
-	const WZMVertex::equal_wEps vertEq;
-	const WZMUV::equal_wEps uvEq;
+	MeshBuildArrays(std::vector<WZMVertex>& vertices, std::vector<WZMUV>& uvs, std::vector<WZMVertex>& normals,
+			std::vector<WZMVertex4>& tangents, std::vector<IndexedTri>& indices):
+		vertices(vertices), uvs(uvs), normals(normals), tangents(tangents), indices(indices) {}
 
-public:
-	compareWZMPoint_less_wEps(float vertEps = 0.0001, float uvEps = 0.0001):
-		vertLess(vertEps), uvLess(uvEps), vertEq(vertEps), uvEq(uvEps) {}
+	void addPoint(const WZMPoint& point)
+	{
+		vertices.push_back(std::tr1::get<0>(point));
+		uvs.push_back(std::tr1::get<1>(point));
+		normals.push_back(std::tr1::get<2>(point));
+		tangents.push_back(WZMVertex4());
+	}
 
-	bool operator() (const WZMPoint& lhs, const WZMPoint& rhs) const
+	void addIndices(const IndexedTri& trio)
 	{
-		if (vertLess(std::tr1::get<0>(lhs), std::tr1::get<0>(rhs)))
+		// out of index
+		if (trio.a() >= vertices.size() && trio.b() >= vertices.size() && trio.c() >= vertices.size())
 		{
-			return true;
+			return;
 		}
-		else
-		{
-			if (vertEq(std::tr1::get<0>(lhs), std::tr1::get<0>(rhs)))
-			{
-				if (uvLess(std::tr1::get<1>(lhs), std::tr1::get<1>(rhs)))
-				{
-					return true;
-				}
-				else
-				{
-					if (uvEq(std::tr1::get<1>(lhs), std::tr1::get<1>(rhs)))
-					{
-						return vertLess(std::tr1::get<2>(lhs), std::tr1::get<2>(rhs));
-					}
-				}
-			}
-		}
-		return false;
+		indices.push_back(trio);
 	}
+
+	std::vector<WZMVertex>& vertices;
+	std::vector<WZMUV>& uvs;
+	std::vector<WZMVertex>& normals;
+	std::vector<WZMVertex4>& tangents;
+	std::vector<IndexedTri>& indices;
 };
 
+WZMPointWeldTraits::WZMPointWeldTraits(GLfloat vertEps, GLfloat uvEps):
+	m_vertEps(std::max(vertEps, std::numeric_limits<GLfloat>::epsilon())),
+	m_vertEq(vertEps), m_uvEq(uvEps)
+{
+}
+
+GLfloat WZMPointWeldTraits::keyEps() const
+{
+	return m_vertEps;
+}
+
+void WZMPointWeldTraits::key(const WZMPoint& point, GLfloat out[3]) const
+{
+	const WZMVertex& pos = std::tr1::get<0>(point);
+	out[0] = pos.x();
+	out[1] = pos.y();
+	out[2] = pos.z();
+}
+
+bool WZMPointWeldTraits::equal(const WZMPoint& lhs, const WZMPoint& rhs) const
+{
+	return m_vertEq(std::tr1::get<0>(lhs), std::tr1::get<0>(rhs)) &&
+		m_uvEq(std::tr1::get<1>(lhs), std::tr1::get<1>(rhs)) &&
+		m_vertEq(std::tr1::get<2>(lhs), std::tr1::get<2>(rhs));
+}
+
 WZMConnector::WZMConnector(GLfloat x, GLfloat y, GLfloat z):
 	m_pos(x, y, z)
 {
@@ -104,12 +144,8 @@ Mesh::Mesh(const Pie3Level& p3)
 {
 	std::vector<Pie3Polygon>::const_iterator itL;
 
-	typedef std::set<WZMPoint, compareWZMPoint_less_wEps> t_tupleSet;
-	t_tupleSet tupleSet;
-	std::pair<t_tupleSet::iterator, bool> inResult;
-
-	std::vector<unsigned> mapping;
-	std::vector<unsigned>::iterator itMap;
+	WZMPointWelder welder;
+	std::pair<unsigned, bool> inResult;
 
 	IndexedTri iTri;
 	WZMVertex tmpNrm;
@@ -122,8 +158,18 @@ Mesh::Mesh(const Pie3Level& p3)
 	 *	 will cause unavoidable duplication)
 	 *	so that our transformed vertex cache isn't
 	 *	completely useless.
+	 *
+	 *	Every corner within eps of an earlier one is welded,
+	 *	see SpatialHash.hpp for how that differs from the old
+	 *	std::set dedup.
 	 */
 
+	welder.reserve(p3.m_points.size());
+	reservePoints(p3.m_points.size());
+	reserveIndices(p3.m_polygons.size());
+	MeshBuildArrays arrays(m_vertexArray.edit(), m_textureArray.edit(), m_normalArray.edit(),
+			       m_tangentArray.edit(), m_indexArray.edit());
+
 	// For each pie3 polygon
 	for (itL = p3.m_polygons.begin(); itL != p3.m_polygons.end(); ++itL)
 	{
@@ -143,22 +189,16 @@ Mesh::Mesh(const Pie3Level& p3)
 		// For all 3 vertices of the triangle
 		for (int i = 0; i < 3; ++i)
 		{
-			inResult = tupleSet.insert(WZMPoint(p3.m_points[itL->getIndex(i)], itL->getUV(i, 0), tmpNrm));
+			inResult = welder.insert(WZMPoint(p3.m_points[itL->getIndex(i)], itL->getUV(i, 0), tmpNrm));
 
-			if (!inResult.second)
+			// welder and mesh grow in lockstep, so welder indices are ours
+			iTri.operator[](i) = inResult.first;
+			if (inResult.second)
 			{
-				iTri.operator[](i) = mapping[std::distance(tupleSet.begin(), inResult.first)];
-			}
-			else
-			{
-				itMap = mapping.begin();
-				std::advance(itMap, std::distance(tupleSet.begin(), inResult.first));
-				mapping.insert(itMap, vertices());
-				iTri.operator[](i) = vertices();
-				addPoint(*inResult.first);
+				arrays.addPoint(welder[inResult.first]);
 			}
 		}
-		addIndices(iTri);
+		arrays.addIndices(iTri);
 	}
 
 	std::list<Pie3Connector>::const_iterator itC;
@@ -171,7 +211,7 @@ Mesh::Mesh(const Pie3Level& p3)
                                   itC->pos.operator[](2)));
 	}
 
-	finishImport();
+	recalculateTangents();
 	recalculateBoundData();
 }
 
@@ -188,9 +228,12 @@ Mesh::operator Pie3Level() const
 {
 	Pie3Level p3;
 
-	std::vector<Pie3Vertex>::iterator itPV;
+	SpatialHash<Pie3Vertex, Pie3VertexHashTraits> points;
+	std::pair<unsigned, bool> inResult;
 
 	std::vector<IndexedTri>::const_iterator itTri;
+	const VertexStream<const WZMVertex> pos = positions();
+	const VertexStream<const WZMUV> uv = uvs();
 
 	unsigned i;
 
@@ -199,6 +242,10 @@ Mesh::operator Pie3Level() const
 	 * so we remove those when converting
 	 */
 
+	points.reserve(vertices());
+	p3.m_points.reserve(vertices());
+	p3.m_polygons.reserve(indices());
+
 	for (itTri = m_indexArray.begin(); itTri != m_indexArray.end(); ++itTri)
 	{
 		Pie3Polygon p3Poly;
@@ -208,25 +255,18 @@ Mesh::operator Pie3Level() const
 
 		for (i = 0; i < 3; ++i)
 		{
-			typedef Pie3Vertex::equal_wEps equals;
-			mybinder1st<equals> compare(m_vertexArray[(*itTri)[i]]);
-
-			itPV = std::find_if(p3.m_points.begin(), p3.m_points.end(), compare);
+			// first equal point wins, same as a linear search would give
+			inResult = points.insert(pos[(*itTri)[i]]);
 
-			if (itPV == p3.m_points.end())
+			p3Poly.m_indices[i] = inResult.first;
+			if (inResult.second)
 			{
-				// add it now
-				p3Poly.m_indices[i] = p3.m_points.size();
-				p3.m_points.push_back(m_vertexArray[(*itTri)[i]]);
-			}
-			else
-			{
-				p3Poly.m_indices[i] = std::distance(p3.m_points.begin(), itPV);
+				p3.m_points.push_back(points[inResult.first]);
 			}
 
 			// TODO: deal with UV animation
-			p3UV.u() = m_textureArray[(*itTri)[i]].u();
-			p3UV.v() = m_textureArray[(*itTri)[i]].v();
+			p3UV.u() = uv[(*itTri)[i]].u();
+			p3UV.v() = uv[(*itTri)[i]].v();
 			p3Poly.m_texCoords[i] = p3UV;
 		}
 		p3.m_polygons.push_back(p3Poly);
@@ -249,13 +289,24 @@ Mesh::operator Pie3Level() const
 
 bool Mesh::read(std::istream& in)
 {
-	std::string str;
+	TextLexer lex;
+	bool ok;
+
+	lex.load(in);
+	ok = read(lex);
+	lex.sync(in);
+	return ok;
+}
+
+bool Mesh::read(TextLexer& in)
+{
+	TextToken str;
 	unsigned i,vertices,indices;
 
 	clear();
 
 	in >> str >> m_name;
-	if (in.fail() || str.compare(WZM_MESH_SIGNATURE) != 0)
+	if (in.fail() || !str.equals(WZM_MESH_SIGNATURE))
 	{
 		std::cerr << "Mesh::read - Expected " << WZM_MESH_SIGNATURE << " directive found " << str;
 		return false;
@@ -268,14 +319,14 @@ bool Mesh::read(std::istream& in)
 	}
 
 	in >> str >> m_teamColours;
-	if (in.fail() || str.compare(WZM_MESH_DIRECTIVE_TEAMCOLOURS) != 0)
+	if (in.fail() || !str.equals(WZM_MESH_DIRECTIVE_TEAMCOLOURS))
 	{
 		std::cerr << "Mesh::read - Expected " << WZM_MESH_DIRECTIVE_TEAMCOLOURS << " directive found " << str;
 		return false;
 	}
 
 	in >> str;
-	if (in.fail() || str.compare(WZM_MESH_DIRECTIVE_MINMAXTSCEN) != 0)
+	if (in.fail() || !str.equals(WZM_MESH_DIRECTIVE_MINMAXTSCEN))
 	{
 		std::cerr << "Mesh::read - Expected " << WZM_MESH_DIRECTIVE_MINMAXTSCEN << " directive found " << str;
 		return false;
@@ -293,27 +344,30 @@ bool Mesh::read(std::istream& in)
 	}
 
 	in >> str >> vertices;
-	if (in.fail() || str.compare(WZM_MESH_DIRECTIVE_VERTICES) != 0)
+	if (in.fail() || !str.equals(WZM_MESH_DIRECTIVE_VERTICES))
 	{
 		std::cerr << "Mesh::read - Expected " << WZM_MESH_DIRECTIVE_VERTICES << " directive found " << str;
 		return false;
 	}
 
 	in >> str >> indices;
-	if (in.fail() || str.compare(WZM_MESH_DIRECTIVE_INDICES) != 0)
+	if (in.fail() || !str.equals(WZM_MESH_DIRECTIVE_INDICES))
 	{
 		std::cerr << "Mesh::read - Expected " << WZM_MESH_DIRECTIVE_INDICES << " directive found " << str;
 		return false;
 	}
 
 	in >> str;
-	if (in.fail() || str.compare(WZM_MESH_DIRECTIVE_VERTEXARRAY) != 0)
+	if (in.fail() || !str.equals(WZM_MESH_DIRECTIVE_VERTEXARRAY))
 	{
 		std::cerr << "Mesh::read - Expected " << WZM_MESH_DIRECTIVE_VERTEXARRAY << " directive found " << str;
 		return false;
 	}
 
 	reservePoints(vertices);
+	reserveIndices(indices);
+	MeshBuildArrays arrays(m_vertexArray.edit(), m_textureArray.edit(), m_normalArray.edit(),
+			       m_tangentArray.edit(), m_indexArray.edit());
 
 	WZMVertex vert, normal;
 	WZMVertex4 tangent;
@@ -321,13 +375,18 @@ bool Mesh::read(std::istream& in)
 
 	for (; vertices > 0; --vertices)
 	{
+		if (!in.checkProgress())
+		{
+			return false;
+		}
+
 		in >> vert.x() >> vert.y() >> vert.z();
 		if (in.fail())
 		{
 			std::cerr << "Mesh::read - Error reading vertex";
 			return false;
 		}
-		m_vertexArray.push_back(vert);
+		arrays.vertices.push_back(vert);
 
 		in >> uv.u() >> uv.v();
 		if (in.fail())
@@ -340,7 +399,7 @@ bool Mesh::read(std::istream& in)
 			std::cerr << "Mesh::read - Error uv coords out of range";
 			return false;
 		}
-		m_textureArray.push_back(uv);
+		arrays.uvs.push_back(uv);
 
 		in >> normal.x() >> normal.y() >> normal.z();
 		if (in.fail())
@@ -348,7 +407,7 @@ bool Mesh::read(std::istream& in)
 			std::cerr << "Mesh::read - Error reading normal";
 			return false;
 		}
-		m_normalArray.push_back(normal);
+		arrays.normals.push_back(normal);
 
 		in >> tangent.x() >> tangent.y() >> tangent.z() >> tangent.w();
 		if (in.fail())
@@ -356,21 +415,25 @@ bool Mesh::read(std::istream& in)
 			std::cerr << "Mesh::read - Error reading t";
 			return false;
 		}
-		m_tangentArray.push_back(tangent);
+		arrays.tangents.push_back(tangent);
 	}
 
 	in >> str;
-	if (str.compare(WZM_MESH_DIRECTIVE_INDEXARRAY) != 0)
+	if (!str.equals(WZM_MESH_DIRECTIVE_INDEXARRAY))
 	{
 		std::cerr << "Mesh::read - Expected " << WZM_MESH_DIRECTIVE_INDEXARRAY << " directive found " << str;
 		return false;
 	}
 
-	reserveIndices(indices);
 	for(; indices > 0; --indices)
 	{
 		IndexedTri tri;
 
+		if (!in.checkProgress())
+		{
+			return false;
+		}
+
 		in >> tri.a() >> tri.b() >> tri.c();
 
 		if (in.fail())
@@ -378,11 +441,11 @@ bool Mesh::read(std::istream& in)
 			std::cerr << "Mesh::read - Error reading indices";
 			return false;
 		}
-		m_indexArray.push_back(tri);
+		arrays.indices.push_back(tri);
 	}
 
 	in >> str >> i;
-	if (in.fail() || str.compare(WZM_MESH_DIRECTIVE_CONNECTORS) != 0)
+	if (in.fail() || !str.equals(WZM_MESH_DIRECTIVE_CONNECTORS))
 	{
 		std::cerr << "Mesh::read - Expected " << WZM_MESH_DIRECTIVE_CONNECTORS << " directive found " << str;
 		return false;
@@ -395,13 +458,13 @@ bool Mesh::read(std::istream& in)
 		for(; i > 0; --i)
 		{
 			in >> con.x() >> con.y() >> con.z();
+			if (in.fail())
+			{
+				std::cerr << "Mesh::read - Error reading connectors";
+				return false;
+			}
+			m_connectors.push_back(con);
 		}
-		if (in.fail())
-		{
-			std::cerr << "Mesh::read - Error reading connectors";
-			return false;
-		}
-		m_connectors.push_back(con);
 	}
 
 	recalculateBoundData();
@@ -425,15 +488,19 @@ void Mesh::write(std::ostream &out) const
 	out << WZM_MESH_DIRECTIVE_VERTICES << " " << vertices() << '\n';
 	out << WZM_MESH_DIRECTIVE_INDICES << " " << indices() << '\n';
 
+	const VertexStream<const WZMVertex> pos = positions(), nrm = normals();
+	const VertexStream<const WZMUV> uv = uvs();
+	const VertexStream<const WZMVertex4> tan = tangents();
+
 	out << WZM_MESH_DIRECTIVE_VERTEXARRAY << '\n';
 	for (unsigned int i = 0; i < vertices(); ++i)
 	{
 		out << '\t';
-		out << m_vertexArray[i].x() << ' ' << m_vertexArray[i].y() << ' ' << m_vertexArray[i].z() << ' ';
-		out << m_textureArray[i].u() << ' ' << m_textureArray[i].v() << ' ';
-		out << m_normalArray[i].x() << ' ' << m_normalArray[i].y() << ' ' << m_normalArray[i].z() << ' ';
-		out << m_tangentArray[i].x() << ' ' << m_tangentArray[i].y() << ' ' << m_tangentArray[i].z() << ' '
-		    << m_tangentArray[i].w() << '\n';
+		out << pos[i].x() << ' ' << pos[i].y() << ' ' << pos[i].z() << ' ';
+		out << uv[i].u() << ' ' << uv[i].v() << ' ';
+		out << nrm[i].x() << ' ' << nrm[i].y() << ' ' << nrm[i].z() << ' ';
+		out << tan[i].x() << ' ' << tan[i].y() << ' ' << tan[i].z() << ' '
+		    << tan[i].w() << '\n';
 	}
 
 	out << WZM_MESH_DIRECTIVE_INDEXARRAY << '\n';
@@ -456,19 +523,197 @@ void Mesh::write(std::ostream &out) const
 	}
 }
 
+template <typename I>
+static bool copyBinaryIndices(const char* blob, unsigned triangles, unsigned vertices,
+			      std::vector<IndexedTri>& out)
+{
+	const I* idx = reinterpret_cast<const I*>(blob);
+
+	out.resize(triangles);
+	for (unsigned i = 0; i < triangles; ++i, idx += 3)
+	{
+		if (idx[0] >= vertices || idx[1] >= vertices || idx[2] >= vertices)
+		{
+			return false;
+		}
+		out[i].a() = idx[0];
+		out[i].b() = idx[1];
+		out[i].c() = idx[2];
+	}
+	return true;
+}
+
+bool Mesh::readBinary(const WZMBinaryView& view, unsigned index)
+{
+	CPP0X_FEATURED(static_assert(sizeof(WZMVertex) == sizeof(GLfloat)*3, "WZMVertex has become fat."));
+	CPP0X_FEATURED(static_assert(sizeof(WZMUV) == sizeof(GLfloat)*2, "WZMUV has become fat."));
+	CPP0X_FEATURED(static_assert(sizeof(WZMVertex4) == sizeof(GLfloat)*4, "WZMVertex4 has become fat."));
+
+	const WZMBMeshEntry& entry = view.meshEntry(index);
+	const unsigned vertices = entry.vertexCount;
+	bool indicesOk;
+
+	clear();
+
+	m_name = view.string(entry.name);
+	if (!isValidWzName(m_name))
+	{
+		std::cerr << "Mesh::readBinary - Invalid mesh name: " << m_name;
+		m_name = std::string();
+	}
+
+	m_teamColours = (entry.flags & WZMB_MESH_TEAMCOLOURS) != 0;
+
+	// blobs have the layout of the arrays, so these are plain block copies
+	const WZMVertex* vertBlob = reinterpret_cast<const WZMVertex*>(view.blob(entry.vertexOffset));
+	const WZMUV* uvBlob = reinterpret_cast<const WZMUV*>(view.blob(entry.uvOffset));
+	const WZMVertex* normalBlob = reinterpret_cast<const WZMVertex*>(view.blob(entry.normalOffset));
+	const WZMVertex4* tangentBlob = reinterpret_cast<const WZMVertex4*>(view.blob(entry.tangentOffset));
+
+	m_vertexArray.assign(vertBlob, vertBlob + vertices);
+	m_textureArray.assign(uvBlob, uvBlob + vertices);
+	m_normalArray.assign(normalBlob, normalBlob + vertices);
+	m_tangentArray.assign(tangentBlob, tangentBlob + vertices);
+
+	if (entry.indexSize == sizeof(uint32_t))
+	{
+		indicesOk = copyBinaryIndices<uint32_t>(view.blob(entry.indexOffset), entry.triangleCount,
+							vertices, m_indexArray.edit());
+	}
+	else
+	{
+		indicesOk = copyBinaryIndices<uint16_t>(view.blob(entry.indexOffset), entry.triangleCount,
+							vertices, m_indexArray.edit());
+	}
+	if (!indicesOk)
+	{
+		std::cerr << "Mesh::readBinary - Index out of range";
+		clear();
+		return false;
+	}
+
+	const WZMVertex* conBlob = reinterpret_cast<const WZMVertex*>(view.blob(entry.connectorOffset));
+	for (unsigned i = 0; i < entry.connectorCount; ++i)
+	{
+		m_connectors.push_back(conBlob[i]);
+	}
+
+	// stored bound data is what recalculateBoundData() produced on save
+	m_mesh_aabb_min = WZMVertex(entry.aabbMin[0], entry.aabbMin[1], entry.aabbMin[2]);
+	m_mesh_aabb_max = WZMVertex(entry.aabbMax[0], entry.aabbMax[1], entry.aabbMax[2]);
+	m_mesh_tspcenter = WZMVertex(entry.tspcenter[0], entry.tspcenter[1], entry.tspcenter[2]);
+	m_mesh_weightcenter = WZMVertex(entry.weightcenter[0], entry.weightcenter[1], entry.weightcenter[2]);
+
+	return true;
+}
+
+// Blobs are packed arrays, so interleaved attributes get gathered on the way out
+template <typename T>
+static void writeBinaryStream(std::ostream& out, uint64_t& pos, const VertexStream<const T>& stream)
+{
+	const size_t chunk = 4096;
+	std::vector<T> buffer;
+	size_t i, j;
+
+	if (stream.contiguous())
+	{
+		wzmbWrite(out, pos, stream.data(), stream.size() * sizeof(T));
+		return;
+	}
+
+	buffer.reserve(std::min(chunk, stream.size()));
+	for (i = 0; i < stream.size(); i += chunk)
+	{
+		buffer.clear();
+		for (j = i; j < stream.size() && j < i + chunk; ++j)
+		{
+			buffer.push_back(stream[j]);
+		}
+		wzmbWrite(out, pos, &buffer[0], buffer.size() * sizeof(T));
+	}
+}
+
+uint64_t Mesh::binaryLayout(WZMBMeshEntry& entry, uint64_t offset) const
+{
+	entry.flags = m_teamColours ? WZMB_MESH_TEAMCOLOURS : 0;
+	entry.vertexCount = vertices();
+	entry.triangleCount = indices();
+	entry.connectorCount = m_connectors.size();
+	entry.indexSize = indexSize();
+
+	offset = wzmbAlign(offset);
+	entry.vertexOffset = static_cast<uint32_t>(offset);
+	offset = wzmbAlign(offset + static_cast<uint64_t>(entry.vertexCount) * sizeof(WZMVertex));
+	entry.uvOffset = static_cast<uint32_t>(offset);
+	offset = wzmbAlign(offset + static_cast<uint64_t>(entry.vertexCount) * sizeof(WZMUV));
+	entry.normalOffset = static_cast<uint32_t>(offset);
+	offset = wzmbAlign(offset + static_cast<uint64_t>(entry.vertexCount) * sizeof(WZMVertex));
+	entry.tangentOffset = static_cast<uint32_t>(offset);
+	offset = wzmbAlign(offset + static_cast<uint64_t>(entry.vertexCount) * sizeof(WZMVertex4));
+	entry.indexOffset = static_cast<uint32_t>(offset);
+	offset = wzmbAlign(offset + static_cast<uint64_t>(entry.triangleCount) * 3 * entry.indexSize);
+	entry.connectorOffset = static_cast<uint32_t>(offset);
+	offset += static_cast<uint64_t>(entry.connectorCount) * sizeof(WZMVertex);
+
+	for (int i = 0; i < 3; ++i)
+	{
+		entry.aabbMin[i] = m_mesh_aabb_min[i];
+		entry.aabbMax[i] = m_mesh_aabb_max[i];
+		entry.tspcenter[i] = m_mesh_tspcenter[i];
+		entry.weightcenter[i] = m_mesh_weightcenter[i];
+	}
+
+	return offset;
+}
+
+void Mesh::writeBinary(std::ostream& out, const WZMBMeshEntry& entry, uint64_t& pos) const
+{
+	std::list<WZMConnector>::const_iterator conIt;
+
+	if (vertices())
+	{
+		wzmbPad(out, pos, entry.vertexOffset);
+		writeBinaryStream(out, pos, positions());
+		wzmbPad(out, pos, entry.uvOffset);
+		writeBinaryStream(out, pos, uvs());
+		wzmbPad(out, pos, entry.normalOffset);
+		writeBinaryStream(out, pos, normals());
+		wzmbPad(out, pos, entry.tangentOffset);
+		writeBinaryStream(out, pos, tangents());
+	}
+
+	if (indices())
+	{
+		wzmbPad(out, pos, entry.indexOffset);
+		if (entry.indexSize == sizeof(uint32_t))
+		{
+			CPP0X_FEATURED(static_assert(sizeof(IndexedTri) == sizeof(uint32_t)*3, "IndexedTri has become fat."));
+			wzmbWrite(out, pos, &m_indexArray[0], indices() * sizeof(IndexedTri));
+		}
+		else
+		{
+			std::vector<GLushort> narrow;
+			copyIndices16(narrow);
+			wzmbWrite(out, pos, &narrow[0], narrow.size() * sizeof(GLushort));
+		}
+	}
+
+	wzmbPad(out, pos, entry.connectorOffset);
+	for (conIt = m_connectors.begin(); conIt != m_connectors.end(); ++conIt)
+	{
+		wzmbWrite(out, pos, &conIt->getPos(), sizeof(WZMVertex));
+	}
+}
+
 bool Mesh::importFromOBJ(const std::vector<OBJTri>&	faces,
 			 const std::vector<OBJVertex>&  verts,
 			 const std::vector<OBJUV>&	uvArray,
 			 const std::vector<OBJVertex>&  normals)
 {
-	typedef std::set<WZMPoint, compareWZMPoint_less_wEps> t_tupleSet;
-	t_tupleSet tupleSet;
+	WZMPointWelder welder;
 
 	std::vector<OBJTri>::const_iterator itFaces;
-	std::pair<t_tupleSet::iterator, bool> inResult;
-
-	std::vector<unsigned> mapping;
-	std::vector<unsigned>::iterator itMap;
+	std::pair<unsigned, bool> inResult;
 
 	unsigned i;
 
@@ -478,8 +723,11 @@ bool Mesh::importFromOBJ(const std::vector<OBJTri>&	faces,
 
 	clear();
 
+	welder.reserve(verts.size());
 	reservePoints(verts.size());
 	reserveIndices(faces.size());
+	MeshBuildArrays arrays(m_vertexArray.edit(), m_textureArray.edit(), m_normalArray.edit(),
+			       m_tangentArray.edit(), m_indexArray.edit());
 
 	for (itFaces = faces.begin(); itFaces != faces.end(); ++itFaces)
 	{
@@ -491,113 +739,88 @@ bool Mesh::importFromOBJ(const std::vector<OBJTri>&	faces,
 			tmpUv = itFaces->uvs.operator [](i) < 1 ? WZMUV() : uvArray[itFaces->uvs.operator [](i) - 1];
 #pragma message "precalculate missing OBJ normal"
 			tmpNrm = itFaces->nrm.operator [](i) < 1 ? WZMVertex() : normals[itFaces->nrm.operator [](i) - 1]; //FIXME
-			inResult = tupleSet.insert(WZMPoint(verts[itFaces->tri[i]-1], tmpUv, tmpNrm));
+			inResult = welder.insert(WZMPoint(verts[itFaces->tri[i]-1], tmpUv, tmpNrm));
 
-			if (!inResult.second)
+			tmpTri[i] = inResult.first;
+			if (inResult.second)
 			{
-				tmpTri[i] = mapping[std::distance(tupleSet.begin(), inResult.first)];
-			}
-			else
-			{
-				itMap = mapping.begin();
-				std::advance(itMap, std::distance(tupleSet.begin(), inResult.first));
-				mapping.insert(itMap, vertices());
-				tmpTri[i] = vertices();
-				addPoint(*inResult.first);
+				arrays.addPoint(welder[inResult.first]);
 			}
 		}
-		addIndices(tmpTri);
+		arrays.addIndices(tmpTri);
 	}
 
-	finishImport();
+	recalculateTangents();
 	recalculateBoundData();
 
 	return true;
 }
 
-std::stringstream* Mesh::exportToOBJ(const Mesh_exportToOBJ_InOutParams& params) const
+// 1 based index of val in table, appended if it isn't there yet
+template <typename T, typename Traits>
+static inline unsigned objTableIndex(const T& val, SpatialHash<T, Traits>& table)
 {
-	const bool invertV = true;
-	std::stringstream* out = new std::stringstream;
+	return table.insert(val).first + 1;
+}
 
-	std::pair<std::set<OBJVertex, OBJVertex::less_wEps>::iterator, bool> vertInResult;
-	std::pair<std::set<OBJUV, OBJUV::less_wEps>::iterator, bool> uvInResult;
-	std::pair<std::set<OBJVertex, OBJVertex::less_wEps>::iterator, bool> normInResult;
+void Mesh::buildOBJTables(const Mesh_exportToOBJ_InOutParams& params, std::vector<OBJCorner>& corners) const
+{
+	const bool invertV = true;
 
 	std::vector<IndexedTri>::const_iterator itF;
-	std::vector<unsigned>::iterator itMap;
-	unsigned i;
+	unsigned i, vert;
 
+	OBJCorner unset;
 	OBJUV uv;
 
-	*out << "o " << m_name << "\n";
+	const VertexStream<const WZMVertex> pos = positions(), nrm = normals();
+	const VertexStream<const WZMUV> uvStream = uvs();
 
+	unset[0] = unset[1] = unset[2] = 0;
+	corners.assign(vertices(), unset);
+
+	// faces order the tables, so walk them rather than the vertices
 	for (itF = m_indexArray.begin(); itF != m_indexArray.end(); ++itF)
 	{
-		*out << "f";
-
 		for (i = 0; i < 3; ++i)
 		{
-			*out << ' ';
-
-			vertInResult = params.vertSet->insert(m_vertexArray[itF->operator [](i)]);
-
-			if (!vertInResult.second)
-			{
-				*out << (*params.vertMapping)[std::distance(params.vertSet->begin(), vertInResult.first)] + 1;
-			}
-			else
+			vert = itF->operator [](i);
+			if (corners[vert][0] != 0)
 			{
-				itMap = params.vertMapping->begin();
-				std::advance(itMap, std::distance(params.vertSet->begin(), vertInResult.first));
-				params.vertMapping->insert(itMap, params.vertices->size());
-				params.vertices->push_back(m_vertexArray[itF->operator [](i)]);
-				*out << params.vertices->size();
+				continue;
 			}
 
-			*out << '/';
-
-			uv = m_textureArray[itF->operator [](i)];
+			uv = uvStream[vert];
 			if (invertV)
 			{
 				uv.v() = 1 - uv.v();
 			}
-			uvInResult = params.uvSet->insert(uv);
 
-			if (!uvInResult.second)
-			{
-				*out << (*params.uvMapping)[std::distance(params.uvSet->begin(), uvInResult.first)] + 1;
-			}
-			else
-			{
-				itMap = params.uvMapping->begin();
-				std::advance(itMap, std::distance(params.uvSet->begin(), uvInResult.first));
-				params.uvMapping->insert(itMap, params.uvs->size());
-				params.uvs->push_back(uv);
-				*out << params.uvs->size();
-			}
+			corners[vert][0] = objTableIndex(pos[vert], *params.vertices);
+			corners[vert][1] = objTableIndex(uv, *params.uvs);
+			corners[vert][2] = objTableIndex(nrm[vert], *params.normals);
+		}
+	}
+}
 
-			*out << '/';
+void Mesh::exportToOBJ(std::ostream& out, const std::vector<OBJCorner>& corners) const
+{
+	std::vector<IndexedTri>::const_iterator itF;
+	unsigned i;
 
-			normInResult = params.normSet->insert(m_normalArray[itF->operator [](i)]);
+	out << "o " << m_name << "\n";
 
-			if (!normInResult.second)
-			{
-				*out << (*params.normMapping)[std::distance(params.normSet->begin(), normInResult.first)] + 1;
-			}
-			else
-			{
-				itMap = params.normMapping->begin();
-				std::advance(itMap, std::distance(params.normSet->begin(), normInResult.first));
-				params.normMapping->insert(itMap, params.normals->size());
-				params.normals->push_back(m_normalArray[itF->operator [](i)]);
-				*out << params.normals->size();
-			}
+	for (itF = m_indexArray.begin(); itF != m_indexArray.end(); ++itF)
+	{
+		out << "f";
+
+		for (i = 0; i < 3; ++i)
+		{
+			const OBJCorner& corner = corners[itF->operator [](i)];
+			out << ' ' << corner[0] << '/' << corner[1] << '/' << corner[2];
 		}
-		*out << '\n';
+		out << '\n';
 	}
-
-	return out;
 }
 
 std::string Mesh::getName() const
@@ -625,7 +848,7 @@ void Mesh::setTeamColours(bool tc)
 
 const WZMConnector& Mesh::getConnector(int index) const
 {
-	std::list<WZMConnector>::const_iterator pos;
+	std::list<WZMConnector>::const_iterator pos = m_connectors.begin();
 	std::advance(pos, index);
 	return *pos;
 }
@@ -647,26 +870,179 @@ void Mesh::rmConnector (int index)
 	m_connectors.erase(pos);
 }
 
-inline int Mesh::connectors() const
+int Mesh::connectors() const
 {
 	return m_connectors.size();
 }
 
-inline unsigned Mesh::vertices() const
+unsigned Mesh::vertices() const
 {
+	if (m_layout == WZM_MESH_LAYOUT_INTERLEAVED)
+	{
+		return m_interleavedArray.size();
+	}
 	return m_vertexArray.size();
 }
 
-inline unsigned Mesh::frames() const
+unsigned Mesh::frames() const
 {
 	return m_frameArray.size();
 }
 
-inline unsigned Mesh::indices() const
+wzm_mesh_layout_t Mesh::layout() const
+{
+	return m_layout;
+}
+
+void Mesh::setLayout(wzm_mesh_layout_t layout)
+{
+	CPP0X_FEATURED(static_assert(sizeof(WZMInterleavedVertex) == sizeof(GLfloat)*12, "WZMInterleavedVertex has become fat."));
+
+	unsigned int i;
+
+	if (layout == m_layout)
+	{
+		return;
+	}
+
+	if (layout == WZM_MESH_LAYOUT_INTERLEAVED)
+	{
+		const std::vector<WZMVertex>& verts = m_vertexArray.get();
+		const std::vector<WZMVertex>& normals = m_normalArray.get();
+		const std::vector<WZMUV>& uvs = m_textureArray.get();
+		const std::vector<WZMVertex4>& tangents = m_tangentArray.get();
+
+		m_interleavedArray.release();
+		WZMInterleavedArray::vector_type& out = m_interleavedArray.edit();
+
+		out.resize(verts.size());
+		for (i = 0; i < out.size(); ++i)
+		{
+			out[i].pos = verts[i];
+			out[i].normal = normals[i];
+			out[i].uv = uvs[i];
+			out[i].tangent = tangents[i];
+		}
+
+		// the memory goes once no copy of the mesh shares it anymore
+		m_vertexArray.release();
+		m_textureArray.release();
+		m_normalArray.release();
+		m_tangentArray.release();
+	}
+	else
+	{
+		const WZMInterleavedArray::vector_type& in = m_interleavedArray.get();
+
+		m_vertexArray.release();
+		m_textureArray.release();
+		m_normalArray.release();
+		m_tangentArray.release();
+
+		std::vector<WZMVertex>& verts = m_vertexArray.edit();
+		std::vector<WZMVertex>& normals = m_normalArray.edit();
+		std::vector<WZMUV>& uvs = m_textureArray.edit();
+		std::vector<WZMVertex4>& tangents = m_tangentArray.edit();
+
+		verts.resize(in.size());
+		normals.resize(in.size());
+		uvs.resize(in.size());
+		tangents.resize(in.size());
+		for (i = 0; i < in.size(); ++i)
+		{
+			verts[i] = in[i].pos;
+			normals[i] = in[i].normal;
+			uvs[i] = in[i].uv;
+			tangents[i] = in[i].tangent;
+		}
+
+		m_interleavedArray.release();
+	}
+
+	m_layout = layout;
+}
+
+/* The stream accessors pick the storage of the current layout, an
+ * interleaved stream starts at the attribute's member of the first record.
+ */
+#define WZM_MESH_STREAM(T, array, member) \
+	if (m_layout == WZM_MESH_LAYOUT_INTERLEAVED) \
+	{ \
+		return VertexStream<T>(m_interleavedArray.empty() ? 0 : &m_interleavedArray[0].member, \
+				       m_interleavedArray.size(), sizeof(WZMInterleavedVertex)); \
+	} \
+	return VertexStream<T>(array.empty() ? 0 : &array[0], array.size())
+
+VertexStream<WZMVertex> Mesh::positions()
+{
+	WZM_MESH_STREAM(WZMVertex, m_vertexArray, pos);
+}
+
+VertexStream<const WZMVertex> Mesh::positions() const
+{
+	WZM_MESH_STREAM(const WZMVertex, m_vertexArray, pos);
+}
+
+VertexStream<WZMVertex> Mesh::normals()
+{
+	WZM_MESH_STREAM(WZMVertex, m_normalArray, normal);
+}
+
+VertexStream<const WZMVertex> Mesh::normals() const
+{
+	WZM_MESH_STREAM(const WZMVertex, m_normalArray, normal);
+}
+
+VertexStream<WZMUV> Mesh::uvs()
+{
+	WZM_MESH_STREAM(WZMUV, m_textureArray, uv);
+}
+
+VertexStream<const WZMUV> Mesh::uvs() const
+{
+	WZM_MESH_STREAM(const WZMUV, m_textureArray, uv);
+}
+
+VertexStream<WZMVertex4> Mesh::tangents()
+{
+	WZM_MESH_STREAM(WZMVertex4, m_tangentArray, tangent);
+}
+
+VertexStream<const WZMVertex4> Mesh::tangents() const
+{
+	WZM_MESH_STREAM(const WZMVertex4, m_tangentArray, tangent);
+}
+
+#undef WZM_MESH_STREAM
+
+unsigned Mesh::indices() const
 {
 	return m_indexArray.size();
 }
 
+unsigned Mesh::indexSize() const
+{
+	if (vertices() > static_cast<unsigned>(std::numeric_limits<GLushort>::max()) + 1)
+	{
+		return sizeof(GLuint);
+	}
+	return sizeof(GLushort);
+}
+
+void Mesh::copyIndices16(std::vector<GLushort>& out) const
+{
+	std::vector<IndexedTri>::const_iterator it;
+
+	out.clear();
+	out.reserve(indices() * 3);
+	for (it = m_indexArray.begin(); it != m_indexArray.end(); ++it)
+	{
+		out.push_back(static_cast<GLushort>(it->a()));
+		out.push_back(static_cast<GLushort>(it->b()));
+		out.push_back(static_cast<GLushort>(it->c()));
+	}
+}
+
 bool Mesh::isValid() const
 {
 	// TODO: check m_frameArray, m_connectors
@@ -699,6 +1075,7 @@ void Mesh::defaultConstructor()
 {
 	m_name.clear();
 	m_teamColours = false;
+	m_layout = WZM_MESH_LAYOUT_SEPARATE;
 }
 
 void Mesh::clear()
@@ -710,11 +1087,12 @@ void Mesh::clear()
 	m_textureArray.clear();
 	m_normalArray.clear();
 	m_tangentArray.clear();
-	m_bitangentArray.clear();
+	m_interleavedArray.clear();
 	m_indexArray.clear();
 
 	m_connectors.clear();
 	m_teamColours = false;
+	m_layout = WZM_MESH_LAYOUT_SEPARATE;
 }
 
 inline void Mesh::reservePoints(const unsigned size)
@@ -723,7 +1101,6 @@ inline void Mesh::reservePoints(const unsigned size)
 	m_textureArray.reserve(size);
 	m_normalArray.reserve(size);
 	m_tangentArray.reserve(size);
-	m_bitangentArray.reserve(size);
 }
 
 inline void Mesh::reserveIndices(const unsigned size)
@@ -731,90 +1108,205 @@ inline void Mesh::reserveIndices(const unsigned size)
 	m_indexArray.reserve(size);
 }
 
-void Mesh::addPoint(const WZMPoint &point)
+/*
+ * Tangent generation runs in two passes over independent chunks: tangents
+ * per triangle, then every vertex gathers the triangles using it. Gathering
+ * goes through the triangles in index order, so each sum is added up in the
+ * same order whatever the number of threads.
+ */
+
+struct TriangleTangents
 {
-	m_vertexArray.push_back(std::tr1::get<0>(point));
-	m_textureArray.push_back(std::tr1::get<1>(point));
-	m_normalArray.push_back(std::tr1::get<2>(point));
-	m_tangentArray.resize(m_tangentArray.size() + 1);
-	m_bitangentArray.resize(m_bitangentArray.size() + 1);
-}
+	WZMVertex tangent, bitangent;
+};
 
-void Mesh::addIndices(const IndexedTri &trio)
+static const size_t tangentChunk = 16 * 1024;
+
+class TriangleTangentTask : public Task
 {
-	// out of index
-	if (trio.a() >= vertices() && trio.b() >= vertices() && trio.c() >= vertices())
+public:
+	TriangleTangentTask(const std::vector<IndexedTri>& tris, const VertexStream<const WZMVertex>& pos,
+			    const VertexStream<const WZMUV>& uv, std::vector<TriangleTangents>& out, size_t first, size_t last):
+		m_tris(&tris), m_pos(pos), m_uv(uv), m_out(&out), m_first(first), m_last(last) {}
+
+	void run()
 	{
-		return;
+		size_t i;
+
+		for (i = m_first; i < m_last; ++i)
+		{
+			const IndexedTri& trio = (*m_tris)[i];
+
+			// Edges of the triangle : postion delta
+			WZMVertex deltaPos1 = m_pos[trio.b()] - m_pos[trio.a()];
+			WZMVertex deltaPos2 = m_pos[trio.c()] - m_pos[trio.a()];
+
+			// UV delta
+			WZMUV deltaUV1 = m_uv[trio.b()] - m_uv[trio.a()];
+			WZMUV deltaUV2 = m_uv[trio.c()] - m_uv[trio.a()];
+
+			// check for nan
+			float r = (deltaUV1.u() * deltaUV2.v() - deltaUV1.v() * deltaUV2.u());
+			if (r)
+				r = 1.f / r;
+
+			(*m_out)[i].tangent = (deltaPos1 * deltaUV2.v() - deltaPos2 * deltaUV1.v()) * r;
+			(*m_out)[i].bitangent = (deltaPos2 * deltaUV1.u() - deltaPos1 * deltaUV2.u()) * r;
+		}
 	}
 
-	m_indexArray.push_back(trio);
+private:
+	const std::vector<IndexedTri>* m_tris;
+	VertexStream<const WZMVertex> m_pos;
+	VertexStream<const WZMUV> m_uv;
+	std::vector<TriangleTangents>* m_out;
+	size_t m_first, m_last;
+};
 
-	// TB-calculation part
+class VertexTangentTask : public Task
+{
+public:
+	VertexTangentTask(const std::vector<unsigned>& offsets, const std::vector<unsigned>& adjacency,
+			  const std::vector<TriangleTangents>& triTangents, const VertexStream<const WZMVertex>& normals,
+			  const VertexStream<WZMVertex4>& out, size_t first, size_t last):
+		m_offsets(&offsets), m_adjacency(&adjacency), m_triTangents(&triTangents),
+		m_normals(normals), m_out(out), m_first(first), m_last(last) {}
 
-	// Shortcuts for vertices
-	WZMVertex &v0 = m_vertexArray[trio.a()];
-	WZMVertex &v1 = m_vertexArray[trio.b()];
-	WZMVertex &v2 = m_vertexArray[trio.c()];
+	void run()
+	{
+		size_t i;
+		unsigned j;
 
-	// Shortcuts for UVs
-	WZMUV &uv0 = m_textureArray[trio.a()];
-	WZMUV &uv1 = m_textureArray[trio.b()];
-	WZMUV &uv2 = m_textureArray[trio.c()];
+		for (i = m_first; i < m_last; ++i)
+		{
+			WZMVertex tangent, bitangent;
 
-	// Edges of the triangle : postion delta
-	WZMVertex deltaPos1 = v1 - v0;
-	WZMVertex deltaPos2 = v2 - v0;
+			for (j = (*m_offsets)[i]; j < (*m_offsets)[i + 1]; ++j)
+			{
+				tangent += (*m_triTangents)[(*m_adjacency)[j]].tangent;
+				bitangent += (*m_triTangents)[(*m_adjacency)[j]].bitangent;
+			}
 
-	// UV delta
-	WZMUV deltaUV1 = uv1 - uv0;
-	WZMUV deltaUV2 = uv2 - uv0;
+			WZMVertex n = m_normals[i];
 
-	// check for nan
-	float r = (deltaUV1.u() * deltaUV2.v() - deltaUV1.v() * deltaUV2.u());
-	if (r)
-		r = 1.f / r;
+			// Gram-Schmidt orthogonalize
+			m_out[i] = WZMVertex4(normalizeVector(tangent - n * n.dotProduct(tangent)));
 
-	WZMVertex4 tangent = WZMVertex((deltaPos1 * deltaUV2.v() - deltaPos2 * deltaUV1.v()) * r);
-	WZMVertex bitangent = (deltaPos2 * deltaUV1.u() - deltaPos1 * deltaUV2.u()) * r;
+			// Calculate handedness
+			if (n.crossProduct(m_out[i].xyz()).dotProduct(bitangent) < 0.0f)
+			{
+				m_out[i].w() = -1.0f;
+			}
+			else
+			{
+				m_out[i].w() = 1.0f;
+			}
+		}
+	}
+
+private:
+	const std::vector<unsigned>* m_offsets;
+	const std::vector<unsigned>* m_adjacency;
+	const std::vector<TriangleTangents>* m_triTangents;
+	VertexStream<const WZMVertex> m_normals;
+	VertexStream<WZMVertex4> m_out;
+	size_t m_first, m_last;
+};
 
-	m_tangentArray[trio.a()] += tangent;
-	m_tangentArray[trio.b()] += tangent;
-	m_tangentArray[trio.c()] += tangent;
+template <typename T>
+static void runTangentTasks(std::vector<T>& tasks)
+{
+	std::vector<Task*> pending;
+	size_t i;
 
-	m_bitangentArray[trio.a()] += bitangent;
-	m_bitangentArray[trio.b()] += bitangent;
-	m_bitangentArray[trio.c()] += bitangent;
+	for (i = 0; i < tasks.size(); ++i)
+	{
+		pending.push_back(&tasks[i]);
+	}
+	TaskPool().run(pending);
 }
 
-void Mesh::finishImport()
+void Mesh::recalculateTangents()
 {
-	for (unsigned int i = 0; i < vertices(); ++i)
+	const Mesh& self = *this; // read only views mustn't detach shared arrays
+	const std::vector<IndexedTri>& allTris = m_indexArray.get();
+	const unsigned count = vertices();
+
+	std::vector<IndexedTri> checkedTris;
+	std::vector<TriangleTangents> triTangents;
+	std::vector<unsigned> offsets(count + 1, 0), adjacency;
+	std::vector<TriangleTangentTask> triTasks;
+	std::vector<VertexTangentTask> vertexTasks;
+	size_t i;
+	int j;
+
+	// triangles pointing outside the vertex arrays don't contribute
+	const std::vector<IndexedTri>* tris = &allTris;
+	for (i = 0; i < allTris.size(); ++i)
 	{
-		WZMVertex n = m_normalArray[i];
-
-		// Gram-Schmidt orthogonalize
-		m_tangentArray[i] = WZMVertex4(normalizeVector(m_tangentArray[i].xyz() - n * n.dotProduct(m_tangentArray[i].xyz())));
+		if (allTris[i].a() >= count || allTris[i].b() >= count || allTris[i].c() >= count)
+		{
+			break;
+		}
+	}
+	if (i < allTris.size())
+	{
+		for (i = 0; i < allTris.size(); ++i)
+		{
+			if (allTris[i].a() < count && allTris[i].b() < count && allTris[i].c() < count)
+			{
+				checkedTris.push_back(allTris[i]);
+			}
+		}
+		tris = &checkedTris;
+	}
 
-		// Calculate handedness
-		if (n.crossProduct(m_tangentArray[i].xyz()).dotProduct(m_bitangentArray[i]) < 0.0f)
+	// vertex -> triangle adjacency, triangles in index order
+	for (i = 0; i < tris->size(); ++i)
+	{
+		for (j = 0; j < 3; ++j)
 		{
-			m_tangentArray[i].w() = -1.0f;
+			++offsets[(*tris)[i][j] + 1];
 		}
-		else
+	}
+	for (i = 0; i < count; ++i)
+	{
+		offsets[i + 1] += offsets[i];
+	}
+
+	std::vector<unsigned> fill(offsets.begin(), offsets.end() - 1);
+	adjacency.resize(tris->size() * 3);
+	for (i = 0; i < tris->size(); ++i)
+	{
+		for (j = 0; j < 3; ++j)
 		{
-			m_tangentArray[i].w() = 1.0f;
+			adjacency[fill[(*tris)[i][j]]++] = i;
 		}
 	}
+
+	triTangents.resize(tris->size());
+	for (i = 0; i < tris->size(); i += tangentChunk)
+	{
+		triTasks.push_back(TriangleTangentTask(*tris, self.positions(), self.uvs(), triTangents,
+						       i, std::min(i + tangentChunk, tris->size())));
+	}
+	runTangentTasks(triTasks);
+
+	const VertexStream<WZMVertex4> out = tangents();
+	for (i = 0; i < count; i += tangentChunk)
+	{
+		vertexTasks.push_back(VertexTangentTask(offsets, adjacency, triTangents, self.normals(), out,
+							i, std::min<size_t>(i + tangentChunk, count)));
+	}
+	runTangentTasks(vertexTasks);
 }
 
 void Mesh::scale(GLfloat x, GLfloat y, GLfloat z)
 {
-	std::vector<WZMVertex>::iterator vertIt;
-	for (vertIt = m_vertexArray.begin(); vertIt < m_vertexArray.end(); ++vertIt)
-	{
-		vertIt->scale(x, y, z);
-	}
+	const VertexStream<WZMVertex> pos = positions();
+	const GLfloat mul[4] = {x, y, z, 1.f};
+
+	vertexKernels().scale(reinterpret_cast<GLfloat*>(pos.data()), pos.size(), pos.stride(), 0x7, mul);
 
 	std::list<WZMConnector>::iterator itC;
 	for (itC = m_connectors.begin(); itC != m_connectors.end(); ++itC)
@@ -823,39 +1315,107 @@ void Mesh::scale(GLfloat x, GLfloat y, GLfloat z)
 	}
 
 	m_mesh_weightcenter.scale(x, y, z);
+	m_mesh_tspcenter.scale(x, y, z);
 	m_mesh_aabb_min.scale(x, y, z);
 	m_mesh_aabb_max.scale(x, y, z);
 
+	// negative factors swap the box's sides
+	for (unsigned i = 0; i < 3; ++i)
+	{
+		if (m_mesh_aabb_min[i] > m_mesh_aabb_max[i])
+		{
+			std::swap(m_mesh_aabb_min[i], m_mesh_aabb_max[i]);
+		}
+	}
 }
 
-void Mesh::mirrorUsingLocalCenter(int axis)
+void Mesh::translate(GLfloat x, GLfloat y, GLfloat z)
 {
-	mirrorFromPoint(getCenterPoint(), axis);
+	const VertexStream<WZMVertex> pos = positions();
+	const GLfloat mul[4] = {1.f, 1.f, 1.f, 1.f}, add[4] = {x, y, z, 0.f};
+
+	vertexKernels().scaleAdd(reinterpret_cast<GLfloat*>(pos.data()), pos.size(), pos.stride(), 0x7, mul, add);
+
+	std::list<WZMConnector>::iterator itC;
+	for (itC = m_connectors.begin(); itC != m_connectors.end(); ++itC)
+	{
+		itC->m_pos += WZMVertex(x, y, z);
+	}
+
+	recalculateBoundData();
 }
 
-void Mesh::mirrorFromPoint(const WZMVertex& point, int axis)
+void Mesh::transform(const Matrix4& matrix)
 {
-	for (unsigned int i = 0; i < vertices(); ++i)
+	const VertexKernels& kernels = vertexKernels();
+	const VertexStream<WZMVertex> pos = positions(), nrm = normals();
+	const VertexStream<WZMVertex4> tan = tangents();
+	Matrix4 normalMatrix;
+	unsigned int i;
+
+	if (matrix.isIdentity())
 	{
-		switch (axis)
+		return;
+	}
+
+	kernels.transform(reinterpret_cast<GLfloat*>(pos.data()), pos.size(), pos.stride(), 0x7, matrix.data(), 1.f);
+
+	// a singular transform flattens the mesh, there's no sensible normal for that
+	if (matrix.normalMatrix(normalMatrix))
+	{
+		kernels.transform(reinterpret_cast<GLfloat*>(nrm.data()), nrm.size(), nrm.stride(), 0x7, normalMatrix.data(), 0.f);
+		kernels.transform(reinterpret_cast<GLfloat*>(tan.data()), tan.size(), tan.stride(), 0x7, matrix.data(), 0.f);
+
+		// scaling leaves them off unit length
+		for (i = 0; i < nrm.size(); ++i)
 		{
-		case 0:
-			m_vertexArray[i].x() = -m_vertexArray[i].x() + 2 * point.x();
-			m_normalArray[i].x() = -m_normalArray[i].x();
-			m_tangentArray[i].x() = -m_tangentArray[i].x();
-			break;
-		case 1:
-			m_vertexArray[i].y() = -m_vertexArray[i].y() + 2 * point.y();
-			m_normalArray[i].y() = -m_normalArray[i].y();
-			m_tangentArray[i].y() = -m_tangentArray[i].y();
-			break;
-		default:
-			m_vertexArray[i].z() = -m_vertexArray[i].z() + 2 * point.z();
-			m_normalArray[i].z() = -m_normalArray[i].z();
-			m_tangentArray[i].z() = -m_tangentArray[i].z();
+			nrm[i] = normalizeVector(nrm[i]);
+		}
+		for (i = 0; i < tan.size(); ++i)
+		{
+			const GLfloat w = tan[i].w();
+			tan[i] = WZMVertex4(normalizeVector(tan[i].xyz()));
+			tan[i].w() = w;
+		}
+
+		if (matrix.determinant3() < 0)
+		{
+			const GLfloat flip[4] = {1.f, 1.f, 1.f, -1.f};
+			kernels.scale(reinterpret_cast<GLfloat*>(tan.data()), tan.size(), tan.stride(), 0x8, flip);
+			reverseWinding();
 		}
 	}
 
+	std::list<WZMConnector>::iterator itC;
+	for (itC = m_connectors.begin(); itC != m_connectors.end(); ++itC)
+	{
+		itC->m_pos = matrix.transformPoint(itC->m_pos);
+	}
+
+	recalculateBoundData();
+}
+
+void Mesh::mirrorUsingLocalCenter(int axis)
+{
+	mirrorFromPoint(getCenterPoint(), axis);
+}
+
+void Mesh::mirrorFromPoint(const WZMVertex& point, int axis)
+{
+	const VertexKernels& kernels = vertexKernels();
+	const VertexStream<WZMVertex> pos = positions(), nrm = normals();
+	const VertexStream<WZMVertex4> tan = tangents();
+	const unsigned component = axis == 0 || axis == 1 ? axis : 2;
+	GLfloat mul[4] = {1.f, 1.f, 1.f, 1.f}, add[4] = {0.f, 0.f, 0.f, 0.f};
+
+	// one pass per stream, only the mirrored component is touched
+	mul[component] = -1.f;
+	add[component] = 2 * point[component];
+
+	kernels.scaleAdd(reinterpret_cast<GLfloat*>(pos.data()), pos.size(), pos.stride(), 1u << component, mul, add);
+	kernels.scale(reinterpret_cast<GLfloat*>(nrm.data()), nrm.size(), nrm.stride(), 1u << component, mul);
+	kernels.scale(reinterpret_cast<GLfloat*>(tan.data()), tan.size(), tan.stride(), 1u << component, mul);
+
 	std::list<WZMConnector>::iterator itC;
 	for (itC = m_connectors.begin(); itC != m_connectors.end(); ++itC)
 	{
@@ -893,32 +1453,28 @@ void Mesh::recalculateBoundData()
 		return;
 	}
 
-	min = max = vxmax = vymax = vzmax = vxmin = vymin = vzmin = m_vertexArray.at(0);
+	const Mesh& self = *this; // read only, mustn't detach shared arrays
+	const VertexStream<const WZMVertex> pos = self.positions();
+	VertexBounds bounds;
+	unsigned int i;
 
-	std::vector<WZMVertex>::const_iterator vertIt;
-	for (vertIt = m_vertexArray.begin(); vertIt < m_vertexArray.end(); ++vertIt)
-	{
-		weight.x() += vertIt->x();
-		weight.y() += vertIt->y();
-		weight.z() += vertIt->z();
+	// the kernel keeps the first extreme vertex of each axis, like the old loop did
+	vertexKernels().bounds(reinterpret_cast<const GLfloat*>(pos.data()), pos.size(), pos.stride(), bounds);
 
-		if (min.x() > vertIt->x()) min.x() = vertIt->x();
-		if (min.y() > vertIt->y()) min.y() = vertIt->y();
-		if (min.z() > vertIt->z()) min.z() = vertIt->z();
-
-		if (max.x() < vertIt->x()) max.x() = vertIt->x();
-		if (max.y() < vertIt->y()) max.y() = vertIt->y();
-		if (max.z() < vertIt->z()) max.z() = vertIt->z();
-
-		if (vxmin.x() > vertIt->x()) vxmin = *vertIt;
-		if (vymin.y() > vertIt->y()) vymin = *vertIt;
-		if (vzmin.z() > vertIt->z()) vzmin = *vertIt;
-
-		if (vxmax.x() < vertIt->x()) vxmax = *vertIt;
-		if (vymax.y() < vertIt->y()) vymax = *vertIt;
-		if (vzmax.z() < vertIt->z()) vzmax = *vertIt;
+	for (i = 0; i < 3; ++i)
+	{
+		weight[i] = bounds.sum[i];
+		min[i] = bounds.min[i];
+		max[i] = bounds.max[i];
 	}
 
+	vxmin = pos[bounds.minIndex[0]];
+	vymin = pos[bounds.minIndex[1]];
+	vzmin = pos[bounds.minIndex[2]];
+	vxmax = pos[bounds.maxIndex[0]];
+	vymax = pos[bounds.maxIndex[1]];
+	vzmax = pos[bounds.maxIndex[2]];
+
 	weight.x() /= vertices();
 	weight.y() /= vertices();
 	weight.z() /= vertices();
@@ -984,11 +1540,13 @@ void Mesh::recalculateBoundData()
 	rad = sqrt((double)rad_sq);
 
 	// second pass (find tight sphere)
-	for (vertIt = m_vertexArray.begin(); vertIt < m_vertexArray.end(); ++vertIt)
+	for (i = 0; i < pos.size(); ++i)
 	{
-		dx = vertIt->x() - cen.x();
-		dy = vertIt->y() - cen.y();
-		dz = vertIt->z() - cen.z();
+		const WZMVertex& vert = pos[i];
+
+		dx = vert.x() - cen.x();
+		dy = vert.y() - cen.y();
+		dz = vert.z() - cen.z();
 		old_to_p_sq = dx*dx + dy*dy + dz*dz;
 
 		// do r**2 first
@@ -1002,9 +1560,9 @@ void Mesh::recalculateBoundData()
 			rad_sq = rad*rad;
 			old_to_new = old_to_p - rad;
 			// centre of new sphere
-			cen.x() = (rad * cen.x() + old_to_new * vertIt->x()) / old_to_p;
-			cen.y() = (rad * cen.y() + old_to_new * vertIt->y()) / old_to_p;
-			cen.z() = (rad * cen.z() + old_to_new * vertIt->z()) / old_to_p;
+			cen.x() = (rad * cen.x() + old_to_new * vert.x()) / old_to_p;
+			cen.y() = (rad * cen.y() + old_to_new * vert.y()) / old_to_p;
+			cen.z() = (rad * cen.z() + old_to_new * vert.z()) / old_to_p;
 		}
 	}
 
@@ -1013,6 +1571,210 @@ void Mesh::recalculateBoundData()
 // END: tight bounding sphere
 }
 
+static bool indicesInRange(const std::vector<IndexedTri>& tris, unsigned vertices)
+{
+	std::vector<IndexedTri>::const_iterator it;
+
+	for (it = tris.begin(); it != tris.end(); ++it)
+	{
+		if (it->a() >= vertices || it->b() >= vertices || it->c() >= vertices)
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+template <typename T, typename A>
+static void remapVertices(CowArray<T, A>& array, const std::vector<GLuint>& remap)
+{
+	const std::vector<T, A>& src = array.get();
+	std::vector<T, A> dst(src.size());
+	size_t i;
+
+	for (i = 0; i < src.size(); ++i)
+	{
+		dst[remap[i]] = src[i];
+	}
+	array.swap(dst);
+}
+
+bool Mesh::optimizeForsyth()
+{
+	if (!indicesInRange(m_indexArray.get(), vertices()))
+	{
+		std::cerr << "Mesh::optimizeForsyth - Index out of range in mesh " << m_name;
+		return false;
+	}
+
+	optimizeTriangleOrder(m_indexArray.edit(), vertices());
+	optimizeVertexOrder();
+	return true;
+}
+
+bool Mesh::optimizeOverdraw(float threshold)
+{
+	const VertexStream<const WZMVertex> pos = static_cast<const Mesh&>(*this).positions();
+
+	if (!indicesInRange(m_indexArray.get(), vertices()))
+	{
+		std::cerr << "Mesh::optimizeOverdraw - Index out of range in mesh " << m_name;
+		return false;
+	}
+
+	::optimizeOverdraw(m_indexArray.edit(), reinterpret_cast<const GLfloat*>(pos.data()), pos.stride(),
+			   vertices(), threshold);
+	optimizeVertexOrder();
+	return true;
+}
+
+void Mesh::optimizeVertexOrder()
+{
+	std::vector<GLuint> remap;
+
+	::optimizeVertexOrder(m_indexArray.edit(), vertices(), remap);
+
+	if (m_layout == WZM_MESH_LAYOUT_INTERLEAVED)
+	{
+		remapVertices(m_interleavedArray, remap);
+	}
+	else
+	{
+		remapVertices(m_vertexArray, remap);
+		remapVertices(m_textureArray, remap);
+		remapVertices(m_normalArray, remap);
+		remapVertices(m_tangentArray, remap);
+	}
+}
+
+VertexCacheStats Mesh::vertexCacheStats() const
+{
+	if (!indicesInRange(m_indexArray.get(), vertices()))
+	{
+		return VertexCacheStats();
+	}
+	return ::vertexCacheStats(m_indexArray.get(), vertices());
+}
+
+OverdrawStats Mesh::overdrawStats(unsigned directions, unsigned resolution) const
+{
+	const VertexStream<const WZMVertex> pos = positions();
+
+	if (!indicesInRange(m_indexArray.get(), vertices()))
+	{
+		return OverdrawStats();
+	}
+	return measureOverdraw(m_indexArray.get(), reinterpret_cast<const GLfloat*>(pos.data()), pos.stride(),
+			       vertices(), directions, resolution);
+}
+
+bool Mesh::simplify(unsigned targetTriangles, float maxError)
+{
+	const VertexStream<const WZMVertex> pos = static_cast<const Mesh&>(*this).positions();
+	const VertexStream<const WZMVertex> nrm = static_cast<const Mesh&>(*this).normals();
+	std::vector<bool> locked(vertices(), false);
+	std::list<WZMConnector>::const_iterator itC;
+	std::vector<IndexedTri>::const_iterator itT;
+	unsigned used = 0, i;
+
+	if (!indicesInRange(m_indexArray.get(), vertices()))
+	{
+		std::cerr << "Mesh::simplify - Index out of range in mesh " << m_name;
+		return false;
+	}
+	if (indices() <= targetTriangles)
+	{
+		return true;
+	}
+
+	// whatever is attached to a connector shouldn't start floating
+	for (itC = m_connectors.begin(); itC != m_connectors.end() && vertices(); ++itC)
+	{
+		GLfloat best = std::numeric_limits<GLfloat>::max();
+		unsigned nearest = 0;
+
+		for (i = 0; i < vertices(); ++i)
+		{
+			const WZMVertex d(pos[i].x() - itC->getPos().x(), pos[i].y() - itC->getPos().y(),
+					  pos[i].z() - itC->getPos().z());
+			const GLfloat dist = d.dotProduct(d);
+
+			if (dist < best)
+			{
+				best = dist;
+				nearest = i;
+			}
+		}
+		locked[nearest] = true;
+	}
+
+	simplifyTriangles(m_indexArray.edit(), reinterpret_cast<const GLfloat*>(pos.data()),
+			  nrm.size() == pos.size() && nrm.stride() == pos.stride() ? reinterpret_cast<const GLfloat*>(nrm.data()) : NULL,
+			  pos.stride(), vertices(), locked, targetTriangles, maxError);
+	optimizeVertexOrder();
+
+	// vertices are numbered by first use now, so the unused ones are the tail
+	for (itT = m_indexArray.get().begin(); itT != m_indexArray.get().end(); ++itT)
+	{
+		used = std::max(used, std::max(itT->a(), std::max(itT->b(), itT->c())) + 1);
+	}
+
+	if (m_layout == WZM_MESH_LAYOUT_INTERLEAVED)
+	{
+		m_interleavedArray.edit().resize(used);
+	}
+	else
+	{
+		m_vertexArray.edit().resize(used);
+		m_textureArray.edit().resize(std::min<size_t>(used, m_textureArray.size()));
+		m_normalArray.edit().resize(std::min<size_t>(used, m_normalArray.size()));
+		m_tangentArray.edit().resize(std::min<size_t>(used, m_tangentArray.size()));
+	}
+
+	recalculateBoundData();
+	return true;
+}
+
+bool Mesh::buildMeshlets(MeshletSet& out, bool keepOrder) const
+{
+	const VertexStream<const WZMVertex> pos = positions();
+
+	if (!indicesInRange(m_indexArray.get(), vertices()))
+	{
+		std::cerr << "Mesh::buildMeshlets - Index out of range in mesh " << m_name;
+		return false;
+	}
+
+	if (keepOrder)
+	{
+		buildMeshletRuns(m_indexArray.get(), reinterpret_cast<const GLfloat*>(pos.data()), pos.stride(),
+				 vertices(), out);
+	}
+	else
+	{
+		::buildMeshlets(m_indexArray.get(), reinterpret_cast<const GLfloat*>(pos.data()), pos.stride(),
+				vertices(), out);
+	}
+	return true;
+}
+
+MeshletStats Mesh::meshletStats() const
+{
+	MeshletSet set;
+
+	if (!buildMeshlets(set))
+	{
+		return MeshletStats();
+	}
+	return ::meshletStats(set);
+}
+
+void Mesh::getBounds(WZMVertex& min, WZMVertex& max) const
+{
+	min = m_mesh_aabb_min;
+	max = m_mesh_aabb_max;
+}
+
 WZMVertex Mesh::getCenterPoint() const
 {
 	WZMVertex center;
@@ -26,10 +26,16 @@
 #include <list>
 #include <tr1/tuple>
 
-#include <QtOpenGL/qgl.h>
+#include <stdint.h>
+
+#include "GLTypes.hpp"
 
 #include "VectorTypes.hpp"
 #include "Polygon.hpp"
+#include "SpatialHash.hpp"
+#include "VertexStream.hpp"
+#include "AlignedAllocator.hpp"
+#include "CowArray.hpp"
 
 #include "OBJ.hpp"
 
@@ -48,6 +54,41 @@ typedef Vertex4<GLfloat> WZMVertex4;
 typedef UV<GLclampf> WZMUV;
 typedef std::tr1::tuple<WZMVertex, WZMUV, WZMVertex> WZMPoint;
 
+enum wzm_mesh_layout_t {WZM_MESH_LAYOUT_SEPARATE = 0, WZM_MESH_LAYOUT_INTERLEAVED};
+
+/**
+  * One vertex of the interleaved layout, 48 bytes with every attribute
+  * 4 byte aligned so the array can be handed to GL as is.
+  */
+struct WZMInterleavedVertex
+{
+	WZMVertex pos;
+	WZMVertex normal;
+	WZMUV uv;
+	WZMVertex4 tangent;
+};
+
+typedef CowArray<WZMInterleavedVertex, AlignedAllocator<WZMInterleavedVertex, 16> > WZMInterleavedArray;
+
+/**
+  * SpatialHash traits for welding WZMPoints: positions are hashed,
+  * positions, uvs and normals have to be equal within their eps.
+  */
+struct WZMPointWeldTraits
+{
+	WZMPointWeldTraits(GLfloat vertEps = 0.0001, GLfloat uvEps = 0.0001);
+
+	GLfloat keyEps() const;
+	void key(const WZMPoint& point, GLfloat out[3]) const;
+	bool equal(const WZMPoint& lhs, const WZMPoint& rhs) const;
+private:
+	GLfloat m_vertEps;
+	WZMVertex::equal_wEps m_vertEq;
+	WZMUV::equal_wEps m_uvEq;
+};
+
+typedef SpatialHash<WZMPoint, WZMPointWeldTraits> WZMPointWelder;
+
 class Mesh;
 
 class WZMConnector
@@ -72,8 +113,16 @@ struct Frame
 };
 
 class Pie3Level;
+class Matrix4;
+struct VertexCacheStats;
+struct OverdrawStats;
+struct MeshletSet;
+struct MeshletStats;
 class Lib3dsMesh;
 struct Mesh_exportToOBJ_InOutParams;
+class WZMBinaryView;
+class TextLexer;
+struct WZMBMeshEntry;
 
 class Mesh
 {
@@ -87,13 +136,22 @@ public:
 	virtual operator Pie3Level() const;
 
 	bool read(std::istream& in);
+	bool read(TextLexer& in);
 	void write(std::ostream& out) const;
 
+	bool readBinary(const WZMBinaryView& view, unsigned index);
+	/// Fills entry (except the name) for blobs starting at offset, returns the end offset
+	uint64_t binaryLayout(WZMBMeshEntry& entry, uint64_t offset) const;
+	void writeBinary(std::ostream& out, const WZMBMeshEntry& entry, uint64_t& pos) const;
+
 	bool importFromOBJ(const std::vector<OBJTri>&	faces,
 			   const std::vector<OBJVertex>& verts,
 			   const std::vector<OBJUV>&	uvArray,
 			   const std::vector<OBJVertex>& normals);
-	std::stringstream* exportToOBJ(const Mesh_exportToOBJ_InOutParams& params) const;
+	/// OBJ export pass 1: adds the attributes used by faces to the shared tables, corners maps each vertex to them
+	void buildOBJTables(const Mesh_exportToOBJ_InOutParams& params, std::vector<OBJCorner>& corners) const;
+	/// OBJ export pass 2: streams the object's faces
+	void exportToOBJ(std::ostream& out, const std::vector<OBJCorner>& corners) const;
 
 	std::string getName() const;
 	void setName(const std::string& name);
@@ -108,43 +166,111 @@ public:
 
 	unsigned vertices() const;
 	unsigned indices() const;
+	/// Bytes per index needed to address every vertex: 2 if it fits, 4 otherwise
+	unsigned indexSize() const;
+	/// Index array narrowed to 16 bit, only meaningful if indexSize() is 2
+	void copyIndices16(std::vector<GLushort>& out) const;
 	unsigned frames() const;
 
+	wzm_mesh_layout_t layout() const;
+	/**
+	  * Moves the vertex attributes to the given layout, one pass over the
+	  * vertices. Geometry building (reads and imports) always goes back
+	  * to the separate layout, everything else works on either.
+	  */
+	void setLayout(wzm_mesh_layout_t layout);
+
 	bool isValid() const;
 
 	void scale(GLfloat x, GLfloat y, GLfloat z);
+	void translate(GLfloat x, GLfloat y, GLfloat z);
+	/**
+	  * Bakes an affine transform into positions, normals (inverse transpose),
+	  * tangents and connectors, one kernel pass per stream. Mirroring
+	  * transforms also flip the tangent handedness and the winding.
+	  */
+	void transform(const Matrix4& matrix);
 	void mirrorUsingLocalCenter(int axis); // x == 0, y == 1, z == 2
 	void mirrorFromPoint(const WZMVertex& point, int axis); // x == 0, y == 1, z == 2
 	void reverseWinding();
+	/**
+	  * Rebuilds tangents (and their handedness) from positions, uvs and
+	  * normals, for after geometry edits. Runs in parallel chunks, the
+	  * result doesn't depend on the number of threads.
+	  */
+	void recalculateTangents();
+
+	/**
+	  * Forsyth triangle reordering for the post-transform cache, then the
+	  * vertices renumbered in the order they're first used. Only the order
+	  * geometry is stored in changes.
+	  */
+	bool optimizeForsyth();
+	VertexCacheStats vertexCacheStats() const;
+	/**
+	  * Overdraw ordering (see optimizeOverdraw() in Overdraw.hpp) on top
+	  * of a vertex cache optimized index array, ACMR grows by threshold
+	  * at most. Vertices are renumbered by first use again afterwards.
+	  */
+	bool optimizeOverdraw(float threshold = 1.05f);
+	OverdrawStats overdrawStats(unsigned directions = 16, unsigned resolution = 256) const;
+
+	/**
+	  * Quadric error decimation down to targetTriangles (see simplifyTriangles()
+	  * in Simplify.hpp), the vertex nearest to each connector is kept in place.
+	  * Unused vertices are dropped and the rest renumbered by first use.
+	  * Flat shaded meshes (PIE imports) split every corner by its normals,
+	  * which locks it, so they barely simplify.
+	  */
+	bool simplify(unsigned targetTriangles, float maxError = 1.f);
+
+	/**
+	  * Splits the triangles into bounded clusters for culling and streaming, see buildMeshlets()
+	  * in Meshlet.hpp. With keepOrder they're runs of the index array instead, see buildMeshletRuns().
+	  */
+	bool buildMeshlets(MeshletSet& out, bool keepOrder = false) const;
+	MeshletStats meshletStats() const;
 
 	WZMVertex getCenterPoint() const;
+	/// Axis aligned box around the positions, as of the last bound data update
+	void getBounds(WZMVertex& min, WZMVertex& max) const;
 
 protected:
 	std::string m_name;
 	std::vector<Frame> m_frameArray;
 
-	std::vector<WZMVertex> m_vertexArray;
-	std::vector<WZMUV> m_textureArray;
-	std::vector<WZMVertex> m_normalArray;
-	std::vector<WZMVertex4> m_tangentArray;
-	std::vector<WZMVertex> m_bitangentArray; // WARNING: used only for non-WZM import, dont rely on it
-	std::vector<IndexedTri> m_indexArray;
+	// geometry is shared between copies until one of them changes it
+	CowArray<WZMVertex> m_vertexArray;
+	CowArray<WZMUV> m_textureArray;
+	CowArray<WZMVertex> m_normalArray;
+	CowArray<WZMVertex4> m_tangentArray;
+	WZMInterleavedArray m_interleavedArray; // replaces the 4 arrays above in the interleaved layout
+	CowArray<IndexedTri> m_indexArray;
 
 	std::list<WZMConnector> m_connectors;
 
 	bool m_teamColours;
+	wzm_mesh_layout_t m_layout;
 	WZMVertex m_mesh_weightcenter, m_mesh_aabb_min, m_mesh_aabb_max, m_mesh_tspcenter;
 
 	void clear();
 	void reservePoints(const unsigned size);
 	void reserveIndices(const unsigned size);
-	void addIndices(const IndexedTri& trio);
-	void addPoint(const WZMPoint& point);
-	void finishImport();
 
 	void recalculateBoundData();
+
+	// Attribute views valid in both layouts
+	VertexStream<WZMVertex> positions();
+	VertexStream<const WZMVertex> positions() const;
+	VertexStream<WZMVertex> normals();
+	VertexStream<const WZMVertex> normals() const;
+	VertexStream<WZMUV> uvs();
+	VertexStream<const WZMUV> uvs() const;
+	VertexStream<WZMVertex4> tangents();
+	VertexStream<const WZMVertex4> tangents() const;
 private:
 	void defaultConstructor();
+	void optimizeVertexOrder();
 };
 
 WZMVertex normalizeVector(const WZMVertex &ver);
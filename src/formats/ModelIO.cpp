@@ -0,0 +1,273 @@
+/*
+	Copyright 2010 Warzone 2100 Project
+
+	This file is part of WMIT.
+
+	WMIT is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	WMIT is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with WMIT.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include "ModelIO.hpp"
+
+#include <cctype>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+
+#include "WZM.hpp"
+#include "Pie.hpp"
+#include "TextLexer.hpp"
+#include "VertexCache.hpp"
+#include "Overdraw.hpp"
+
+static bool extensionIs(const std::string& ext, const char* wanted)
+{
+	std::string::size_type i;
+
+	for (i = 0; i < ext.size() && wanted[i] != '\0'; ++i)
+	{
+		if (std::tolower(static_cast<unsigned char>(ext[i])) != wanted[i])
+		{
+			return false;
+		}
+	}
+	return i == ext.size() && wanted[i] == '\0';
+}
+
+bool guessModelType(const std::string& fileName, wmit_filetype_t& type)
+{
+	const std::string ext = fileName.substr(fileName.find_last_of('.') + 1);
+
+	if (extensionIs(ext, "wzm"))
+	{
+		type = WMIT_FT_WZM;
+	}
+	else if (extensionIs(ext, "wzmb"))
+	{
+		type = WMIT_FT_WZMB;
+	}
+	else if (extensionIs(ext, "obj"))
+	{
+		type = WMIT_FT_OBJ;
+	}
+	else if (extensionIs(ext, "pie"))
+	{
+		type = WMIT_FT_PIE;
+	}
+	else
+	{
+		return false;
+	}
+
+	return true;
+}
+
+const char* modelTypeExtension(wmit_filetype_t type)
+{
+	switch (type)
+	{
+	case WMIT_FT_WZM:
+		return "wzm";
+	case WMIT_FT_WZMB:
+		return "wzmb";
+	case WMIT_FT_OBJ:
+		return "obj";
+	case WMIT_FT_PIE:
+	default:
+		return "pie";
+	}
+}
+
+bool loadModel(const std::string& fileName, WZM& model, LoadProgress* progress)
+{
+	wmit_filetype_t type;
+
+	if (!guessModelType(fileName, type))
+	{
+		return false;
+	}
+
+	bool read_success = false;
+	std::ifstream f;
+	TextLexer lex;
+
+	// binary models are mapped, not streamed
+	if (type == WMIT_FT_WZMB)
+	{
+		return model.readBinary(fileName, progress);
+	}
+
+	f.open(fileName.c_str(), std::ios::in | std::ios::binary);
+	const int pieversion = type == WMIT_FT_PIE ? pieVersion(f) : 0;
+
+	// the readers report through the lexer
+	lex.setProgress(progress);
+	lex.load(f);
+	f.close();
+
+	switch (type)
+	{
+	case WMIT_FT_WZM:
+		read_success = model.read(lex);
+		break;
+	case WMIT_FT_OBJ:
+		read_success = model.importFromOBJ(lex);
+		break;
+	case WMIT_FT_PIE:
+	default:
+		if (pieversion <= 2)
+		{
+			Pie2Model p2;
+			read_success = p2.read(lex);
+			if (read_success)
+				model = WZM(Pie3Model(p2));
+		}
+		else // 3 or higher
+		{
+			Pie3Model p3;
+			read_success = p3.read(lex);
+			if (read_success)
+				model = WZM(p3);
+		}
+
+		// levels only turn into meshes here
+		if (read_success && progress && !progress->meshesBuilt(model.meshes()))
+		{
+			model = WZM();
+			read_success = false;
+		}
+	}
+
+	return read_success;
+}
+
+bool saveModel(const std::string& fileName, const WZM& model, wmit_filetype_t type)
+{
+	std::ofstream out;
+	Pie3Model p3;
+	bool write_success = true;
+
+	// converted before the file is opened, a model PIE can't hold must not leave a broken file
+	if (type == WMIT_FT_PIE)
+	{
+		p3 = model;
+		if (!p3.fitsPointIndices())
+		{
+			std::cerr << "saveModel - A mesh has more than " << Pie3Level::maxPoints()
+				  << " points, too many for PIE, " << fileName << " not written" << std::endl;
+			return false;
+		}
+	}
+
+	if (type == WMIT_FT_WZMB)
+	{
+		out.open(fileName.c_str(), std::ios::out | std::ios::binary);
+	}
+	else
+	{
+		out.open(fileName.c_str());
+	}
+
+	switch (type)
+	{
+	case WMIT_FT_WZM:
+		model.write(out);
+		break;
+	case WMIT_FT_WZMB:
+		write_success = model.writeBinary(out);
+		break;
+	case WMIT_FT_OBJ:
+		model.exportToOBJ(out);
+		break;
+	case WMIT_FT_PIE:
+	default:
+		p3.write(out);
+	}
+
+	out.close();
+
+	return write_success && !out.fail();
+}
+
+bool optimizeModel(WZM& model, bool overdraw, std::ostream& log)
+{
+	const VertexCacheStats before = model.vertexCacheStats();
+	OverdrawStats overdrawBefore, overdrawAfter;
+	bool ok;
+
+	if (overdraw)
+	{
+		overdrawBefore = model.overdrawStats();
+	}
+
+	ok = model.optimizeForsyth();
+	if (ok && overdraw)
+	{
+		ok = model.optimizeOverdraw();
+		overdrawAfter = model.overdrawStats();
+	}
+
+	const VertexCacheStats after = model.vertexCacheStats();
+	const std::streamsize precision = log.precision();
+
+	log << std::fixed << std::setprecision(3)
+	    << "ACMR " << before.acmr() << " -> " << after.acmr()
+	    << ", ATVR " << before.atvr() << " -> " << after.atvr();
+	if (overdraw)
+	{
+		log << ", overdraw " << overdrawBefore.overdraw() << " -> " << overdrawAfter.overdraw();
+	}
+	log.unsetf(std::ios::floatfield);
+	log.precision(precision);
+	return ok;
+}
+
+bool parseLODRatios(const std::string& list, std::vector<float>& ratios)
+{
+	std::string::size_type start = 0, end;
+
+	ratios.clear();
+	do
+	{
+		end = list.find(',', start);
+
+		const std::string item = list.substr(start, end == std::string::npos ? end : end - start);
+		char* stop;
+		const double ratio = std::strtod(item.c_str(), &stop);
+
+		if (item.empty() || *stop != '\0' || !(ratio > 0. && ratio <= 1.))
+		{
+			std::cerr << "parseLODRatios - Invalid ratio " << item << std::endl;
+			return false;
+		}
+		ratios.push_back(static_cast<float>(ratio));
+		start = end + 1;
+	} while (end != std::string::npos);
+
+	return true;
+}
+
+std::string lodFileName(const std::string& fileName, unsigned level)
+{
+	std::string::size_type dot = fileName.find_last_of('.');
+	const std::string::size_type slash = fileName.find_last_of("/\\");
+	std::ostringstream ss;
+
+	if (dot == std::string::npos || (slash != std::string::npos && dot < slash))
+	{
+		dot = fileName.size();
+	}
+	ss << fileName.substr(0, dot) << "_lod" << level << fileName.substr(dot);
+	return ss.str();
+}
@@ -0,0 +1,55 @@
+/*
+	Copyright 2010 Warzone 2100 Project
+
+	This file is part of WMIT.
+
+	WMIT is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	WMIT is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with WMIT.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef MODELIO_HPP
+#define MODELIO_HPP
+
+#include <iosfwd>
+#include <string>
+#include <vector>
+
+#include "wmit.h"
+
+class WZM;
+class LoadProgress;
+
+/*
+ * Qt free model file loading and saving, used by the editor as well as the
+ * command line converters. Safe to call from several threads at once as long
+ * as every thread works on its own model.
+ */
+
+bool guessModelType(const std::string& fileName, wmit_filetype_t& type);
+const char* modelTypeExtension(wmit_filetype_t type);
+
+/// progress (optional) hears from the reader, cancelling it makes the load fail
+bool loadModel(const std::string& fileName, WZM& model, LoadProgress* progress = 0);
+bool saveModel(const std::string& fileName, const WZM& model, wmit_filetype_t type);
+
+/**
+  * Forsyth vertex cache optimization of every mesh, optionally followed by
+  * overdraw ordering. Writes ACMR, ATVR (and overdraw) before and after to log.
+  */
+bool optimizeModel(WZM& model, bool overdraw, std::ostream& log);
+
+/// Comma separated level of detail ratios like "0.5,0.25", each in (0, 1]
+bool parseLODRatios(const std::string& list, std::vector<float>& ratios);
+/// File level of detail level of fileName is saved to: name_lod1.ext for level 1
+std::string lodFileName(const std::string& fileName, unsigned level);
+
+#endif // MODELIO_HPP
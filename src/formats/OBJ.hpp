@@ -22,12 +22,13 @@
 
 #include <iostream>
 #include <vector>
-#include <set>
+#include <limits>
 
-#include <QtOpenGL/qgl.h>
+#include "GLTypes.hpp"
 
 #include "VectorTypes.hpp"
 #include "Polygon.hpp"
+#include "SpatialHash.hpp"
 
 typedef Vertex<GLfloat> OBJVertex;
 typedef UV<GLclampf> OBJUV;
@@ -36,9 +37,9 @@ struct OBJTri
 {
 	IndexedTri tri;
 
-	// signed short: -1 means not specified
-	Vector<short, 3> nrm;
-	Vector<short, 3> uvs;
+	// signed: -1 means not specified
+	Vector<int, 3> nrm;
+	Vector<int, 3> uvs;
 
 	bool operator == (const OBJTri& rhs)
 	{
@@ -77,22 +78,76 @@ inline void writeOBJNormal(const OBJVertex& norm, std::ostream& out)
 			<< norm.z() << '\n';
 }
 
-/* Ugh, those wretched template parameters have a way of fuglying things up
- * so I'm burrying them here so that hopefuly no-one sees them...
- * these are function parameters, currently assumed to be valid pointers,
- * these are treated like references.
+/// 1 based v/vt/vn indices of an exported vertex, 0 if not exported yet
+typedef Vector<unsigned, 3> OBJCorner;
+
+/**
+  * SpatialHash traits for the OBJ export tables, equality as in equal_wEps
+  */
+struct OBJVertexHashTraits
+{
+	GLfloat keyEps() const
+	{
+		return std::numeric_limits<GLfloat>::epsilon();
+	}
+
+	void key(const OBJVertex& vert, GLfloat out[3]) const
+	{
+		out[0] = vert.x();
+		out[1] = vert.y();
+		out[2] = vert.z();
+	}
+
+	bool equal(const OBJVertex& lhs, const OBJVertex& rhs) const
+	{
+		return m_vertEq(lhs, rhs);
+	}
+private:
+	OBJVertex::equal_wEps m_vertEq;
+};
+
+struct OBJUVHashTraits
+{
+	GLfloat keyEps() const
+	{
+		return std::numeric_limits<GLfloat>::epsilon();
+	}
+
+	void key(const OBJUV& uv, GLfloat out[3]) const
+	{
+		out[0] = uv.u();
+		out[1] = uv.v();
+		out[2] = 0.f;
+	}
+
+	bool equal(const OBJUV& lhs, const OBJUV& rhs) const
+	{
+		return m_uvEq(lhs, rhs);
+	}
+private:
+	OBJUV::equal_wEps m_uvEq;
+};
+
+/**
+  * Unique attributes in first use order, which is also the OBJ numbering.
+  *
+  * Exact duplicates get the numbers the old std::set<..., less_wEps> tables
+  * gave them. Values within eps of each other may not: less_wEps isn't a
+  * strict weak ordering, so the set matched whatever it met on its search
+  * path, or nothing, where the hash takes the first match in use order.
+  * See SpatialHash.hpp, and wmit-bench weld for the counts on jittered input.
+  */
+typedef SpatialHash<OBJVertex, OBJVertexHashTraits> OBJVertexTable;
+typedef SpatialHash<OBJUV, OBJUVHashTraits> OBJUVTable;
+
+/* Shared tables of a multi-mesh export, currently assumed to be valid
+ * pointers, these are treated like references.
  */
 struct Mesh_exportToOBJ_InOutParams
 {
-	std::vector<OBJVertex>* vertices;
-	std::set<OBJVertex, OBJVertex::less_wEps>* vertSet;
-	std::vector<unsigned>* vertMapping;
-	std::vector<OBJUV>* uvs;
-	std::set<OBJUV, OBJUV::less_wEps>* uvSet;
-	std::vector<unsigned>* uvMapping;
-	std::vector<OBJVertex>* normals;
-	std::set<OBJVertex, OBJVertex::less_wEps>* normSet;
-	std::vector<unsigned>* normMapping;
+	OBJVertexTable* vertices;
+	OBJUVTable* uvs;
+	OBJVertexTable* normals;
 };
 
 #endif // OBJ_HPP
@@ -22,9 +22,11 @@
 #include <iostream>
 #include <vector>
 #include <list>
-#include <QtOpenGL/qgl.h>
+#include <limits>
+#include "GLTypes.hpp"
 #include "VectorTypes.hpp"
 #include "Polygon.hpp"
+#include "TextLexer.hpp"
 
 #include "WZM.hpp" // for friends
 
@@ -55,12 +57,16 @@ public:
 	virtual ~APieLevel(){}
 
 	virtual bool read(std::istream& in);
+	virtual bool read(TextLexer& in);
 	virtual void write(std::ostream& out) const;
 
 	int points() const;
 	int polygons() const;
 	int connectors() const;
 
+	/// Polygons index points with shorts, more points than this can't be written
+	static int maxPoints();
+
 	bool isValid() const;
 protected:
 	void clearAll();
@@ -80,12 +86,15 @@ public:
 	virtual unsigned version() const =0;
 
 	virtual bool read(std::istream& in);
+	virtual bool read(TextLexer& in);
 	virtual void write(std::ostream& out) const;
 
 	unsigned levels() const;
 	virtual unsigned getType() const;
 
 	bool isValid() const;
+	/// False if a level has more than L::maxPoints() points (e.g. from a big OBJ)
+	bool fitsPointIndices() const;
 
 	//virtual bool addFeature(unsigned feature);
 	//virtual bool removeFeature(unsigned feature);
@@ -97,13 +106,13 @@ protected:
 	virtual unsigned textureHeight() const =0;
 	virtual unsigned textureWidth() const =0;
 
-	virtual bool readHeaderBlock(std::istream& in);
+	virtual bool readHeaderBlock(TextLexer& in);
 
-	virtual bool readTexturesBlock(std::istream& in);
-	virtual bool readTextureDirective(std::istream& in);
-	virtual bool readNormalmapDirective(std::istream& in);
+	virtual bool readTexturesBlock(TextLexer& in);
+	virtual bool readTextureDirective(TextLexer& in);
+	virtual bool readNormalmapDirective(TextLexer& in);
 
-	virtual bool readLevelsBlock(std::istream& in);
+	virtual bool readLevelsBlock(TextLexer& in);
 
 	std::string m_texture;
 	std::string m_texture_normalmap;
@@ -117,7 +126,7 @@ template <typename V>
 struct PieConnector
 {
 	virtual ~PieConnector(){}
-	bool read(std::istream& in);
+	bool read(TextLexer& in);
 	void write(std::ostream& out) const;
 	V pos;
 };
@@ -191,6 +200,31 @@ public:
 	operator Pie2Vertex() const;
 };
 
+/**
+  * SpatialHash traits for Pie3Vertex, equality as in Pie3Vertex::equal_wEps
+  */
+struct Pie3VertexHashTraits
+{
+	GLfloat keyEps() const
+	{
+		return std::numeric_limits<GLfloat>::epsilon();
+	}
+
+	void key(const Pie3Vertex& vert, GLfloat out[3]) const
+	{
+		out[0] = vert.x();
+		out[1] = vert.y();
+		out[2] = vert.z();
+	}
+
+	bool equal(const Pie3Vertex& lhs, const Pie3Vertex& rhs) const
+	{
+		return m_vertEq(lhs, rhs);
+	}
+private:
+	Pie3Vertex::equal_wEps m_vertEq;
+};
+
 class Pie3Connector : public PieConnector<Pie3Vertex>
 {
 public:
@@ -21,6 +21,7 @@
 
 #include "Generic.hpp"
 #include "Util.hpp"
+#include "TextLexer.hpp"
 
 #include "Pie.hpp" // Hack for autocomplete
 
@@ -36,14 +37,26 @@ APieLevel< V, P, C>::APieLevel()
 {
 }
 
-// TODO: Write error messages to std::cerr
 template<typename V, typename P, typename C>
 bool APieLevel< V, P, C>::read(std::istream& in)
 {
-	std::string str;
+	TextLexer lex;
+	bool ok;
+
+	lex.load(in);
+	ok = read(lex);
+	lex.sync(in);
+	return ok;
+}
+
+// TODO: Write error messages to std::cerr
+template<typename V, typename P, typename C>
+bool APieLevel< V, P, C>::read(TextLexer& in)
+{
+	TextToken str;
 	unsigned uint;
 
-	std::streampos cnctrStrt;
+	size_t cnctrStrt;
 
 	clearAll();
 
@@ -51,14 +64,14 @@ bool APieLevel< V, P, C>::read(std::istream& in)
 
 	// LEVEL %u
 	in >> str >> uint;
-	if ( in.fail() || str.compare("LEVEL") != 0)
+	if ( in.fail() || !str.equals("LEVEL"))
 	{
 		streamfail();
 	}
 
 	// POINTS %u
 	in >> str >> uint;
-	if ( in.fail() || str.compare("POINTS") != 0)
+	if ( in.fail() || !str.equals("POINTS"))
 	{
 		streamfail();
 	}
@@ -67,6 +80,11 @@ bool APieLevel< V, P, C>::read(std::istream& in)
 	for (; uint > 0; --uint)
 	{
 		V point;
+
+		if (!in.checkProgress())
+		{
+			streamfail();
+		}
 		in >> point.x() >> point.y() >> point.z();
 		m_points.push_back(point);
 	}
@@ -78,7 +96,7 @@ bool APieLevel< V, P, C>::read(std::istream& in)
 
 	// POLYGONS %u
 	in >> str >> uint;
-	if ( in.fail() || str.compare("POLYGONS") != 0)
+	if ( in.fail() || !str.equals("POLYGONS"))
 	{
 		streamfail();
 	}
@@ -87,7 +105,7 @@ bool APieLevel< V, P, C>::read(std::istream& in)
 	for (; uint > 0; --uint)
 	{
 		P poly;
-		if (!poly.read(in))
+		if (!in.checkProgress() || !poly.read(in))
 		{
 			streamfail();
 		}
@@ -95,13 +113,13 @@ bool APieLevel< V, P, C>::read(std::istream& in)
 	}
 
 	// Optional: CONNECTORS %u
-	cnctrStrt = in.tellg();
+	cnctrStrt = in.tell();
 	in >> str >> uint;
-	if ( in.fail() || str.compare("CONNECTORS") != 0)
+	if ( in.fail() || !str.equals("CONNECTORS"))
 	{
 		// no connectors or eof
 		in.clear();
-		in.seekg(cnctrStrt);
+		in.seek(cnctrStrt);
 		return true;
 	}
 
@@ -181,12 +199,23 @@ void APieLevel< V, P, C>::clearAll()
 	m_connectors.clear();
 }
 
+template<typename V, typename P, typename C>
+int APieLevel<V, P, C>::maxPoints()
+{
+	return std::numeric_limits<short>::max();
+}
+
 template<typename V, typename P, typename C>
 bool APieLevel<V, P, C>::isValid() const
 {
 	typename std::vector<P>::const_iterator it;
 	unsigned i;
 
+	if (points() > maxPoints())
+	{
+		return false;
+	}
+
 	for (it = m_polygons.begin(); it != m_polygons.end(); ++it)
 	{
 		for (i = 0; i < it->vertices(); ++i)
@@ -201,10 +230,10 @@ bool APieLevel<V, P, C>::isValid() const
 }
 
 template <typename V>
-bool PieConnector<V>::read(std::istream& in)
+bool PieConnector<V>::read(TextLexer& in)
 {
 	in >> pos.x() >> pos.y() >> pos.z();
-	return in.good() || in.eof();
+	return !in.fail();
 }
 
 template <typename V>
@@ -261,17 +290,29 @@ inline bool APieModel<L>::isFeatureSet(unsigned feature) const
 	return (m_type & feature);
 }
 
+template <typename L>
+bool APieModel<L>::read(std::istream& in)
+{
+	TextLexer lex;
+	bool ok;
+
+	lex.load(in);
+	ok = read(lex);
+	lex.sync(in);
+	return ok;
+}
+
 #define streamfail() do {\
 	clearAll();	\
 	in.clear();	\
-	in.seekg(start);	\
+	in.seek(start);	\
 	return false; } while(0)
 
 // TODO: Write error messages to std::cerr
 template <typename L>
-bool APieModel<L>::read(std::istream& in)
+bool APieModel<L>::read(TextLexer& in)
 {
-	std::streampos start = in.tellg();
+	size_t start = in.tell();
 
 	clearAll();
 
@@ -287,21 +328,22 @@ bool APieModel<L>::read(std::istream& in)
 #undef streamfail
 
 template <typename L>
-bool APieModel<L>::readHeaderBlock(std::istream& in)
+bool APieModel<L>::readHeaderBlock(TextLexer& in)
 {
-	std::string str;
+	TextToken str;
 	unsigned uint;
 
 	// PIE %u
 	in >> str >> uint;
-	if ( in.fail() || str.compare(PIE_MODEL_SIGNATURE) != 0)
+	if ( in.fail() || !str.equals(PIE_MODEL_SIGNATURE))
 	{
 		return false;
 	}
 
 	// TYPE %x
-	in >> str >> std::hex >> m_type >> std::dec;
-	if ( in.fail() || str.compare(PIE_MODEL_DIRECTIVE_TYPE) != 0)
+	in >> str;
+	in.hex(m_type);
+	if ( in.fail() || !str.equals(PIE_MODEL_DIRECTIVE_TYPE))
 	{
 		return false;
 	}
@@ -310,27 +352,27 @@ bool APieModel<L>::readHeaderBlock(std::istream& in)
 }
 
 template <typename L>
-bool APieModel<L>::readTexturesBlock(std::istream& in)
+bool APieModel<L>::readTexturesBlock(TextLexer& in)
 {
 	return readTextureDirective(in) && readNormalmapDirective(in);
 }
 
 // PIE2 specialization
 template <>
-inline bool APieModel<Pie2Level>::readTexturesBlock(std::istream& in)
+inline bool APieModel<Pie2Level>::readTexturesBlock(TextLexer& in)
 {
 	return readTextureDirective(in);
 }
 
 template <typename L>
-bool APieModel<L>::readTextureDirective(std::istream& in)
+bool APieModel<L>::readTextureDirective(TextLexer& in)
 {
-	std::string str;
+	TextToken str;
 	unsigned uint;
 
 	// TEXTURE 0 %s %u %u
 	in >> str >> uint >> m_texture >> uint >> uint;
-	if ( in.fail() || str.compare(PIE_MODEL_DIRECTIVE_TEXTURE) != 0)
+	if ( in.fail() || !str.equals(PIE_MODEL_DIRECTIVE_TEXTURE))
 	{
 		return false;
 	}
@@ -350,11 +392,11 @@ bool APieModel<L>::readTextureDirective(std::istream& in)
 
 // Optional directive
 template <typename L>
-bool APieModel<L>::readNormalmapDirective(std::istream& in)
+bool APieModel<L>::readNormalmapDirective(TextLexer& in)
 {
-	std::string str;
+	TextToken str;
 	unsigned uint;
-	std::streampos entrypoint = in.tellg();
+	size_t entrypoint = in.tell();
 
 	// NORMALMAP 0 %s
 	in >> str >> uint >> m_texture_normalmap;
@@ -363,10 +405,10 @@ bool APieModel<L>::readNormalmapDirective(std::istream& in)
 		return false;
 	}
 
-	if (str.compare(PIE_MODEL_DIRECTIVE_NORMALMAP) != 0)
+	if (!str.equals(PIE_MODEL_DIRECTIVE_NORMALMAP))
 	{
 		m_texture_normalmap.clear();
-		in.seekg(entrypoint);
+		in.seek(entrypoint);
 	}
 
 	// no constraits for normalmap name afaik
@@ -375,14 +417,14 @@ bool APieModel<L>::readNormalmapDirective(std::istream& in)
 }
 
 template <typename L>
-bool APieModel<L>::readLevelsBlock(std::istream& in)
+bool APieModel<L>::readLevelsBlock(TextLexer& in)
 {
-	std::string str;
+	TextToken str;
 	unsigned uint;
 
 	// LEVELS %u
 	in >> str >> uint;
-	if ( in.fail() || str.compare(PIE_MODEL_DIRECTIVE_LEVELS) != 0)
+	if ( in.fail() || !str.equals(PIE_MODEL_DIRECTIVE_LEVELS))
 	{
 		return false;
 	}
@@ -454,4 +496,19 @@ bool APieModel<L>::isValid() const
 	return true;
 }
 
+template<typename L>
+bool APieModel<L>::fitsPointIndices() const
+{
+	typename std::vector<L>::const_iterator it;
+
+	for (it = m_levels.begin(); it != m_levels.end(); ++it)
+	{
+		if (it->points() > L::maxPoints())
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
 #endif //PIE_T_CPP
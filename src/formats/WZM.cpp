@@ -25,7 +25,9 @@
 #include <set>
 #include <list>
 
+#include <cctype>
 #include <cmath>
+#include <cstring>
 
 #include <sstream>
 
@@ -35,6 +37,13 @@
 #include "Vector.hpp"
 
 #include "OBJ.hpp"
+#include "TextLexer.hpp"
+#include "WZMBinary.hpp"
+#include "MappedFile.hpp"
+#include "TaskPool.hpp"
+#include "VertexCache.hpp"
+#include "Overdraw.hpp"
+#include "Meshlet.hpp"
 
 void WZMaterial::setDefaults()
 {
@@ -62,7 +71,8 @@ bool WZMaterial::isDefault() const
 	return true;
 }
 
-std::istream& operator>> (std::istream& in, WZMaterial& mat)
+template <typename S>
+static S& readMaterial(S& in, WZMaterial& mat)
 {
 	in >> mat.vals[WZM_MAT_EMISSIVE].x() >> mat.vals[WZM_MAT_EMISSIVE].y() >> mat.vals[WZM_MAT_EMISSIVE].z()
 	   >> mat.vals[WZM_MAT_AMBIENT].x()  >> mat.vals[WZM_MAT_AMBIENT].y()  >> mat.vals[WZM_MAT_AMBIENT].z()
@@ -72,6 +82,16 @@ std::istream& operator>> (std::istream& in, WZMaterial& mat)
 	return in;
 }
 
+std::istream& operator>> (std::istream& in, WZMaterial& mat)
+{
+	return readMaterial(in, mat);
+}
+
+TextLexer& operator>> (TextLexer& in, WZMaterial& mat)
+{
+	return readMaterial(in, mat);
+}
+
 std::ostream& operator<< (std::ostream& out, const WZMaterial& mat)
 {
 	out << mat.vals[WZM_MAT_EMISSIVE].x() << ' ' << mat.vals[WZM_MAT_EMISSIVE].y() << ' ' << mat.vals[WZM_MAT_EMISSIVE].z() << ' '
@@ -82,6 +102,227 @@ std::ostream& operator<< (std::ostream& out, const WZMaterial& mat)
 	return out;
 }
 
+/*
+ * Per mesh import tasks. Every task fills its own, preallocated mesh,
+ * so the model comes out the same whatever order they run in.
+ */
+
+class PieLevelTask : public Task
+{
+public:
+	PieLevelTask(const Pie3Level& level, Mesh& mesh): m_level(&level), m_mesh(&mesh) {}
+
+	void run()
+	{
+		*m_mesh = Mesh(*m_level);
+	}
+
+private:
+	const Pie3Level* m_level;
+	Mesh* m_mesh;
+};
+
+class TextMeshTask : public Task
+{
+public:
+	TextMeshTask(const char* begin, const char* end, Mesh& mesh):
+		ok(false), m_begin(begin), m_end(end), m_mesh(&mesh) {}
+
+	void run()
+	{
+		TextLexer in(m_begin, m_end);
+
+		ok = m_mesh->read(in);
+		if (ok && !in.atEnd())
+		{
+			std::cerr << "WZM::read - Unexpected data after mesh " << m_mesh->getName();
+			ok = false;
+		}
+	}
+
+	bool ok;
+
+private:
+	const char* m_begin;
+	const char* m_end;
+	Mesh* m_mesh;
+};
+
+class BinaryMeshTask : public Task
+{
+public:
+	BinaryMeshTask(const WZMBinaryView& view, unsigned index, Mesh& mesh):
+		ok(false), m_view(&view), m_index(index), m_mesh(&mesh) {}
+
+	void run()
+	{
+		ok = m_mesh->readBinary(*m_view, m_index);
+	}
+
+	bool ok;
+
+private:
+	const WZMBinaryView* m_view;
+	unsigned m_index;
+	Mesh* m_mesh;
+};
+
+class OBJGroupTask : public Task
+{
+public:
+	OBJGroupTask(const std::vector<OBJTri>& faces, const std::vector<OBJVertex>& verts,
+		     const std::vector<OBJUV>& uvs, const std::vector<OBJVertex>& normals, Mesh& mesh):
+		m_faces(&faces), m_verts(&verts), m_uvs(&uvs), m_normals(&normals), m_mesh(&mesh) {}
+
+	void run()
+	{
+		m_mesh->importFromOBJ(*m_faces, *m_verts, *m_uvs, *m_normals);
+	}
+
+private:
+	const std::vector<OBJTri>* m_faces;
+	const std::vector<OBJVertex>* m_verts;
+	const std::vector<OBJUV>* m_uvs;
+	const std::vector<OBJVertex>* m_normals;
+	Mesh* m_mesh;
+};
+
+class ForsythTask : public Task
+{
+public:
+	ForsythTask(Mesh& mesh): ok(false), m_mesh(&mesh) {}
+
+	void run()
+	{
+		ok = m_mesh->optimizeForsyth();
+	}
+
+	bool ok;
+
+private:
+	Mesh* m_mesh;
+};
+
+class OverdrawTask : public Task
+{
+public:
+	OverdrawTask(Mesh& mesh, float threshold): ok(false), m_mesh(&mesh), m_threshold(threshold) {}
+
+	void run()
+	{
+		ok = m_mesh->optimizeOverdraw(m_threshold);
+	}
+
+	bool ok;
+
+private:
+	Mesh* m_mesh;
+	float m_threshold;
+};
+
+class SimplifyTask : public Task
+{
+public:
+	SimplifyTask(Mesh& mesh, unsigned targetTriangles, float maxError):
+		ok(false), m_mesh(&mesh), m_targetTriangles(targetTriangles), m_maxError(maxError) {}
+
+	void run()
+	{
+		ok = m_mesh->simplify(m_targetTriangles, m_maxError);
+	}
+
+	bool ok;
+
+private:
+	Mesh* m_mesh;
+	unsigned m_targetTriangles;
+	float m_maxError;
+};
+
+// Triangles left of triangles at ratio, at least one
+static unsigned targetTriangles(unsigned triangles, float ratio)
+{
+	const double target = std::ceil(static_cast<double>(triangles) * std::max(0.f, std::min(ratio, 1.f)));
+
+	return std::max(1u, static_cast<unsigned>(target));
+}
+
+template <typename T>
+static void runMeshTasks(std::vector<T>& tasks)
+{
+	std::vector<Task*> pending;
+	typename std::vector<T>::iterator it;
+
+	pending.reserve(tasks.size());
+	for (it = tasks.begin(); it != tasks.end(); ++it)
+	{
+		pending.push_back(&*it);
+	}
+	TaskPool().run(pending);
+}
+
+template <typename T>
+static bool allTasksOk(const std::vector<T>& tasks)
+{
+	typename std::vector<T>::const_iterator it;
+
+	for (it = tasks.begin(); it != tasks.end(); ++it)
+	{
+		if (!it->ok)
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+static void skipTokens(TextLexer& in, unsigned long long count)
+{
+	TextToken tok;
+
+	for (; count > 0 && !in.fail(); --count)
+	{
+		in >> tok;
+	}
+}
+
+/*
+ * Moves past the next text mesh only looking at the counts in its header,
+ * which is a lot cheaper than parsing the numbers. Anything malformed is
+ * left to Mesh::read to report.
+ */
+static bool skipTextMesh(TextLexer& in)
+{
+	TextToken str;
+	unsigned vertices, indices, connectors;
+
+	// MESH name TEAMCOLOURS tc MINMAXTSPCEN 9 values
+	skipTokens(in, 5 + 9);
+	if (!(in >> str >> vertices).fail() && !str.equals(WZM_MESH_DIRECTIVE_VERTICES))
+	{
+		return false;
+	}
+	if (!(in >> str >> indices).fail() && !str.equals(WZM_MESH_DIRECTIVE_INDICES))
+	{
+		return false;
+	}
+
+	// VERTEXARRAY, position, uv, normal and tangent per vertex
+	skipTokens(in, 1 + 12ULL * vertices);
+	if (!(in >> str).fail() && !str.equals(WZM_MESH_DIRECTIVE_INDEXARRAY))
+	{
+		return false;
+	}
+	skipTokens(in, 3ULL * indices);
+	if (!(in >> str >> connectors).fail() && !str.equals(WZM_MESH_DIRECTIVE_CONNECTORS))
+	{
+		return false;
+	}
+	skipTokens(in, 3ULL * connectors);
+
+	return !in.fail();
+}
+
 WZM::WZM()
 {
 	m_material.setDefaults();
@@ -89,8 +330,9 @@ WZM::WZM()
 
 WZM::WZM(const Pie3Model &p3)
 {
-	std::vector<Pie3Level>::const_iterator it;
+	std::vector<PieLevelTask> tasks;
 	std::stringstream ss;
+	size_t i;
 
 	m_material.setDefaults();
 
@@ -98,17 +340,24 @@ WZM::WZM(const Pie3Model &p3)
 	setTextureName(WZM_TEX_NORMALMAP, p3.m_texture_normalmap);
 	setTextureName(WZM_TEX_TCMASK, p3.m_texture_tcmask);
 
-	for (it = p3.m_levels.begin(); it != p3.m_levels.end(); ++it)
+	// levels convert independently
+	m_meshes.resize(p3.m_levels.size());
+	tasks.reserve(p3.m_levels.size());
+	for (i = 0; i < p3.m_levels.size(); ++i)
 	{
-		m_meshes.push_back(*it);
+		tasks.push_back(PieLevelTask(p3.m_levels[i], m_meshes[i]));
+	}
+	runMeshTasks(tasks);
 
+	for (i = 0; i < m_meshes.size(); ++i)
+	{
 		// name
-		ss << m_meshes.size();
-		m_meshes.back().setName(ss.str());
+		ss << i + 1;
+		m_meshes[i].setName(ss.str());
 		ss.str(std::string());
 
 		// per-mesh team colors
-		m_meshes.back().setTeamColours(isTextureSet(WZM_TEX_TCMASK));
+		m_meshes[i].setTeamColours(isTextureSet(WZM_TEX_TCMASK));
 	}
 }
 
@@ -127,12 +376,23 @@ WZM::operator Pie3Model() const
 
 bool WZM::read(std::istream& in)
 {
-	std::string str;
+	TextLexer lex;
+	bool ok;
+
+	lex.load(in);
+	ok = read(lex);
+	lex.sync(in);
+	return ok;
+}
+
+bool WZM::read(TextLexer& in)
+{
+	TextToken str;
 	int i,meshes;
 
 	clear();
 	in >> str;
-	if (in.fail() || str.compare(WZM_MODEL_SIGNATURE) != 0)
+	if (in.fail() || !str.equals(WZM_MODEL_SIGNATURE))
 	{
 		std::cerr << "WZM::read - Missing header";
 		return false;
@@ -152,7 +412,7 @@ bool WZM::read(std::istream& in)
 
 	// TEXTURE %s
 	in >> str;
-	if (str.compare(WZM_MODEL_DIRECTIVE_TEXTURE) != 0)
+	if (!str.equals(WZM_MODEL_DIRECTIVE_TEXTURE))
 	{
 		std::cerr << "WZM::read - Expected " << WZM_MODEL_DIRECTIVE_TEXTURE << " directive but got" << str;
 		return false;
@@ -169,7 +429,7 @@ bool WZM::read(std::istream& in)
 	in >> str;
 
 	// optional: team color mask
-	if (!str.compare(WZM_MODEL_DIRECTIVE_TCMASK))
+	if (str.equals(WZM_MODEL_DIRECTIVE_TCMASK))
 	{
 		in >> m_textures[WZM_TEX_TCMASK];
 		if (in.fail())
@@ -184,7 +444,7 @@ bool WZM::read(std::istream& in)
 	}
 
 	// optional: normalmap
-	if (!str.compare(WZM_MODEL_DIRECTIVE_NORMALMAP))
+	if (str.equals(WZM_MODEL_DIRECTIVE_NORMALMAP))
 	{
 		in >> m_textures[WZM_TEX_NORMALMAP];
 		if (in.fail())
@@ -199,7 +459,7 @@ bool WZM::read(std::istream& in)
 	}
 
 	// optional: material
-	if (!str.compare(WZM_MODEL_DIRECTIVE_MATERIAL))
+	if (str.equals(WZM_MODEL_DIRECTIVE_MATERIAL))
 	{
 		in >> m_material;
 		if (in.fail())
@@ -216,13 +476,58 @@ bool WZM::read(std::istream& in)
 	// token was pre read here
 	// MESHES %u
 	in >> meshes;
-	if (in.fail() || str.compare("MESHES") != 0)
+	if (in.fail() || !str.equals("MESHES"))
 	{
 		std::cerr << "WZM::read - Expected MESHES directive but got " << str;
 		clear();
 		return false;
 	}
 
+	// find where every mesh ends, then parse them in parallel
+	if (meshes > 1)
+	{
+		std::vector<size_t> ends;
+		const size_t start = in.tell();
+
+		ends.reserve(meshes + 1);
+		ends.push_back(start);
+		for (i = 0; i < meshes && in.checkProgress() && skipTextMesh(in); ++i)
+		{
+			ends.push_back(in.tell());
+		}
+
+		if (in.progress() && in.progress()->cancelled())
+		{
+			clear();
+			return false;
+		}
+
+		if (i == meshes)
+		{
+			std::vector<TextMeshTask> tasks;
+
+			m_meshes.resize(meshes);
+			tasks.reserve(meshes);
+			for (i = 0; i < meshes; ++i)
+			{
+				tasks.push_back(TextMeshTask(in.begin() + ends[i], in.begin() + ends[i + 1], m_meshes[i]));
+			}
+			runMeshTasks(tasks);
+
+			// the scan is at the end of the last mesh by now
+			if (!allTasksOk(tasks) || (in.progress() && !(in.checkProgress() && in.progress()->meshesBuilt(meshes))))
+			{
+				clear();
+				return false;
+			}
+			return true;
+		}
+
+		// something's malformed, read one by one to report where
+		in.clear();
+		in.seek(start);
+	}
+
 	m_meshes.reserve(meshes);
 	for(; meshes>0; --meshes)
 	{
@@ -233,6 +538,12 @@ bool WZM::read(std::istream& in)
 			return false;
 		}
 		m_meshes.push_back(mesh);
+
+		if (in.progress() && !in.progress()->meshesBuilt(1))
+		{
+			clear();
+			return false;
+		}
 	}
 	return true;
 }
@@ -280,22 +591,204 @@ void WZM::write(std::ostream& out) const
 	}
 }
 
+bool WZM::readBinary(const std::string& fileName, LoadProgress* progress)
+{
+	MappedFile file;
+
+	clear();
+	if (!file.open(fileName))
+	{
+		std::cerr << "WZM::readBinary - Unable to open " << fileName;
+		return false;
+	}
+	return readBinary(file.data(), file.size(), progress);
+}
+
+/// The meshes are read in parallel, so progress only hears about the start and the end
+bool WZM::readBinary(const char* data, size_t size, LoadProgress* progress)
+{
+	WZMBinaryView view;
+	std::vector<BinaryMeshTask> tasks;
+	unsigned i;
+
+	clear();
+	if (!view.open(data, size))
+	{
+		return false;
+	}
+
+	const WZMBHeader& hdr = view.header();
+
+	for (i = WZM_TEX__FIRST; i < WZM_TEX__LAST; ++i)
+	{
+		if (hdr.textures[i] != WZMB_NO_STRING)
+		{
+			m_textures[static_cast<wzm_texture_type_t>(i)] = view.string(hdr.textures[i]);
+		}
+	}
+
+	for (i = WZM_MAT__FIRST; i < WZM_MAT__LAST; ++i)
+	{
+		m_material.vals[i] = WZMVertex4(hdr.material[i][0], hdr.material[i][1],
+						hdr.material[i][2], hdr.material[i][3]);
+	}
+	m_material.shininess = hdr.shininess;
+
+	if (progress && !progress->consumed(0, size))
+	{
+		return false;
+	}
+
+	// read in place, copying whole meshes around isn't cheap
+	m_meshes.resize(view.meshes());
+	tasks.reserve(view.meshes());
+	for (i = 0; i < view.meshes(); ++i)
+	{
+		tasks.push_back(BinaryMeshTask(view, i, m_meshes[i]));
+	}
+	runMeshTasks(tasks);
+
+	if (!allTasksOk(tasks) || (progress && !(progress->consumed(size, size) && progress->meshesBuilt(view.meshes()))))
+	{
+		clear();
+		return false;
+	}
+	return true;
+}
+
+bool WZM::writeBinary(std::ostream& out) const
+{
+	WZMBHeader hdr;
+	std::vector<WZMBMeshEntry> entries(m_meshes.size());
+	std::string strings;
+	uint64_t pos;
+	unsigned i;
+
+	std::memset(&hdr, 0, sizeof(hdr));
+	std::memcpy(hdr.signature, WZMB_MODEL_SIGNATURE, sizeof(hdr.signature));
+	hdr.version = WZMB_MODEL_VERSION;
+	hdr.byteOrder = WZMB_BYTEORDER_MARK;
+
+	for (i = WZM_TEX__FIRST; i < WZM_TEX__LAST; ++i)
+	{
+		const wzm_texture_type_t type = static_cast<wzm_texture_type_t>(i);
+
+		hdr.textures[i] = WZMB_NO_STRING;
+		if (isTextureSet(type))
+		{
+			hdr.textures[i] = strings.size();
+			strings.append(getTextureName(type)).push_back('\0');
+		}
+	}
+
+	for (i = WZM_MAT__FIRST; i < WZM_MAT__LAST; ++i)
+	{
+		hdr.material[i][0] = m_material.vals[i].x();
+		hdr.material[i][1] = m_material.vals[i].y();
+		hdr.material[i][2] = m_material.vals[i].z();
+		hdr.material[i][3] = m_material.vals[i].w();
+	}
+	hdr.shininess = m_material.shininess;
+
+	for (i = 0; i < m_meshes.size(); ++i)
+	{
+		std::memset(&entries[i], 0, sizeof(WZMBMeshEntry));
+		entries[i].name = strings.size();
+		strings.append(m_meshes[i].getName()).push_back('\0');
+	}
+
+	// layout
+	pos = sizeof(WZMBHeader);
+	hdr.meshCount = m_meshes.size();
+	hdr.meshTableOffset = static_cast<uint32_t>(wzmbAlign(pos));
+	pos = hdr.meshTableOffset + entries.size() * sizeof(WZMBMeshEntry);
+	hdr.stringTableOffset = static_cast<uint32_t>(pos);
+	hdr.stringTableSize = strings.size();
+	pos += strings.size();
+
+	for (i = 0; i < m_meshes.size(); ++i)
+	{
+		pos = m_meshes[i].binaryLayout(entries[i], pos);
+		if (pos > 0xFFFFFFFFu)
+		{
+			break;
+		}
+	}
+	if (pos > 0xFFFFFFFFu)
+	{
+		std::cerr << "WZM::writeBinary - Model too big for the binary format";
+		return false;
+	}
+	hdr.fileSize = static_cast<uint32_t>(pos);
+
+	// data
+	pos = 0;
+	wzmbWrite(out, pos, &hdr, sizeof(hdr));
+	wzmbPad(out, pos, hdr.meshTableOffset);
+	if (!entries.empty())
+	{
+		wzmbWrite(out, pos, &entries[0], entries.size() * sizeof(WZMBMeshEntry));
+	}
+	wzmbWrite(out, pos, strings.data(), strings.size());
+
+	for (i = 0; i < m_meshes.size(); ++i)
+	{
+		m_meshes[i].writeBinary(out, entries[i], pos);
+	}
+
+	return !out.fail();
+}
+
+// v, v/vt, v//vn or v/vt/vn
+static bool readOBJFaceVertex(TextLexer& line, OBJTri& tri, unsigned pos)
+{
+	line >> tri.tri.operator [](pos);
+	tri.uvs.operator [](pos) = -1;
+	tri.nrm.operator [](pos) = -1;
+
+	if (line.skip('/'))
+	{
+		if (line.peek() != '/' && line.peek() != -1 && !std::isspace(line.peek()))
+		{
+			line >> tri.uvs.operator [](pos);
+		}
+		if (line.skip('/') && line.peek() != -1 && !std::isspace(line.peek()))
+		{
+			line >> tri.nrm.operator [](pos);
+		}
+	}
+	return !line.fail();
+}
+
+bool WZM::importFromOBJ(std::istream& in)
+{
+	TextLexer lex;
+	bool ok;
+
+	lex.load(in);
+	ok = importFromOBJ(lex);
+	lex.sync(in);
+	return ok;
+}
+
 /*
  * This function does the parsing,
  * we'll let class Mesh do the WZM'izing
  */
-bool WZM::importFromOBJ(std::istream& in)
+bool WZM::importFromOBJ(TextLexer& in)
 {
 	const bool invertV = true;
 	std::vector<OBJVertex> vertArray, normArray;
 	std::vector<OBJUV> uvArray;
 	std::vector<OBJTri> groupedFaces;
 
+	// faces and names of every finished group, meshes are built at the end
+	std::vector<std::vector<OBJTri> > groups;
+	std::vector<std::string> names;
+	std::vector<OBJGroupTask> tasks;
+
 	std::string name("Default"); //Default name of default obj group is default
-	std::vector<std::string> vertices, indices;
-	std::vector<std::string>::iterator itVStr;
-	std::string str;
-	std::stringstream ss;
+	TextLexer line;
 
 	// Only give warnings once
 	bool warnLine = false, warnPoint = false;
@@ -304,7 +797,6 @@ bool WZM::importFromOBJ(std::istream& in)
 	OBJTri tri;
 	OBJVertex vert;
 	OBJUV uv;
-	Mesh mesh;
 
 	unsigned i, pos;
 
@@ -319,29 +811,19 @@ bool WZM::importFromOBJ(std::istream& in)
 	 * because it accepts any whitespace as a space.
 	 */
 
-	while (!(in.eof()|| in.fail()))
+	while (in.checkProgress() && in.nextLine(line))
 	{
-		std::getline(in, str);
-		ss.str(str);
-		ss.seekg(0);
-		ss.clear();
-
-		if (str.empty() || ss.fail())
-		{
-			continue;
-		}
-
-		switch(ss.get())
+		switch(line.get())
 		{
 		case '#':
 			// ignore comments
 			continue;
 		case 'v':
-			switch(ss.get())
+			switch(line.get())
 			{
 			case 't':
-				ss >> uv.u() >> uv.v();
-				if (ss.fail())
+				line >> uv.u() >> uv.v();
+				if (line.fail())
 				{
 					return false;
 				}
@@ -352,8 +834,8 @@ bool WZM::importFromOBJ(std::istream& in)
 				uvArray.push_back(uv);
 				break;
 			case 'n':	// normals
-				ss >> vert.x() >> vert.y() >> vert.z();
-				if (ss.fail())
+				line >> vert.x() >> vert.y() >> vert.z();
+				if (line.fail())
 				{
 					return false;
 				}
@@ -362,8 +844,8 @@ bool WZM::importFromOBJ(std::istream& in)
 			case 'p':	// and parameter vertices
 				break;
 			default:
-				ss >> vert.x() >> vert.y() >> vert.z();
-				if (ss.fail())
+				line >> vert.x() >> vert.y() >> vert.z();
+				if (line.fail())
 				{
 					return false;
 				}
@@ -371,19 +853,7 @@ bool WZM::importFromOBJ(std::istream& in)
 			}
 			break;
 		case 'f':
-			vertices = split(str);
-			if (vertices.size() < 2 + 1)
-			{
-				 /* Should never happen, faces will have >= 3+1 tokens
-				  * ( more than 3 vertices + the "f" directive)
-				  */
-				break;
-			}
-
-			itVStr = vertices.begin();
-			++itVStr; // Advance to first vertex
-
-			for (i = 0; itVStr != vertices.end(); ++itVStr, ++i)
+			for (i = 0; !line.atEnd(); ++i)
 			{
 				if (i <= 2)
 				{
@@ -392,35 +862,15 @@ bool WZM::importFromOBJ(std::istream& in)
 				else
 				{
 					tri.uvs.operator [](1) = tri.uvs.operator [](2);
+					tri.nrm.operator [](1) = tri.nrm.operator [](2);
 					tri.tri.operator [](1) = tri.tri.operator [](2);
 					pos = 2;
 				}
 
-				indices = split(*itVStr, '/');
-
-				ss.str(indices[0]), ss.clear(), ss.seekg(0);
-
-				ss >> tri.tri.operator [](pos);
-
-				if (indices.size() >= 2 && !indices[1].empty())
-				{
-					ss.str(indices[1]), ss.clear(), ss.seekg(0);
-					ss >> tri.uvs.operator [](pos);
-				}
-				else
-				{
-					tri.uvs.operator [](pos) = -1;
-					tri.nrm.operator [](pos) = -1;
-				}
-
-				if (indices.size() == 3 && !indices[2].empty())
-				{
-					ss.str(indices[2]), ss.clear(), ss.seekg(0);
-					ss >> tri.nrm.operator [](pos);
-				}
-				else
+				// tolerate broken faces, keep what we've got so far
+				if (!readOBJFaceVertex(line, tri, pos))
 				{
-					tri.nrm.operator [](pos) = -1;
+					break;
 				}
 
 				if (i >= 2)
@@ -448,83 +898,87 @@ bool WZM::importFromOBJ(std::istream& in)
 		case 'o':
 			if (!groupedFaces.empty())
 			{
-				mesh.importFromOBJ(groupedFaces, vertArray, uvArray, normArray);
-				mesh.setTeamColours(false);
-				mesh.setName(name);
-				m_meshes.push_back(mesh);
-				groupedFaces.clear();
+				groups.push_back(std::vector<OBJTri>());
+				groups.back().swap(groupedFaces);
+				names.push_back(name);
 			}
-			ss >> name;
+			line >> name;
 			if (!isValidWzName(name))
 			{
-				ss.str(std::string()), ss.clear(), ss.seekg(0);
-				ss << m_meshes.size();
+				std::stringstream ss;
+				ss << groups.size();
 				ss >> name;
 			}
 			break;
 		}
 	}
+	if (in.fail())
+	{
+		// cancelled
+		clear();
+		return false;
+	}
 	if (!groupedFaces.empty())
 	{
-		mesh.importFromOBJ(groupedFaces, vertArray, uvArray, normArray);
-		mesh.setTeamColours(false);
-		mesh.setName(name);
-		m_meshes.push_back(mesh);
+		groups.push_back(std::vector<OBJTri>());
+		groups.back().swap(groupedFaces);
+		names.push_back(name);
+	}
+
+	// groups only index the global arrays, which are complete now
+	m_meshes.resize(groups.size());
+	tasks.reserve(groups.size());
+	for (i = 0; i < groups.size(); ++i)
+	{
+		tasks.push_back(OBJGroupTask(groups[i], vertArray, uvArray, normArray, m_meshes[i]));
+	}
+	runMeshTasks(tasks);
+
+	for (i = 0; i < m_meshes.size(); ++i)
+	{
+		m_meshes[i].setTeamColours(false);
+		m_meshes[i].setName(names[i]);
+	}
+
+	if (in.progress() && !in.progress()->meshesBuilt(m_meshes.size()))
+	{
+		clear();
+		return false;
 	}
 	return true;
 }
 
 void WZM::exportToOBJ(std::ostream &out) const
 {
-	std::list<std::stringstream*> objectBuffers;
-
 	Mesh_exportToOBJ_InOutParams params;
 
-	OBJVertex::less_wEps vertCompare;
-	std::set<OBJVertex, OBJVertex::less_wEps> vertSet(vertCompare);
-	std::vector<OBJVertex> vertices;
-	std::vector<unsigned> vertMapping;
+	OBJVertexTable vertices;
+	OBJUVTable uvs;
+	OBJVertexTable normals;
 
 	params.vertices = &vertices;
-	params.vertSet = &vertSet;
-	params.vertMapping = &vertMapping;
-
-	OBJUV::less_wEps uvCompare;
-	std::set<OBJUV, OBJUV::less_wEps> uvSet(uvCompare);
-	std::vector<OBJUV> uvs;
-	std::vector<unsigned> uvMapping;
-
 	params.uvs = &uvs;
-	params.uvSet = &uvSet;
-	params.uvMapping = &uvMapping;
-
-	OBJVertex::less_wEps normCompare;
-	std::set<OBJVertex, OBJVertex::less_wEps> normSet(normCompare);
-	std::vector<OBJVertex> normals;
-	std::vector<unsigned> normMapping;
-
 	params.normals = &normals;
-	params.normSet = &normSet;
-	params.normMapping = &normMapping;
 
-	std::vector<Mesh>::const_iterator itM;
-	std::vector<OBJVertex>::iterator itVert;
-	std::vector<OBJUV>::iterator	itUV;
-	std::vector<OBJVertex>::iterator itNorm;
-	std::stringstream* pSSS;
+	std::vector<std::vector<OBJCorner> > corners(m_meshes.size());
+	std::vector<OBJVertex>::const_iterator itVert;
+	std::vector<OBJUV>::const_iterator	itUV;
+	std::vector<OBJVertex>::const_iterator itNorm;
+	unsigned i;
 
 	if (!getTextureName(WZM_TEX_DIFFUSE).empty())
 	{
 		out << "mtllib " << getTextureName(WZM_TEX_DIFFUSE) << ".mtl\nusemtl " << getTextureName(WZM_TEX_DIFFUSE) << "\n\n";
 	}
 
-	for (itM = m_meshes.begin(); itM != m_meshes.end(); ++itM)
+	// the shared tables have to be written before any face
+	for (i = 0; i < m_meshes.size(); ++i)
 	{
-		objectBuffers.push_back(itM->exportToOBJ(params));
+		m_meshes[i].buildOBJTables(params, corners[i]);
 	}
 
 	out << "# " << vertices.size() << " vertices\n";
-	for (itVert = vertices.begin(); itVert != vertices.end(); ++itVert)
+	for (itVert = vertices.values().begin(); itVert != vertices.values().end(); ++itVert)
 	{
 		writeOBJVertex(*itVert, out);
 	}
@@ -532,7 +986,7 @@ void WZM::exportToOBJ(std::ostream &out) const
 	out << '\n';
 
 	out << "# " << uvs.size() << " texture coords\n";
-	for (itUV = uvs.begin(); itUV != uvs.end(); ++itUV)
+	for (itUV = uvs.values().begin(); itUV != uvs.values().end(); ++itUV)
 	{
 		writeOBJUV(*itUV, out);
 	}
@@ -540,19 +994,15 @@ void WZM::exportToOBJ(std::ostream &out) const
 	out << '\n';
 
 	out << "# " << normals.size() << " vertex normals\n";
-	for (itNorm = normals.begin(); itNorm != normals.end(); ++itNorm)
+	for (itNorm = normals.values().begin(); itNorm != normals.values().end(); ++itNorm)
 	{
 		writeOBJNormal(*itNorm, out);
 	}
 
-	while (!objectBuffers.empty())
+	for (i = 0; i < m_meshes.size(); ++i)
 	{
-		pSSS = objectBuffers.front();
-		objectBuffers.pop_front();
-
-		out << "\n" << pSSS->str();
-
-		delete pSSS;
+		out << "\n";
+		m_meshes[i].exportToOBJ(out, corners[i]);
 	}
 }
 
@@ -691,6 +1141,46 @@ void WZM::scale(GLfloat x, GLfloat y, GLfloat z, int mesh)
 	}
 }
 
+void WZM::translate(GLfloat x, GLfloat y, GLfloat z, int mesh)
+{
+	// All or a single mesh
+	if (mesh < 0)
+	{
+		std::vector<Mesh>::iterator it;
+		for (it = m_meshes.begin(); it != m_meshes.end(); ++it)
+		{
+			it->translate(x, y, z);
+		}
+	}
+	else
+	{
+		if (m_meshes.size() > (std::vector<Mesh>::size_type)mesh)
+		{
+			m_meshes[(std::vector<Mesh>::size_type)mesh].translate(x, y, z);
+		}
+	}
+}
+
+void WZM::transform(const Matrix4& matrix, int mesh)
+{
+	// All or a single mesh
+	if (mesh < 0)
+	{
+		std::vector<Mesh>::iterator it;
+		for (it = m_meshes.begin(); it != m_meshes.end(); ++it)
+		{
+			it->transform(matrix);
+		}
+	}
+	else
+	{
+		if (m_meshes.size() > (std::vector<Mesh>::size_type)mesh)
+		{
+			m_meshes[(std::vector<Mesh>::size_type)mesh].transform(matrix);
+		}
+	}
+}
+
 void WZM::mirror(int axis, int mesh)
 {
 	if (axis < 0 || axis > 5 || mesh >= (int)m_meshes.size())
@@ -759,6 +1249,168 @@ void WZM::reverseWinding(int mesh)
 
 }
 
+bool WZM::optimizeForsyth(int mesh)
+{
+	std::vector<ForsythTask> tasks;
+	size_t i;
+
+	// All or a single mesh
+	for (i = 0; i < m_meshes.size(); ++i)
+	{
+		if (mesh < 0 || (size_t)mesh == i)
+		{
+			tasks.push_back(ForsythTask(m_meshes[i]));
+		}
+	}
+	runMeshTasks(tasks);
+
+	return allTasksOk(tasks);
+}
+
+bool WZM::optimizeOverdraw(float threshold, int mesh)
+{
+	std::vector<OverdrawTask> tasks;
+	size_t i;
+
+	// All or a single mesh
+	for (i = 0; i < m_meshes.size(); ++i)
+	{
+		if (mesh < 0 || (size_t)mesh == i)
+		{
+			tasks.push_back(OverdrawTask(m_meshes[i], threshold));
+		}
+	}
+	runMeshTasks(tasks);
+
+	return allTasksOk(tasks);
+}
+
+VertexCacheStats WZM::vertexCacheStats() const
+{
+	std::vector<Mesh>::const_iterator it;
+	VertexCacheStats stats;
+
+	for (it = m_meshes.begin(); it != m_meshes.end(); ++it)
+	{
+		stats += it->vertexCacheStats();
+	}
+	return stats;
+}
+
+OverdrawStats WZM::overdrawStats() const
+{
+	std::vector<Mesh>::const_iterator it;
+	OverdrawStats stats;
+
+	for (it = m_meshes.begin(); it != m_meshes.end(); ++it)
+	{
+		stats += it->overdrawStats();
+	}
+	return stats;
+}
+
+MeshletStats WZM::meshletStats() const
+{
+	std::vector<Mesh>::const_iterator it;
+	MeshletStats stats;
+
+	for (it = m_meshes.begin(); it != m_meshes.end(); ++it)
+	{
+		stats += it->meshletStats();
+	}
+	return stats;
+}
+
+bool WZM::simplify(float ratio, float maxError, int mesh)
+{
+	std::vector<SimplifyTask> tasks;
+	size_t i;
+
+	// All or a single mesh
+	for (i = 0; i < m_meshes.size(); ++i)
+	{
+		if (mesh < 0 || (size_t)mesh == i)
+		{
+			tasks.push_back(SimplifyTask(m_meshes[i], targetTriangles(m_meshes[i].indices(), ratio), maxError));
+		}
+	}
+	runMeshTasks(tasks);
+
+	return allTasksOk(tasks);
+}
+
+bool WZM::generateLODs(const std::vector<float>& ratios, std::vector<WZM>& lods) const
+{
+	std::vector<SimplifyTask> tasks;
+	size_t i, j;
+
+	lods.clear();
+	lods.reserve(ratios.size());
+	for (i = 0; i < ratios.size(); ++i)
+	{
+		// shares geometry with the previous level until simplify detaches it
+		lods.push_back(i ? lods.back() : *this);
+
+		tasks.clear();
+		for (j = 0; j < m_meshes.size(); ++j)
+		{
+			tasks.push_back(SimplifyTask(lods.back().m_meshes[j],
+						     targetTriangles(m_meshes[j].indices(), ratios[i]), 1.f));
+		}
+		runMeshTasks(tasks);
+
+		if (!allTasksOk(tasks))
+		{
+			std::cerr << "WZM::generateLODs - Simplifying level " << i + 1 << " failed";
+			return false;
+		}
+	}
+	return true;
+}
+
+unsigned WZM::triangles() const
+{
+	std::vector<Mesh>::const_iterator it;
+	unsigned count = 0;
+
+	for (it = m_meshes.begin(); it != m_meshes.end(); ++it)
+	{
+		count += it->indices();
+	}
+	return count;
+}
+
+bool WZM::calculateBounds(WZMVertex& min, WZMVertex& max) const
+{
+	std::vector<Mesh>::const_iterator it;
+	WZMVertex meshMin, meshMax;
+	bool found = false;
+	unsigned i;
+
+	for (it = m_meshes.begin(); it != m_meshes.end(); ++it)
+	{
+		if (!it->vertices())
+		{
+			continue;
+		}
+
+		it->getBounds(meshMin, meshMax);
+		if (!found)
+		{
+			min = meshMin;
+			max = meshMax;
+			found = true;
+			continue;
+		}
+		for (i = 0; i < 3; ++i)
+		{
+			min[i] = std::min(min[i], meshMin[i]);
+			max[i] = std::max(max[i], meshMax[i]);
+		}
+	}
+	return found;
+}
+
 WZMVertex WZM::calculateCenterPoint() const
 {
 	WZMVertex center, meshcenter;
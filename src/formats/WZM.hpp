@@ -36,6 +36,11 @@
 #define WZM_MODEL_DIRECTIVE_MESHES "MESHES"
 
 class Pie3Model;
+struct VertexCacheStats;
+struct OverdrawStats;
+struct MeshletStats;
+class TextLexer;
+class LoadProgress;
 
 enum wzm_texture_type_t {WZM_TEX_DIFFUSE = 0, WZM_TEX_TCMASK, WZM_TEX_NORMALMAP, WZM_TEX_SPECULAR,
 			 WZM_TEX__LAST, WZM_TEX__FIRST = WZM_TEX_DIFFUSE};
@@ -53,6 +58,7 @@ struct WZMaterial
 	bool isDefault() const;
 };
 std::istream& operator>> (std::istream& in, WZMaterial& mat);
+TextLexer& operator>> (TextLexer& in, WZMaterial& mat);
 std::ostream& operator<< (std::ostream& out, const WZMaterial& mat);
 
 class WZM
@@ -65,9 +71,16 @@ public:
 	virtual operator Pie3Model() const;
 
 	bool read(std::istream& in);
+	bool read(TextLexer& in);
 	void write(std::ostream& out) const;
 
+	/// Binary WZM (.wzmb), see WZMBinary.hpp
+	bool readBinary(const std::string& fileName, LoadProgress* progress = 0);
+	bool readBinary(const char* data, size_t size, LoadProgress* progress = 0);
+	bool writeBinary(std::ostream& out) const;
+
 	bool importFromOBJ(std::istream& in);
+	bool importFromOBJ(TextLexer& in);
 	void exportToOBJ(std::ostream& out) const;
 
 	int version() const;
@@ -88,10 +101,34 @@ public:
 	bool isValid() const;
 
 	void scale(GLfloat x, GLfloat y, GLfloat z, int mesh = -1);
+	void translate(GLfloat x, GLfloat y, GLfloat z, int mesh = -1);
+	void transform(const Matrix4& matrix, int mesh = -1);
 	void mirror(int axis, int mesh = -1); // x == 0, y == 1, z == 2
 	void reverseWinding(int mesh = -1);
 
+	/// See Mesh::optimizeForsyth, meshes are optimized in parallel
+	bool optimizeForsyth(int mesh = -1);
+	/// See Mesh::optimizeOverdraw, run after optimizeForsyth
+	bool optimizeOverdraw(float threshold = 1.05f, int mesh = -1);
+	/// Sums over all meshes
+	VertexCacheStats vertexCacheStats() const;
+	OverdrawStats overdrawStats() const;
+	MeshletStats meshletStats() const;
+
+	/// See Mesh::simplify, every mesh keeps ratio of its triangles, meshes are simplified in parallel
+	bool simplify(float ratio, float maxError = 1.f, int mesh = -1);
+	/**
+	  * Level of detail chain: lods[i] keeps ratios[i] of this model's
+	  * triangles (ratios should be decreasing) and is simplified from
+	  * lods[i - 1], so each level only refines the next coarser one.
+	  */
+	bool generateLODs(const std::vector<float>& ratios, std::vector<WZM>& lods) const;
+	/// Triangles of all meshes
+	unsigned triangles() const;
+
 	WZMVertex calculateCenterPoint() const;
+	/// Box around all meshes, false if there's no geometry
+	bool calculateBounds(WZMVertex& min, WZMVertex& max) const;
 
 protected:
 	void clear();
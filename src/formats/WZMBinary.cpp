@@ -0,0 +1,192 @@
+/*
+	Copyright 2010 Warzone 2100 Project
+
+	This file is part of WMIT.
+
+	WMIT is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	WMIT is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with WMIT.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "WZMBinary.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+void wzmbPad(std::ostream& out, uint64_t& pos, uint64_t target)
+{
+	static const char zeros[WZMB_ALIGNMENT] = {0};
+
+	while (pos < target)
+	{
+		const uint64_t len = std::min<uint64_t>(target - pos, WZMB_ALIGNMENT);
+		out.write(zeros, static_cast<std::streamsize>(len));
+		pos += len;
+	}
+}
+
+void wzmbWrite(std::ostream& out, uint64_t& pos, const void* data, size_t size)
+{
+	if (size)
+	{
+		out.write(static_cast<const char*>(data), static_cast<std::streamsize>(size));
+		pos += size;
+	}
+}
+
+WZMBinaryView::WZMBinaryView():
+	m_data(0), m_size(0), m_header(0), m_meshes(0)
+{
+}
+
+bool WZMBinaryView::open(const char* data, size_t size)
+{
+	unsigned i;
+
+	m_data = data;
+	m_size = size;
+	m_header = 0;
+	m_meshes = 0;
+
+	if (!data || size < sizeof(WZMBHeader))
+	{
+		std::cerr << "WZMBinaryView::open - File too small for header";
+		return false;
+	}
+
+	const WZMBHeader* hdr = reinterpret_cast<const WZMBHeader*>(data);
+
+	if (std::memcmp(hdr->signature, WZMB_MODEL_SIGNATURE, sizeof(hdr->signature)) != 0)
+	{
+		std::cerr << "WZMBinaryView::open - Missing header";
+		return false;
+	}
+	if (hdr->byteOrder != WZMB_BYTEORDER_MARK)
+	{
+		std::cerr << "WZMBinaryView::open - File was written with a different byte order";
+		return false;
+	}
+	if (hdr->version != WZMB_MODEL_VERSION)
+	{
+		std::cerr << "WZMBinaryView::open - Unsupported WZMB version " << hdr->version;
+		return false;
+	}
+	if (hdr->fileSize > size)
+	{
+		std::cerr << "WZMBinaryView::open - File is truncated";
+		return false;
+	}
+
+	// sections
+	if (hdr->meshTableOffset % sizeof(uint32_t) != 0 ||
+		static_cast<uint64_t>(hdr->meshTableOffset) + static_cast<uint64_t>(hdr->meshCount) * sizeof(WZMBMeshEntry) > size)
+	{
+		std::cerr << "WZMBinaryView::open - Mesh table out of bounds";
+		return false;
+	}
+	if (static_cast<uint64_t>(hdr->stringTableOffset) + hdr->stringTableSize > size ||
+		(hdr->stringTableSize && data[hdr->stringTableOffset + hdr->stringTableSize - 1] != '\0'))
+	{
+		std::cerr << "WZMBinaryView::open - Bad string table";
+		return false;
+	}
+
+	m_header = hdr;
+	m_meshes = reinterpret_cast<const WZMBMeshEntry*>(data + hdr->meshTableOffset);
+
+	for (i = 0; i < WZM_TEX__LAST; ++i)
+	{
+		if (!checkString(hdr->textures[i]))
+		{
+			std::cerr << "WZMBinaryView::open - Bad texture name";
+			m_header = 0;
+			return false;
+		}
+	}
+
+	for (i = 0; i < hdr->meshCount; ++i)
+	{
+		const WZMBMeshEntry& entry = m_meshes[i];
+
+		if (!checkString(entry.name))
+		{
+			std::cerr << "WZMBinaryView::open - Bad name of mesh " << i;
+			m_header = 0;
+			return false;
+		}
+
+		if (entry.indexSize != sizeof(uint16_t) && entry.indexSize != sizeof(uint32_t))
+		{
+			std::cerr << "WZMBinaryView::open - Unsupported index size " << entry.indexSize << " in mesh " << i;
+			m_header = 0;
+			return false;
+		}
+
+		if (!checkBlob(entry.vertexOffset, entry.vertexCount, 3 * sizeof(float)) ||
+			!checkBlob(entry.uvOffset, entry.vertexCount, 2 * sizeof(float)) ||
+			!checkBlob(entry.normalOffset, entry.vertexCount, 3 * sizeof(float)) ||
+			!checkBlob(entry.tangentOffset, entry.vertexCount, 4 * sizeof(float)) ||
+			!checkBlob(entry.indexOffset, entry.triangleCount, 3 * entry.indexSize) ||
+			!checkBlob(entry.connectorOffset, entry.connectorCount, 3 * sizeof(float)))
+		{
+			std::cerr << "WZMBinaryView::open - Data of mesh " << i << " out of bounds";
+			m_header = 0;
+			return false;
+		}
+	}
+
+	return true;
+}
+
+const WZMBHeader& WZMBinaryView::header() const
+{
+	return *m_header;
+}
+
+unsigned WZMBinaryView::meshes() const
+{
+	return m_header ? m_header->meshCount : 0;
+}
+
+const WZMBMeshEntry& WZMBinaryView::meshEntry(unsigned index) const
+{
+	return m_meshes[index];
+}
+
+const char* WZMBinaryView::string(uint32_t offset) const
+{
+	if (offset == WZMB_NO_STRING)
+	{
+		return "";
+	}
+	return m_data + m_header->stringTableOffset + offset;
+}
+
+const char* WZMBinaryView::blob(uint32_t offset) const
+{
+	return m_data + offset;
+}
+
+bool WZMBinaryView::checkString(uint32_t offset) const
+{
+	// the table itself is known to end with a NUL
+	return offset == WZMB_NO_STRING || offset < m_header->stringTableSize;
+}
+
+bool WZMBinaryView::checkBlob(uint32_t offset, uint64_t count, uint64_t elementSize) const
+{
+	if (!count)
+	{
+		return true;
+	}
+	return offset % sizeof(float) == 0 && static_cast<uint64_t>(offset) + count * elementSize <= m_size;
+}
@@ -0,0 +1,132 @@
+/*
+	Copyright 2010 Warzone 2100 Project
+
+	This file is part of WMIT.
+
+	WMIT is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	WMIT is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with WMIT.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef WZMBINARY_HPP
+#define WZMBINARY_HPP
+
+#include <cstddef>
+#include <iostream>
+
+#include <stdint.h>
+
+#include "WZM.hpp"
+
+/*
+ * Binary WZM (.wzmb) layout, all values in host byte order:
+ *
+ *	WZMBHeader
+ *	WZMBMeshEntry[meshCount]	at meshTableOffset
+ *	string table			at stringTableOffset, NUL terminated strings
+ *	per mesh blobs			each at an WZMB_ALIGNMENT aligned offset
+ *
+ * Blobs have exactly the in-memory layout of the Mesh arrays (packed
+ * GLfloat x,y,z / u,v / x,y,z / x,y,z,w vectors and index triplets), so they
+ * can be copied in one go or pointed at directly from GL.
+ * All offsets are absolute file offsets, which limits files to 4GB.
+ */
+
+#define WZMB_MODEL_SIGNATURE "WZMB"
+#define WZMB_MODEL_VERSION 1
+#define WZMB_BYTEORDER_MARK 0x01020304u
+#define WZMB_ALIGNMENT 16
+#define WZMB_NO_STRING 0xFFFFFFFFu
+
+enum wzmb_mesh_flags_t {WZMB_MESH_TEAMCOLOURS = 0x1};
+
+struct WZMBHeader
+{
+	char signature[4];
+	uint32_t version;
+	uint32_t byteOrder;
+	uint32_t fileSize;
+
+	uint32_t meshCount;
+	uint32_t meshTableOffset;
+	uint32_t stringTableOffset;
+	uint32_t stringTableSize;
+
+	uint32_t textures[WZM_TEX__LAST];	// string table offsets or WZMB_NO_STRING
+
+	float material[WZM_MAT__LAST][4];
+	float shininess;
+	uint32_t reserved[3];
+};
+
+struct WZMBMeshEntry
+{
+	uint32_t name;			// string table offset
+	uint32_t flags;
+	uint32_t vertexCount;
+	uint32_t triangleCount;
+	uint32_t connectorCount;
+	uint32_t indexSize;		// bytes per index
+
+	uint32_t vertexOffset;
+	uint32_t uvOffset;
+	uint32_t normalOffset;
+	uint32_t tangentOffset;
+	uint32_t indexOffset;
+	uint32_t connectorOffset;
+
+	float aabbMin[3], aabbMax[3];
+	float tspcenter[3], weightcenter[3];
+};
+
+inline uint64_t wzmbAlign(uint64_t offset)
+{
+	return (offset + WZMB_ALIGNMENT - 1) & ~static_cast<uint64_t>(WZMB_ALIGNMENT - 1);
+}
+
+/// Writes zero bytes until pos reaches target
+void wzmbPad(std::ostream& out, uint64_t& pos, uint64_t target);
+void wzmbWrite(std::ostream& out, uint64_t& pos, const void* data, size_t size);
+
+/**
+  * Validated view on a binary WZM image in memory (usually a MappedFile).
+  *
+  * open() checks the header and that every section and blob lies within the
+  * image, after that the accessors hand out pointers straight into it.
+  * Index values are not checked here, see Mesh::readBinary.
+  */
+class WZMBinaryView
+{
+public:
+	WZMBinaryView();
+
+	bool open(const char* data, size_t size);
+
+	const WZMBHeader& header() const;
+	unsigned meshes() const;
+	const WZMBMeshEntry& meshEntry(unsigned index) const;
+
+	/// Returns an empty string for WZMB_NO_STRING
+	const char* string(uint32_t offset) const;
+
+	const char* blob(uint32_t offset) const;
+
+private:
+	bool checkString(uint32_t offset) const;
+	bool checkBlob(uint32_t offset, uint64_t count, uint64_t elementSize) const;
+
+	const char* m_data;
+	size_t m_size;
+	const WZMBHeader* m_header;
+	const WZMBMeshEntry* m_meshes;
+};
+
+#endif // WZMBINARY_HPP
@@ -23,21 +23,32 @@
 #include <QSettings>
 
 #include <fstream>
+#include <iostream>
+#include <cstring>
 
 #include "MainWindow.hpp"
 #include "WZM.hpp"
 #include "Pie.hpp"
+#include "BatchConvert.hpp"
+#include "ModelIO.hpp"
 #include "wmit.h"
 
 int main(int argc, char *argv[])
 {
 	QTextCodec::setCodecForCStrings(QTextCodec::codecForLocale());
 
-	if (argc > 2)
+	if (argc > 1 && std::strcmp(argv[1], "--batch") == 0)
+	{
+		// command line batch conversion mode
+		return runBatchConversion(std::vector<std::string>(argv + 2, argv + argc));
+	}
+	else if (argc > 2)
 	{
 		// command line conversion mode
-		QString inname = argv[1];
-		QString outname = argv[2];
+		const bool overdraw = std::strcmp(argv[1], "--overdraw") == 0;
+		const bool optimize = overdraw || std::strcmp(argv[1], "--forsyth") == 0;
+		QString inname = argv[1 + optimize];
+		QString outname = argv[2 + optimize];
 
 		wmit_filetype_t outtype;
 
@@ -49,6 +60,13 @@ int main(int argc, char *argv[])
 		if (!MainWindow::loadModel(inname, model))
 			return 1;
 
+		if (optimize)
+		{
+			if (!optimizeModel(model, overdraw, std::cout))
+				return 1;
+			std::cout << std::endl;
+		}
+
 		return !MainWindow::saveModel(outname, model, outtype);
 	}
 	else
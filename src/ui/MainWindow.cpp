@@ -24,17 +24,29 @@
 #include "ExportDialog.hpp"
 #include "TextureDialog.h"
 #include "UVEditor.hpp"
+#include "ModelLoader.hpp"
 
+#include <algorithm>
 #include <fstream>
+#include <iostream>
 
 #include <QFileInfo>
 #include <QFileDialog>
 #include <QDir>
+#include <QStatusBar>
+#include <QProgressBar>
+#include <QPushButton>
+#include <QInputDialog>
+#include <QMessageBox>
+#include <QTime>
 
 #include <QtDebug>
 #include <QVariant>
 
 #include "Pie.hpp"
+#include "ModelIO.hpp"
+#include "VertexCache.hpp"
+#include "Overdraw.hpp"
 
 MainWindow::MainWindow(QWidget *parent) :
 	QMainWindow(parent),
@@ -45,7 +57,10 @@ MainWindow::MainWindow(QWidget *parent) :
 	m_textureDialog(new TextureDialog(this)),
 	m_UVEditor(new UVEditor(this)),
 	m_settings(new QSettings(this)),
-	m_shaderSignalMapper(new QSignalMapper(this))
+	m_shaderSignalMapper(new QSignalMapper(this)),
+	m_loader(new ModelLoader(this)),
+	m_loadProgress(new QProgressBar(this)),
+	m_loadCancel(new QPushButton(tr("Cancel"), this))
 {
 	ui->setupUi(this);
 
@@ -60,12 +75,26 @@ MainWindow::MainWindow(QWidget *parent) :
 	m_UVEditor->hide();
 	this->addDockWidget(Qt::LeftDockWidgetArea, m_UVEditor, Qt::Horizontal);
 
+	// shown while a model loads in the background
+	m_loadProgress->setRange(0, 100);
+	m_loadProgress->hide();
+	m_loadCancel->hide();
+	statusBar()->addPermanentWidget(m_loadProgress);
+	statusBar()->addPermanentWidget(m_loadCancel);
+
 
 	connect(ui->centralWidget, SIGNAL(viewerInitialized()), this, SLOT(_on_viewerInitialized()));
 	connect(ui->actionAboutQt, SIGNAL(triggered()), QApplication::instance(), SLOT(aboutQt()));
 	connect(ui->actionShowAxes, SIGNAL(toggled(bool)), ui->centralWidget, SLOT(setAxisIsDrawn(bool)));
 	connect(ui->actionShowGrid, SIGNAL(toggled(bool)), ui->centralWidget, SLOT(setGridIsDrawn(bool)));
 	connect(ui->actionShowLightSource, SIGNAL(toggled(bool)), ui->centralWidget, SLOT(setDrawLightSource(bool)));
+	connect(ui->actionCullHiddenGeometry, SIGNAL(toggled(bool)), ui->centralWidget, SLOT(setCulling(bool)));
+	connect(ui->actionShowFrameStats, SIGNAL(toggled(bool)), ui->centralWidget, SLOT(setDrawFrameStats(bool)));
+
+	// background loading
+	connect(m_loader, SIGNAL(progress(qlonglong,qlonglong,int)), this, SLOT(_on_loadProgress(qlonglong,qlonglong,int)));
+	connect(m_loader, SIGNAL(finished()), this, SLOT(_on_modelLoaded()));
+	connect(m_loadCancel, SIGNAL(clicked()), m_loader, SLOT(cancel()));
 
 	// transformations
 	connect(transformDock, SIGNAL(scaleXYZChanged(double)), this, SLOT(_on_scaleXYZChanged(double)));
@@ -78,6 +107,9 @@ MainWindow::MainWindow(QWidget *parent) :
 	connect(transformDock, SIGNAL(setActiveMeshIdx(int)), &m_model, SLOT(setActiveMesh(int)));
 	connect(transformDock, SIGNAL(removeMeshIdx(int)), this, SLOT(_on_removeMesh(int)));
 	connect(transformDock, SIGNAL(mirrorAxis(int)), this, SLOT(_on_mirrorAxis(int)));
+	connect(transformDock, SIGNAL(simplify(int,double)), this, SLOT(_on_simplify(int,double)));
+
+	m_assembly.setBase(&m_model);
 
 	clear();
 
@@ -92,6 +124,10 @@ MainWindow::~MainWindow()
 
 void MainWindow::clear()
 {
+	m_loader->cancel();
+	m_loadProgress->hide();
+	m_loadCancel->hide();
+	removeAttachments();
 	m_model.clear();
 	m_currentFile.clear();
 
@@ -101,6 +137,10 @@ void MainWindow::clear()
 	ui->actionSaveAs->setDisabled(true);
 	ui->actionSetupTextures->setDisabled(true);
 	ui->actionAppendModel->setDisabled(true);
+	ui->actionSceneGrid->setDisabled(true);
+	ui->actionSceneSingle->setDisabled(true);
+	ui->actionSceneBenchmark->setDisabled(true);
+	ui->actionSceneAttach->setDisabled(true);
 }
 
 bool MainWindow::openFile(const QString &filePath)
@@ -110,10 +150,51 @@ bool MainWindow::openFile(const QString &filePath)
 		return false;
 	}
 
+	// the current model stays up until the new one is read, see _on_modelLoaded()
+	m_loader->load(filePath);
+
+	m_loadProgress->setValue(0);
+	m_loadProgress->setFormat(tr("Loading %1: %p%").arg(QFileInfo(filePath).fileName()));
+	m_loadProgress->show();
+	m_loadCancel->show();
+	return true;
+}
+
+void MainWindow::_on_loadProgress(qlonglong bytes, qlonglong total, int meshes)
+{
+	const QString fileName = QFileInfo(m_loader->fileName()).fileName();
+
+	m_loadProgress->setValue(total > 0 ? static_cast<int>(bytes * 100 / total) : 0);
+	if (meshes > 0)
+	{
+		m_loadProgress->setFormat(tr("Loading %1: %p%, %2 meshes").arg(fileName, QString::number(meshes)));
+	}
+}
+
+void MainWindow::_on_modelLoaded()
+{
+	const QString filePath = m_loader->fileName();
 	WZM tmpmodel;
-	if (loadModel(filePath, tmpmodel))
+
+	// finished() of a load that got replaced by another one
+	if (!m_loader->isFinished())
+	{
+		return;
+	}
+
+	m_loadProgress->hide();
+	m_loadCancel->hide();
+
+	// already handled, or dropped by cancel()
+	if (filePath.isEmpty())
+	{
+		return;
+	}
+
+	if (m_loader->takeModel(tmpmodel))
 	{
 		QFileInfo modelFileNfo(filePath);
+		removeAttachments();
 		m_model = tmpmodel;
 		m_currentFile = modelFileNfo.absoluteFilePath();
 
@@ -122,87 +203,81 @@ bool MainWindow::openFile(const QString &filePath)
 		ui->actionSaveAs->setEnabled(true);
 		ui->actionSetupTextures->setEnabled(true);
 		ui->actionAppendModel->setEnabled(true);
+		ui->actionSceneGrid->setEnabled(true);
+		ui->actionSceneBenchmark->setEnabled(true);
+		ui->actionSceneAttach->setEnabled(true);
 
 		if (!fireTextureDialog(true))
 		{
 			clear();
-			return false;
 		}
 	}
-
-	return true;
-}
-
-bool MainWindow::guessModelTypeFromFilename(const QString& fname, wmit_filetype_t& type)
-{
-	QString ext = fname.right(fname.size() - fname.lastIndexOf('.') - 1);
-
-	if (ext.compare(QString("wzm"), Qt::CaseInsensitive) == 0)
+	else if (m_loader->cancelled())
 	{
-		type = WMIT_FT_WZM;
-	}
-	else if (ext.compare(QString("obj"), Qt::CaseInsensitive) == 0)
-	{
-		type = WMIT_FT_OBJ;
-	}
-	else if (ext.compare(QString("pie"), Qt::CaseInsensitive) == 0)
-	{
-		type = WMIT_FT_PIE;
+		statusBar()->showMessage(tr("Loading %1 cancelled").arg(QFileInfo(filePath).fileName()));
 	}
 	else
 	{
-		return false;
+		statusBar()->showMessage(tr("Unable to load %1").arg(QFileInfo(filePath).fileName()));
 	}
+}
 
-	return true;
+bool MainWindow::guessModelTypeFromFilename(const QString& fname, wmit_filetype_t& type)
+{
+	return guessModelType(fname.toLocal8Bit().constData(), type);
 }
 
 bool MainWindow::saveModel(const QString &file, const WZM &model, const wmit_filetype_t &type)
 {
-	std::ofstream out;
-	out.open(file.toLocal8Bit().constData());
-
-	switch (type)
-	{
-	case WMIT_FT_WZM:
-		model.write(out);
-		break;
-	case WMIT_FT_OBJ:
-		model.exportToOBJ(out);
-		break;
-	case WMIT_FT_PIE:
-	default:
-		Pie3Model p3 = model;
-		p3.write(out);
-	}
-
-	out.close();
-
-	return true;
+	return ::saveModel(file.toLocal8Bit().constData(), model, type);
 }
 
 bool MainWindow::saveModel(const QString &file, const QWZM &model, const wmit_filetype_t &type)
 {
 	std::ofstream out;
-	out.open(file.toLocal8Bit().constData());
+	Pie3Model p3;
+	bool write_success = true;
+
+	// see ::saveModel()
+	if (type == WMIT_FT_PIE)
+	{
+		p3 = model;
+		if (!p3.fitsPointIndices())
+		{
+			std::cerr << "MainWindow::saveModel - A mesh has more than " << Pie3Level::maxPoints()
+				  << " points, too many for PIE" << std::endl;
+			return false;
+		}
+	}
+
+	if (type == WMIT_FT_WZMB)
+	{
+		out.open(file.toLocal8Bit().constData(), std::ios::out | std::ios::binary);
+	}
+	else
+	{
+		out.open(file.toLocal8Bit().constData());
+	}
 
 	switch (type)
 	{
 	case WMIT_FT_WZM:
 		model.write(out);
 		break;
+	case WMIT_FT_WZMB:
+		write_success = model.writeBinary(out);
+		break;
 	case WMIT_FT_OBJ:
 		model.exportToOBJ(out);
 		break;
 	case WMIT_FT_PIE:
 	default:
-		Pie3Model p3 = model;
 		p3.write(out);
 	}
 
 	out.close();
 
-	return true;
+	return write_success && !out.fail();
 }
 
 void MainWindow::changeEvent(QEvent *e)
@@ -220,67 +295,31 @@ void MainWindow::changeEvent(QEvent *e)
 
 bool MainWindow::loadModel(const QString& file, WZM& model)
 {
-	wmit_filetype_t type;
-
-	if (!guessModelTypeFromFilename(file, type))
-	{
-		return false;
-	}
-
-	bool read_success = false;
-	std::ifstream f;
-
-	f.open(file.toLocal8Bit(), std::ios::in | std::ios::binary);
-
-	switch (type)
-	{
-	case WMIT_FT_WZM:
-		read_success = model.read(f);
-		break;
-	case WMIT_FT_OBJ:
-		read_success = model.importFromOBJ(f);
-		break;
-	case WMIT_FT_PIE:
-	default:
-		int pieversion = pieVersion(f);
-		if (pieversion <= 2)
-		{
-			Pie2Model p2;
-			read_success = p2.read(f);
-			if (read_success)
-				model = WZM(Pie3Model(p2));
-		}
-		else // 3 or higher
-		{
-			Pie3Model p3;
-			read_success = p3.read(f);
-			if (read_success)
-				model = WZM(p3);
-		}
-	}
-
-	f.close();
-
-	return read_success;
+	return ::loadModel(file.toLocal8Bit().constData(), model);
 }
 
 bool MainWindow::fireTextureDialog(const bool reinit)
+{
+	return fireTextureDialog(m_model, m_currentFile, reinit);
+}
+
+bool MainWindow::fireTextureDialog(QWZM& model, const QString& modelFile, const bool reinit)
 {
 	QMap<wzm_texture_type_t, QString> texmap;
 
 	if (reinit)
 	{
-		m_model.getTexturesMap(texmap);
+		model.getTexturesMap(texmap);
 		m_textureDialog->setTexturesMap(texmap);
-		m_textureDialog->createTextureIcons(m_pathImport, m_currentFile);
+		m_textureDialog->createTextureIcons(m_pathImport, modelFile);
 	}
 
 	if (m_textureDialog->exec() == QDialog::Accepted)
 	{
 		QMap<wzm_texture_type_t, QString>::const_iterator it;
 
-		m_model.clearTextureNames();
-		m_model.clearGLRenderTextures();
+		model.clearTextureNames();
+		model.clearGLRenderTextures();
 
 		m_textureDialog->getTexturesFilepath(texmap);
 		for (it = texmap.begin(); it != texmap.end(); ++it)
@@ -288,8 +327,8 @@ bool MainWindow::fireTextureDialog(const bool reinit)
 			if (!it.value().isEmpty())
 			{
 				QFileInfo texFileNfo(it.value());
-				m_model.loadGLRenderTexture(it.key(), texFileNfo.filePath());
-				m_model.setTextureName(it.key(), texFileNfo.fileName().toStdString());
+				model.loadGLRenderTexture(it.key(), texFileNfo.filePath());
+				model.setTextureName(it.key(), texFileNfo.fileName().toStdString());
 			}
 		}
 
@@ -305,8 +344,9 @@ void MainWindow::on_actionOpen_triggered()
 	QFileDialog* fileDialog = new QFileDialog(this,
 						  tr("Select File to open"),
 						  m_pathImport,
-						  tr("All Compatible (*.wzm *.pie *.obj);;"
+						  tr("All Compatible (*.wzm *.wzmb *.pie *.obj);;"
 						     "WZM models (*.wzm);;"
+						     "Binary WZM models (*.wzmb);;"
 						     "PIE models (*.pie);;"
 						     "OBJ files (*.obj)"));
 	fileDialog->setFileMode(QFileDialog::ExistingFile);
@@ -348,6 +388,7 @@ void MainWindow::on_actionSaveAs_triggered()
 	fDialog->setAcceptMode(QFileDialog::AcceptSave);
 	fDialog->setFilter("PIE models (*.pie);;"
 			   "WZM models (*.wzm);;"
+			   "Binary WZM models (*.wzmb);;"
 			   "OBJ files (*.obj)");
 	fDialog->setWindowTitle(tr("Choose output file"));
 	fDialog->setDefaultSuffix("pie");
@@ -369,8 +410,7 @@ void MainWindow::on_actionSaveAs_triggered()
 		return;
 	}
 
-/* Disabled till ready
-	if (type == PIE)
+	if (type == WMIT_FT_PIE)
 	{
 		exportDialog = new PieExportDialog(this);
 		exportDialog->exec();
@@ -381,20 +421,46 @@ void MainWindow::on_actionSaveAs_triggered()
 		exportDialog->exec();
 	}
 
-	if (exportDialog->result() != QDialog::Accepted)
+	const bool accepted = exportDialog->result() == QDialog::Accepted;
+	const int optimisation = exportDialog->optimisationSelected();
+	const bool optimize = optimisation == 0 || optimisation == 2;
+	const bool overdraw = optimisation == 2;
+
+	delete exportDialog;
+	exportDialog = NULL;
+
+	if (!accepted)
 	{
 		return;
 	}
 
-	if (exportDialog->optimisationSelected() == 0)
+	if (optimize)
 	{
-//		model.optimizeForsyth();
+		const VertexCacheStats before = m_model.vertexCacheStats();
+		const OverdrawStats overdrawBefore = overdraw ? m_model.overdrawStats() : OverdrawStats();
+		QString message;
+
+		m_model.optimizeForsyth();
+		if (overdraw)
+		{
+			m_model.optimizeOverdraw();
+			const OverdrawStats overdrawAfter = m_model.overdrawStats();
+
+			message = tr(", overdraw %1 -> %2")
+				  .arg(overdrawBefore.overdraw(), 0, 'f', 3).arg(overdrawAfter.overdraw(), 0, 'f', 3);
+		}
+
+		const VertexCacheStats after = m_model.vertexCacheStats();
+
+		statusBar()->showMessage(tr("Vertex cache optimized: ACMR %1 -> %2, ATVR %3 -> %4")
+					 .arg(before.acmr(), 0, 'f', 3).arg(after.acmr(), 0, 'f', 3)
+					 .arg(before.atvr(), 0, 'f', 3).arg(after.atvr(), 0, 'f', 3) + message);
 	}
-	delete exportDialog;
-	exportDialog = NULL;
-*/
 
-	saveModel(fDialog->selectedFiles().first(), m_model, type);
+	if (!saveModel(fDialog->selectedFiles().first(), m_model, type))
+	{
+		statusBar()->showMessage(tr("Unable to save %1").arg(fDialog->selectedFiles().first()));
+	}
 }
 
 void MainWindow::_on_viewerInitialized()
@@ -455,6 +521,14 @@ void MainWindow::_on_viewerInitialized()
 	connect(m_shaderSignalMapper, SIGNAL(mapped(int)),
 		     this, SLOT(_on_shaderActionTriggered(int)));
 
+	// not a renderer choice, QWZM picks it up for instanced draws
+	if (GLEE_ARB_draw_instanced)
+	{
+		ui->centralWidget->loadShader(WZ_SHADER_INSTANCED, WMIT_SHADER_INSTANCED_DEFPATH_VERT,
+					      WMIT_SHADER_INSTANCED_DEFPATH_FRAG);
+	}
+	ui->actionSceneInstancing->setEnabled(ui->centralWidget->hasShader(WZ_SHADER_INSTANCED));
+
 	QMenu* rendererMenu = new QMenu(this);
 	rendererMenu->addActions(shaderGroup->actions());
 
@@ -473,17 +547,25 @@ void MainWindow::_on_viewerInitialized()
 		&m_model, SLOT(setDrawCenterPointFlag(bool)));
 	connect(ui->actionShowNormals, SIGNAL(triggered(bool)),
 		&m_model, SLOT(setDrawNormalsFlag(bool)));
+	connect(ui->actionShowClusters, SIGNAL(triggered(bool)),
+		&m_model, SLOT(setDrawClustersFlag(bool)));
 }
 
 void MainWindow::_on_shaderActionTriggered(int type)
 {
-	if (static_cast<wz_shader_type_t>(type) != WZ_SHADER_NONE)
-	{
-		m_model.setActiveShader(static_cast<wz_shader_type_t>(type));
-	}
-	else
+	QList<QWZM*> models = m_attachmentModels.values();
+
+	models.prepend(&m_model);
+	foreach (QWZM* model, models)
 	{
-		m_model.disableShaders();
+		if (static_cast<wz_shader_type_t>(type) != WZ_SHADER_NONE)
+		{
+			model->setActiveShader(static_cast<wz_shader_type_t>(type));
+		}
+		else
+		{
+			model->disableShaders();
+		}
 	}
 }
 
@@ -532,6 +614,15 @@ void MainWindow::_on_removeMesh(int mesh)
 	ui->centralWidget->updateGL();
 }
 
+void MainWindow::_on_simplify(int mesh, double ratio)
+{
+	const unsigned before = m_model.triangles();
+
+	m_model.simplify(ratio, 1.f, mesh);
+	statusBar()->showMessage(tr("Simplified: %1 -> %2 triangles").arg(before).arg(m_model.triangles()));
+	ui->centralWidget->updateGL();
+}
+
 void MainWindow::on_actionClose_triggered()
 {
 	clear();
@@ -547,14 +638,15 @@ void MainWindow::on_actionSetupTextures_triggered()
 	fireTextureDialog();
 }
 
-void MainWindow::on_actionAppendModel_triggered()
+QString MainWindow::getModelFileName(const QString& caption)
 {
 	QString filePath;
 	QFileDialog* fileDialog = new QFileDialog(this,
-						  tr("Select file to append"),
+						  caption,
 						  m_pathImport,
-						  tr("All Compatible (*.wzm *.pie *.obj);;"
+						  tr("All Compatible (*.wzm *.wzmb *.pie *.obj);;"
 						     "WZM models (*.wzm);;"
+						     "Binary WZM models (*.wzmb);;"
 						     "PIE models (*.pie);;"
 						     "OBJ files (*.obj)"));
 	fileDialog->setFileMode(QFileDialog::ExistingFile);
@@ -567,6 +659,13 @@ void MainWindow::on_actionAppendModel_triggered()
 	delete fileDialog;
 	fileDialog = 0;
 
+	return filePath;
+}
+
+void MainWindow::on_actionAppendModel_triggered()
+{
+	const QString filePath = getModelFileName(tr("Select file to append"));
+
 	if (!filePath.isEmpty())
 	{
 		WZM newmodel;
@@ -585,3 +684,264 @@ void MainWindow::on_actionTakeScreenshot_triggered()
 {
 	ui->centralWidget->saveSnapshot(false);
 }
+
+void MainWindow::on_actionSceneGrid_triggered()
+{
+	bool ok;
+	const int count = QInputDialog::getInt(this, tr("Instance Grid"), tr("Copies of the model:"),
+					       100, 1, 100000, 1, &ok);
+
+	if (ok)
+	{
+		fillSceneGrid(count);
+		updateRenderList();
+	}
+}
+
+void MainWindow::on_actionSceneSingle_triggered()
+{
+	m_scene.clear();
+	updateRenderList();
+}
+
+void MainWindow::on_actionSceneInstancing_toggled(bool checked)
+{
+	m_scene.setInstancing(checked);
+	m_assembly.setInstancing(checked);
+	ui->centralWidget->updateGL();
+}
+
+void MainWindow::on_actionSceneBenchmark_triggered()
+{
+	static const unsigned counts[] = {1, 100, 10000};
+	const QWZMScene previous = m_scene;
+	const bool hardware = ui->actionSceneInstancing->isEnabled();
+	QStringList report;
+	unsigned i;
+	int mode;
+
+	for (i = 0; i < sizeof(counts) / sizeof(counts[0]); ++i)
+	{
+		fillSceneGrid(counts[i]);
+		updateRenderList();
+
+		for (mode = hardware ? 0 : 1; mode < 2; ++mode)
+		{
+			m_scene.setInstancing(mode == 0);
+			report << tr("%1 copies, %2: %3 ms/frame").arg(counts[i])
+				  .arg(mode == 0 ? tr("instanced") : tr("one by one"))
+				  .arg(measureFrameTime(20), 0, 'f', 2);
+		}
+	}
+
+	m_scene = previous;
+	m_scene.setInstancing(ui->actionSceneInstancing->isChecked());
+	updateRenderList();
+
+	if (!hardware)
+	{
+		report << tr("Hardware instancing isn't available here.");
+	}
+	report << tr("Frame times include the swap, vertical sync may cap them.");
+	QMessageBox::information(this, tr("Instancing Benchmark"), report.join("\n"));
+}
+
+void MainWindow::on_actionSceneAttach_triggered()
+{
+	QStringList mounts;
+	QList<QPair<int, int> > targets;
+	int part, conn;
+	bool ok;
+
+	for (part = 0; part < (int)m_assembly.parts(); ++part)
+	{
+		for (conn = 0; conn < m_assembly.model(part)->connectorCount(); ++conn)
+		{
+			mounts << tr("%1 (part %2), connector %3").arg(partName(part)).arg(part + 1).arg(conn + 1);
+			targets.append(qMakePair(part, conn));
+		}
+	}
+
+	if (mounts.isEmpty())
+	{
+		QMessageBox::information(this, tr("Attach at Connector"), tr("There are no connectors to attach to."));
+		return;
+	}
+
+	const QString mount = QInputDialog::getItem(this, tr("Attach at Connector"), tr("Mount point:"),
+						    mounts, 0, false, &ok);
+	if (!ok)
+	{
+		return;
+	}
+
+	const QString filePath = getModelFileName(tr("Select part to attach"));
+	if (filePath.isEmpty())
+	{
+		return;
+	}
+
+	QWZM* model = loadAttachment(filePath);
+	const QPair<int, int> target = targets.at(mounts.indexOf(mount));
+
+	if (model && m_assembly.attach(target.first, target.second, model) >= 0)
+	{
+		m_attachmentFiles.append(QFileInfo(filePath).absoluteFilePath());
+		ui->actionSceneDetachLast->setEnabled(true);
+		ui->actionSceneDetachAll->setEnabled(true);
+
+		// copies in the scene show the old assembly
+		m_scene.clear();
+		updateRenderList();
+	}
+}
+
+void MainWindow::on_actionSceneDetachLast_triggered()
+{
+	// parts only hang off earlier ones, so the last has nothing mounted on it
+	const QString file = m_attachmentFiles.takeLast();
+
+	m_scene.clear();
+	m_assembly.detach(m_assembly.parts() - 1);
+	if (!m_attachmentFiles.contains(file))
+	{
+		delete m_attachmentModels.take(file);
+	}
+
+	ui->actionSceneDetachLast->setEnabled(!m_attachmentFiles.isEmpty());
+	ui->actionSceneDetachAll->setEnabled(!m_attachmentFiles.isEmpty());
+	updateRenderList();
+}
+
+void MainWindow::on_actionSceneDetachAll_triggered()
+{
+	removeAttachments();
+}
+
+/// Attachments loaded from the same file share one model, textures are only asked for the first time
+QWZM* MainWindow::loadAttachment(const QString& filePath)
+{
+	const QString key = QFileInfo(filePath).absoluteFilePath();
+	WZM tmpmodel;
+
+	if (m_attachmentModels.contains(key))
+	{
+		return m_attachmentModels.value(key);
+	}
+
+	if (!loadModel(filePath, tmpmodel))
+	{
+		return 0;
+	}
+
+	QWZM* model = new QWZM(this);
+	*model = tmpmodel;
+
+	// not in the render list on its own, so it doesn't get the view's managers from there
+	model->setTextureManager(ui->centralWidget);
+	model->setShaderManager(ui->centralWidget);
+	if (m_model.getActiveShader() != WZ_SHADER_NONE)
+	{
+		model->setActiveShader(m_model.getActiveShader());
+	}
+
+	if (!fireTextureDialog(*model, key, true))
+	{
+		delete model;
+		return 0;
+	}
+
+	m_attachmentModels.insert(key, model);
+	return model;
+}
+
+void MainWindow::removeAttachments()
+{
+	const bool shown = !m_scene.empty() || !m_attachmentFiles.isEmpty();
+
+	m_scene.clear();
+	m_assembly.detachAll();
+	m_attachmentFiles.clear();
+	qDeleteAll(m_attachmentModels);
+	m_attachmentModels.clear();
+
+	ui->actionSceneDetachLast->setDisabled(true);
+	ui->actionSceneDetachAll->setDisabled(true);
+	if (shown)
+	{
+		updateRenderList();
+	}
+}
+
+QString MainWindow::partName(int part) const
+{
+	return QFileInfo(part ? m_attachmentFiles.at(part - 1) : m_currentFile).baseName();
+}
+
+void MainWindow::updateRenderList()
+{
+	ui->centralWidget->removeFromRenderList(&m_scene);
+	ui->centralWidget->removeFromRenderList(&m_assembly);
+	ui->centralWidget->removeFromRenderList(&m_model);
+
+	if (!m_scene.empty())
+	{
+		ui->centralWidget->addToRenderList(&m_scene);
+		ui->centralWidget->setSceneRadius(std::max(m_scene.radius(), 3.f));
+		ui->centralWidget->showEntireScene();
+		statusBar()->showMessage(tr("Scene: %1 copies of %2 parts").arg(m_scene.instances() / m_assembly.parts())
+					 .arg(m_assembly.parts()));
+	}
+	else if (m_assembly.parts() > 1)
+	{
+		ui->centralWidget->addToRenderList(&m_assembly);
+		ui->centralWidget->setSceneRadius(std::max(m_assembly.radius(), 3.f));
+	}
+	else
+	{
+		ui->centralWidget->addToRenderList(&m_model);
+		ui->centralWidget->setSceneRadius(3);
+	}
+
+	ui->actionSceneSingle->setEnabled(!m_scene.empty());
+	ui->centralWidget->updateGL();
+}
+
+/// Copies of the whole assembly, which is just m_model if nothing is attached
+void MainWindow::fillSceneGrid(unsigned count)
+{
+	const std::vector<Matrix4> placements = QWZMScene::gridPlacements(count, sceneGridSpacing());
+	std::vector<Matrix4>::const_iterator it;
+
+	m_scene.clear();
+	for (it = placements.begin(); it != placements.end(); ++it)
+	{
+		m_assembly.addToScene(m_scene, *it);
+	}
+}
+
+GLfloat MainWindow::sceneGridSpacing()
+{
+	// some room between neighbours, and never 0 for an empty model
+	return std::max(m_assembly.radius() * 2.5f, 0.1f);
+}
+
+/// Average of frames redraws, measured after one to get buffer uploads out of the way
+double MainWindow::measureFrameTime(int frames)
+{
+	QTime timer;
+
+	ui->centralWidget->updateGL();
+	ui->centralWidget->makeCurrent();
+	glFinish();
+
+	timer.start();
+	for (int i = 0; i < frames; ++i)
+	{
+		ui->centralWidget->updateGL();
+	}
+	ui->centralWidget->makeCurrent();
+	glFinish();
+
+	return timer.elapsed() / static_cast<double>(frames);
+}
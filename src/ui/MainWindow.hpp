@@ -23,13 +23,17 @@
 
 #include <QString>
 #include <QList>
+#include <QMap>
 #include <QSet>
+#include <QStringList>
 #include <QPair>
 
 #include <QSettings>
 #include <QSignalMapper>
 
 #include "QWZM.hpp"
+#include "QWZMScene.hpp"
+#include "QWZMAssembly.hpp"
 #include "wmit.h"
 
 class TransformDock;
@@ -37,6 +41,9 @@ class ImportDialog;
 class ExportDialog;
 class TextureDialog;
 class UVEditor;
+class ModelLoader;
+class QProgressBar;
+class QPushButton;
 
 namespace Ui {
 	class MainWindow;
@@ -50,6 +57,7 @@ public:
 
 	void clear();
 
+	/// Starts loading file in the background, the model is replaced once it's read
 	bool openFile(const QString& file);
 
 	static bool loadModel(const QString& file, WZM& model);
@@ -69,8 +77,17 @@ private slots:
 	void on_actionSetupTextures_triggered();
 	void on_actionAppendModel_triggered();
 	void on_actionTakeScreenshot_triggered();
+	void on_actionSceneGrid_triggered();
+	void on_actionSceneSingle_triggered();
+	void on_actionSceneInstancing_toggled(bool);
+	void on_actionSceneBenchmark_triggered();
+	void on_actionSceneAttach_triggered();
+	void on_actionSceneDetachLast_triggered();
+	void on_actionSceneDetachAll_triggered();
 
 	void _on_viewerInitialized();
+	void _on_loadProgress(qlonglong bytes, qlonglong total, int meshes);
+	void _on_modelLoaded();
 	void _on_shaderActionTriggered(int);
 
 	// transformations
@@ -81,6 +98,7 @@ private slots:
 	void _on_reverseWindings(int mesh);
 	void _on_mirrorAxis(int axis);
 	void _on_removeMesh(int mesh);
+	void _on_simplify(int mesh, double ratio);
 
 private:
 	Ui::MainWindow* ui;
@@ -94,11 +112,32 @@ private:
 	QSettings* m_settings;
 
 	QSignalMapper *m_shaderSignalMapper;
+
+	ModelLoader* m_loader;
+	QProgressBar* m_loadProgress;
+	QPushButton* m_loadCancel;
+
 	QString m_pathImport, m_pathExport, m_currentFile;
 
 	QWZM m_model;
+	QWZMScene m_scene;
+	QWZMAssembly m_assembly;	// m_model is the base
+	QMap<QString, QWZM*> m_attachmentModels;	// by file, shared by the parts made from it
+	QStringList m_attachmentFiles;	// file of each part after the base
 
 	bool fireTextureDialog(const bool reinit = false);
+	bool fireTextureDialog(QWZM& model, const QString& modelFile, const bool reinit);
+	QString getModelFileName(const QString& caption);
+
+	QWZM* loadAttachment(const QString& filePath);
+	void removeAttachments();
+	QString partName(int part) const;
+
+	// draws m_scene if it has copies, else m_assembly if anything is attached, else m_model
+	void updateRenderList();
+	void fillSceneGrid(unsigned count);
+	GLfloat sceneGridSpacing();
+	double measureFrameTime(int frames);
 };
 
 #endif // MAINWINDOW_HPP
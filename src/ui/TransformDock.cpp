@@ -208,3 +208,8 @@ void TransformDock::on_removeMeshButton_clicked()
 {
 	emit removeMeshIdx(m_selected_mesh);
 }
+
+void TransformDock::on_simplifyButton_clicked()
+{
+	emit simplify(m_selected_mesh, ui->simplifySpinBox->value() / 100.);
+}
@@ -42,6 +42,7 @@ signals:
 	void scaleZChanged(double);
 	void reverseWindings(int mesh);
 	void mirrorAxis(int);
+	void simplify(int mesh, double ratio);
 
 	void applyTransformations();
 	void setActiveMeshIdx(int);
@@ -73,6 +74,7 @@ private slots:
 	void on_mirrorYButton_clicked();
 	void on_mirrorZButton_clicked();
 	void on_removeMeshButton_clicked();
+	void on_simplifyButton_clicked();
 };
 
 #endif // TRANSFORMDOCK_HPP
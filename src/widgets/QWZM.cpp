@@ -20,6 +20,10 @@
 #include "QWZM.hpp"
 #include "Pie.hpp"
 
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+
 #include "QtGLView.hpp"
 
 #ifdef CPP0X_AVAILABLE
@@ -32,8 +36,54 @@ static const char tangentAtributeName[] = "tangent";
 
 const GLint QWZM::winding = GL_CCW;
 
+// VBOs hold Mesh's interleaved layout as is
+static const GLsizei vboStride = sizeof(WZMInterleavedVertex);
+static const GLsizeiptr vboNormalOffset = offsetof(WZMInterleavedVertex, normal);
+static const GLsizeiptr vboUVOffset = offsetof(WZMInterleavedVertex, uv);
+static const GLsizeiptr vboTangentOffset = offsetof(WZMInterleavedVertex, tangent);
+
+// size of the instances array in instanced.vert, 16 matrices stay within the GL 2.0 uniform minimum
+static const GLsizei instancingBatch = 16;
+
+static inline const GLvoid* bufferOffset(GLsizeiptr offset)
+{
+	return reinterpret_cast<const GLvoid*>(offset);
+}
+
+static inline GLint flippedWinding(GLint winding)
+{
+	return winding == GL_CCW ? GL_CW : GL_CCW;
+}
+
+template <typename T>
+static void uploadIndices(const std::vector<IndexedTri>& tris)
+{
+	std::vector<T> indices;
+	std::vector<IndexedTri>::const_iterator it;
+
+	indices.reserve(tris.size() * 3);
+	for (it = tris.begin(); it != tris.end(); ++it)
+	{
+		indices.push_back(static_cast<T>(it->a()));
+		indices.push_back(static_cast<T>(it->b()));
+		indices.push_back(static_cast<T>(it->c()));
+	}
+	glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(T),
+		     indices.empty() ? 0 : &indices[0], GL_STATIC_DRAW);
+}
+
+// Spreads the meshlet ids over the hues so neighbours rarely look alike
+static void clusterColour(size_t meshlet)
+{
+	const unsigned hash = static_cast<unsigned>(meshlet) * 2654435761u;
+
+	glColor3ub(64 + (hash >> 24) % 192, 64 + (hash >> 16) % 192, 64 + (hash >> 8) % 192);
+}
+
 QWZM::QWZM(QObject *parent):
-	QObject(parent), m_tcmaskColour(0, 0x60, 0, 0xFF), m_drawNormals(false), m_drawCenterPoint(false)
+	QObject(parent), m_gl_buffers_context(0),
+	m_tcmaskColour(0, 0x60, 0, 0xFF), m_drawNormals(false), m_drawCenterPoint(false),
+	m_drawClusters(false), m_instancing(true)
 {
 	defaultConstructor();
 }
@@ -41,24 +91,54 @@ QWZM::QWZM(QObject *parent):
 QWZM::~QWZM()
 {
 	clear();
+
+	// buffers die with their context anyway, only clean up if we still can
+	if (m_gl_buffers_context && QGLContext::currentContext() == m_gl_buffers_context)
+	{
+		std::vector<GLMeshBuffers>::iterator it;
+		for (it = m_gl_buffers.begin(); it != m_gl_buffers.end(); ++it)
+		{
+			deleteGLBuffers(*it);
+		}
+	}
 }
 
 void QWZM::render()
 {
-	GLint frontFace;
+	static const std::vector<Matrix4> single(1);
+
+	renderInstances(single);
+}
+
+void QWZM::renderInstances(const std::vector<Matrix4>& instances)
+{
+	std::vector<Matrix4>::const_iterator it;
+	GLint frontFace, cullFaceMode;
+
+	m_cullStats = CullStats();
+	if (instances.empty())
+	{
+		return;
+	}
+
 	glGetIntegerv(GL_FRONT_FACE, &frontFace);
 
 	glPushMatrix();
-	glPushAttrib(GL_TEXTURE_BIT);
+	glPushAttrib(GL_TEXTURE_BIT | GL_LIGHTING_BIT | GL_ENABLE_BIT);
 	glPushClientAttrib(GL_CLIENT_VERTEX_ARRAY_BIT);
 
-	glScalef(1/128.f, 1/128.f, 1/128.f); // Scale from warzone to fit in our scene. possibly a FIXME
-
-	// before shaders
-	if (m_drawCenterPoint)
-		drawCenterPoint();
-	if (m_drawNormals)
-		drawNormals();
+	// before shaders, the overlays only go around the first copy
+	if (m_drawCenterPoint || m_drawNormals)
+	{
+		glPushMatrix();
+		glMultMatrixf(instances.front().data());
+		glScalef(1/128.f, 1/128.f, 1/128.f);
+		if (m_drawCenterPoint)
+			drawCenterPoint();
+		if (m_drawNormals)
+			drawNormals();
+		glPopMatrix();
+	}
 
 	// actual draw code starts here
 
@@ -66,8 +146,17 @@ void QWZM::render()
 
 	QGLShaderProgram* shader = 0;
 
+	// clusters are shown untextured, lit with their colour as material
+	if (m_drawClusters)
+	{
+		glDisable(GL_TEXTURE_2D);
+		glColorMaterial(GL_FRONT, GL_AMBIENT_AND_DIFFUSE);
+		glEnable(GL_COLOR_MATERIAL);
+	}
+
 	// prepare shader data
-	if (setupTextureUnits(getActiveShader()))
+	const bool textured = !m_drawClusters && setupTextureUnits(getActiveShader());
+	if (textured)
 	{
 		if (!isFixedPipelineRenderer())
 		{
@@ -82,20 +171,113 @@ void QWZM::render()
 		}
 	}
 
+	// falls back to client side arrays
+	const bool useBuffers = prepareGLBuffers();
+
+	// the instancing shader stands in for the fixed pipeline only, cluster colours need a draw per meshlet
+	QGLShaderProgram* instancingShader = 0;
+	if (m_instancing && instances.size() > 1 && useBuffers && !shader && !m_drawClusters
+			&& GLEE_ARB_draw_instanced && m_shaderman && m_shaderman->hasShader(WZ_SHADER_INSTANCED))
+	{
+		instancingShader = m_shaderman->getShader(WZ_SHADER_INSTANCED);
+	}
+
 	glClientActiveTexture(GL_TEXTURE0);
 	glEnableClientState(GL_TEXTURE_COORD_ARRAY);
 	glEnableClientState(GL_NORMAL_ARRAY);
 	glEnableClientState(GL_VERTEX_ARRAY);
 
-	// check for desired
-	if (frontFace != winding)
+	glGetIntegerv(GL_CULL_FACE_MODE, &cullFaceMode);
+	const bool cullBackFaces = glIsEnabled(GL_CULL_FACE) && cullFaceMode == GL_BACK;
+
+	if (instancingShader)
+	{
+		instancingShader->bind();
+		instancingShader->setUniformValue("Texture0", GLint(0));
+		instancingShader->setUniformValue("textured", GLint(textured));
+		drawInstanced(instancingShader, instances);
+		instancingShader->release();
+	}
+	else
+	{
+		for (it = instances.begin(); it != instances.end(); ++it)
+		{
+			glPushMatrix();
+			glMultMatrixf(it->data());
+			glScalef(1/128.f, 1/128.f, 1/128.f); // Scale from warzone to fit in our scene. possibly a FIXME
+			drawMeshes(shader, useBuffers, cullBackFaces, it->determinant3() < 0 ? flippedWinding(winding) : winding);
+			glPopMatrix();
+		}
+	}
+
+	if (useBuffers)
+	{
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+	}
+
+	// release shader data
+	if (shader)
 	{
-		glFrontFace(winding);
+		shader->disableAttributeArray(tangentAtributeName);
 	}
+	releaseShader(getActiveShader());
+	clearTextureUnits(getActiveShader());
+
+	// set it back
+	glFrontFace(frontFace);
+
+	glPopMatrix();
+	glPopClientAttrib();
+	glPopAttrib();
+}
+
+void QWZM::applyMaterial()
+{
+	glMaterialfv(GL_FRONT, GL_EMISSION, m_material.vals[WZM_MAT_EMISSIVE]);
+	glMaterialfv(GL_FRONT, GL_AMBIENT, m_material.vals[WZM_MAT_AMBIENT]);
+	glMaterialfv(GL_FRONT, GL_DIFFUSE, m_material.vals[WZM_MAT_DIFFUSE]);
+	glMaterialfv(GL_FRONT, GL_SPECULAR, m_material.vals[WZM_MAT_SPECULAR]);
+	glMaterialf(GL_FRONT, GL_SHININESS, m_material.shininess);
+}
+
+// The view as seen from the space the current modelview maps from
+static ViewCuller currentViewCuller(bool cullBackFaces)
+{
+	GLfloat modelView[16], projection[16];
+
+	glGetFloatv(GL_MODELVIEW_MATRIX, modelView);
+	glGetFloatv(GL_PROJECTION_MATRIX, projection);
+	return ViewCuller(modelView, projection, cullBackFaces);
+}
+
+/**
+  * Draws every mesh with the current modelview, which has to include the
+  * warzone scale. frontFace is the winding that faces the viewer there.
+  */
+void QWZM::drawMeshes(QGLShaderProgram* shader, bool useBuffers, bool cullBackFaces, GLint frontFace)
+{
+	// pending transforms are only previewed here, the vertex data stays untouched
+	const Matrix4 pending = pendingTransform();
+	const GLint pendingWinding = pending.determinant3() < 0 ? flippedWinding(frontFace) : frontFace;
 
 	if (m_active_mesh < 0)
 	{
-		glScalef(scale_all * scale_xyz[0], scale_all * scale_xyz[1], scale_all * scale_xyz[2]);
+		glMultMatrixf(pending.data());
+		glFrontFace(pendingWinding);
+	}
+	else
+	{
+		glFrontFace(frontFace);
+	}
+
+	// bounds are in mesh space, so test them against the view as seen from there,
+	// the active mesh has the pending transform on top and gets its own culler
+	ViewCuller modelCuller, activeCuller;
+
+	if (m_culling)
+	{
+		modelCuller = currentViewCuller(cullBackFaces);
 	}
 
 	for (int i = 0; i < (int)m_meshes.size(); ++i)
@@ -105,54 +287,171 @@ void QWZM::render()
 		if (m_active_mesh == i)
 		{
 			glPushMatrix();
-			glScalef(scale_all * scale_xyz[0], scale_all * scale_xyz[1], scale_all * scale_xyz[2]);
+			glMultMatrixf(pending.data());
+			glFrontFace(pendingWinding);
+
+			if (m_culling)
+			{
+				activeCuller = currentViewCuller(cullBackFaces);
+			}
 		}
 
-		glMaterialfv(GL_FRONT, GL_EMISSION, m_material.vals[WZM_MAT_EMISSIVE]);
-		glMaterialfv(GL_FRONT, GL_AMBIENT, m_material.vals[WZM_MAT_AMBIENT]);
-		glMaterialfv(GL_FRONT, GL_DIFFUSE, m_material.vals[WZM_MAT_DIFFUSE]);
-		glMaterialfv(GL_FRONT, GL_SPECULAR, m_material.vals[WZM_MAT_SPECULAR]);
-		glMaterialf(GL_FRONT, GL_SHININESS, m_material.shininess);
+		const ViewCuller& culler = m_active_mesh == i ? activeCuller : modelCuller;
+		const bool visible = !m_culling
+			|| culler.boxVisible(msh.m_mesh_aabb_min, msh.m_mesh_aabb_max);
 
-		CPP0X_FEATURED(static_assert(sizeof(WZMUV) == sizeof(GLfloat)*2, "WZMUV has become fat."));
-		glTexCoordPointer(2, GL_FLOAT, 0, &msh.m_textureArray[0]);
+		applyMaterial();
 
-		if (shader)
+		if (msh.m_indexArray.empty())
 		{
-			shader->setAttributeArray(tangentAtributeName, (GLfloat*)&msh.m_tangentArray[0], 4);
+			// nothing to draw
+		}
+		else if (!visible)
+		{
+			++m_cullStats.meshesCulled;
+			m_cullStats.trianglesCulled += msh.indices();
+		}
+		else if (useBuffers)
+		{
+			const GLMeshBuffers& buffers = m_gl_buffers[i];
+
+			glBindBuffer(GL_ARRAY_BUFFER, buffers.vertices);
+			glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, buffers.indices);
+
+			glTexCoordPointer(2, GL_FLOAT, vboStride, bufferOffset(vboUVOffset));
+
+			if (shader)
+			{
+				shader->setAttributeBuffer(tangentAtributeName, GL_FLOAT, vboTangentOffset, 4, vboStride);
+			}
+
+			glNormalPointer(GL_FLOAT, vboStride, bufferOffset(vboNormalOffset));
+			glVertexPointer(3, GL_FLOAT, vboStride, bufferOffset(0));
+
+			drawGLBuffers(buffers, m_culling ? &culler : 0);
 		}
+		else
+		{
+			// streams carry the stride, so either mesh layout works here
+			const VertexStream<const WZMUV> uvs = msh.uvs();
+			const VertexStream<const WZMVertex4> tangents = msh.tangents();
+			const VertexStream<const WZMVertex> normals = msh.normals();
+			const VertexStream<const WZMVertex> positions = msh.positions();
+
+			CPP0X_FEATURED(static_assert(sizeof(WZMUV) == sizeof(GLfloat)*2, "WZMUV has become fat."));
+			glTexCoordPointer(2, GL_FLOAT, uvs.stride(), uvs.data());
+
+			if (shader)
+			{
+				shader->setAttributeArray(tangentAtributeName, (const GLfloat*)tangents.data(), 4, tangents.stride());
+			}
 
-		glNormalPointer(GL_FLOAT, 0, &msh.m_normalArray[0]);
+			glNormalPointer(GL_FLOAT, normals.stride(), normals.data());
 
-		CPP0X_FEATURED(static_assert(sizeof(WZMVertex) == sizeof(GLfloat)*3, "WZMVertex has become fat."));
-		glVertexPointer(3, GL_FLOAT, 0, &msh.m_vertexArray[0]);
+			CPP0X_FEATURED(static_assert(sizeof(WZMVertex) == sizeof(GLfloat)*3, "WZMVertex has become fat."));
+			glVertexPointer(3, GL_FLOAT, positions.stride(), positions.data());
 
-		CPP0X_FEATURED(static_assert(sizeof(IndexedTri) == sizeof(GLushort)*3, "IndexedTri has become fat."));
-		glDrawElements(GL_TRIANGLES, msh.m_indexArray.size() * 3, GL_UNSIGNED_SHORT, &msh.m_indexArray[0]);
+			CPP0X_FEATURED(static_assert(sizeof(IndexedTri) == sizeof(GLuint)*3, "IndexedTri has become fat."));
+			glDrawElements(GL_TRIANGLES, msh.m_indexArray.size() * 3, GL_UNSIGNED_INT, &msh.m_indexArray[0]);
+
+			++m_cullStats.meshesDrawn;
+			m_cullStats.trianglesDrawn += msh.indices();
+		}
 
 		if (m_active_mesh == i)
 		{
 			glPopMatrix();
+			glFrontFace(frontFace);
 		}
 	}
+}
 
-	// release shader data
-	if (shader)
-	{
-		shader->disableAttributeArray(tangentAtributeName);
-	}
-	releaseShader(getActiveShader());
-	clearTextureUnits(getActiveShader());
+/**
+  * Draws the copies with glDrawElementsInstancedARB, instancingBatch at a
+  * time. The modelview stays at the camera, each instance matrix carries
+  * the copy's placement, the warzone scale and the pending transform.
+  * Culling is per copy and mesh here, meshlets are drawn whole.
+  */
+void QWZM::drawInstanced(QGLShaderProgram* shader, const std::vector<Matrix4>& instances)
+{
+	GLfloat view[16], projection[16];
+	std::vector<GLfloat> batch[2];	// copies drawn as they are, mirrored copies
+	std::vector<Matrix4>::const_iterator it;
+	GLsizei first, count;
+	int side;
 
-	// set it back
-	if (frontFace != winding)
+	glGetFloatv(GL_MODELVIEW_MATRIX, view);
+	glGetFloatv(GL_PROJECTION_MATRIX, projection);
+
+	const Matrix4 camera(view);
+	const Matrix4 pending = pendingTransform();
+	const Matrix4 toScene = Matrix4::scale(1/128.f, 1/128.f, 1/128.f);
+	const GLint location = shader->uniformLocation("instances");
+
+	for (int i = 0; i < (int)m_meshes.size(); ++i)
 	{
-		glFrontFace(frontFace);
-	}
+		const Mesh& msh = m_meshes.at(i);
+		const GLMeshBuffers& buffers = m_gl_buffers[i];
 
-	glPopMatrix();
-	glPopClientAttrib();
-	glPopAttrib();
+		if (msh.m_indexArray.empty())
+		{
+			continue;
+		}
+
+		const Matrix4 local = (m_active_mesh < 0 || m_active_mesh == i) ? toScene * pending : toScene;
+
+		batch[0].clear();
+		batch[1].clear();
+		for (it = instances.begin(); it != instances.end(); ++it)
+		{
+			const Matrix4 model = *it * local;
+
+			if (m_culling)
+			{
+				const ViewCuller culler((camera * model).data(), projection, false);
+
+				if (!culler.boxVisible(msh.m_mesh_aabb_min, msh.m_mesh_aabb_max))
+				{
+					++m_cullStats.meshesCulled;
+					m_cullStats.trianglesCulled += msh.indices();
+					continue;
+				}
+			}
+			++m_cullStats.meshesDrawn;
+			m_cullStats.trianglesDrawn += msh.indices();
+
+			side = model.determinant3() < 0;
+			batch[side].insert(batch[side].end(), model.data(), model.data() + 16);
+		}
+
+		if (batch[0].empty() && batch[1].empty())
+		{
+			continue;
+		}
+
+		applyMaterial();
+
+		glBindBuffer(GL_ARRAY_BUFFER, buffers.vertices);
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, buffers.indices);
+		glTexCoordPointer(2, GL_FLOAT, vboStride, bufferOffset(vboUVOffset));
+		glNormalPointer(GL_FLOAT, vboStride, bufferOffset(vboNormalOffset));
+		glVertexPointer(3, GL_FLOAT, vboStride, bufferOffset(0));
+
+		for (side = 0; side < 2; ++side)
+		{
+			glFrontFace(side ? flippedWinding(winding) : winding);
+
+			count = batch[side].size() / 16;
+			for (first = 0; first < count; first += instancingBatch)
+			{
+				const GLsizei copies = std::min(count - first, instancingBatch);
+
+				glUniformMatrix4fv(location, copies, GL_FALSE, &batch[side][first * 16]);
+				glDrawElementsInstancedARB(GL_TRIANGLES, buffers.indexCount, buffers.indexType,
+							   bufferOffset(0), copies);
+			}
+		}
+	}
 }
 
 void QWZM::drawCenterPoint()
@@ -168,11 +467,13 @@ void QWZM::drawCenterPoint()
 		center = m_meshes.at(m_active_mesh).getCenterPoint();
 	}
 
+	center = pendingTransform().transformPoint(center);
+
 	const float lineLength = 40.0;
 	GLfloat x, y, z;
-	x = center.x() * scale_all * scale_xyz[0];
-	y = center.y() * scale_all * scale_xyz[1];
-	z = center.z() * scale_all * scale_xyz[2];
+	x = center.x();
+	y = center.y();
+	z = center.z();
 
 	GLboolean lighting;
 	glGetBooleanv(GL_LIGHTING, &lighting);
@@ -215,15 +516,17 @@ void QWZM::drawNormals()
 	for (int i = 0; i < (int)m_meshes.size(); ++i)
 	{
 		const Mesh& msh = m_meshes.at(i);
+		const VertexStream<const WZMVertex> positions = msh.positions();
+		const VertexStream<const WZMVertex> normals = msh.normals();
 		WZMVertex nrm;
 
-		for (int j = 0; j < (int)msh.m_vertexArray.size(); ++j)
+		for (int j = 0; j < (int)positions.size(); ++j)
 		{
-			nrm = msh.m_normalArray[j];// / 0.5; // FIXME: multiplier
-			qglviewer::Vec from(msh.m_vertexArray[j].x(), msh.m_vertexArray[j].y(), msh.m_vertexArray[j].z());
-			qglviewer::Vec to(msh.m_vertexArray[j].x() + nrm.x(),
-					     msh.m_vertexArray[j].y() + nrm.y(),
-					     msh.m_vertexArray[j].z() + nrm.z());
+			nrm = normals[j];// / 0.5; // FIXME: multiplier
+			qglviewer::Vec from(positions[j].x(), positions[j].y(), positions[j].z());
+			qglviewer::Vec to(positions[j].x() + nrm.x(),
+					     positions[j].y() + nrm.y(),
+					     positions[j].z() + nrm.z());
 			QGLViewer::drawArrow(from, to);
 		}
 	}
@@ -233,6 +536,196 @@ void QWZM::drawNormals()
 		glEnable(GL_LIGHTING);
 }
 
+void QWZM::invalidateGLBuffers(int mesh)
+{
+	if (mesh < 0)
+	{
+		std::vector<GLMeshBuffers>::iterator it;
+		for (it = m_gl_buffers.begin(); it != m_gl_buffers.end(); ++it)
+		{
+			it->dirty = true;
+		}
+	}
+	else if (mesh < (int)m_gl_buffers.size())
+	{
+		m_gl_buffers[mesh].dirty = true;
+	}
+}
+
+/**
+  * Brings the mesh buffers up to date, has to be called with a current context.
+  *
+  * @return	false if rendering has to use client side arrays
+  */
+bool QWZM::prepareGLBuffers()
+{
+	const QGLContext* context = QGLContext::currentContext();
+	GLMeshBuffers empty = {0, 0, 0, GL_UNSIGNED_SHORT, true};
+	unsigned i;
+
+	if (!GLEE_VERSION_1_5 || !context)
+	{
+		return false;
+	}
+
+	if (m_gl_buffers_context && m_gl_buffers_context != context)
+	{
+		// another viewport, share or leave the buffers where they are
+		if (!QGLContext::areSharing(m_gl_buffers_context, context))
+		{
+			return false;
+		}
+	}
+	m_gl_buffers_context = context;
+
+	// drop buffers of removed meshes
+	for (i = m_meshes.size(); i < m_gl_buffers.size(); ++i)
+	{
+		deleteGLBuffers(m_gl_buffers[i]);
+	}
+	m_gl_buffers.resize(m_meshes.size(), empty);
+
+	for (i = 0; i < m_meshes.size(); ++i)
+	{
+		if (m_gl_buffers[i].dirty)
+		{
+			uploadGLBuffers(m_meshes[i], m_gl_buffers[i]);
+		}
+	}
+
+	return true;
+}
+
+void QWZM::uploadGLBuffers(Mesh& msh, GLMeshBuffers& buffers)
+{
+	// keep the mesh interleaved from now on, then it's a single block copy
+	msh.setLayout(WZM_MESH_LAYOUT_INTERLEAVED);
+
+	const WZMInterleavedArray& interleaved = msh.m_interleavedArray;
+
+	if (!buffers.vertices)
+	{
+		glGenBuffers(1, &buffers.vertices);
+	}
+	if (!buffers.indices)
+	{
+		glGenBuffers(1, &buffers.indices);
+	}
+
+	glBindBuffer(GL_ARRAY_BUFFER, buffers.vertices);
+	glBufferData(GL_ARRAY_BUFFER, interleaved.size() * sizeof(WZMInterleavedVertex),
+		     interleaved.empty() ? 0 : &interleaved[0], GL_STATIC_DRAW);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+	/*
+	 * Clusters are runs of the index array, so the IBO keeps the vertex cache
+	 * and overdraw order the mesh got optimized to and the visible clusters are
+	 * still ranges of it. That's one cheap pass, so it's done whether culling
+	 * is on or not, scenes switch it per draw.
+	 */
+	MeshletSet clusters;
+
+	msh.buildMeshlets(clusters, true);
+	buffers.meshlets.swap(clusters.meshlets);
+
+	const std::vector<IndexedTri>& tris = msh.m_indexArray.get();
+
+	// keep 16 bit indices on the GPU unless the mesh needs wider ones
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, buffers.indices);
+	if (msh.indexSize() == sizeof(GLushort))
+	{
+		uploadIndices<GLushort>(tris);
+		buffers.indexType = GL_UNSIGNED_SHORT;
+	}
+	else
+	{
+		uploadIndices<GLuint>(tris);
+		buffers.indexType = GL_UNSIGNED_INT;
+	}
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+
+	buffers.indexCount = msh.m_indexArray.size() * 3;
+	buffers.dirty = false;
+}
+
+void QWZM::deleteGLBuffers(GLMeshBuffers& buffers)
+{
+	if (buffers.vertices)
+	{
+		glDeleteBuffers(1, &buffers.vertices);
+	}
+	if (buffers.indices)
+	{
+		glDeleteBuffers(1, &buffers.indices);
+	}
+	buffers.vertices = buffers.indices = 0;
+	buffers.indexCount = 0;
+	buffers.meshlets.clear();
+	buffers.dirty = true;
+}
+
+/**
+  * Draws the bound buffers. With a culler the meshlets outside the view
+  * and the ones facing away from it if back faces get culled anyway are
+  * left out.
+  */
+void QWZM::drawGLBuffers(const GLMeshBuffers& buffers, const ViewCuller* culler)
+{
+	const GLsizeiptr indexSize = buffers.indexType == GL_UNSIGNED_SHORT ? sizeof(GLushort) : sizeof(GLuint);
+
+	++m_cullStats.meshesDrawn;
+
+	if (buffers.meshlets.empty())
+	{
+		glDrawElements(GL_TRIANGLES, buffers.indexCount, buffers.indexType, bufferOffset(0));
+		m_cullStats.trianglesDrawn += buffers.indexCount / 3;
+		return;
+	}
+
+	GLuint first = 0, count = 0;
+	size_t i;
+
+	// neighbouring visible meshlets are merged into one draw
+	for (i = 0; i < buffers.meshlets.size(); ++i)
+	{
+		const Meshlet& meshlet = buffers.meshlets[i];
+
+		if (culler && !culler->visible(meshlet))
+		{
+			++m_cullStats.clustersCulled;
+			m_cullStats.trianglesCulled += meshlet.triangleCount;
+			continue;
+		}
+		++m_cullStats.clustersDrawn;
+		m_cullStats.trianglesDrawn += meshlet.triangleCount;
+
+		if (m_drawClusters)
+		{
+			clusterColour(i);
+			glDrawElements(GL_TRIANGLES, meshlet.triangleCount * 3, buffers.indexType,
+				       bufferOffset(meshlet.triangleOffset * 3 * indexSize));
+		}
+		else if (count && first + count == meshlet.triangleOffset)
+		{
+			count += meshlet.triangleCount;
+		}
+		else
+		{
+			if (count)
+			{
+				glDrawElements(GL_TRIANGLES, count * 3, buffers.indexType, bufferOffset(first * 3 * indexSize));
+			}
+			first = meshlet.triangleOffset;
+			count = meshlet.triangleCount;
+		}
+	}
+
+	if (count)
+	{
+		glDrawElements(GL_TRIANGLES, count * 3, buffers.indexType, bufferOffset(first * 3 * indexSize));
+	}
+}
+
 void QWZM::animate()
 {
 
@@ -241,6 +734,7 @@ void QWZM::animate()
 void QWZM::clear()
 {
 	WZM::clear();
+	invalidateGLBuffers();
 
 	clearGLRenderTextures();
 
@@ -574,14 +1068,22 @@ void QWZM::setScaleZ(GLfloat z)
 	m_pending_changes = true;
 }
 
+void QWZM::addPendingTransform(const Matrix4& matrix)
+{
+	m_pending_transform = matrix * m_pending_transform;
+	m_pending_changes = true;
+}
+
 void QWZM::slotMirrorAxis(int axis)
 {
 	mirror(axis, m_active_mesh);
+	invalidateGLBuffers(m_active_mesh);
 }
 
 void QWZM::applyTransformations()
 {
-	scale(scale_all * scale_xyz[0], scale_all * scale_xyz[1], scale_all * scale_xyz[2], m_active_mesh);
+	transform(pendingTransform(), m_active_mesh);
+	invalidateGLBuffers(m_active_mesh);
 
 	// reset values
 	resetAllPendingChanges();
@@ -596,13 +1098,21 @@ void QWZM::applyPendingChangesToModel(WZM &model) const
 {
 	if (m_pending_changes)
 	{
-		model.scale(scale_all * scale_xyz[0], scale_all * scale_xyz[1], scale_all * scale_xyz[2], m_active_mesh);
+		model.transform(pendingTransform(), m_active_mesh);
 	}
 }
 
+Matrix4 QWZM::pendingTransform() const
+{
+	// the scale sliders come first, then whatever got composed on top
+	return m_pending_transform * Matrix4::scale(scale_all * scale_xyz[0], scale_all * scale_xyz[1],
+						    scale_all * scale_xyz[2]);
+}
+
 void QWZM::resetAllPendingChanges()
 {
 	scale_all = scale_xyz[0] = scale_xyz[1] = scale_xyz[2] = 1.;
+	m_pending_transform = Matrix4();
 	m_pending_changes = false;
 }
 
@@ -611,6 +1121,64 @@ void QWZM::setDrawNormalsFlag(bool draw)
 	m_drawNormals = draw;
 }
 
+void QWZM::setInstancing(bool enable)
+{
+	m_instancing = enable;
+}
+
+GLfloat QWZM::sceneRadius() const
+{
+	WZMVertex min, max;
+
+	if (!calculateBounds(min, max))
+	{
+		return 0.f;
+	}
+	return std::sqrt(WZMVertex(max - min).dotProduct(WZMVertex(max - min))) / 2.f / 128.f;
+}
+
+int QWZM::connectorCount() const
+{
+	int count = 0;
+
+	for (int i = 0; i < meshes(); ++i)
+	{
+		count += m_meshes.at(i).connectors();
+	}
+	return count;
+}
+
+bool QWZM::connectorPosition(int index, WZMVertex& pos) const
+{
+	if (index < 0)
+	{
+		return false;
+	}
+
+	for (int i = 0; i < meshes(); ++i)
+	{
+		const Mesh& msh = m_meshes.at(i);
+
+		if (index < msh.connectors())
+		{
+			pos = msh.getConnector(index).getPos();
+			// where the preview draws it, see drawMeshes()
+			if (m_active_mesh < 0 || m_active_mesh == i)
+			{
+				pos = pendingTransform().transformPoint(pos);
+			}
+			return true;
+		}
+		index -= msh.connectors();
+	}
+	return false;
+}
+
+void QWZM::setDrawClustersFlag(bool draw)
+{
+	m_drawClusters = draw;
+}
+
 void QWZM::setDrawCenterPointFlag(bool draw)
 {
 	m_drawCenterPoint = draw;
@@ -622,6 +1190,7 @@ void QWZM::operator=(const WZM& wzm)
 {
 	clear();
 	WZM::operator=(wzm);
+	invalidateGLBuffers();
 	meshCountChanged(meshes(), getMeshNames());
 }
 
@@ -634,11 +1203,40 @@ void QWZM::addMesh(const Mesh& mesh)
 void QWZM::rmMesh(int index)
 {
 	WZM::rmMesh(index);
+	invalidateGLBuffers();
 	meshCountChanged(meshes(), getMeshNames());
 }
 
+void QWZM::reverseWinding(int mesh)
+{
+	WZM::reverseWinding(mesh);
+	invalidateGLBuffers(mesh);
+}
+
+bool QWZM::optimizeForsyth(int mesh)
+{
+	const bool ok = WZM::optimizeForsyth(mesh);
+	invalidateGLBuffers(mesh);
+	return ok;
+}
+
+bool QWZM::optimizeOverdraw(float threshold, int mesh)
+{
+	const bool ok = WZM::optimizeOverdraw(threshold, mesh);
+	invalidateGLBuffers(mesh);
+	return ok;
+}
+
+bool QWZM::simplify(float ratio, float maxError, int mesh)
+{
+	const bool ok = WZM::simplify(ratio, maxError, mesh);
+	invalidateGLBuffers(mesh);
+	return ok;
+}
+
 bool QWZM::importFromOBJ(std::istream& in)
 {
+	invalidateGLBuffers();
 	if (WZM::importFromOBJ(in))
 	{
 		meshCountChanged(meshes(), getMeshNames());
@@ -670,11 +1268,24 @@ void QWZM::write(std::ostream& out) const
 		WZM res = *this;
 		applyPendingChangesToModel(res);
 		res.write(out);
+		return;
 	}
 
 	WZM::write(out);
 }
 
+bool QWZM::writeBinary(std::ostream& out) const
+{
+	if (m_pending_changes)
+	{
+		WZM res = *this;
+		applyPendingChangesToModel(res);
+		return res.writeBinary(out);
+	}
+
+	return WZM::writeBinary(out);
+}
+
 void QWZM::exportToOBJ(std::ostream& out) const
 {
 	if (m_pending_changes)
@@ -682,6 +1293,7 @@ void QWZM::exportToOBJ(std::ostream& out) const
 		WZM res = *this;
 		applyPendingChangesToModel(res);
 		res.exportToOBJ(out);
+		return;
 	}
 
 	WZM::exportToOBJ(out);
@@ -28,17 +28,24 @@
 #include "GLee.h"
 
 #include "WZM.hpp"
+#include "Matrix4.hpp"
+#include "Meshlet.hpp"
 #include "IAnimatable.hpp"
 #include "IGLTexturedRenderable.hpp"
 #include "IGLShaderRenderable.h"
+#include "IGLCullableRenderable.hpp"
 
 enum wz_shader_type_t {WZ_SHADER_NONE = 0, WZ_SHADER_PIE3, WZ_SHADER_PIE3_USER,
-		       WZ_SHADER__LAST, WZ_SHADER__FIRST = WZ_SHADER_NONE};
+		       WZ_SHADER__LAST, WZ_SHADER__FIRST = WZ_SHADER_NONE,
+		       // internal, not a renderer choice
+		       WZ_SHADER_INSTANCED = WZ_SHADER__LAST};
 
 class Pie3Model;
+class QGLContext;
+class QGLShaderProgram;
 
 class QWZM: public QObject, protected WZM, public IAnimatable,
-		public IGLTexturedRenderable, public IGLShaderRenderable
+		public IGLTexturedRenderable, public IGLShaderRenderable, public IGLCullableRenderable
 {
 	Q_OBJECT
 public:
@@ -72,6 +79,8 @@ public slots:
 	void setScaleX(GLfloat x);
 	void setScaleY(GLfloat y);
 	void setScaleZ(GLfloat z);
+	/// Composes matrix after the pending transform, applied with the rest by applyTransformations
+	void addPendingTransform(const Matrix4& matrix);
 	void slotMirrorAxis(int axis);
 
 	void setActiveMesh(int mesh = -1);
@@ -79,6 +88,8 @@ public slots:
 
 	void setDrawNormalsFlag(bool draw);
 	void setDrawCenterPointFlag(bool draw);
+	/// Tints every cluster of the meshes in its own colour
+	void setDrawClustersFlag(bool draw);
 
 public:
 	/// IAnimatable
@@ -88,6 +99,22 @@ public:
 	void render();
 	void setTextureManager(IGLTextureManager * manager);
 
+	/**
+	  * Draws the model once per transform (in scene units, applied before
+	  * the warzone scale), sharing one set of GPU buffers. With the fixed
+	  * pipeline renderer and ARB_draw_instanced the copies go out as
+	  * instanced draws, otherwise one after another.
+	  */
+	void renderInstances(const std::vector<Matrix4>& instances);
+	void setInstancing(bool enable);
+	bool instancing() const {return m_instancing;}
+	/// Radius of the model's bounding box in scene units, 0 if there's no geometry
+	GLfloat sceneRadius() const;
+	/// Connectors of all meshes, numbered in mesh order
+	int connectorCount() const;
+	/// Position of a connector in model units with the pending transform previewed, false if there's no such connector
+	bool connectorPosition(int index, WZMVertex& pos) const;
+
 	/// IGLShaderRenderable
 	bool initShader(int type);
 	bool bindShader(int type);
@@ -95,8 +122,10 @@ public:
 
 	/// WZM interface - mesh control border
 	virtual operator Pie3Model() const;
-	inline bool read(std::istream& in) {return WZM::read(in);}
+	inline bool read(std::istream& in) {invalidateGLBuffers(); return WZM::read(in);}
 	void write(std::ostream& out) const;
+	inline bool readBinary(const std::string& fileName) {invalidateGLBuffers(); return WZM::readBinary(fileName);}
+	bool writeBinary(std::ostream& out) const;
 
 	bool importFromOBJ(std::istream& in);
 	void exportToOBJ(std::ostream& out) const;
@@ -105,9 +134,13 @@ public:
 	inline std::string getTextureName(wzm_texture_type_t type) const {return WZM::getTextureName(type);}
 	inline void clearTextureNames() {WZM::clearTextureNames();}
 
-	inline void reverseWinding(int mesh = -1) {WZM::reverseWinding(mesh);}
+	void reverseWinding(int mesh = -1);
+	bool optimizeForsyth(int mesh = -1);
+	bool optimizeOverdraw(float threshold = 1.05f, int mesh = -1);
+	bool simplify(float ratio, float maxError = 1.f, int mesh = -1);
 
-	inline Mesh& getMesh(int index) {return WZM::getMesh(index);}
+	/// Geometry may be changed through the returned mesh, so its GL buffers are dropped
+	inline Mesh& getMesh(int index) {invalidateGLBuffers(index); return WZM::getMesh(index);}
 	void addMesh (const Mesh& mesh);
 	void rmMesh (int index);
 	inline int meshes() const {return WZM::meshes();}
@@ -122,11 +155,36 @@ private:
 	void clearTextureUnits(int type);
 
 	void applyPendingChangesToModel(WZM& model) const;
+	Matrix4 pendingTransform() const;
 	void resetAllPendingChanges();
 
+	// GPU copies of the mesh arrays, one interleaved VBO and one IBO per mesh
+	struct GLMeshBuffers
+	{
+		GLuint vertices, indices;
+		GLsizei indexCount;
+		GLenum indexType;
+		bool dirty;
+		// runs of the IBO, which is the mesh's index array as is, triangleOffset is into it
+		std::vector<Meshlet> meshlets;
+	};
+
+	void invalidateGLBuffers(int mesh = -1);
+	bool prepareGLBuffers();
+	void uploadGLBuffers(Mesh& msh, GLMeshBuffers& buffers);
+	void deleteGLBuffers(GLMeshBuffers& buffers);
+	void drawGLBuffers(const GLMeshBuffers& buffers, const ViewCuller* culler);
+	void drawMeshes(QGLShaderProgram* shader, bool useBuffers, bool cullBackFaces, GLint frontFace);
+	void drawInstanced(QGLShaderProgram* shader, const std::vector<Matrix4>& instances);
+	void applyMaterial();
+
+	std::vector<GLMeshBuffers> m_gl_buffers;
+	const QGLContext* m_gl_buffers_context;
+
 	std::map<wzm_texture_type_t, GLuint> m_gl_textures;
 
 	GLfloat scale_all, scale_xyz[3];
+	Matrix4 m_pending_transform;
 	static const GLint winding;
 
 	int m_active_mesh;
@@ -136,6 +194,8 @@ private:
 
 	bool m_drawNormals;
 	bool m_drawCenterPoint;
+	bool m_drawClusters;
+	bool m_instancing;
 };
 
 #endif // QWZM_HPP
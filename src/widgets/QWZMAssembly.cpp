@@ -0,0 +1,236 @@
+/*
+	Copyright 2010 Warzone 2100 Project
+
+	This file is part of WMIT.
+
+	WMIT is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	WMIT is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with WMIT.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include "QWZMAssembly.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+
+#include "QWZM.hpp"
+
+QWZMAssembly::QWZMAssembly():
+	m_batchesValid(false)
+{
+}
+
+void QWZMAssembly::setBase(QWZM* model)
+{
+	Part base;
+
+	clear();
+
+	base.model = model;
+	base.connector = -1;
+	m_parts.push_back(base);
+	m_hierarchy.addNode(-1);
+}
+
+int QWZMAssembly::attach(int parent, int connector, QWZM* model, const Matrix4& transform)
+{
+	Part part;
+
+	if (parent < 0 || parent >= (int)m_parts.size())
+	{
+		std::cerr << "QWZMAssembly::attach - No part " << parent << " to attach to\n";
+		return -1;
+	}
+
+	if (!m_parts[parent].model->connectorPosition(connector, part.mount))
+	{
+		std::cerr << "QWZMAssembly::attach - Part " << parent << " has no connector " << connector << "\n";
+		return -1;
+	}
+
+	part.model = model;
+	part.connector = connector;
+	part.transform = transform;
+	m_parts.push_back(part);
+	m_batchesValid = false;
+
+	return m_hierarchy.addNode(parent, mountTransform(part.mount, transform));
+}
+
+void QWZMAssembly::detach(int part)
+{
+	std::vector<int> remap;
+	size_t i;
+
+	// the base goes with clear()
+	if (part <= 0 || part >= (int)m_parts.size())
+	{
+		return;
+	}
+
+	m_hierarchy.removeSubtree(part, &remap);
+	for (i = part; i < remap.size(); ++i)
+	{
+		if (remap[i] >= 0)
+		{
+			m_parts[remap[i]] = m_parts[i];
+		}
+	}
+	m_parts.resize(m_hierarchy.size());
+	m_batchesValid = false;
+}
+
+void QWZMAssembly::detachAll()
+{
+	if (m_parts.size() > 1)
+	{
+		const Part base = m_parts.front();
+
+		setBase(base.model);
+		setTransform(0, base.transform);
+	}
+}
+
+void QWZMAssembly::clear()
+{
+	m_parts.clear();
+	m_hierarchy.clear();
+	m_batches.clear();
+	m_batchesValid = false;
+}
+
+size_t QWZMAssembly::parts() const
+{
+	return m_parts.size();
+}
+
+bool QWZMAssembly::empty() const
+{
+	return m_parts.empty();
+}
+
+QWZM* QWZMAssembly::model(int part) const
+{
+	return m_parts[part].model;
+}
+
+int QWZMAssembly::parent(int part) const
+{
+	return m_hierarchy.parent(part);
+}
+
+int QWZMAssembly::connector(int part) const
+{
+	return m_parts[part].connector;
+}
+
+const Matrix4& QWZMAssembly::transform(int part) const
+{
+	return m_parts[part].transform;
+}
+
+void QWZMAssembly::setTransform(int part, const Matrix4& transform)
+{
+	Part& p = m_parts[part];
+
+	p.transform = transform;
+	m_hierarchy.setLocal(part, part ? mountTransform(p.mount, transform) : transform);
+}
+
+GLfloat QWZMAssembly::radius()
+{
+	GLfloat radius = 0.f;
+	size_t i;
+
+	update();
+	for (i = 0; i < m_parts.size(); ++i)
+	{
+		const Matrix4& m = m_hierarchy.world(i);
+		const GLfloat distance = std::sqrt(m(0, 3) * m(0, 3) + m(1, 3) * m(1, 3) + m(2, 3) * m(2, 3));
+
+		radius = std::max(radius, distance + m_parts[i].model->sceneRadius());
+	}
+	return radius;
+}
+
+void QWZMAssembly::addToScene(QWZMScene& scene, const Matrix4& placement)
+{
+	size_t i;
+
+	update();
+	for (i = 0; i < m_parts.size(); ++i)
+	{
+		scene.addInstance(m_parts[i].model, placement * m_hierarchy.world(i));
+	}
+}
+
+void QWZMAssembly::setInstancing(bool enable)
+{
+	m_batches.setInstancing(enable);
+}
+
+bool QWZMAssembly::instancing() const
+{
+	return m_batches.instancing();
+}
+
+void QWZMAssembly::render()
+{
+	const size_t updated = update();
+
+	if (!m_batchesValid)
+	{
+		m_batches.clear();
+		addToScene(m_batches, Matrix4());
+		m_batchesValid = true;
+	}
+
+	m_batches.setCulling(m_culling);
+	m_batches.render();
+	m_cullStats = m_batches.cullStats();
+	m_cullStats.transformsUpdated = updated;
+}
+
+/**
+  * Warzone keeps connectors with z pointing down into the ground and y
+  * pointing backwards, the model itself is y up. The mount point is in
+  * model units, world transforms in scene units like QWZM::renderInstances
+  * takes them.
+  */
+Matrix4 QWZMAssembly::mountTransform(const WZMVertex& mount, const Matrix4& transform)
+{
+	return Matrix4::translation(mount.x() / 128.f, -mount.z() / 128.f, -mount.y() / 128.f) * transform;
+}
+
+size_t QWZMAssembly::update()
+{
+	WZMVertex pos;
+	size_t i, updated;
+
+	for (i = 1; i < m_parts.size(); ++i)
+	{
+		Part& part = m_parts[i];
+
+		if (m_parts[m_hierarchy.parent(i)].model->connectorPosition(part.connector, pos) && !(pos == part.mount))
+		{
+			part.mount = pos;
+			m_hierarchy.setLocal(i, mountTransform(part.mount, part.transform));
+		}
+	}
+
+	updated = m_hierarchy.update();
+	if (updated)
+	{
+		m_batchesValid = false;
+	}
+	return updated;
+}
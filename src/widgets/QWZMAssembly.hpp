@@ -0,0 +1,103 @@
+/*
+	Copyright 2010 Warzone 2100 Project
+
+	This file is part of WMIT.
+
+	WMIT is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	WMIT is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with WMIT.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef QWZMASSEMBLY_HPP
+#define QWZMASSEMBLY_HPP
+
+#include <vector>
+
+#include "Matrix4.hpp"
+#include "TransformHierarchy.hpp"
+#include "IGLCullableRenderable.hpp"
+#include "QWZMScene.hpp"
+#include "Mesh.hpp"
+
+class QWZM;
+
+/**
+  * Models mounted on each other's connectors, the way Warzone puts a droid
+  * together from its components. Part 0 is the base, every other part hangs
+  * off a connector of an earlier one.
+  *
+  * World transforms are cached in a TransformHierarchy, so a frame only
+  * recomputes the parts that moved (or whose mount point moved) and what's
+  * mounted on them. Parts of the same model are drawn as instances.
+  *
+  * Models aren't owned, see QWZMScene.
+  */
+class QWZMAssembly: public IGLCullableRenderable
+{
+public:
+	QWZMAssembly();
+	virtual ~QWZMAssembly() {}
+
+	/// Starts over with model as the base part
+	void setBase(QWZM* model);
+	/**
+	  * Mounts model at a connector of part parent. transform (in scene
+	  * units) is applied on top of the mount point, e.g. to turn a turret.
+	  *
+	  * @return	the new part's index, -1 if parent or its connector don't exist
+	  */
+	int attach(int parent, int connector, QWZM* model, const Matrix4& transform = Matrix4());
+	/// Removes part and everything mounted on it, the parts after it move down
+	void detach(int part);
+	/// Removes everything but the base
+	void detachAll();
+	void clear();
+
+	size_t parts() const;
+	bool empty() const;
+	QWZM* model(int part) const;
+	int parent(int part) const;
+	int connector(int part) const;
+
+	const Matrix4& transform(int part) const;
+	void setTransform(int part, const Matrix4& transform);
+
+	/// Radius around the origin holding every part
+	GLfloat radius();
+	/// Adds every part to scene, with the whole assembly placed by placement
+	void addToScene(QWZMScene& scene, const Matrix4& placement);
+
+	void setInstancing(bool enable);
+	bool instancing() const;
+
+	/// IGLRenderable
+	void render();
+
+private:
+	struct Part
+	{
+		QWZM* model;
+		int connector;
+		WZMVertex mount;	// connector position in the parent's model units
+		Matrix4 transform;
+	};
+
+	static Matrix4 mountTransform(const WZMVertex& mount, const Matrix4& transform);
+	/// Picks up connectors moved by model edits, then brings world transforms up to date
+	size_t update();
+
+	std::vector<Part> m_parts;
+	TransformHierarchy m_hierarchy;
+	QWZMScene m_batches;	// parts grouped by model, rebuilt when a world transform changed
+	bool m_batchesValid;
+};
+
+#endif // QWZMASSEMBLY_HPP
@@ -0,0 +1,141 @@
+/*
+	Copyright 2010 Warzone 2100 Project
+
+	This file is part of WMIT.
+
+	WMIT is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	WMIT is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with WMIT.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include "QWZMScene.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+#include "QWZM.hpp"
+
+QWZMScene::QWZMScene():
+	m_instancing(true)
+{
+}
+
+void QWZMScene::addInstance(QWZM* model, const Matrix4& transform)
+{
+	ModelList::iterator it;
+
+	for (it = m_models.begin(); it != m_models.end(); ++it)
+	{
+		if (it->first == model)
+		{
+			it->second.push_back(transform);
+			return;
+		}
+	}
+
+	m_models.push_back(std::make_pair(model, std::vector<Matrix4>(1, transform)));
+}
+
+void QWZMScene::addGrid(QWZM* model, unsigned count, GLfloat spacing)
+{
+	const std::vector<Matrix4> placements = gridPlacements(count, spacing);
+	std::vector<Matrix4>::const_iterator it;
+
+	for (it = placements.begin(); it != placements.end(); ++it)
+	{
+		addInstance(model, *it);
+	}
+}
+
+std::vector<Matrix4> QWZMScene::gridPlacements(unsigned count, GLfloat spacing)
+{
+	const unsigned side = static_cast<unsigned>(std::ceil(std::sqrt(static_cast<double>(count))));
+	const GLfloat offset = (side - 1) * spacing / 2.f;
+	std::vector<Matrix4> placements;
+	unsigned i;
+
+	placements.reserve(count);
+	for (i = 0; i < count; ++i)
+	{
+		placements.push_back(Matrix4::translation((i % side) * spacing - offset, 0.f, (i / side) * spacing - offset));
+	}
+	return placements;
+}
+
+void QWZMScene::clear()
+{
+	m_models.clear();
+}
+
+bool QWZMScene::empty() const
+{
+	return m_models.empty();
+}
+
+size_t QWZMScene::instances() const
+{
+	ModelList::const_iterator it;
+	size_t count = 0;
+
+	for (it = m_models.begin(); it != m_models.end(); ++it)
+	{
+		count += it->second.size();
+	}
+	return count;
+}
+
+GLfloat QWZMScene::radius() const
+{
+	ModelList::const_iterator it;
+	std::vector<Matrix4>::const_iterator itI;
+	GLfloat radius = 0.f;
+
+	for (it = m_models.begin(); it != m_models.end(); ++it)
+	{
+		const GLfloat modelRadius = it->first->sceneRadius();
+
+		for (itI = it->second.begin(); itI != it->second.end(); ++itI)
+		{
+			const Matrix4& m = *itI;
+			const GLfloat distance = std::sqrt(m(0, 3) * m(0, 3) + m(1, 3) * m(1, 3) + m(2, 3) * m(2, 3));
+
+			radius = std::max(radius, distance + modelRadius);
+		}
+	}
+	return radius;
+}
+
+void QWZMScene::setInstancing(bool enable)
+{
+	m_instancing = enable;
+}
+
+void QWZMScene::render()
+{
+	ModelList::iterator it;
+
+	m_cullStats = CullStats();
+
+	// models may be shown on their own too, so their settings only change for the draw
+	for (it = m_models.begin(); it != m_models.end(); ++it)
+	{
+		QWZM* model = it->first;
+		const bool culling = model->culling(), instancing = model->instancing();
+
+		model->setCulling(m_culling);
+		model->setInstancing(m_instancing);
+		model->renderInstances(it->second);
+		m_cullStats += model->cullStats();
+
+		model->setCulling(culling);
+		model->setInstancing(instancing);
+	}
+}
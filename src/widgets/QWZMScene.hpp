@@ -0,0 +1,70 @@
+/*
+	Copyright 2010 Warzone 2100 Project
+
+	This file is part of WMIT.
+
+	WMIT is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	WMIT is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with WMIT.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef QWZMSCENE_HPP
+#define QWZMSCENE_HPP
+
+#include <vector>
+#include <utility>
+
+#include "Matrix4.hpp"
+#include "IGLCullableRenderable.hpp"
+
+class QWZM;
+
+/**
+  * Many placed copies of one or more models. Copies of the same model
+  * share its GPU buffers and get drawn with QWZM::renderInstances, so
+  * repeated models go out as instanced draws where possible.
+  *
+  * Models aren't owned, they have to outlive the scene and be set up
+  * (textures, shaders) by whoever owns them.
+  */
+class QWZMScene: public IGLCullableRenderable
+{
+public:
+	QWZMScene();
+	virtual ~QWZMScene() {}
+
+	/// Places a copy of model, transform is in scene units
+	void addInstance(QWZM* model, const Matrix4& transform);
+	/// count copies of model on a square grid, see gridPlacements()
+	void addGrid(QWZM* model, unsigned count, GLfloat spacing);
+	/// count translations on a square grid in the XZ plane, centred on the origin
+	static std::vector<Matrix4> gridPlacements(unsigned count, GLfloat spacing);
+	void clear();
+
+	bool empty() const;
+	size_t instances() const;
+	/// Radius around the origin holding every copy, scaling transforms aside
+	GLfloat radius() const;
+
+	void setInstancing(bool enable);
+	bool instancing() const {return m_instancing;}
+
+	/// IGLRenderable
+	void render();
+
+private:
+	typedef std::vector<std::pair<QWZM*, std::vector<Matrix4> > > ModelList;
+
+	ModelList m_models;
+	bool m_instancing;
+};
+
+#endif // QWZMSCENE_HPP
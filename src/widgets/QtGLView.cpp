@@ -35,6 +35,7 @@
 
 #include "IGLTexturedRenderable.hpp"
 #include "IGLShaderRenderable.h"
+#include "IGLCullableRenderable.hpp"
 
 enum LIGHTING_TYPE {
 	LIGHT_EMISSIVE, LIGHT_AMBIENT, LIGHT_DIFFUSE, LIGHT_SPECULAR, LIGHT_TYPE_MAX
@@ -48,7 +49,9 @@ static GLfloat lightCol0[LIGHT_TYPE_MAX][4] = {
 
 QtGLView::QtGLView(QWidget *parent) :
 		QGLViewer(parent),
-		drawLightSource(true)
+		drawLightSource(true),
+		culling(true),
+		drawFrameStats(false)
 {
 	setStateFileName(QString::null);
 	connect(&textureUpdater, SIGNAL(fileChanged(QString)), this, SLOT(textureChanged(QString)));
@@ -108,9 +111,15 @@ void QtGLView::draw()
 {
 	glLightfv(GL_LIGHT0, GL_POSITION, lightPos0);
 
+	m_frameStats = CullStats();
+
 	foreach(IGLRenderable* obj, renderList)
 	{
 		obj->render();
+
+		IGLCullableRenderable* obj_cr = dynamic_cast<IGLCullableRenderable*>(obj);
+		if (obj_cr)
+			m_frameStats += obj_cr->cullStats();
 	}
 }
 
@@ -130,6 +139,18 @@ void QtGLView::postDraw()
 		drawLight(GL_LIGHT0);
 	}
 
+	if (drawFrameStats)
+	{
+		glColor3f(1.f, 1.f, 1.f);
+		drawText(10, height() - 50, tr("Transforms: %1 recomputed").arg(m_frameStats.transformsUpdated));
+		drawText(10, height() - 30, tr("Meshes: %1 drawn, %2 culled").arg(m_frameStats.meshesDrawn)
+			 .arg(m_frameStats.meshesCulled));
+		drawText(10, height() - 10, tr("Triangles: %1 drawn, %2 culled (clusters: %3 drawn, %4 culled)")
+			 .arg(m_frameStats.trianglesDrawn).arg(m_frameStats.trianglesCulled)
+			 .arg(m_frameStats.clustersDrawn).arg(m_frameStats.clustersCulled));
+		glColor3f(lightCol0[LIGHT_DIFFUSE][0], lightCol0[LIGHT_DIFFUSE][1], lightCol0[LIGHT_DIFFUSE][2]);
+	}
+
 	/* Grid begin - Copied from QGLViewer source then modified */
 	if (gridIsDrawn())
 	{
@@ -243,6 +264,11 @@ void QtGLView::dynamicManagedSetup(IGLRenderable *object, bool remove)
 	IGLShaderRenderable* obj_sr = dynamic_cast<IGLShaderRenderable*>(object);
 	if (obj_sr)
 		obj_sr->setShaderManager(remove ? NULL : this);
+
+	// culling is a view setting
+	IGLCullableRenderable* obj_cr = dynamic_cast<IGLCullableRenderable*>(object);
+	if (obj_cr && !remove)
+		obj_cr->setCulling(culling);
 }
 
 void QtGLView::addToRenderList(IGLRenderable* object)
@@ -494,3 +520,24 @@ void QtGLView::setDrawLightSource(bool draw)
 
 	repaint();
 }
+
+void QtGLView::setCulling(bool enable)
+{
+	culling = enable;
+
+	foreach(IGLRenderable* obj, renderList)
+	{
+		IGLCullableRenderable* obj_cr = dynamic_cast<IGLCullableRenderable*>(obj);
+		if (obj_cr)
+			obj_cr->setCulling(enable);
+	}
+
+	repaint();
+}
+
+void QtGLView::setDrawFrameStats(bool draw)
+{
+	drawFrameStats = draw;
+
+	repaint();
+}
@@ -33,6 +33,7 @@
 #include "GLTexture.hpp"
 #include "IGLTextureManager.hpp"
 #include "IGLShaderManager.h"
+#include "ViewCuller.hpp"
 
 class IGLRenderable;
 class ITexturedRenderable;
@@ -65,8 +66,13 @@ public:
 	virtual bool loadShader(int type, const QString& fileNameVert, const QString& fileNameFrag);
 	virtual void unloadShader(int type);
 
+	/// Summed over every cullable renderable in the last frame
+	const CullStats& frameStats() const {return m_frameStats;}
+
 public slots:
 	void setDrawLightSource(bool draw);
+	void setCulling(bool enable);
+	void setDrawFrameStats(bool draw);
 
 signals:
 	void viewerInitialized();
@@ -100,6 +106,9 @@ private:
 	QFileSystemWatcher textureUpdater;
 	QBasicTimer updateTimer;
 	bool drawLightSource;
+	bool culling;
+	bool drawFrameStats;
+	CullStats m_frameStats;
 
 	void dynamicManagedSetup(IGLRenderable* object, bool remove = false);
 
@@ -15,6 +15,9 @@
 #define WMIT_SHADER_PIE3_USERFILE_VERT "pie3.vert"
 #define WMIT_SHADER_PIE3_USERFILE_FRAG "pie3.frag"
 
+#define WMIT_SHADER_INSTANCED_DEFPATH_VERT ":/data/shaders/instanced.vert"
+#define WMIT_SHADER_INSTANCED_DEFPATH_FRAG ":/data/shaders/instanced.frag"
+
 #define WMIT_IMAGES_NOTEXTURE ":/data/images/notex.png"
 
-enum wmit_filetype_t { WMIT_FT_PIE = 0, WMIT_FT_WZM, WMIT_FT_OBJ};
+enum wmit_filetype_t { WMIT_FT_PIE = 0, WMIT_FT_WZM, WMIT_FT_OBJ, WMIT_FT_WZMB};
@@ -3,6 +3,13 @@ TEMPLATE = app
 
 QT += opengl xml
 
+# C++0x enables the threaded TaskPool and static checks
+*-g++*|*-clang* {
+    QMAKE_CXXFLAGS += -std=c++0x
+    DEFINES += CPP0X_AVAILABLE
+    unix:LIBS += -lpthread
+}
+
 INCLUDEPATH += src src/basic src/formats src/ui src/widgets 3rdparty/GLee
 
 HEADERS += \
@@ -10,6 +17,8 @@ HEADERS += \
     src/formats/Pie.hpp \
     src/formats/OBJ.hpp \
     src/formats/Mesh.hpp \
+    src/formats/WZMBinary.hpp \
+    src/formats/ModelIO.hpp \
     src/ui/UVEditor.hpp \
     src/ui/TransformDock.hpp \
     src/ui/TeamColoursDock.hpp \
@@ -17,21 +26,44 @@ HEADERS += \
     src/ui/ImportDialog.hpp \
     src/ui/ExportDialog.hpp \
     src/Util.hpp \
+    src/QtUtil.hpp \
+    src/ModelLoader.hpp \
     src/Generic.hpp \
+    src/basic/GLTypes.hpp \
     src/basic/VectorTypes.hpp \
     src/basic/Vector.hpp \
     src/basic/Polygon.hpp \
+    src/basic/SpatialHash.hpp \
+    src/basic/VertexStream.hpp \
+    src/basic/AlignedAllocator.hpp \
+    src/basic/CowArray.hpp \
+    src/basic/VertexKernels.hpp \
+    src/basic/VertexCache.hpp \
+    src/basic/Overdraw.hpp \
+    src/basic/Simplify.hpp \
+    src/basic/Meshlet.hpp \
+    src/basic/ViewCuller.hpp \
+    src/basic/Matrix4.hpp \
+    src/basic/TransformHierarchy.hpp \
+    src/basic/MappedFile.hpp \
+    src/basic/TextLexer.hpp \
+    src/basic/TaskPool.hpp \
+    src/basic/LoadProgress.hpp \
+    src/BatchConvert.hpp \
     src/basic/IGLTextureManager.hpp \
     src/basic/IGLRenderable.hpp \
     src/basic/IAnimatable.hpp \
     src/basic/GLTexture.hpp \
     3rdparty/GLee/GLee.h \
     src/widgets/QWZM.hpp \
+    src/widgets/QWZMScene.hpp \
+    src/widgets/QWZMAssembly.hpp \
     src/widgets/QtGLView.hpp \
     src/wmit.h \
     src/basic/IGLTexturedRenderable.hpp \
     src/basic/IGLShaderManager.h \
     src/basic/IGLShaderRenderable.h \
+    src/basic/IGLCullableRenderable.hpp \
     src/ui/TextureDialog.h \
     src/ui/TexConfigDialog.hpp
     
@@ -40,6 +72,8 @@ SOURCES += \
     src/formats/Pie_t.cpp \
     src/formats/Pie.cpp \
     src/formats/Mesh.cpp \
+    src/formats/WZMBinary.cpp \
+    src/formats/ModelIO.cpp \
     src/ui/UVEditor.cpp \
     src/ui/TransformDock.cpp \
     src/ui/TeamColoursDock.cpp \
@@ -47,12 +81,29 @@ SOURCES += \
     src/ui/ImportDialog.cpp \
     src/ui/ExportDialog.cpp \
     src/Util.cpp \
+    src/QtUtil.cpp \
+    src/ModelLoader.cpp \
     src/main.cpp \
     src/Generic.cpp \
     src/basic/Polygon_t.cpp \
     src/basic/GLTexture.cpp \
+    src/basic/MappedFile.cpp \
+    src/basic/TextLexer.cpp \
+    src/basic/TaskPool.cpp \
+    src/basic/VertexKernels.cpp \
+    src/basic/VertexCache.cpp \
+    src/basic/Overdraw.cpp \
+    src/basic/Simplify.cpp \
+    src/basic/Meshlet.cpp \
+    src/basic/ViewCuller.cpp \
+    src/basic/Matrix4.cpp \
+    src/basic/TransformHierarchy.cpp \
+    src/basic/LoadProgress.cpp \
+    src/BatchConvert.cpp \
     3rdparty/GLee/GLee.c \
     src/widgets/QWZM.cpp \
+    src/widgets/QWZMScene.cpp \
+    src/widgets/QWZMAssembly.cpp \
     src/widgets/QtGLView.cpp \
     src/ui/TextureDialog.cpp \
     src/ui/TexConfigDialog.cpp
@@ -73,7 +124,9 @@ OTHER_FILES += \
     HACKING.txt \
     COPYING.nongpl \
     data/shaders/pie3.vert \
-    data/shaders/pie3.frag
+    data/shaders/pie3.frag \
+    data/shaders/instanced.vert \
+    data/shaders/instanced.frag
 
 
 CONFIG(debug, debug|release) {